@@ -0,0 +1,116 @@
+/**
+ * @file    access_tracker.hpp
+ * @brief   倒排桶访问频率统计
+ * @details 查询线程对探测到的桶做一次relaxed原子自增，开销可忽略；
+ *          分层存储等策略定期调用decay()，把新增计数折算进指数衰减的频率分数，
+ *          使分数跟随最近的查询分布而不是历史累计。折算与读取累计值之间由互斥锁保护，
+ *          查询线程的record不加锁
+ * @author  Tyooughtul
+ */
+
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+namespace minimilvus {
+
+/**
+ * @brief   每个桶的访问计数与衰减频率
+ */
+class ListAccessTracker {
+public:
+    explicit ListAccessTracker(int n_lists = 0) { reset(n_lists); }
+
+    /**
+     * @note    移动不能与其他操作并发（持有它的索引被移动时）
+     */
+    ListAccessTracker(ListAccessTracker&& other) noexcept
+        : n_lists_(std::exchange(other.n_lists_, 0)), pending_(std::move(other.pending_)),
+          totals_(std::move(other.totals_)), scores_(std::move(other.scores_)) {}
+
+    ListAccessTracker& operator=(ListAccessTracker&& other) noexcept {
+        if (this != &other) {
+            n_lists_ = std::exchange(other.n_lists_, 0);
+            pending_ = std::move(other.pending_);
+            totals_ = std::move(other.totals_);
+            scores_ = std::move(other.scores_);
+        }
+        return *this;
+    }
+
+    /**
+     * @brief   清空并按新的桶数量重建
+     * @note    不能与record并发调用
+     */
+    void reset(int n_lists) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        n_lists_ = n_lists;
+        pending_ = std::make_unique<std::atomic<uint64_t>[]>(n_lists);
+        totals_.assign(n_lists, 0);
+        scores_.assign(n_lists, 0.0);
+        for (int i = 0; i < n_lists; ++i) pending_[i].store(0, std::memory_order_relaxed);
+    }
+
+    int n_lists() const { return n_lists_; }
+
+    /**
+     * @brief   记录一次访问，可被多个查询线程并发调用
+     */
+    void record(int list) { pending_[list].fetch_add(1, std::memory_order_relaxed); }
+
+    /**
+     * @brief   累计访问次数（含尚未折算的部分）
+     * @note    可与decay并发：持锁读取，不会看到计数从pending移到totals的中间状态
+     */
+    uint64_t count(int list) const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return totals_[list] + pending_[list].load(std::memory_order_relaxed);
+    }
+
+    /**
+     * @brief   所有桶的累计访问次数（同一把锁下取的快照）
+     */
+    std::vector<uint64_t> counts() const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        std::vector<uint64_t> result(n_lists_);
+        for (int i = 0; i < n_lists_; ++i) result[i] = totals_[i] + pending_[i].load(std::memory_order_relaxed);
+        return result;
+    }
+
+    /**
+     * @brief   折算新增访问：score = score * factor + 新增次数
+     * @param   factor  衰减系数，0表示只看上一周期，越接近1历史权重越大
+     * @return  折算后的频率分数（副本）
+     * @throws  std::invalid_argument 当factor不在[0, 1)内时
+     * @note    可与record、count、scores并发
+     */
+    std::vector<double> decay(double factor) {
+        if (factor < 0.0 || factor >= 1.0) throw std::invalid_argument("Decay factor must be in [0, 1)");
+        std::lock_guard<std::mutex> lock(mutex_);
+        for (int i = 0; i < n_lists_; ++i) {
+            uint64_t recent = pending_[i].exchange(0, std::memory_order_relaxed);
+            totals_[i] += recent;
+            scores_[i] = scores_[i] * factor + static_cast<double>(recent);
+        }
+        return scores_;
+    }
+
+    std::vector<double> scores() const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return scores_;
+    }
+
+private:
+    int n_lists_ = 0;
+    std::unique_ptr<std::atomic<uint64_t>[]> pending_;  ///< 上次decay以来的访问次数
+    std::vector<uint64_t> totals_;                      ///< 已折算的累计次数
+    std::vector<double> scores_;                        ///< 指数衰减频率
+    mutable std::mutex mutex_;                          ///< 保护totals_、scores_
+};
+
+} // namespace minimilvus
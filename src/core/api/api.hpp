@@ -8,8 +8,11 @@
 
 #include <vector>
 #include <string>
-#include "../../third_party/json.hpp"
-#include "dataset.hpp"
+#include <optional>
+#include "../../../third_party/json.hpp"
+#include "../dataset.hpp"
+#include "../profiler.hpp"
+#include "../memory_stats.hpp"
 
 namespace minimilvus {
 
@@ -18,6 +21,8 @@ using json = nlohmann::json;
 struct SearchRequest {
     std::vector<float> vector;
     int top_k = 10;
+    bool profile = false;
+    std::string collection = "default";
 };
 
 struct SearchResultItem {
@@ -27,11 +32,95 @@ struct SearchResultItem {
 
 struct SearchResponse {
     std::vector<SearchResultItem> results;
+    std::optional<QueryProfile> profile;
 };
 
-NLOHMANN_DEFINE_TYPE_NON_INTRUSIVE(SearchRequest, vector, top_k)
+NLOHMANN_DEFINE_TYPE_NON_INTRUSIVE_WITH_DEFAULT(SearchRequest, vector, top_k, profile, collection)
 NLOHMANN_DEFINE_TYPE_NON_INTRUSIVE(SearchResultItem, id, distance)
-NLOHMANN_DEFINE_TYPE_NON_INTRUSIVE(SearchResponse, results)
+
+inline void to_json(json& j, const QueryProfile& p) {
+    json stages = json::object();
+    for (int s = 0; s < QueryProfile::kStageCount; ++s) {
+        auto stage = static_cast<ProfileStage>(s);
+        stages[profile_stage_name(stage)] = {
+            {"cycles", p.stage_cycles[s]},
+            {"us", p.stage_us(stage)}
+        };
+    }
+    j = json{
+        {"stages", stages},
+        {"total_us", p.total_us()},
+        {"centroids_scored", p.centroids_scored},
+        {"buckets_probed", p.buckets_probed},
+        {"vectors_scanned", p.vectors_scanned},
+        {"heap_pushes", p.heap_pushes},
+        {"graph_expanded", p.graph_expanded},
+        {"results_returned", p.results_returned}
+    };
+}
+
+inline void from_json(const json& j, QueryProfile& p) {
+    for (int s = 0; s < QueryProfile::kStageCount; ++s) {
+        const char* name = profile_stage_name(static_cast<ProfileStage>(s));
+        if (j.at("stages").contains(name)) {
+            p.stage_cycles[s] = j.at("stages").at(name).at("cycles").get<uint64_t>();
+        }
+    }
+    p.centroids_scored = j.value("centroids_scored", int64_t{0});
+    p.buckets_probed = j.value("buckets_probed", int64_t{0});
+    p.vectors_scanned = j.value("vectors_scanned", int64_t{0});
+    p.heap_pushes = j.value("heap_pushes", int64_t{0});
+    p.graph_expanded = j.value("graph_expanded", int64_t{0});
+    p.results_returned = j.value("results_returned", int64_t{0});
+}
+
+// profile只在请求开启剖析时出现在响应中
+inline void to_json(json& j, const SearchResponse& r) {
+    j = json{{"results", r.results}};
+    if (r.profile) j["profile"] = *r.profile;
+}
+
+inline void from_json(const json& j, SearchResponse& r) {
+    j.at("results").get_to(r.results);
+    if (j.contains("profile")) r.profile = j.at("profile").get<QueryProfile>();
+}
+
+inline void to_json(json& j, const MemoryUsage& u) {
+    j = json{
+        {"used_bytes", u.used_bytes},
+        {"allocated_bytes", u.allocated_bytes},
+        {"slack_bytes", u.slack_bytes()}
+    };
+}
+
+inline void to_json(json& j, const MemoryReport& r) {
+    j = json{{"components", r.components}, {"total", r.total()}};
+}
+
+/**
+ * @brief   将内存报告序列化为 JSON（供内存查询 API 使用）
+ */
+inline std::string serialize_memory_report(const MemoryReport& report) {
+    json j = report;
+    return j.dump();
+}
+
+/**
+ * @brief   将内存报告格式化为 Prometheus 文本格式（供 metrics 端点使用）
+ */
+inline std::string format_memory_metrics(const MemoryReport& report) {
+    std::string out = "# TYPE minimilvus_memory_used_bytes gauge\n";
+    for (const auto& [name, usage] : report.components) {
+        out += "minimilvus_memory_used_bytes{component=\"" + name + "\"} " +
+               std::to_string(usage.used_bytes) + "\n";
+    }
+    out += "# TYPE minimilvus_memory_allocated_bytes gauge\n";
+    for (const auto& [name, usage] : report.components) {
+        out += "minimilvus_memory_allocated_bytes{component=\"" + name + "\"} " +
+               std::to_string(usage.allocated_bytes) + "\n";
+    }
+    return out;
+}
 
 inline std::string serialize_search_request(const SearchRequest& request) {
     json j = request;
@@ -44,8 +133,17 @@ inline SearchRequest parse_search_request(const std::string& json_str) {
 }
 
 inline std::string serialize_search_response(const SearchResponse& response) {
-    json j = response;
-    return j.dump();
+    if (!response.profile) {
+        json j = response;
+        return j.dump();
+    }
+    // 开启剖析时，结果的序列化（含生成文本）计入serialization阶段；
+    // 剖析对象自身必须在计时结束后才能序列化，单独拼接
+    QueryProfile profile = *response.profile;
+    uint64_t start = read_tsc();
+    std::string results = json(response.results).dump();
+    profile.add(ProfileStage::Serialization, read_tsc() - start);
+    return "{\"results\":" + results + ",\"profile\":" + json(profile).dump() + "}";
 }
 
 inline SearchResponse parse_search_response(const std::string& json_str) {
@@ -0,0 +1,224 @@
+/**
+ * @file    async_shard_server.hpp
+ * @brief   基于协程的分片服务端
+ * @details 与ShardServer使用同一帧协议，但每个连接是事件循环上的一个协程：
+ *          读帧 -> （可选）转移到线程池搜索 -> 回到循环写响应，
+ *          等待网络时不占用线程，单个循环线程即可承载大量并发连接
+ * @author  Tyooughtul
+ */
+
+#pragma once
+#include <fcntl.h>
+#include <string>
+#include <vector>
+#include <unordered_set>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include "rpc.hpp"
+#include "event_loop.hpp"
+#include "task.hpp"
+#include "thread_pool.hpp"
+
+namespace minimilvus {
+
+/**
+ * @brief   协程分片服务端
+ * @details 同一连接上的请求按顺序处理，不同连接之间并发；
+ *          提供线程池时搜索在线程池中执行，否则直接在循环线程中执行。
+ *          有多个事件循环时，第一个循环负责accept，新连接轮转投递给各个循环
+ */
+class AsyncShardServer {
+public:
+    using SearchFn = ShardServer::SearchFn;
+
+    /**
+     * @brief   构造函数
+     * @param   loop        事件循环（需在其他线程中run）
+     * @param   search_fn   搜索函数
+     * @param   pool        执行搜索的线程池，可为空
+     */
+    AsyncShardServer(EventLoop& loop, SearchFn search_fn, ThreadPool* pool = nullptr)
+        : AsyncShardServer(std::vector<EventLoop*>{&loop}, std::move(search_fn), pool) {}
+
+    /**
+     * @brief   构造函数（多个事件循环）
+     * @param   loops       事件循环列表，loops[0]负责accept
+     * @param   search_fn   搜索函数
+     * @param   pool        执行搜索的线程池，可为空
+     * @throws  std::invalid_argument 当loops为空时
+     */
+    AsyncShardServer(std::vector<EventLoop*> loops, SearchFn search_fn, ThreadPool* pool = nullptr)
+        : loops_(std::move(loops)), search_fn_(std::move(search_fn)), pool_(pool) {
+        if (loops_.empty()) throw std::invalid_argument("AsyncShardServer requires an event loop");
+    }
+
+    ~AsyncShardServer() { stop(); }
+
+    AsyncShardServer(const AsyncShardServer&) = delete;
+    AsyncShardServer& operator=(const AsyncShardServer&) = delete;
+
+    /**
+     * @brief   在127.0.0.1上监听并开始服务
+     * @param   port    端口，0表示由系统分配
+     * @return  实际监听的端口
+     * @throws  std::runtime_error 当监听失败时
+     */
+    int start(int port = 0) {
+        listen_fd_ = ::socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+        int one = 1;
+        setsockopt(listen_fd_, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+        sockaddr_in addr{};
+        addr.sin_family = AF_INET;
+        addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        addr.sin_port = htons(static_cast<uint16_t>(port));
+        socklen_t addr_len = sizeof(addr);
+        if (::bind(listen_fd_, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0 ||
+            ::listen(listen_fd_, 1024) != 0 ||
+            ::getsockname(listen_fd_, reinterpret_cast<sockaddr*>(&addr), &addr_len) != 0) {
+            ::close(listen_fd_);
+            listen_fd_ = -1;
+            throw std::runtime_error("AsyncShardServer failed to listen");
+        }
+        running_ = true;
+        active_ = 1;
+        loops_[0]->post([this] { spawn(accept_loop()); });
+        return ntohs(addr.sin_port);
+    }
+
+    /**
+     * @brief   停止服务，关闭所有连接并等待其协程退出
+     * @note    不能在循环线程中调用；调用时事件循环必须仍在运行
+     */
+    void stop() {
+        if (!running_.exchange(false)) return;
+        std::unique_lock<std::mutex> lock(mutex_);
+        ::shutdown(listen_fd_, SHUT_RDWR);
+        for (int fd : client_fds_) ::shutdown(fd, SHUT_RDWR);
+        cv_.wait(lock, [this] { return active_ == 0; });
+        ::close(listen_fd_);
+        listen_fd_ = -1;
+    }
+
+    /**
+     * @brief   已处理的请求数
+     */
+    uint64_t requests_served() const { return requests_served_.load(); }
+
+private:
+    std::vector<EventLoop*> loops_;
+    size_t next_loop_ = 0;                  ///< 仅在accept协程中访问
+    SearchFn search_fn_;
+    ThreadPool* pool_;
+    int listen_fd_ = -1;
+    std::atomic<bool> running_{false};
+    std::atomic<uint64_t> requests_served_{0};
+    std::mutex mutex_;                      ///< 保护client_fds_和active_
+    std::condition_variable cv_;
+    std::unordered_set<int> client_fds_;
+    int active_ = 0;                        ///< 存活的协程数（接收协程 + 连接协程）
+
+    void finish_one() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (--active_ == 0) cv_.notify_all();
+    }
+
+    Task<void> accept_loop() {
+        while (running_) {
+            int fd = ::accept4(listen_fd_, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+            if (fd >= 0) {
+                int one = 1;
+                setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+                {
+                    std::lock_guard<std::mutex> lock(mutex_);
+                    client_fds_.insert(fd);
+                    active_++;
+                }
+                EventLoop* loop = loops_[next_loop_++ % loops_.size()];
+                if (loop == loops_[0]) {
+                    spawn(serve(fd, *loop));
+                } else {
+                    loop->post([this, fd, loop] { spawn(serve(fd, *loop)); });
+                }
+            } else if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                co_await loops_[0]->readable(listen_fd_);
+            } else if (errno != EINTR && errno != ECONNABORTED) {
+                break;
+            }
+        }
+        finish_one();
+    }
+
+    Task<void> serve(int fd, EventLoop& loop) {
+        std::string buffer;
+        size_t parsed = 0;
+        bool open = true;
+        while (open) {
+            // 处理缓冲区中所有完整的帧
+            while (open && buffer.size() - parsed >= 5) {
+                uint32_t len = 0;
+                std::memcpy(&len, buffer.data() + parsed, 4);
+                if (len == 0 || len > kMaxFrameSize) {
+                    open = false;
+                    break;
+                }
+                if (buffer.size() - parsed < 4 + static_cast<size_t>(len)) break;
+                auto type = static_cast<MessageType>(buffer[parsed + 4]);
+                std::string payload = buffer.substr(parsed + 5, len - 1);
+                parsed += 4 + len;
+                std::string response = co_await handle(loop, type, std::move(payload));
+                open = co_await async_send(loop, fd, response);
+            }
+            if (!open) break;
+            buffer.erase(0, parsed);
+            parsed = 0;
+
+            constexpr size_t kReadSize = 16 << 10;
+            size_t old_size = buffer.size();
+            buffer.resize(old_size + kReadSize);
+            ssize_t n = co_await async_recv(loop, fd, buffer.data() + old_size, kReadSize);
+            if (n <= 0) break;
+            buffer.resize(old_size + n);
+        }
+        // 先从集合移除再关闭，避免stop()对已复用的fd执行shutdown
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            client_fds_.erase(fd);
+            ::close(fd);
+        }
+        finish_one();
+    }
+
+    /**
+     * @brief   处理一个请求帧，返回编码好的响应帧
+     * @note    在循环线程中开始和结束；有线程池时中间的搜索在线程池中执行
+     */
+    Task<std::string> handle(EventLoop& loop, MessageType type, std::string payload) {
+        if (type != MessageType::SearchRequest) {
+            co_return encode_frame(MessageType::Error, "unsupported message type");
+        }
+        uint64_t request_id = 0;
+        int k = 0;
+        std::vector<float> query;
+        try {
+            decode_search_request(payload, request_id, k, query);
+        } catch (const std::exception& e) {
+            co_return encode_frame(MessageType::Error, e.what());
+        }
+
+        if (pool_) co_await resume_on(*pool_);
+        std::string frame;
+        try {
+            auto results = search_fn_(query, k);
+            frame = encode_frame(MessageType::SearchResponse, encode_search_response(request_id, results));
+        } catch (const std::exception& e) {
+            frame = encode_frame(MessageType::Error, e.what());
+        }
+        if (pool_) co_await loop.schedule();
+
+        requests_served_++;
+        co_return frame;
+    }
+};
+
+} // namespace minimilvus
@@ -0,0 +1,608 @@
+/**
+ * @file    codecs.hpp
+ * @brief   向量编码器
+ * @details 倒排桶中向量的存储格式：原始float、FP16半精度、SQ8标量量化和PQ乘积量化。
+ *          每个编码器提供按度量特化的Scanner，在查询开始时预处理查询向量
+ *          （SQ8的偏移、PQ的查找表），之后对每个编码只做一次内联的距离计算
+ * @author  Tyooughtul
+ */
+
+#pragma once
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <cmath>
+#include <istream>
+#include <limits>
+#include <ostream>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include <immintrin.h>
+#include "dataset.hpp"
+#include "kmeans.hpp"
+#include "metrics.hpp"
+#include "memory_stats.hpp"
+
+namespace minimilvus {
+
+namespace detail {
+
+template<typename T>
+void write_pod(std::ostream& out, const T& value) {
+    out.write(reinterpret_cast<const char*>(&value), sizeof(T));
+}
+
+template<typename T>
+void read_pod(std::istream& in, T& value) {
+    in.read(reinterpret_cast<char*>(&value), sizeof(T));
+}
+
+template<typename T>
+void write_vector(std::ostream& out, const std::vector<T>& v) {
+    write_pod(out, static_cast<int64_t>(v.size()));
+    out.write(reinterpret_cast<const char*>(v.data()), v.size() * sizeof(T));
+}
+
+/**
+ * @brief   流中当前位置之后剩余的字节数
+ * @return  剩余字节数；流不支持定位时返回uint64_t最大值（不做限制）
+ * @note    用于在分配前按实际大小校验文件中读出的长度字段
+ */
+inline uint64_t remaining_bytes(std::istream& in) {
+    std::streampos pos = in.tellg();
+    if (pos < 0) return std::numeric_limits<uint64_t>::max();
+    in.seekg(0, std::ios::end);
+    std::streampos end = in.tellg();
+    in.seekg(pos);
+    return end > pos ? static_cast<uint64_t>(end - pos) : 0;
+}
+
+/**
+ * @throws  std::runtime_error 当长度非法或数据被截断时
+ */
+template<typename T>
+void read_vector(std::istream& in, std::vector<T>& v) {
+    int64_t size = -1;
+    read_pod(in, size);
+    if (!in || size < 0) throw std::runtime_error("Truncated vector in index stream");
+    // 损坏的长度字段不能触发超大分配
+    if (static_cast<uint64_t>(size) > remaining_bytes(in) / sizeof(T)) {
+        throw std::runtime_error("Truncated vector in index stream");
+    }
+    v.resize(size);
+    in.read(reinterpret_cast<char*>(v.data()), size * sizeof(T));
+    if (!in) throw std::runtime_error("Truncated vector in index stream");
+}
+
+inline void write_string(std::ostream& out, const std::string& s) {
+    write_pod(out, static_cast<int32_t>(s.size()));
+    out.write(s.data(), s.size());
+}
+
+inline std::string read_string(std::istream& in) {
+    int32_t size = -1;
+    read_pod(in, size);
+    if (!in || size < 0 || size > 4096) throw std::runtime_error("Invalid string in index stream");
+    std::string s(size, '\0');
+    in.read(s.data(), size);
+    return s;
+}
+
+} // namespace detail
+
+/**
+ * @brief   float转IEEE半精度（就近舍入到偶数）
+ */
+inline uint16_t float_to_half(float f) {
+    uint32_t x;
+    std::memcpy(&x, &f, sizeof(x));
+    uint32_t sign = (x >> 16) & 0x8000;
+    uint32_t raw_exp = (x >> 23) & 0xff;
+    uint32_t mant = x & 0x7fffff;
+    if (raw_exp == 0xff) return static_cast<uint16_t>(sign | 0x7c00 | (mant ? 0x200 : 0));
+    int32_t exp = static_cast<int32_t>(raw_exp) - 127 + 15;
+    if (exp >= 31) return static_cast<uint16_t>(sign | 0x7c00);
+    if (exp <= 0) {
+        if (exp < -10) return static_cast<uint16_t>(sign);
+        mant |= 0x800000;
+        uint32_t shift = static_cast<uint32_t>(14 - exp);
+        uint32_t half = mant >> shift;
+        uint32_t rem = mant & ((1u << shift) - 1);
+        uint32_t mid = 1u << (shift - 1);
+        if (rem > mid || (rem == mid && (half & 1))) half++;
+        return static_cast<uint16_t>(sign | half);
+    }
+    uint32_t half = sign | (static_cast<uint32_t>(exp) << 10) | (mant >> 13);
+    uint32_t rem = mant & 0x1fff;
+    if (rem > 0x1000 || (rem == 0x1000 && (half & 1))) half++;   // 进位可溢出到指数，结果仍正确
+    return static_cast<uint16_t>(half);
+}
+
+/**
+ * @brief   IEEE半精度转float
+ */
+inline float half_to_float(uint16_t h) {
+    uint32_t sign = static_cast<uint32_t>(h & 0x8000) << 16;
+    uint32_t exp = (h >> 10) & 0x1f;
+    uint32_t mant = h & 0x3ff;
+    uint32_t bits;
+    if (exp == 0) {
+        if (mant == 0) {
+            bits = sign;
+        } else {
+            exp = 127 - 15 + 1;
+            while (!(mant & 0x400)) {
+                mant <<= 1;
+                exp--;
+            }
+            bits = sign | (exp << 23) | ((mant & 0x3ff) << 13);
+        }
+    } else if (exp == 31) {
+        bits = sign | 0x7f800000 | (mant << 13);
+    } else {
+        bits = sign | ((exp + 112) << 23) | (mant << 13);
+    }
+    float f;
+    std::memcpy(&f, &bits, sizeof(f));
+    return f;
+}
+
+/**
+ * @brief   原始float编码，无损
+ */
+class FlatCodec {
+public:
+    static constexpr const char* kName = "Flat";
+    static constexpr idx_t kMinTrainSamples = 0;
+
+    explicit FlatCodec(int dim) : dim_(dim) {}
+
+    void train(const VectorDataset&) {}
+    bool is_trained() const { return true; }
+    int get_dim() const { return dim_; }
+    size_t code_size() const { return dim_ * sizeof(float); }
+    std::string name() const { return kName; }
+
+    void encode(std::span<const float> vec, uint8_t* code) const {
+        std::memcpy(code, vec.data(), code_size());
+    }
+
+    void decode(const uint8_t* code, float* out) const {
+        std::memcpy(out, code, code_size());
+    }
+
+    template<typename Metric>
+    class Scanner {
+    public:
+        Scanner(const FlatCodec& codec, std::span<const float> query) : query_(query), dim_(codec.dim_) {}
+
+        float operator()(const uint8_t* code) const {
+            return Metric::distance(query_, {reinterpret_cast<const float*>(code), static_cast<size_t>(dim_)});
+        }
+
+    private:
+        std::span<const float> query_;
+        int dim_;
+    };
+
+    template<typename Metric>
+    Scanner<Metric> scanner(std::span<const float> query) const { return Scanner<Metric>(*this, query); }
+
+    void save(std::ostream&) const {}
+    static FlatCodec load(std::istream&, int dim) { return FlatCodec(dim); }
+    MemoryUsage memory_usage() const { return {}; }
+
+private:
+    int dim_;
+};
+
+/**
+ * @brief   FP16半精度编码，内存减半，精度损失约1e-3相对误差
+ * @note    支持F16C时扫描直接用 _mm256_cvtph_ps 解码8维
+ */
+class FP16Codec {
+public:
+    static constexpr const char* kName = "FP16";
+    static constexpr idx_t kMinTrainSamples = 0;
+
+    explicit FP16Codec(int dim) : dim_(dim) {}
+
+    void train(const VectorDataset&) {}
+    bool is_trained() const { return true; }
+    int get_dim() const { return dim_; }
+    size_t code_size() const { return dim_ * sizeof(uint16_t); }
+    std::string name() const { return kName; }
+
+    void encode(std::span<const float> vec, uint8_t* code) const {
+        for (int d = 0; d < dim_; ++d) {
+            uint16_t h = float_to_half(vec[d]);
+            std::memcpy(code + 2 * d, &h, sizeof(h));
+        }
+    }
+
+    void decode(const uint8_t* code, float* out) const {
+        for (int d = 0; d < dim_; ++d) {
+            uint16_t h;
+            std::memcpy(&h, code + 2 * d, sizeof(h));
+            out[d] = half_to_float(h);
+        }
+    }
+
+    template<typename Metric>
+    class Scanner {
+    public:
+        Scanner(const FP16Codec& codec, std::span<const float> query) : query_(query.data()), dim_(codec.dim_) {}
+
+        float operator()(const uint8_t* code) const {
+            float sum = 0;
+            int d = 0;
+#if defined(__AVX2__) && defined(__F16C__) && defined(__FMA__)
+            __m256 acc = _mm256_setzero_ps();
+            for (; d + 8 <= dim_; d += 8) {
+                __m256 x = _mm256_cvtph_ps(_mm_loadu_si128(reinterpret_cast<const __m128i*>(code + 2 * d)));
+                __m256 q = _mm256_loadu_ps(query_ + d);
+                if constexpr (Metric::kInnerProduct) {
+                    acc = _mm256_fmadd_ps(q, x, acc);
+                } else {
+                    __m256 diff = _mm256_sub_ps(q, x);
+                    acc = _mm256_fmadd_ps(diff, diff, acc);
+                }
+            }
+            sum = detail::hsum256(acc);
+#endif
+            for (; d < dim_; ++d) {
+                uint16_t h;
+                std::memcpy(&h, code + 2 * d, sizeof(h));
+                float x = half_to_float(h);
+                if constexpr (Metric::kInnerProduct) {
+                    sum += query_[d] * x;
+                } else {
+                    float diff = query_[d] - x;
+                    sum += diff * diff;
+                }
+            }
+            return Metric::kInnerProduct ? -sum : sum;
+        }
+
+    private:
+        const float* query_;
+        int dim_;
+    };
+
+    template<typename Metric>
+    Scanner<Metric> scanner(std::span<const float> query) const { return Scanner<Metric>(*this, query); }
+
+    void save(std::ostream&) const {}
+    static FP16Codec load(std::istream&, int dim) { return FP16Codec(dim); }
+    MemoryUsage memory_usage() const { return {}; }
+
+private:
+    int dim_;
+};
+
+/**
+ * @brief   SQ8标量量化：每维按训练集的[min, max]均匀量化到8位
+ * @details 解码值 x = vmin[d] + code * scale[d]；
+ *          L2扫描时预先计算 q - vmin，IP扫描时预先计算 q * scale 和 q·vmin
+ */
+class SQ8Codec {
+public:
+    static constexpr const char* kName = "SQ8";
+    static constexpr idx_t kMinTrainSamples = 1;
+
+    explicit SQ8Codec(int dim) : dim_(dim) {}
+
+    /**
+     * @brief   统计每维的取值范围
+     * @throws  std::invalid_argument 当数据集为空或维度不符时
+     */
+    void train(const VectorDataset& dataset) {
+        if (dataset.get_count() == 0 || dataset.get_dim() != dim_) {
+            throw std::invalid_argument("SQ8 training requires a non-empty dataset of matching dim");
+        }
+        vmin_.assign(dim_, std::numeric_limits<float>::max());
+        std::vector<float> vmax(dim_, std::numeric_limits<float>::lowest());
+        for (idx_t i = 0; i < dataset.get_count(); ++i) {
+            auto vec = dataset.get_vector(i);
+            for (int d = 0; d < dim_; ++d) {
+                vmin_[d] = std::min(vmin_[d], vec[d]);
+                vmax[d] = std::max(vmax[d], vec[d]);
+            }
+        }
+        scale_.resize(dim_);
+        for (int d = 0; d < dim_; ++d) scale_[d] = (vmax[d] - vmin_[d]) / 255.0f;
+    }
+
+    bool is_trained() const { return !scale_.empty(); }
+    int get_dim() const { return dim_; }
+    size_t code_size() const { return dim_; }
+    std::string name() const { return kName; }
+
+    /**
+     * @note    超出训练范围的值截断到边界
+     */
+    void encode(std::span<const float> vec, uint8_t* code) const {
+        for (int d = 0; d < dim_; ++d) {
+            float q = scale_[d] > 0 ? (vec[d] - vmin_[d]) / scale_[d] : 0.0f;
+            code[d] = static_cast<uint8_t>(std::clamp(std::nearbyint(q), 0.0f, 255.0f));
+        }
+    }
+
+    void decode(const uint8_t* code, float* out) const {
+        for (int d = 0; d < dim_; ++d) out[d] = vmin_[d] + code[d] * scale_[d];
+    }
+
+    template<typename Metric>
+    class Scanner {
+    public:
+        Scanner(const SQ8Codec& codec, std::span<const float> query)
+            : scale_(codec.scale_.data()), dim_(codec.dim_), shifted_(codec.dim_) {
+            for (int d = 0; d < dim_; ++d) {
+                if constexpr (Metric::kInnerProduct) {
+                    shifted_[d] = query[d] * scale_[d];
+                    bias_ += query[d] * codec.vmin_[d];
+                } else {
+                    shifted_[d] = query[d] - codec.vmin_[d];
+                }
+            }
+        }
+
+        float operator()(const uint8_t* code) const {
+            const float* q = shifted_.data();
+            float sum = 0;
+            int d = 0;
+#if defined(__AVX2__) && defined(__FMA__)
+            __m256 acc = _mm256_setzero_ps();
+            for (; d + 8 <= dim_; d += 8) {
+                __m128i bytes = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(code + d));
+                __m256 c = _mm256_cvtepi32_ps(_mm256_cvtepu8_epi32(bytes));
+                if constexpr (Metric::kInnerProduct) {
+                    acc = _mm256_fmadd_ps(_mm256_loadu_ps(q + d), c, acc);
+                } else {
+                    __m256 x = _mm256_mul_ps(_mm256_loadu_ps(scale_ + d), c);
+                    __m256 diff = _mm256_sub_ps(_mm256_loadu_ps(q + d), x);
+                    acc = _mm256_fmadd_ps(diff, diff, acc);
+                }
+            }
+            sum = detail::hsum256(acc);
+#endif
+            for (; d < dim_; ++d) {
+                if constexpr (Metric::kInnerProduct) {
+                    sum += q[d] * code[d];
+                } else {
+                    float diff = q[d] - code[d] * scale_[d];
+                    sum += diff * diff;
+                }
+            }
+            return Metric::kInnerProduct ? -(sum + bias_) : sum;
+        }
+
+    private:
+        const float* scale_;
+        int dim_;
+        std::vector<float> shifted_;    ///< L2: q - vmin；IP: q * scale
+        float bias_ = 0;                ///< IP: q · vmin
+    };
+
+    template<typename Metric>
+    Scanner<Metric> scanner(std::span<const float> query) const { return Scanner<Metric>(*this, query); }
+
+    void save(std::ostream& out) const {
+        detail::write_vector(out, vmin_);
+        detail::write_vector(out, scale_);
+    }
+
+    /**
+     * @throws  std::runtime_error 当参数与维度不符时
+     */
+    static SQ8Codec load(std::istream& in, int dim) {
+        SQ8Codec codec(dim);
+        detail::read_vector(in, codec.vmin_);
+        detail::read_vector(in, codec.scale_);
+        if (codec.vmin_.size() != static_cast<size_t>(dim) || codec.scale_.size() != static_cast<size_t>(dim)) {
+            throw std::runtime_error("SQ8 parameters do not match dim");
+        }
+        return codec;
+    }
+
+    MemoryUsage memory_usage() const {
+        MemoryUsage usage = vector_memory(vmin_);
+        usage += vector_memory(scale_);
+        return usage;
+    }
+
+private:
+    int dim_;
+    std::vector<float> vmin_;   ///< 每维最小值
+    std::vector<float> scale_;  ///< 每维量化步长
+};
+
+/**
+ * @brief   PQ乘积量化：向量切成m段，每段用256个码字之一表示，每个向量m字节
+ * @details 码本由每段独立的KMeans训练；扫描时先算查询每段到256个码字的距离表（ADC），
+ *          之后每个编码的距离只是m次查表相加
+ */
+class PQCodec {
+public:
+    static constexpr const char* kName = "PQ";
+    static constexpr int kCentroids = 256;          ///< 每段码字数（8位编码）
+    static constexpr idx_t kMaxTrainSamples = 65536;
+    static constexpr idx_t kMinTrainSamples = kCentroids;
+
+    /**
+     * @brief   构造函数
+     * @param   dim     向量维度
+     * @param   m       分段数，需整除dim
+     * @throws  std::invalid_argument 当m不整除dim时
+     */
+    PQCodec(int dim, int m = 8) : dim_(dim), m_(m) {
+        if (m <= 0 || dim % m != 0) throw std::invalid_argument("PQ segments must divide dim");
+        dsub_ = dim / m;
+    }
+
+    /**
+     * @brief   训练每段的码本
+     * @throws  std::invalid_argument 当训练样本少于256个时
+     * @param   dataset     训练数据
+     * @param   n_iter      每段KMeans的迭代次数
+     * @note    样本超过kMaxTrainSamples时等间隔抽样
+     */
+    void train(const VectorDataset& dataset, int n_iter = 10) {
+        if (dataset.get_count() < kCentroids || dataset.get_dim() != dim_) {
+            throw std::invalid_argument("PQ training requires at least 256 vectors of matching dim");
+        }
+        idx_t n = std::min(dataset.get_count(), kMaxTrainSamples);
+        idx_t step = dataset.get_count() / n;
+        codebooks_.assign(static_cast<size_t>(m_) * kCentroids * dsub_, 0.0f);
+        for (int j = 0; j < m_; ++j) {
+            VectorDataset sub(dsub_);
+            auto rows = sub.extend(n);
+            for (idx_t i = 0; i < n; ++i) {
+                auto vec = dataset.get_vector(i * step);
+                std::copy(vec.begin() + j * dsub_, vec.begin() + (j + 1) * dsub_, rows.begin() + i * dsub_);
+            }
+            KMeans kmeans(kCentroids, n_iter, dsub_);
+            kmeans.set_verbose(false);
+            kmeans.train(sub);
+            const auto& centroids = kmeans.get_centroids();
+            std::copy(centroids.begin(), centroids.end(), codebooks_.begin() + j * kCentroids * dsub_);
+        }
+    }
+
+    bool is_trained() const { return !codebooks_.empty(); }
+    int get_dim() const { return dim_; }
+    int segments() const { return m_; }
+    size_t code_size() const { return m_; }
+    std::string name() const { return kName + std::to_string(m_); }
+
+    /**
+     * @brief   第j段第c个码字
+     */
+    const float* centroid(int j, int c) const {
+        return codebooks_.data() + (static_cast<size_t>(j) * kCentroids + c) * dsub_;
+    }
+
+    void encode(std::span<const float> vec, uint8_t* code) const {
+        for (int j = 0; j < m_; ++j) {
+            std::span<const float> sub(vec.data() + j * dsub_, dsub_);
+            int best = 0;
+            float best_dist = std::numeric_limits<float>::max();
+            for (int c = 0; c < kCentroids; ++c) {
+                float d = l2_distance(sub, {centroid(j, c), static_cast<size_t>(dsub_)});
+                if (d < best_dist) {
+                    best_dist = d;
+                    best = c;
+                }
+            }
+            code[j] = static_cast<uint8_t>(best);
+        }
+    }
+
+    void decode(const uint8_t* code, float* out) const {
+        for (int j = 0; j < m_; ++j) std::copy_n(centroid(j, code[j]), dsub_, out + j * dsub_);
+    }
+
+    /**
+     * @brief   每个码字与向量对应段的内积表 t[j][c] = <v_j, r_jc>
+     */
+    std::vector<float> inner_product_table(std::span<const float> vec) const {
+        std::vector<float> table(static_cast<size_t>(m_) * kCentroids);
+        for (int j = 0; j < m_; ++j) {
+            std::span<const float> sub(vec.data() + j * dsub_, dsub_);
+            for (int c = 0; c < kCentroids; ++c) {
+                table[j * kCentroids + c] = ip_distance(sub, {centroid(j, c), static_cast<size_t>(dsub_)});
+            }
+        }
+        return table;
+    }
+
+    /**
+     * @brief   残差编码的桶项表 t[j][c] = ||r_jc||² + 2<centroid_j, r_jc>
+     * @details ||q - c - r||² = ||q - c||² + (||r||² + 2<c, r>) - 2<q, r>，
+     *          第二项只与桶和码字有关，可在训练后预计算，查询时每个桶只需一次表加法
+     */
+    std::vector<float> residual_term_table(std::span<const float> list_centroid) const {
+        std::vector<float> table = inner_product_table(list_centroid);
+        for (int j = 0; j < m_; ++j) {
+            for (int c = 0; c < kCentroids; ++c) {
+                std::span<const float> r(centroid(j, c), dsub_);
+                table[j * kCentroids + c] = ip_distance(r, r) + 2.0f * table[j * kCentroids + c];
+            }
+        }
+        return table;
+    }
+
+    template<typename Metric>
+    class Scanner {
+    public:
+        Scanner(const PQCodec& codec, std::span<const float> query)
+            : m_(codec.m_), table_(static_cast<size_t>(codec.m_) * kCentroids) {
+            for (int j = 0; j < m_; ++j) {
+                std::span<const float> sub(query.data() + j * codec.dsub_, codec.dsub_);
+                for (int c = 0; c < kCentroids; ++c) {
+                    table_[j * kCentroids + c] =
+                        Metric::distance(sub, {codec.centroid(j, c), static_cast<size_t>(codec.dsub_)});
+                }
+            }
+        }
+
+        /**
+         * @brief   直接使用外部算好的 m * 256 距离表，结果加上bias
+         */
+        Scanner(int m, std::vector<float> table, float bias = 0.0f) : m_(m), table_(std::move(table)), bias_(bias) {}
+
+        float operator()(const uint8_t* code) const {
+            const float* t = table_.data();
+            float s0 = bias_, s1 = 0, s2 = 0, s3 = 0;
+            int j = 0;
+            for (; j + 4 <= m_; j += 4) {
+                s0 += t[(j + 0) * kCentroids + code[j + 0]];
+                s1 += t[(j + 1) * kCentroids + code[j + 1]];
+                s2 += t[(j + 2) * kCentroids + code[j + 2]];
+                s3 += t[(j + 3) * kCentroids + code[j + 3]];
+            }
+            for (; j < m_; ++j) s0 += t[j * kCentroids + code[j]];
+            return (s0 + s1) + (s2 + s3);
+        }
+
+    private:
+        int m_;
+        std::vector<float> table_;  ///< m * 256 的距离表
+        float bias_ = 0.0f;
+    };
+
+    template<typename Metric>
+    Scanner<Metric> scanner(std::span<const float> query) const { return Scanner<Metric>(*this, query); }
+
+    void save(std::ostream& out) const {
+        detail::write_pod(out, static_cast<int32_t>(m_));
+        detail::write_vector(out, codebooks_);
+    }
+
+    /**
+     * @throws  std::runtime_error 当码本与维度不符时
+     */
+    static PQCodec load(std::istream& in, int dim) {
+        int32_t m = 0;
+        detail::read_pod(in, m);
+        if (!in || m <= 0 || dim % m != 0) throw std::runtime_error("Invalid PQ segment count");
+        PQCodec codec(dim, m);
+        detail::read_vector(in, codec.codebooks_);
+        if (codec.codebooks_.size() != static_cast<size_t>(m) * kCentroids * codec.dsub_) {
+            throw std::runtime_error("PQ codebook size mismatch");
+        }
+        return codec;
+    }
+
+    MemoryUsage memory_usage() const { return vector_memory(codebooks_); }
+
+private:
+    int dim_;
+    int m_;
+    int dsub_;
+    std::vector<float> codebooks_;  ///< [m][256][dsub]
+};
+
+} // namespace minimilvus
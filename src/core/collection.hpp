@@ -0,0 +1,393 @@
+/**
+ * @file    collection.hpp
+ * @brief   集合（Collection）实现
+ * @details 一个集合拥有独立的维度、度量、索引类型和WAL，
+ *          数据以 快照文件 + WAL 的形式持久化在数据目录下
+ * @author  Tyooughtul
+ */
+
+#pragma once
+#include <string>
+#include <vector>
+#include <memory>
+#include <queue>
+#include <sstream>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <stdexcept>
+#include "dataset.hpp"
+#include "ivf_index.hpp"
+#include "wal.hpp"
+#include "rwlock.hpp"
+#include "memory_stats.hpp"
+
+namespace minimilvus {
+
+/**
+ * @brief   索引类型
+ */
+enum class IndexType {
+    Flat, ///< 暴力扫描
+    IVF   ///< 倒排索引
+};
+
+/**
+ * @brief   集合配置
+ */
+struct CollectionConfig {
+    std::string name;                      ///< 集合名
+    int dim = 0;                           ///< 向量维度
+    MetricType metric = MetricType::L2;    ///< 距离度量
+    IndexType index_type = IndexType::IVF; ///< 索引类型
+    int n_lists = 100;                     ///< IVF桶数量
+    std::string data_dir = "data";         ///< 数据目录
+};
+
+/**
+ * @brief   集合类
+ * @details 读操作（search）持读锁，写操作（insert/build/flush）持写锁；
+ *          插入先写WAL再写内存，flush时写快照并清空WAL。
+ *          WAL记录带有向量ID，重放时跳过快照中已有的记录
+ */
+class Collection {
+public:
+    /**
+     * @brief   打开集合
+     * @param   config  集合配置
+     * @throws  std::invalid_argument 当配置非法时
+     * @note    数据目录下存在快照时加载快照，然后重放WAL中快照之后的插入；
+     *          flush中途崩溃（快照已替换、WAL未清空）时，快照中已有的记录按ID跳过
+     * @throws  std::runtime_error 当WAL中的记录ID与快照不连续时
+     */
+    explicit Collection(CollectionConfig config)
+        : config_(std::move(config)), dataset_(config_.dim),
+          wal_(prepare_wal_path(config_), false) {
+        if (config_.dim <= 0) throw std::invalid_argument("Collection dim must be positive");
+        if (config_.index_type == IndexType::IVF && config_.metric != MetricType::L2) {
+            throw std::invalid_argument("IVF index only supports L2 metric");
+        }
+
+        if (std::filesystem::exists(dataset_path(config_))) {
+            dataset_ = VectorDataset::load(dataset_path(config_));
+        }
+        if (config_.index_type == IndexType::IVF && std::filesystem::exists(index_path(config_))) {
+            index_ = std::make_unique<IVFIndex>(IVFIndex::load(index_path(config_)));
+        }
+        Manifest manifest = read_manifest(config_);
+        generation_ = manifest.generation;
+        if (manifest.count >= 0 && manifest.count != dataset_.get_count()) {
+            // 数据集快照已替换但manifest未更新：索引快照可能是新的也可能是旧的，重建
+            index_.reset();
+            if (config_.index_type == IndexType::IVF && dataset_.get_count() >= config_.n_lists) {
+                index_ = std::make_unique<IVFIndex>(config_.dim, config_.n_lists);
+                index_->build(dataset_);
+            }
+            dirty_ = true;
+        }
+
+        // 重放快照之后的插入
+        wal_.for_each_record([this](const std::string& op, const std::string& data) {
+            if (op != "ADD_VECTOR") return;
+            auto [id, vec] = parse_record(data);
+            if (id >= 0 && id < dataset_.get_count()) return;
+            if (id > dataset_.get_count()) {
+                throw std::runtime_error("WAL record gap in collection " + config_.name);
+            }
+            apply_insert(vec);
+            dirty_ = true;
+        });
+    }
+
+    Collection(const Collection&) = delete;
+    Collection& operator=(const Collection&) = delete;
+
+    /**
+     * @brief   插入一个向量
+     * @param   vec     向量数据
+     * @return  新向量的ID
+     * @throws  std::invalid_argument 当维度不匹配时
+     * @throws  std::runtime_error 当WAL写入失败时
+     */
+    idx_t insert(const std::vector<float>& vec) {
+        if (vec.size() != static_cast<size_t>(config_.dim)) {
+            throw std::invalid_argument("Dimension Mismatch");
+        }
+        std::string data = format_vector(vec);
+        idx_t id;
+        {
+            StdRWLock::WriteLock lock(lock_);
+            id = dataset_.get_count();
+            if (!wal_.append("ADD_VECTOR", std::to_string(id) + ":" + data)) {
+                throw std::runtime_error("WAL append failed for collection " + config_.name);
+            }
+            dirty_ = true;
+            apply_insert(vec);
+        }
+        notify_usage();
+        return id;
+    }
+
+    /**
+     * @brief   批量插入向量
+     * @param   vecs    向量列表
+     * @return  第一个新向量的ID，其余ID依次递增
+     * @throws  std::invalid_argument 当维度不匹配时
+     * @throws  std::runtime_error 当WAL写入失败时
+     * @note    整批记录一次写入WAL并落盘，比逐个insert少大量系统调用
+     */
+    idx_t insert_batch(const std::vector<std::vector<float>>& vecs) {
+        std::vector<std::pair<std::string, std::string>> records;
+        records.reserve(vecs.size());
+        for (const auto& vec : vecs) {
+            if (vec.size() != static_cast<size_t>(config_.dim)) {
+                throw std::invalid_argument("Dimension Mismatch");
+            }
+            records.emplace_back("ADD_VECTOR", format_vector(vec));
+        }
+        idx_t first;
+        {
+            StdRWLock::WriteLock lock(lock_);
+            first = dataset_.get_count();
+            for (size_t i = 0; i < records.size(); ++i) {
+                records[i].second.insert(0, std::to_string(first + static_cast<idx_t>(i)) + ":");
+            }
+            if (!wal_.append_batch(records)) {
+                throw std::runtime_error("WAL append failed for collection " + config_.name);
+            }
+            dirty_ = true;
+            for (const auto& vec : vecs) apply_insert(vec);
+        }
+        notify_usage();
+        return first;
+    }
+
+    /**
+     * @brief   (重新)构建索引
+     * @note    Flat集合无需构建；IVF集合数据量不足n_lists时跳过
+     */
+    void build_index() {
+        {
+            StdRWLock::WriteLock lock(lock_);
+            if (config_.index_type != IndexType::IVF) return;
+            if (dataset_.get_count() < config_.n_lists) return;
+            auto index = std::make_unique<IVFIndex>(config_.dim, config_.n_lists);
+            index->build(dataset_);
+            index_ = std::move(index);
+            dirty_ = true;
+        }
+        notify_usage();
+    }
+
+    /**
+     * @brief   搜索最近邻
+     * @param   query   查询向量
+     * @param   k       返回结果数量
+     * @param   profile 剖析结果输出（可为空）
+     * @return  按距离升序的结果
+     * @note    IVF集合在索引构建前退化为暴力扫描
+     */
+    std::vector<SearchResult> search(std::span<const float> query, int k,
+                                     QueryProfile* profile = nullptr) const {
+        if (query.size() != static_cast<size_t>(config_.dim)) {
+            throw std::invalid_argument("Dimension Mismatch");
+        }
+        StdRWLock::ReadLock lock(lock_);
+        if (index_) {
+            return index_->search(query, dataset_, k, 0.2f, 20, 5, profile);
+        }
+        return flat_search(query, k);
+    }
+
+    /**
+     * @brief   写快照并清空WAL
+     * @note    顺序为：快照（临时文件+rename原子替换）-> manifest（代数+1与快照行数）-> 清空WAL，
+     *          只读副本据此判断读到的WAL记录属于哪一代快照；
+     *          任一步之后崩溃，重新打开时按manifest行数与记录ID恢复，不会重复插入
+     */
+    void flush() {
+        {
+            StdRWLock::WriteLock lock(lock_);
+            if (!dirty_) return;
+            dataset_.save(dataset_path(config_) + ".tmp");
+            std::filesystem::rename(dataset_path(config_) + ".tmp", dataset_path(config_));
+            if (index_) {
+                index_->save(index_path(config_) + ".tmp");
+                std::filesystem::rename(index_path(config_) + ".tmp", index_path(config_));
+            }
+            write_manifest(config_, {++generation_, dataset_.get_count()});
+            wal_.clear();
+            dirty_ = false;
+        }
+        notify_usage();
+    }
+
+    /**
+     * @brief   设置内存占用变化的回调
+     * @param   listener    参数为集合当前的分配字节数，在insert/build_index/flush之后、
+     *                      不持有集合锁时调用
+     * @note    需在集合被共享给其他线程之前设置
+     */
+    void set_usage_listener(std::function<void(size_t)> listener) {
+        usage_listener_ = std::move(listener);
+    }
+
+    /**
+     * @brief   是否有未写入快照的修改
+     */
+    bool dirty() const {
+        StdRWLock::ReadLock lock(lock_);
+        return dirty_;
+    }
+
+    /**
+     * @brief   向量数量
+     */
+    idx_t size() const {
+        StdRWLock::ReadLock lock(lock_);
+        return dataset_.get_count();
+    }
+
+    /**
+     * @brief   统计集合的内存占用
+     */
+    MemoryReport memory_report() const {
+        StdRWLock::ReadLock lock(lock_);
+        MemoryReport report;
+        report.add("dataset.vectors", dataset_.memory_usage());
+        if (index_) report.merge(index_->memory_report(), "ivf.");
+        report.add("wal", wal_.memory_usage());
+        return report;
+    }
+
+    const CollectionConfig& config() const { return config_; }
+
+    // ---- 磁盘布局（供只读副本共享） ----
+
+    static std::string dataset_path(const CollectionConfig& c) { return c.data_dir + "/" + c.name + ".mmvd"; }
+    static std::string index_path(const CollectionConfig& c) { return c.data_dir + "/" + c.name + ".ivf"; }
+    static std::string wal_path(const CollectionConfig& c) { return c.data_dir + "/" + c.name + ".wal"; }
+    static std::string manifest_path(const CollectionConfig& c) { return c.data_dir + "/" + c.name + ".manifest"; }
+
+    /**
+     * @brief   快照清单：代数与快照中的向量数
+     */
+    struct Manifest {
+        uint64_t generation = 0;    ///< 快照代数，每次flush加一
+        idx_t count = -1;           ///< 快照中的向量数，旧格式的manifest中缺省为-1
+    };
+
+    /**
+     * @brief   读取manifest，不存在时代数为0
+     */
+    static Manifest read_manifest(const CollectionConfig& c) {
+        std::ifstream file(manifest_path(c));
+        Manifest manifest;
+        file >> manifest.generation;
+        if (!(file >> manifest.count)) manifest.count = -1;
+        return manifest;
+    }
+
+    /**
+     * @brief   读取快照代数，manifest不存在时为0
+     */
+    static uint64_t read_generation(const CollectionConfig& c) {
+        return read_manifest(c).generation;
+    }
+
+    /**
+     * @brief   解析WAL中ADD_VECTOR记录的数据：ID:逗号分隔的float
+     * @return  (向量ID, 向量)；不带ID的旧格式记录ID为-1
+     */
+    static std::pair<idx_t, std::vector<float>> parse_record(const std::string& data) {
+        size_t pos = data.find(':');
+        if (pos == std::string::npos) return {-1, parse_vector(data)};
+        return {std::stoll(data.substr(0, pos)), parse_vector(data.substr(pos + 1))};
+    }
+
+    /**
+     * @brief   向量的文本格式：逗号分隔的float
+     */
+    static std::string format_vector(const std::vector<float>& vec) {
+        std::ostringstream oss;
+        oss.precision(9);
+        for (size_t i = 0; i < vec.size(); ++i) {
+            if (i) oss << ',';
+            oss << vec[i];
+        }
+        return oss.str();
+    }
+
+    static std::vector<float> parse_vector(const std::string& data) {
+        std::vector<float> vec;
+        std::istringstream iss(data);
+        std::string elem;
+        while (std::getline(iss, elem, ',')) {
+            if (!elem.empty()) vec.push_back(std::stof(elem));
+        }
+        return vec;
+    }
+
+private:
+    CollectionConfig config_;
+    VectorDataset dataset_;
+    std::unique_ptr<IVFIndex> index_;
+    WAL wal_;
+    mutable StdRWLock lock_;
+    bool dirty_ = false;
+    uint64_t generation_ = 0;   ///< 快照代数，每次flush加一
+    std::function<void(size_t)> usage_listener_;   ///< 内存占用变化回调（可为空）
+
+    static void write_manifest(const CollectionConfig& c, const Manifest& manifest) {
+        std::string tmp = manifest_path(c) + ".tmp";
+        {
+            std::ofstream file(tmp, std::ios::trunc);
+            file << manifest.generation << " " << manifest.count << "\n";
+        }
+        std::filesystem::rename(tmp, manifest_path(c));
+    }
+
+    /// 调用方不能持有lock_
+    void notify_usage() {
+        if (usage_listener_) usage_listener_(memory_report().total().allocated_bytes);
+    }
+
+    /// 创建数据目录并返回WAL路径（在WAL成员构造前调用）
+    static std::string prepare_wal_path(const CollectionConfig& config) {
+        std::filesystem::create_directories(config.data_dir);
+        return wal_path(config);
+    }
+
+    /// 调用方需持有写锁（或处于构造阶段）
+    idx_t apply_insert(const std::vector<float>& vec) {
+        idx_t id = dataset_.get_count();
+        dataset_.add(vec);
+        if (index_) index_->add(vec, id);
+        return id;
+    }
+
+    float distance(std::span<const float> a, std::span<const float> b) const {
+        return config_.metric == MetricType::L2 ? l2_distance(a, b) : -ip_distance(a, b);
+    }
+
+    std::vector<SearchResult> flat_search(std::span<const float> query, int k) const {
+        std::priority_queue<SearchResult> top;
+        for (idx_t i = 0; i < dataset_.get_count(); ++i) {
+            float d = distance(query, dataset_.get_vector(i));
+            if (top.size() < static_cast<size_t>(k)) {
+                top.push({i, d});
+            } else if (d < top.top().distance) {
+                top.pop();
+                top.push({i, d});
+            }
+        }
+        std::vector<SearchResult> results(top.size());
+        for (size_t i = results.size(); i-- > 0;) {
+            results[i] = top.top();
+            top.pop();
+        }
+        return results;
+    }
+};
+
+} // namespace minimilvus
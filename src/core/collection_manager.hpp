@@ -0,0 +1,337 @@
+/**
+ * @file    collection_manager.hpp
+ * @brief   多租户集合管理器
+ * @details 管理大量命名集合：按名称路由请求，冷集合按需从磁盘加载，
+ *          超出内存预算时按LRU淘汰已加载的集合
+ * @author  Tyooughtul
+ */
+
+#pragma once
+#include <string>
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <unordered_map>
+#include <atomic>
+#include <functional>
+#include <stdexcept>
+#include "collection.hpp"
+#include "api/api.hpp"
+
+namespace minimilvus {
+
+/**
+ * @brief   集合管理器
+ * @details 注册表按名称哈希分成多个分段，每段一把读写锁，请求之间不存在全局锁；
+ *          每个集合条目有自己的互斥锁保护加载/淘汰。
+ *          借出的集合在归还（shared_ptr释放）前不会被淘汰，保证同一集合的WAL只有一个写入者；
+ *          集合插入、构建索引和flush后自动重新计入内存预算
+ * @note    管理器需比借出的集合活得更久；调用方不应长期持有借出的集合，否则它一直占用预算
+ */
+class CollectionManager {
+public:
+    /**
+     * @brief   构造函数
+     * @param   memory_budget_bytes     已加载集合的内存预算，0表示不限制
+     */
+    explicit CollectionManager(size_t memory_budget_bytes = 0)
+        : memory_budget_(memory_budget_bytes) {}
+
+    CollectionManager(const CollectionManager&) = delete;
+    CollectionManager& operator=(const CollectionManager&) = delete;
+
+    /**
+     * @brief   创建集合
+     * @param   config  集合配置
+     * @return  新建的集合
+     * @throws  std::invalid_argument 当同名集合已存在时
+     */
+    std::shared_ptr<Collection> create(const CollectionConfig& config) {
+        auto entry = std::make_shared<Entry>();
+        entry->config = config;
+        {
+            Shard& shard = shard_for(config.name);
+            std::unique_lock lock(shard.mutex);
+            if (!shard.entries.emplace(config.name, entry).second) {
+                throw std::invalid_argument("Collection already exists: " + config.name);
+            }
+        }
+        return acquire(entry);
+    }
+
+    /**
+     * @brief   注册一个已存在于磁盘上的集合，不立即加载
+     * @param   config  集合配置
+     * @note    用于启动时登记所有集合，首次访问时才加载
+     */
+    void register_existing(const CollectionConfig& config) {
+        auto entry = std::make_shared<Entry>();
+        entry->config = config;
+        Shard& shard = shard_for(config.name);
+        std::unique_lock lock(shard.mutex);
+        shard.entries.emplace(config.name, entry);
+    }
+
+    /**
+     * @brief   按名称获取集合，必要时从磁盘加载
+     * @param   name    集合名
+     * @return  集合；不存在时返回nullptr
+     */
+    std::shared_ptr<Collection> get(const std::string& name) {
+        std::shared_ptr<Entry> entry = find_entry(name);
+        if (!entry) return nullptr;
+        return acquire(entry);
+    }
+
+    /**
+     * @brief   删除集合（仅从管理器移除，不删除磁盘文件）
+     * @return  是否存在并被移除
+     * @throws  std::runtime_error 当集合仍被借出时（否则之后同名集合会与旧对象同时写同一个WAL）
+     */
+    bool drop(const std::string& name) {
+        std::shared_ptr<Entry> entry = find_entry(name);
+        if (!entry) return false;
+        // 加锁顺序：条目锁 -> 分段锁，与淘汰时一致
+        std::lock_guard<std::mutex> lock(entry->mutex);
+        if (entry->collection && entry->collection.use_count() > 1) {
+            throw std::runtime_error("Collection is in use: " + name);
+        }
+        {
+            Shard& shard = shard_for(name);
+            std::unique_lock shard_lock(shard.mutex);
+            auto it = shard.entries.find(name);
+            if (it == shard.entries.end() || it->second != entry) return false;
+            shard.entries.erase(it);
+        }
+        if (entry->collection) unload(*entry);
+        return true;
+    }
+
+    /**
+     * @brief   路由搜索请求到对应集合
+     * @param   request     搜索请求（按collection字段路由）
+     * @return  搜索响应
+     * @throws  std::invalid_argument 当集合不存在时
+     */
+    SearchResponse search(const SearchRequest& request) {
+        auto collection = get(request.collection);
+        if (!collection) throw std::invalid_argument("Unknown collection: " + request.collection);
+
+        SearchResponse response;
+        QueryProfile profile;
+        auto results = collection->search(request.vector, request.top_k,
+                                          request.profile ? &profile : nullptr);
+        for (const auto& r : results) response.results.push_back({r.id, r.distance});
+        if (request.profile) response.profile = profile;
+        return response;
+    }
+
+    /**
+     * @brief   重新统计某集合的内存并按需淘汰
+     * @param   name    集合名
+     * @note    插入、构建索引和flush会自动重新计费，仅在集合内存以其他方式变化时需要调用
+     */
+    void refresh_usage(const std::string& name) {
+        std::shared_ptr<Entry> entry = find_entry(name);
+        if (!entry) return;
+        {
+            std::lock_guard<std::mutex> lock(entry->mutex);
+            if (!entry->collection) return;
+            charge(*entry, entry->collection.get(), entry->collection->memory_report().total().allocated_bytes);
+        }
+        evict_if_needed(entry.get());
+    }
+
+    /**
+     * @brief   将所有已加载集合写快照
+     */
+    void flush_all() {
+        for_each_entry([](Entry& entry) {
+            std::shared_ptr<Collection> collection;
+            {
+                std::lock_guard<std::mutex> lock(entry.mutex);
+                collection = entry.collection;
+            }
+            // 持有引用期间集合不会被淘汰；flush在条目锁外进行，其内存回调可以安全地触发淘汰
+            if (collection) collection->flush();
+        });
+    }
+
+    /**
+     * @brief   已加载集合的内存合计（字节）
+     */
+    size_t loaded_bytes() const { return loaded_bytes_.load(); }
+
+    /**
+     * @brief   已加载集合的数量
+     */
+    size_t loaded_count() {
+        size_t count = 0;
+        for_each_entry([&count](Entry& entry) {
+            std::lock_guard<std::mutex> lock(entry.mutex);
+            if (entry.collection) count++;
+        });
+        return count;
+    }
+
+    /**
+     * @brief   汇总所有已加载集合的内存报告，组件名以集合名为前缀
+     */
+    MemoryReport memory_report() {
+        MemoryReport report;
+        for_each_entry([&report](Entry& entry) {
+            std::lock_guard<std::mutex> lock(entry.mutex);
+            if (entry.collection) {
+                report.merge(entry.collection->memory_report(), entry.config.name + ".");
+            }
+        });
+        return report;
+    }
+
+private:
+    static constexpr size_t kShardCount = 64;
+
+    /**
+     * @brief   集合条目
+     */
+    struct Entry {
+        CollectionConfig config;                  ///< 集合配置
+        std::mutex mutex;                         ///< 保护加载与淘汰
+        std::shared_ptr<Collection> collection;   ///< 已加载的集合，冷集合为空
+        std::mutex charge_mutex;                  ///< 保护计费字段，不与其他锁嵌套获取
+        const Collection* charged = nullptr;      ///< 当前计费的集合实例
+        size_t charged_bytes = 0;                 ///< 计入预算的字节数
+        std::atomic<uint64_t> last_access{0};     ///< LRU时间戳
+    };
+
+    /**
+     * @brief   注册表分段
+     */
+    struct Shard {
+        std::shared_mutex mutex;
+        std::unordered_map<std::string, std::shared_ptr<Entry>> entries;
+    };
+
+    Shard shards_[kShardCount];
+    size_t memory_budget_;
+    std::atomic<size_t> loaded_bytes_{0};
+    std::atomic<uint64_t> clock_{0};
+
+    Shard& shard_for(const std::string& name) {
+        return shards_[std::hash<std::string>{}(name) % kShardCount];
+    }
+
+    std::shared_ptr<Entry> find_entry(const std::string& name) {
+        Shard& shard = shard_for(name);
+        std::shared_lock lock(shard.mutex);
+        auto it = shard.entries.find(name);
+        return it == shard.entries.end() ? nullptr : it->second;
+    }
+
+    void for_each_entry(const std::function<void(Entry&)>& fn) {
+        for (auto& shard : shards_) {
+            std::vector<std::shared_ptr<Entry>> entries;
+            {
+                std::shared_lock lock(shard.mutex);
+                for (auto& [name, entry] : shard.entries) entries.push_back(entry);
+            }
+            for (auto& entry : entries) fn(*entry);
+        }
+    }
+
+    /**
+     * @brief   借出集合，冷集合在此加载
+     */
+    std::shared_ptr<Collection> acquire(const std::shared_ptr<Entry>& entry) {
+        entry->last_access = ++clock_;
+        std::shared_ptr<Collection> collection;
+        bool loaded = false;
+        {
+            std::lock_guard<std::mutex> lock(entry->mutex);
+            if (!entry->collection) {
+                auto opened = std::make_shared<Collection>(entry->config);
+                const Collection* instance = opened.get();
+                opened->set_usage_listener([this, weak = std::weak_ptr<Entry>(entry), instance](size_t bytes) {
+                    auto owner = weak.lock();
+                    if (owner && charge(*owner, instance, bytes)) evict_if_needed(owner.get());
+                });
+                {
+                    std::lock_guard<std::mutex> charge_lock(entry->charge_mutex);
+                    entry->charged = instance;
+                }
+                charge(*entry, instance, opened->memory_report().total().allocated_bytes);
+                entry->collection = std::move(opened);
+                loaded = true;
+            }
+            collection = entry->collection;
+        }
+        if (loaded) evict_if_needed(entry.get());
+        return collection;
+    }
+
+    /**
+     * @brief   更新条目的计费字节数
+     * @param   instance    计费的集合实例；不是条目当前加载的实例（已被卸载）时忽略
+     * @return  计费是否增长
+     */
+    bool charge(Entry& entry, const Collection* instance, size_t bytes) {
+        std::lock_guard<std::mutex> lock(entry.charge_mutex);
+        if (entry.charged != instance) return false;
+        bool grew = bytes > entry.charged_bytes;
+        loaded_bytes_ += bytes;
+        loaded_bytes_ -= entry.charged_bytes;
+        entry.charged_bytes = bytes;
+        return grew;
+    }
+
+    /**
+     * @brief   卸载条目中的集合，调用方需持有entry.mutex
+     */
+    void unload(Entry& entry) {
+        {
+            std::lock_guard<std::mutex> lock(entry.charge_mutex);
+            loaded_bytes_ -= entry.charged_bytes;
+            entry.charged_bytes = 0;
+            entry.charged = nullptr;
+        }
+        entry.collection.reset();
+    }
+
+    /**
+     * @brief   超出预算时按LRU淘汰，跳过刚访问的集合和仍被借出的集合
+     * @param   keep    不参与淘汰的条目
+     * @note    淘汰前写快照，之后的访问从磁盘重新加载；
+     *          淘汰中flush触发的内存回调不会再次进入淘汰
+     */
+    void evict_if_needed(Entry* keep) {
+        if (memory_budget_ == 0) return;
+        static thread_local bool evicting = false;
+        if (evicting) return;
+        evicting = true;
+        struct Reset { bool& flag; ~Reset() { flag = false; } } reset{evicting};
+
+        while (loaded_bytes_.load() > memory_budget_) {
+            std::shared_ptr<Entry> victim;
+            uint64_t oldest = UINT64_MAX;
+            for_each_entry([&](Entry& entry) {
+                if (&entry == keep) return;
+                std::lock_guard<std::mutex> lock(entry.mutex);
+                // 条目自身持有一份引用，多于一份说明仍有调用方在使用
+                if (entry.collection && entry.collection.use_count() == 1 && entry.last_access < oldest) {
+                    oldest = entry.last_access;
+                    victim = find_entry(entry.config.name);
+                }
+            });
+            if (!victim) return;
+
+            std::lock_guard<std::mutex> lock(victim->mutex);
+            // 借出只发生在持有条目锁时，此处检查后不会再有新的借用者
+            if (!victim->collection || victim->collection.use_count() > 1) continue;
+            victim->collection->flush();
+            unload(*victim);
+        }
+    }
+};
+
+} // namespace minimilvus
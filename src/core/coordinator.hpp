@@ -0,0 +1,592 @@
+/**
+ * @file    coordinator.hpp
+ * @brief   分片集群的查询协调节点
+ * @details 插入按全局ID哈希路由到分片，查询并发分发到所有分片，
+ *          把各分片返回的本地ID映射回全局ID后k路归并Top-K；
+ *          对迟迟未返回的分片发送对冲请求（hedged request）以削减长尾延迟
+ * @author  Tyooughtul
+ */
+
+#pragma once
+#include <string>
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <atomic>
+#include <chrono>
+#include <queue>
+#include <algorithm>
+#include <tuple>
+#include <functional>
+#include <stdexcept>
+#include <poll.h>
+#include <signal.h>
+#include <sys/wait.h>
+#include "rpc.hpp"
+#include "rwlock.hpp"
+
+namespace minimilvus {
+
+/**
+ * @brief   分片节点地址
+ */
+struct ShardEndpoint {
+    std::string host = "127.0.0.1";  ///< 主机地址
+    int port = 0;                    ///< 端口
+};
+
+/**
+ * @brief   协调节点配置
+ */
+struct CoordinatorOptions {
+    bool hedging = true;                                  ///< 是否启用对冲请求
+    std::chrono::microseconds hedge_delay{2000};          ///< 分片超过该时间未返回则发送对冲请求
+    std::chrono::milliseconds timeout{1000};              ///< 单次查询的总超时
+};
+
+/**
+ * @brief   按全局ID计算所属分片
+ * @param   global_id   全局ID
+ * @param   n_shards    分片数量
+ * @return  分片编号
+ * @note    先用splitmix64混合再取模，连续ID均匀分散到各分片
+ */
+inline size_t shard_for_id(idx_t global_id, size_t n_shards) {
+    uint64_t x = static_cast<uint64_t>(global_id) + 0x9e3779b97f4a7c15ULL;
+    x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    x = (x ^ (x >> 27)) * 0x94d049bb133111ebULL;
+    x ^= x >> 31;
+    return static_cast<size_t>(x % n_shards);
+}
+
+/**
+ * @brief   k路归并各分片的有序结果
+ * @param   shard_results   每个分片按距离升序的结果
+ * @param   k               返回结果数量
+ * @return  全局按距离升序的前K个结果
+ */
+inline std::vector<SearchResult> merge_topk(const std::vector<std::vector<SearchResult>>& shard_results, int k) {
+    // (距离, 分片, 分片内位置) 的最小堆
+    using Cursor = std::tuple<float, size_t, size_t>;
+    std::priority_queue<Cursor, std::vector<Cursor>, std::greater<Cursor>> heap;
+    for (size_t s = 0; s < shard_results.size(); ++s) {
+        if (!shard_results[s].empty()) heap.emplace(shard_results[s][0].distance, s, 0);
+    }
+    std::vector<SearchResult> merged;
+    merged.reserve(k);
+    while (!heap.empty() && merged.size() < static_cast<size_t>(k)) {
+        auto [dist, s, pos] = heap.top();
+        heap.pop();
+        merged.push_back(shard_results[s][pos]);
+        if (pos + 1 < shard_results[s].size()) {
+            heap.emplace(shard_results[s][pos + 1].distance, s, pos + 1);
+        }
+    }
+    return merged;
+}
+
+/**
+ * @brief   查询协调节点
+ * @details 插入时分配全局ID，按shard_for_id路由到分片并依次写入该分片的所有副本，
+ *          记录 分片内本地ID -> 全局ID 的映射；查询结果先按映射换回全局ID再归并。
+ *          没有经过本协调节点插入数据的分片（映射为空）视为自行返回全局ID，结果原样归并。
+ *          每个分片可以有多个副本地址：首个请求发往副本0，对冲请求轮转到下一个副本
+ *          （只有一个副本时发往同一进程的另一条连接，由该进程的另一个线程处理）。
+ *          所有请求在调用线程内用poll等待并非阻塞读取，先到的响应生效，落败的连接直接关闭。
+ *          某个副本连接失败或返回错误时转向该分片的下一个副本；
+ *          复用的空闲连接可能已被对端关闭，失败时先在同一副本上换新连接重试一次
+ */
+class Coordinator {
+public:
+    /**
+     * @brief   构造函数
+     * @param   shards      每个分片的副本地址列表
+     * @param   options     协调配置
+     */
+    Coordinator(std::vector<std::vector<ShardEndpoint>> shards, CoordinatorOptions options = {})
+        : options_(options) {
+        for (auto& replicas : shards) {
+            if (replicas.empty()) throw std::invalid_argument("Shard without endpoints");
+            for (auto& endpoint : replicas) pools_.push_back(std::make_unique<ConnectionPool>(endpoint));
+            shard_pool_offset_.push_back(pools_.size() - replicas.size());
+            shard_replicas_.push_back(replicas.size());
+        }
+        global_ids_.resize(shard_replicas_.size());
+    }
+
+    Coordinator(const Coordinator&) = delete;
+    Coordinator& operator=(const Coordinator&) = delete;
+
+    /**
+     * @brief   插入一个向量
+     * @param   vec     向量数据
+     * @return  分配的全局ID
+     * @throws  std::runtime_error 当分片的某个副本不可达、返回错误或超时，
+     *          或各副本返回的本地ID不一致、不连续时
+     * @note    插入不是幂等的，不对冲也不重试；目标分片需从空分片开始只经本协调节点写入，
+     *          本地ID才与映射表一一对应，插入失败后该分片需要重建。插入之间串行执行，可与search并发
+     */
+    idx_t insert(std::span<const float> vec) {
+        std::lock_guard<std::mutex> insert_lock(insert_mutex_);
+        const idx_t global_id = next_global_id_;
+        const size_t shard = shard_for_id(global_id, shard_replicas_.size());
+        const uint64_t request_id = next_request_id_++;
+        const std::string payload = encode_insert_request(request_id, vec);
+
+        idx_t local_id = -1;
+        for (size_t r = 0; r < shard_replicas_[shard]; ++r) {
+            idx_t replica_id = insert_on(shard_pool_offset_[shard] + r, request_id, payload);
+            if (r > 0 && replica_id != local_id) throw std::runtime_error("Shard replicas diverged on insert");
+            local_id = replica_id;
+        }
+        {
+            StdRWLock::WriteLock lock(id_lock_);
+            auto& ids = global_ids_[shard];
+            if (local_id != static_cast<idx_t>(ids.size())) {
+                throw std::runtime_error("Shard returned a non-contiguous local id");
+            }
+            ids.push_back(global_id);
+        }
+        next_global_id_++;
+        return global_id;
+    }
+
+    /**
+     * @brief   经本协调节点写入某分片的向量数
+     */
+    size_t shard_size(size_t shard) const {
+        StdRWLock::ReadLock lock(id_lock_);
+        return global_ids_.at(shard).size();
+    }
+
+    /**
+     * @brief   分发查询并合并结果
+     * @param   query   查询向量
+     * @param   k       返回结果数量
+     * @return  全局Top-K
+     * @throws  std::invalid_argument 当k不在[1, kMaxSearchK]内时
+     * @throws  std::runtime_error 当某个分片超时或全部副本失败时
+     */
+    std::vector<SearchResult> search(std::span<const float> query, int k) {
+        if (k <= 0 || k > kMaxSearchK) throw std::invalid_argument("Invalid k");
+        const size_t n_shards = shard_replicas_.size();
+        const uint64_t request_id = next_request_id_++;
+        const std::string payload = encode_search_request(request_id, k, query);
+
+        std::vector<std::vector<SearchResult>> shard_results(n_shards);
+        std::vector<bool> done(n_shards, false);
+        std::vector<int> attempts_sent(n_shards, 0);
+        std::vector<int> failures(n_shards, 0);
+        // 任何退出路径（含异常）都关闭未完成的连接：落败或超时的请求仍可能有未读响应，连接不能复用
+        AttemptSet attempts;
+        size_t remaining = n_shards;
+
+        for (size_t s = 0; s < n_shards; ++s) {
+            if (!send_attempt(s, 0, payload, attempts, false)) throw std::runtime_error("Shard unreachable");
+            attempts_sent[s] = 1;
+        }
+
+        auto start = std::chrono::steady_clock::now();
+        bool hedged = !options_.hedging;
+        while (remaining > 0) {
+            auto elapsed = std::chrono::steady_clock::now() - start;
+            if (elapsed >= options_.timeout) break;
+
+            if (!hedged && elapsed >= options_.hedge_delay) {
+                for (size_t s = 0; s < n_shards; ++s) {
+                    if (done[s]) continue;
+                    if (send_attempt(s, attempts_sent[s], payload, attempts, true)) {
+                        attempts_sent[s]++;
+                        hedges_sent_++;
+                    }
+                }
+                hedged = true;
+            }
+
+            // 未对冲前等到对冲时刻，对冲后等到总超时
+            auto next_deadline = hedged
+                ? std::chrono::duration_cast<std::chrono::nanoseconds>(options_.timeout)
+                : std::chrono::duration_cast<std::chrono::nanoseconds>(options_.hedge_delay);
+            auto wait = std::max(std::chrono::nanoseconds(0), next_deadline - elapsed);
+            timespec ts{static_cast<time_t>(wait.count() / 1000000000),
+                        static_cast<long>(wait.count() % 1000000000)};
+
+            std::vector<pollfd> fds;
+            std::vector<size_t> fd_attempt;
+            for (size_t i = 0; i < attempts.size(); ++i) {
+                if (attempts[i].fd < 0) continue;
+                fds.push_back({attempts[i].fd, POLLIN, 0});
+                fd_attempt.push_back(i);
+            }
+            if (fds.empty()) break;
+            if (::ppoll(fds.data(), fds.size(), &ts, nullptr) <= 0) continue;
+
+            for (size_t i = 0; i < fds.size(); ++i) {
+                if (!(fds[i].revents & (POLLIN | POLLERR | POLLHUP))) continue;
+                // 重试可能向attempts追加元素，不能跨越追加持有引用
+                const size_t index = fd_attempt[i];
+
+                MessageType type;
+                std::string response;
+                int status = try_recv_frame(attempts[index].fd, attempts[index].buffer, type, response);
+                if (status == 0) continue;
+
+                uint64_t response_id = 0;
+                std::vector<SearchResult> results;
+                bool ok = status > 0 && type == MessageType::SearchResponse;
+                if (ok) {
+                    try {
+                        decode_search_response(response, response_id, results);
+                    } catch (const std::exception&) {
+                        ok = false;
+                    }
+                }
+                Attempt& a = attempts[index];
+                const size_t shard = a.shard;
+                if (!ok || response_id != request_id) {
+                    ::close(a.fd);
+                    a.fd = -1;
+                    if (!done[shard] && !attempts.in_flight(shard)) {
+                        retry(a, attempts_sent[shard], failures[shard], payload, attempts);
+                    }
+                    continue;
+                }
+                pools_[a.pool]->release(a.fd);
+                a.fd = -1;
+                if (!done[shard]) {
+                    done[shard] = true;
+                    shard_results[shard] = std::move(results);
+                    remaining--;
+                    if (a.hedge) hedges_won_++;
+                }
+            }
+        }
+
+        if (remaining > 0) throw std::runtime_error("Shard search timed out");
+        to_global_ids(shard_results);
+        return merge_topk(shard_results, k);
+    }
+
+    /**
+     * @brief   已发送的对冲请求数
+     */
+    uint64_t hedges_sent() const { return hedges_sent_.load(); }
+
+    /**
+     * @brief   对冲请求先于原请求返回的次数
+     */
+    uint64_t hedges_won() const { return hedges_won_.load(); }
+
+    /**
+     * @brief   因连接失败或分片返回错误而重发的请求数
+     */
+    uint64_t retries() const { return retries_.load(); }
+
+private:
+    /**
+     * @brief   单个分片副本的空闲连接池
+     */
+    class ConnectionPool {
+    public:
+        explicit ConnectionPool(ShardEndpoint endpoint) : endpoint_(std::move(endpoint)) {}
+
+        ~ConnectionPool() {
+            for (int fd : idle_) ::close(fd);
+        }
+
+        /**
+         * @brief   取一条连接，优先复用空闲连接
+         * @param   reused  输出：是否为复用的连接
+         * @return  fd，连接失败返回-1
+         */
+        int acquire(bool& reused) {
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                if (!idle_.empty()) {
+                    int fd = idle_.back();
+                    idle_.pop_back();
+                    reused = true;
+                    return fd;
+                }
+            }
+            reused = false;
+            return connect();
+        }
+
+        /**
+         * @brief   新建一条连接（不经过空闲列表）
+         */
+        int connect() { return connect_tcp(endpoint_.host, endpoint_.port); }
+
+        void release(int fd) {
+            std::lock_guard<std::mutex> lock(mutex_);
+            idle_.push_back(fd);
+        }
+
+    private:
+        ShardEndpoint endpoint_;
+        std::mutex mutex_;
+        std::vector<int> idle_;
+    };
+
+    /**
+     * @brief   一次发往某分片副本的请求
+     */
+    struct Attempt {
+        size_t shard;        ///< 分片编号
+        size_t pool;         ///< 连接池编号
+        int fd;              ///< 连接，处理完后置为-1
+        bool hedge;          ///< 是否为对冲请求
+        bool reused;         ///< 连接是否取自空闲列表
+        std::string buffer;  ///< 已收到但尚未成帧的响应数据
+    };
+
+    /**
+     * @brief   一次查询的全部请求，析构时关闭仍未完成的连接
+     */
+    class AttemptSet {
+    public:
+        AttemptSet() = default;
+        ~AttemptSet() {
+            for (auto& a : attempts_) {
+                if (a.fd >= 0) ::close(a.fd);
+            }
+        }
+        AttemptSet(const AttemptSet&) = delete;
+        AttemptSet& operator=(const AttemptSet&) = delete;
+
+        void push_back(Attempt attempt) { attempts_.push_back(std::move(attempt)); }
+        size_t size() const { return attempts_.size(); }
+        Attempt& operator[](size_t i) { return attempts_[i]; }
+
+        /**
+         * @brief   分片是否还有未完成的请求
+         */
+        bool in_flight(size_t shard) const {
+            return std::any_of(attempts_.begin(), attempts_.end(),
+                               [shard](const Attempt& a) { return a.shard == shard && a.fd >= 0; });
+        }
+
+    private:
+        std::vector<Attempt> attempts_;
+    };
+
+    CoordinatorOptions options_;
+    std::vector<std::unique_ptr<ConnectionPool>> pools_;
+    std::vector<size_t> shard_pool_offset_;
+    std::vector<size_t> shard_replicas_;
+    std::atomic<uint64_t> next_request_id_{1};
+    std::atomic<uint64_t> hedges_sent_{0};
+    std::atomic<uint64_t> hedges_won_{0};
+    std::atomic<uint64_t> retries_{0};
+    std::mutex insert_mutex_;                       ///< 串行化插入，保证全局ID与本地ID按序对应
+    idx_t next_global_id_ = 0;                      ///< 下一个全局ID，受insert_mutex_保护
+    mutable StdRWLock id_lock_;                     ///< 保护global_ids_
+    std::vector<std::vector<idx_t>> global_ids_;    ///< 每个分片：本地ID -> 全局ID
+
+    /**
+     * @brief   把各分片结果中的本地ID换成全局ID
+     * @throws  std::runtime_error 当分片返回了映射表中没有的本地ID时
+     */
+    void to_global_ids(std::vector<std::vector<SearchResult>>& shard_results) const {
+        StdRWLock::ReadLock lock(id_lock_);
+        for (size_t s = 0; s < shard_results.size(); ++s) {
+            const auto& ids = global_ids_[s];
+            if (ids.empty()) continue;
+            for (auto& r : shard_results[s]) {
+                if (r.id < 0 || r.id >= static_cast<idx_t>(ids.size())) {
+                    throw std::runtime_error("Shard returned an unknown local id");
+                }
+                r.id = ids[r.id];
+            }
+        }
+    }
+
+    /**
+     * @brief   向一个副本发送插入请求并等待响应
+     * @return  副本返回的本地ID
+     * @throws  std::runtime_error 当连接失败、副本返回错误或超过options_.timeout时
+     */
+    idx_t insert_on(size_t pool, uint64_t request_id, const std::string& payload) {
+        bool reused = false;
+        int fd = send_on(pool, reused, MessageType::InsertRequest, payload);
+        if (fd < 0) throw std::runtime_error("Shard unreachable");
+
+        const auto deadline = std::chrono::steady_clock::now() + options_.timeout;
+        std::string buffer, response;
+        MessageType type;
+        int status = 0;
+        while (status == 0) {
+            auto wait = std::chrono::duration_cast<std::chrono::milliseconds>(deadline - std::chrono::steady_clock::now());
+            if (wait.count() <= 0) break;
+            pollfd pfd{fd, POLLIN, 0};
+            if (::poll(&pfd, 1, static_cast<int>(wait.count())) < 0 && errno != EINTR) break;
+            status = try_recv_frame(fd, buffer, type, response);
+        }
+        uint64_t response_id = 0;
+        idx_t local_id = -1;
+        bool ok = status > 0 && type == MessageType::InsertResponse;
+        if (ok) {
+            try {
+                decode_insert_response(response, response_id, local_id);
+            } catch (const std::exception&) {
+                ok = false;
+            }
+        }
+        if (!ok || response_id != request_id) {
+            ::close(fd);
+            throw std::runtime_error(status > 0 && type == MessageType::Error ? "Shard insert failed: " + response
+                                                                            : "Shard insert failed");
+        }
+        pools_[pool]->release(fd);
+        return local_id;
+    }
+
+    /**
+     * @brief   在一条连接上发送请求
+     * @return  成功时返回fd；失败时关闭连接，若是复用的连接则换新连接重试一次
+     */
+    int send_on(size_t pool, bool& reused, MessageType type, const std::string& payload) {
+        int fd = pools_[pool]->acquire(reused);
+        if (fd < 0 || send_frame(fd, type, payload)) return fd;
+        ::close(fd);
+        if (!reused) return -1;
+        reused = false;
+        fd = pools_[pool]->connect();
+        if (fd < 0 || send_frame(fd, type, payload)) return fd;
+        ::close(fd);
+        return -1;
+    }
+
+    /**
+     * @brief   向分片发送请求：从第attempt个副本开始，失败时依次尝试其余副本
+     * @return  是否有副本成功发出
+     */
+    bool send_attempt(size_t shard, int attempt, const std::string& payload, AttemptSet& attempts, bool hedge) {
+        const size_t replicas = shard_replicas_[shard];
+        for (size_t r = 0; r < replicas; ++r) {
+            size_t pool = shard_pool_offset_[shard] + (attempt + r) % replicas;
+            bool reused = false;
+            int fd = send_on(pool, reused, MessageType::SearchRequest, payload);
+            if (fd >= 0) {
+                attempts.push_back({shard, pool, fd, hedge, reused, {}});
+                return true;
+            }
+        }
+        return false;
+    }
+
+    /**
+     * @brief   分片的最后一个请求失败后重发
+     * @details 复用的连接可能在空闲期间被对端关闭，先在同一副本上用新连接重试；
+     *          否则转向下一个副本。每个分片最多重发 副本数+1 次
+     * @throws  std::runtime_error 当重试次数用尽或所有副本都无法连接时
+     */
+    void retry(const Attempt& failed, int& attempts_sent, int& failures,
+               const std::string& payload, AttemptSet& attempts) {
+        // failed指向attempts中的元素，追加新请求后失效，先取出需要的字段
+        const size_t shard = failed.shard, pool = failed.pool;
+        const bool hedge = failed.hedge, reused = failed.reused;
+        if (++failures > static_cast<int>(shard_replicas_[shard])) throw std::runtime_error("Shard unreachable");
+        retries_++;
+        if (reused) {
+            int fd = pools_[pool]->connect();
+            if (fd >= 0 && send_frame(fd, MessageType::SearchRequest, payload)) {
+                attempts.push_back({shard, pool, fd, hedge, false, {}});
+                return;
+            }
+            if (fd >= 0) ::close(fd);
+        }
+        if (!send_attempt(shard, attempts_sent++, payload, attempts, hedge)) {
+            throw std::runtime_error("Shard unreachable");
+        }
+    }
+};
+
+/**
+ * @brief   单机多进程分片集群（用于本地测试）
+ * @details 为每个分片fork一个子进程，子进程内调用工厂函数构建本分片的存储（如一个Collection）
+ *          及其搜索/插入函数并启动ShardServer；数据经Coordinator::insert按ID哈希写入各分片
+ * @note    应在父进程创建OpenMP线程之前启动，fork后的子进程只保留调用线程
+ */
+class LocalCluster {
+public:
+    /// 分片工厂：参数为分片编号，在子进程中调用，返回该分片的请求处理函数
+    using ShardFactory = std::function<ShardServer::Handlers(int shard)>;
+
+    /**
+     * @brief   启动集群
+     * @param   n_shards    分片数量
+     * @param   factory     分片工厂
+     * @throws  std::runtime_error 当子进程启动失败时
+     */
+    LocalCluster(int n_shards, const ShardFactory& factory) {
+        for (int s = 0; s < n_shards; ++s) {
+            int pipe_fds[2];
+            if (::pipe(pipe_fds) != 0) throw std::runtime_error("pipe failed");
+            pid_t pid = ::fork();
+            if (pid < 0) throw std::runtime_error("fork failed");
+            if (pid == 0) {
+                ::close(pipe_fds[0]);
+                int port = -1;
+                try {
+                    ShardServer server(factory(s));
+                    port = server.start();
+                    write_all_fd(pipe_fds[1], &port, sizeof(port));
+                    ::close(pipe_fds[1]);
+                    server.wait();
+                } catch (...) {
+                    write_all_fd(pipe_fds[1], &port, sizeof(port));
+                }
+                ::_exit(0);
+            }
+            ::close(pipe_fds[1]);
+            int port = -1;
+            ssize_t n = ::read(pipe_fds[0], &port, sizeof(port));
+            ::close(pipe_fds[0]);
+            pids_.push_back(pid);
+            if (n != sizeof(port) || port <= 0) {
+                shutdown();
+                throw std::runtime_error("Shard process failed to start");
+            }
+            endpoints_.push_back({{"127.0.0.1", port}});
+        }
+    }
+
+    ~LocalCluster() { shutdown(); }
+
+    LocalCluster(const LocalCluster&) = delete;
+    LocalCluster& operator=(const LocalCluster&) = delete;
+
+    /**
+     * @brief   各分片的地址，可直接用于构造Coordinator
+     */
+    const std::vector<std::vector<ShardEndpoint>>& endpoints() const { return endpoints_; }
+
+    /**
+     * @brief   终止所有分片进程
+     */
+    void shutdown() {
+        for (pid_t pid : pids_) {
+            ::kill(pid, SIGTERM);
+            ::waitpid(pid, nullptr, 0);
+        }
+        pids_.clear();
+    }
+
+private:
+    std::vector<pid_t> pids_;
+    std::vector<std::vector<ShardEndpoint>> endpoints_;
+
+    static void write_all_fd(int fd, const void* buf, size_t len) {
+        const char* p = static_cast<const char*>(buf);
+        while (len > 0) {
+            ssize_t n = ::write(fd, p, len);
+            if (n <= 0) return;
+            p += n;
+            len -= n;
+        }
+    }
+};
+
+} // namespace minimilvus
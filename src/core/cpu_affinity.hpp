@@ -0,0 +1,357 @@
+/**
+ * @file    cpu_affinity.hpp
+ * @brief   CPU亲和性与线程绑核
+ * @details 解析CPU列表、读取NUMA拓扑，按角色（I/O、搜索、后台）划分核心，
+ *          并把线程池、OpenMP和事件循环线程绑定到指定核心，保持每线程搜索缓冲区的L1/L2热度
+ * @author  Tyooughtul
+ */
+
+#pragma once
+#include <pthread.h>
+#include <sched.h>
+#include <omp.h>
+#include <algorithm>
+#include <cmath>
+#include <filesystem>
+#include <fstream>
+#include <map>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace minimilvus {
+
+/**
+ * @brief   解析Linux风格的CPU列表
+ * @param   list    如 "0-3,8,10-11"
+ * @return  升序去重的CPU编号
+ * @throws  std::invalid_argument 当格式错误时
+ */
+inline std::vector<int> parse_cpu_list(const std::string& list) {
+    std::vector<int> cpus;
+    std::stringstream ss(list);
+    std::string item;
+    while (std::getline(ss, item, ',')) {
+        item.erase(std::remove_if(item.begin(), item.end(), ::isspace), item.end());
+        if (item.empty()) continue;
+        try {
+            size_t dash = item.find('-');
+            int first = std::stoi(item.substr(0, dash));
+            int last = dash == std::string::npos ? first : std::stoi(item.substr(dash + 1));
+            if (first < 0 || last < first) throw std::invalid_argument(item);
+            for (int c = first; c <= last; ++c) cpus.push_back(c);
+        } catch (const std::exception&) {
+            throw std::invalid_argument("Invalid CPU list: " + list);
+        }
+    }
+    std::sort(cpus.begin(), cpus.end());
+    cpus.erase(std::unique(cpus.begin(), cpus.end()), cpus.end());
+    return cpus;
+}
+
+/**
+ * @brief   当前进程允许运行的CPU（受taskset/cpuset限制）
+ */
+inline std::vector<int> available_cpus() {
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    std::vector<int> cpus;
+    if (sched_getaffinity(0, sizeof(set), &set) == 0) {
+        for (int c = 0; c < CPU_SETSIZE; ++c) {
+            if (CPU_ISSET(c, &set)) cpus.push_back(c);
+        }
+    }
+    if (cpus.empty()) cpus.push_back(0);
+    return cpus;
+}
+
+namespace detail {
+
+/**
+ * @brief   读取一个cgroup v2目录的 cpu.max
+ * @return  配额对应的核数；未限制为0；文件不存在或无法解析为-1
+ */
+inline double read_cpu_max(const std::filesystem::path& dir) {
+    std::ifstream file(dir / "cpu.max");
+    std::string quota;
+    double period = 0;
+    if (!(file >> quota >> period)) return -1.0;
+    if (quota == "max" || period <= 0) return 0.0;
+    try {
+        return std::stod(quota) / period;
+    } catch (const std::exception&) {
+        return 0.0;
+    }
+}
+
+/**
+ * @brief   读取一个cgroup v1 cpu控制器目录的 cpu.cfs_quota_us / cpu.cfs_period_us
+ * @return  同read_cpu_max
+ */
+inline double read_cfs_quota(const std::filesystem::path& dir) {
+    std::ifstream quota_file(dir / "cpu.cfs_quota_us");
+    std::ifstream period_file(dir / "cpu.cfs_period_us");
+    double quota = 0, period = 0;
+    if (!(quota_file >> quota && period_file >> period)) return -1.0;
+    return quota > 0 && period > 0 ? quota / period : 0.0;
+}
+
+/**
+ * @brief   从进程所在的cgroup逐级向上直到挂载点，取各级配额中最小的限制
+ * @param   base    挂载点（v2为根，v1为cpu控制器目录）
+ * @param   group   进程所在的cgroup路径（/proc/self/cgroup中的第三列）
+ * @return  最小限制，未限制时为0；任何一级都没有配额文件时为-1
+ */
+template<typename Reader>
+double min_limit_along(const std::filesystem::path& base, const std::string& group, Reader read) {
+    double result = -1.0;
+    std::filesystem::path rel = std::filesystem::path(group).relative_path();
+    while (true) {
+        double limit = read(base / rel);
+        if (limit > 0) result = result > 0 ? std::min(result, limit) : limit;
+        else if (limit == 0 && result < 0) result = 0.0;
+        if (rel.empty()) break;
+        rel = rel.parent_path();
+    }
+    return result;
+}
+
+} // namespace detail
+
+/**
+ * @brief   cgroup限制的CPU配额（核数，可为小数）
+ * @param   root        cgroup挂载点
+ * @param   self_cgroup 描述本进程所属cgroup的文件
+ * @return  配额对应的核数，未限制或无法读取时返回0
+ * @details 先从 /proc/self/cgroup 解析本进程所在的cgroup（v2为 "0::/path"，
+ *          v1取含cpu控制器的一行），从该目录逐级向上直到挂载点，取最严格的限制；
+ *          依次尝试cgroup v2的 cpu.max（"quota period" 或 "max period"）
+ *          和cgroup v1的 cpu.cfs_quota_us / cpu.cfs_period_us（quota为-1表示不限制）。
+ *          没有cgroup命名空间的容器或systemd服务中，配额设在子cgroup上而不是挂载点
+ */
+inline double cgroup_cpu_limit(const std::filesystem::path& root = "/sys/fs/cgroup",
+                               const std::filesystem::path& self_cgroup = "/proc/self/cgroup") {
+    std::string v2_group = "/", v1_group = "/";
+    {
+        std::ifstream file(self_cgroup);
+        std::string line;
+        while (std::getline(file, line)) {
+            size_t first = line.find(':');
+            size_t second = first == std::string::npos ? first : line.find(':', first + 1);
+            if (second == std::string::npos) continue;
+            std::string controllers = line.substr(first + 1, second - first - 1);
+            std::string path = line.substr(second + 1);
+            if (line.compare(0, first, "0") == 0 && controllers.empty()) {
+                v2_group = path;
+                continue;
+            }
+            std::stringstream ss(controllers);
+            std::string controller;
+            while (std::getline(ss, controller, ',')) {
+                if (controller == "cpu") v1_group = path;
+            }
+        }
+    }
+
+    double limit = detail::min_limit_along(root, v2_group, detail::read_cpu_max);
+    if (limit >= 0) return limit;
+    for (const char* dir : {"cpu", "cpu,cpuacct", "cpuacct,cpu"}) {
+        limit = detail::min_limit_along(root / dir, v1_group, detail::read_cfs_quota);
+        if (limit >= 0) return limit;
+    }
+    return 0.0;
+}
+
+/**
+ * @brief   实际可用的并发数
+ * @details 取亲和性允许的CPU数与cgroup配额（向上取整）中的较小者；
+ *          容器中hardware_concurrency()返回宿主机核数，按它开线程会超订并被CFS限流
+ */
+inline int effective_cpu_count() {
+    int cpus = static_cast<int>(available_cpus().size());
+    double limit = cgroup_cpu_limit();
+    if (limit > 0) cpus = std::min(cpus, static_cast<int>(std::ceil(limit)));
+    return std::max(cpus, 1);
+}
+
+/**
+ * @brief   NUMA节点 -> 该节点上本进程可用的CPU
+ * @note    读取 /sys/devices/system/node，不可用时视为单节点
+ */
+inline std::map<int, std::vector<int>> numa_nodes() {
+    std::vector<int> allowed = available_cpus();
+    std::map<int, std::vector<int>> nodes;
+    const std::filesystem::path root = "/sys/devices/system/node";
+    std::error_code ec;
+    for (const auto& entry : std::filesystem::directory_iterator(root, ec)) {
+        std::string name = entry.path().filename().string();
+        if (name.rfind("node", 0) != 0 || name.size() == 4 ||
+            !std::all_of(name.begin() + 4, name.end(), ::isdigit)) continue;
+        std::ifstream file(entry.path() / "cpulist");
+        std::string list;
+        if (!std::getline(file, list)) continue;
+        std::vector<int> cpus;
+        for (int c : parse_cpu_list(list)) {
+            if (std::binary_search(allowed.begin(), allowed.end(), c)) cpus.push_back(c);
+        }
+        if (!cpus.empty()) nodes[std::stoi(name.substr(4))] = std::move(cpus);
+    }
+    if (nodes.empty()) nodes[0] = allowed;
+    return nodes;
+}
+
+/**
+ * @brief   把当前线程绑定到一组CPU
+ * @return  是否成功（CPU不在允许集合内时失败）
+ */
+inline bool pin_current_thread(const std::vector<int>& cpus) {
+    if (cpus.empty()) return false;
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    for (int c : cpus) {
+        if (c >= 0 && c < CPU_SETSIZE) CPU_SET(c, &set);
+    }
+    return pthread_setaffinity_np(pthread_self(), sizeof(set), &set) == 0;
+}
+
+/**
+ * @brief   当前线程绑定的CPU
+ */
+inline std::vector<int> current_thread_affinity() {
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    std::vector<int> cpus;
+    if (pthread_getaffinity_np(pthread_self(), sizeof(set), &set) == 0) {
+        for (int c = 0; c < CPU_SETSIZE; ++c) {
+            if (CPU_ISSET(c, &set)) cpus.push_back(c);
+        }
+    }
+    return cpus;
+}
+
+/**
+ * @brief   一组线程的绑核方案
+ * @details 第i个线程绑定到 sets[i % sets.size()]；sets为空表示不绑核
+ */
+struct AffinityPlan {
+    std::vector<std::vector<int>> sets;
+
+    /**
+     * @brief   不绑核
+     */
+    static AffinityPlan none() { return {}; }
+
+    /**
+     * @brief   每个线程独占一个核，线程数多于核数时轮转复用
+     */
+    static AffinityPlan per_core(const std::vector<int>& cpus) {
+        AffinityPlan plan;
+        for (int c : cpus) plan.sets.push_back({c});
+        return plan;
+    }
+
+    /**
+     * @brief   所有线程共享同一组核，由调度器在组内均衡
+     */
+    static AffinityPlan shared(const std::vector<int>& cpus) {
+        AffinityPlan plan;
+        if (!cpus.empty()) plan.sets.push_back(cpus);
+        return plan;
+    }
+
+    /**
+     * @brief   线程按NUMA节点轮转分组，每个线程可在本节点的所有核上运行
+     */
+    static AffinityPlan per_numa_node() {
+        AffinityPlan plan;
+        for (auto& [node, cpus] : numa_nodes()) plan.sets.push_back(cpus);
+        return plan;
+    }
+
+    bool empty() const { return sets.empty(); }
+
+    /**
+     * @brief   第i个线程应绑定的CPU
+     */
+    const std::vector<int>& for_thread(size_t i) const { return sets[i % sets.size()]; }
+
+    /**
+     * @brief   把当前线程按第i个线程的方案绑定
+     * @return  方案为空或绑定成功时返回true
+     */
+    bool apply(size_t i) const { return empty() || pin_current_thread(for_thread(i)); }
+};
+
+/**
+ * @brief   按角色划分的核心集合
+ * @details 网络I/O线程、搜索线程和后台线程（构建索引、flush等）使用互不重叠的核，
+ *          避免后台任务和网络中断打断搜索线程的缓存
+ */
+struct CoreLayout {
+    std::vector<int> io;            ///< 事件循环/网络线程
+    std::vector<int> search;        ///< 搜索线程池与OpenMP
+    std::vector<int> background;    ///< 后台任务
+
+    /**
+     * @brief   从可用核中按数量划分：前io_count个给I/O，后background_count个给后台，其余给搜索
+     * @note    核数不足时各角色共享全部核
+     */
+    static CoreLayout split(const std::vector<int>& cpus, size_t io_count = 1, size_t background_count = 1) {
+        CoreLayout layout;
+        if (cpus.size() < io_count + background_count + 1) {
+            layout.io = layout.search = layout.background = cpus;
+            return layout;
+        }
+        layout.io.assign(cpus.begin(), cpus.begin() + io_count);
+        layout.background.assign(cpus.end() - background_count, cpus.end());
+        layout.search.assign(cpus.begin() + io_count, cpus.end() - background_count);
+        return layout;
+    }
+
+    /**
+     * @brief   解析配置，如 "io=0;search=1-6;background=7"
+     * @throws  std::invalid_argument 当格式错误时
+     * @note    未指定的角色使用全部可用核
+     */
+    static CoreLayout parse(const std::string& spec) {
+        CoreLayout layout;
+        std::stringstream ss(spec);
+        std::string item;
+        while (std::getline(ss, item, ';')) {
+            if (item.empty()) continue;
+            size_t eq = item.find('=');
+            if (eq == std::string::npos) throw std::invalid_argument("Invalid core layout: " + spec);
+            std::string role = item.substr(0, eq);
+            std::vector<int> cpus = parse_cpu_list(item.substr(eq + 1));
+            if (role == "io") layout.io = cpus;
+            else if (role == "search") layout.search = cpus;
+            else if (role == "background") layout.background = cpus;
+            else throw std::invalid_argument("Unknown core role: " + role);
+        }
+        std::vector<int> all = available_cpus();
+        for (auto* cpus : {&layout.io, &layout.search, &layout.background}) {
+            if (cpus->empty()) *cpus = all;
+        }
+        return layout;
+    }
+};
+
+/**
+ * @brief   按方案绑定OpenMP线程池中的每个线程
+ * @param   plan    绑核方案，第i个OpenMP线程使用plan.for_thread(i)
+ * @return  全部绑定成功时返回true
+ * @note    libgomp复用线程，之后的并行区域沿用绑定；传入none()不做任何事。
+ *          要恢复不绑核，可传入 AffinityPlan::shared(available_cpus())
+ */
+inline bool pin_openmp_threads(const AffinityPlan& plan) {
+    if (plan.empty()) return true;
+    bool ok = true;
+    #pragma omp parallel reduction(&& : ok)
+    {
+        ok = plan.apply(omp_get_thread_num());
+    }
+    return ok;
+}
+
+} // namespace minimilvus
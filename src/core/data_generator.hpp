@@ -0,0 +1,241 @@
+/**
+ * @file    data_generator.hpp
+ * @brief   可复现的合成数据集生成器
+ * @details 基于计数器的随机数生成，按块并行生成向量，结果与线程数无关；
+ *          支持把生成结果缓存为数据集文件，重复运行benchmark时直接加载
+ * @author  Tyooughtul
+ */
+
+#pragma once
+#include <vector>
+#include <string>
+#include <cmath>
+#include <algorithm>
+#include <cstdint>
+#include <filesystem>
+#include <iostream>
+#include <omp.h>
+#include "dataset.hpp"
+
+namespace minimilvus {
+
+/**
+ * @brief   基于计数器的随机数生成器
+ * @details 由(seed, stream)唯一确定一条随机序列，第i个数只依赖于i，
+ *          因此每个向量可以在任意线程上独立生成且结果确定
+ */
+class CounterRng {
+public:
+    CounterRng(uint64_t seed, uint64_t stream) : key_(mix(seed ^ mix(stream + 0x9E3779B97F4A7C15ull))) {}
+
+    /**
+     * @brief   下一个64位随机数
+     */
+    uint64_t next_u64() {
+        return mix(key_ + (counter_++) * 0x9E3779B97F4A7C15ull);
+    }
+
+    /**
+     * @brief   [0, 1) 均匀分布
+     */
+    float uniform() {
+        return (next_u64() >> 40) * (1.0f / 16777216.0f);
+    }
+
+    /**
+     * @brief   [lo, hi) 均匀分布
+     */
+    float uniform(float lo, float hi) {
+        return lo + (hi - lo) * uniform();
+    }
+
+    /**
+     * @brief   标准正态分布（Box-Muller，成对生成）
+     */
+    float normal() {
+        if (has_spare_) {
+            has_spare_ = false;
+            return spare_;
+        }
+        float u1 = uniform();
+        float u2 = uniform();
+        if (u1 < 1e-7f) u1 = 1e-7f;
+        float r = std::sqrt(-2.0f * std::log(u1));
+        float theta = 6.28318530718f * u2;
+        spare_ = r * std::sin(theta);
+        has_spare_ = true;
+        return r * std::cos(theta);
+    }
+
+private:
+    uint64_t key_;
+    uint64_t counter_ = 0;
+    float spare_ = 0.0f;
+    bool has_spare_ = false;
+
+    /// SplitMix64终结函数，作为无状态的混合函数
+    static uint64_t mix(uint64_t z) {
+        z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+        z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+        return z ^ (z >> 31);
+    }
+};
+
+/**
+ * @brief   合成数据分布类型
+ */
+enum class DataDistribution {
+    Clustered,       ///< 高斯混合，各簇等概率
+    Uniform,         ///< [-10, 10] 均匀分布
+    Anisotropic,     ///< 高斯混合，各维方差按维度衰减（模拟embedding低方差维）
+    SkewedClusters   ///< 高斯混合，簇大小服从Zipf分布
+};
+
+/**
+ * @brief   数据生成配置
+ */
+struct DataGenConfig {
+    int dim = 128;                                        ///< 向量维度
+    int64_t count = 0;                                    ///< 向量数量
+    int n_centers = 100;                                  ///< 簇数量
+    float noise_stddev = 1.0f;                            ///< 簇内噪声标准差
+    float zipf_s = 1.1f;                                  ///< SkewedClusters的Zipf指数
+    DataDistribution distribution = DataDistribution::Clustered;  ///< 分布类型
+    uint64_t seed = 42;                                   ///< 随机种子
+
+    /**
+     * @brief   生成可作为缓存文件名的唯一标识
+     */
+    std::string cache_key() const {
+        static const char* names[] = {"clustered", "uniform", "aniso", "skewed"};
+        return std::string(names[static_cast<int>(distribution)]) +
+               "_d" + std::to_string(dim) + "_n" + std::to_string(count) +
+               "_c" + std::to_string(n_centers) + "_s" + std::to_string(seed) +
+               "_sd" + std::to_string(static_cast<int>(noise_stddev * 1000)) +
+               "_z" + std::to_string(static_cast<int>(zipf_s * 1000));
+    }
+};
+
+/**
+ * @brief   合成数据集生成器
+ * @details 第i个向量使用stream=i的独立随机序列，按块并行填充；
+ *          查询向量使用独立的stream区间，与数据向量不重叠
+ */
+class DataGenerator {
+public:
+    explicit DataGenerator(const DataGenConfig& config) : config_(config) {
+        CounterRng rng(config_.seed, kCenterStream);
+        centers_.resize(static_cast<size_t>(config_.n_centers) * config_.dim);
+        for (auto& v : centers_) v = rng.uniform(-10.0f, 10.0f);
+
+        // 各维的缩放系数：Anisotropic下按 1/sqrt(1+d) 衰减
+        scales_.assign(config_.dim, 1.0f);
+        if (config_.distribution == DataDistribution::Anisotropic) {
+            for (int d = 0; d < config_.dim; ++d) {
+                scales_[d] = 4.0f / std::sqrt(1.0f + d);
+            }
+        }
+
+        // 簇选择的累积分布：Skewed按Zipf，其余等概率
+        cdf_.resize(config_.n_centers);
+        double total = 0.0;
+        for (int c = 0; c < config_.n_centers; ++c) {
+            double w = config_.distribution == DataDistribution::SkewedClusters
+                       ? 1.0 / std::pow(c + 1.0, config_.zipf_s) : 1.0;
+            total += w;
+            cdf_[c] = total;
+        }
+        for (auto& v : cdf_) v /= total;
+    }
+
+    /**
+     * @brief   生成第index个向量
+     * @param   index   向量序号（决定随机流）
+     * @param   out     输出缓冲区，长度为dim
+     */
+    void generate_one(uint64_t index, float* out) const {
+        CounterRng rng(config_.seed, index);
+        if (config_.distribution == DataDistribution::Uniform) {
+            for (int d = 0; d < config_.dim; ++d) out[d] = rng.uniform(-10.0f, 10.0f);
+            return;
+        }
+        float u = rng.uniform();
+        int c = static_cast<int>(std::lower_bound(cdf_.begin(), cdf_.end(), u) - cdf_.begin());
+        if (c >= config_.n_centers) c = config_.n_centers - 1;
+        const float* center = centers_.data() + static_cast<size_t>(c) * config_.dim;
+        for (int d = 0; d < config_.dim; ++d) {
+            out[d] = center[d] + rng.normal() * config_.noise_stddev * scales_[d];
+        }
+    }
+
+    /**
+     * @brief   并行生成整个数据集
+     * @return  包含config.count个向量的数据集
+     */
+    VectorDataset generate() const {
+        VectorDataset dataset(config_.dim);
+        float* out = dataset.extend(config_.count).data();
+        #pragma omp parallel for schedule(static, kBlockSize)
+        for (int64_t i = 0; i < config_.count; ++i) {
+            generate_one(static_cast<uint64_t>(i), out + i * config_.dim);
+        }
+        return dataset;
+    }
+
+    /**
+     * @brief   生成查询向量，与数据集同分布但随机流不重叠
+     * @param   n   查询数量
+     */
+    std::vector<std::vector<float>> generate_queries(int n) const {
+        std::vector<std::vector<float>> queries(n, std::vector<float>(config_.dim));
+        for (int i = 0; i < n; ++i) {
+            generate_one(kQueryStreamBase + i, queries[i].data());
+        }
+        return queries;
+    }
+
+    /**
+     * @brief   优先从缓存目录加载，否则生成并写入缓存
+     * @param   cache_dir   缓存目录，不存在会自动创建
+     * @return  数据集
+     * @note    缓存损坏或读取失败时重新生成并覆盖
+     */
+    VectorDataset generate_or_load(const std::string& cache_dir) const {
+        namespace fs = std::filesystem;
+        fs::path path = fs::path(cache_dir) / (config_.cache_key() + ".mmvd");
+        if (fs::exists(path)) {
+            try {
+                VectorDataset cached = VectorDataset::load(path.string());
+                if (cached.get_dim() == config_.dim && cached.get_count() == config_.count) {
+                    std::cout << "Loaded cached dataset " << path << std::endl;
+                    return cached;
+                }
+            } catch (const std::exception& e) {
+                std::cerr << "Ignoring bad dataset cache: " << e.what() << std::endl;
+            }
+        }
+        VectorDataset dataset = generate();
+        std::error_code ec;
+        fs::create_directories(cache_dir, ec);
+        try {
+            dataset.save(path.string());
+        } catch (const std::exception& e) {
+            std::cerr << "Failed to write dataset cache: " << e.what() << std::endl;
+        }
+        return dataset;
+    }
+
+    const DataGenConfig& config() const { return config_; }
+
+private:
+    static constexpr int kBlockSize = 1024;
+    static constexpr uint64_t kCenterStream = ~0ull;
+    static constexpr uint64_t kQueryStreamBase = 1ull << 62;
+
+    DataGenConfig config_;
+    std::vector<float> centers_;
+    std::vector<float> scales_;
+    std::vector<double> cdf_;
+};
+
+} // namespace minimilvus
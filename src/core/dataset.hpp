@@ -9,6 +9,11 @@
 #include <vector>
 #include <stdexcept>
 #include <span>
+#include <string>
+#include <fstream>
+#include <limits>
+#include <cstdint>
+#include "memory_stats.hpp"
 
 namespace minimilvus {
 
@@ -43,6 +48,89 @@ public:
         cnt_++;
     }
 
+    /**
+     * @brief   批量添加向量
+     * @param   data    按行优先扁平存储的若干向量，长度必须是维度的整数倍
+     * @throws  std::invalid_argument 当长度不是维度整数倍时
+     * @note    比逐个add少一次临时vector的构造和拷贝
+     */
+    void add_batch(std::span<const scalar_t> data) {
+        if (data.size() % dim_ != 0) throw std::invalid_argument("Dimension Mismatch");
+        data_.insert(data_.end(), data.begin(), data.end());
+        cnt_ += data.size() / dim_;
+    }
+
+    /**
+     * @brief   在末尾追加n个零向量，返回其可写视图
+     * @param   n       追加的向量数量
+     * @return  新增向量的扁平化可写视图，供调用方并行填充
+     * @note    视图在下一次改变数据集大小的操作后失效
+     */
+    std::span<scalar_t> extend(idx_t n) {
+        size_t old_size = data_.size();
+        data_.resize(old_size + n * dim_);
+        cnt_ += n;
+        return {data_.data() + old_size, static_cast<size_t>(n * dim_)};
+    }
+
+    /**
+     * @brief   预留容量
+     * @param   n       预计的向量总数
+     */
+    void reserve(idx_t n) {
+        data_.reserve(n * dim_);
+    }
+
+    /**
+     * @brief   保存数据集到文件
+     * @param   path    文件路径
+     * @throws  std::runtime_error 当文件无法写入时
+     * @note    文件格式：magic(4B) | dim(8B) | count(8B) | float数据
+     */
+    void save(const std::string& path) const {
+        std::ofstream file(path, std::ios::binary | std::ios::trunc);
+        if (!file.is_open()) throw std::runtime_error("Failed to open dataset file: " + path);
+        file.write(kFileMagic, 4);
+        file.write(reinterpret_cast<const char*>(&dim_), sizeof(dim_));
+        file.write(reinterpret_cast<const char*>(&cnt_), sizeof(cnt_));
+        file.write(reinterpret_cast<const char*>(data_.data()), data_.size() * sizeof(scalar_t));
+        if (!file) throw std::runtime_error("Failed to write dataset file: " + path);
+    }
+
+    /**
+     * @brief   从文件加载数据集
+     * @param   path    文件路径
+     * @return  加载的数据集
+     * @throws  std::runtime_error 当文件不存在、格式错误或被截断时
+     */
+    static VectorDataset load(const std::string& path) {
+        std::ifstream file(path, std::ios::binary);
+        if (!file.is_open()) throw std::runtime_error("Failed to open dataset file: " + path);
+        char magic[4];
+        int64_t dim = 0, cnt = 0;
+        file.read(magic, 4);
+        file.read(reinterpret_cast<char*>(&dim), sizeof(dim));
+        file.read(reinterpret_cast<char*>(&cnt), sizeof(cnt));
+        if (!file || std::string(magic, 4) != std::string(kFileMagic, 4) || dim <= 0 || cnt < 0 ||
+            dim > std::numeric_limits<int>::max()) {
+            throw std::runtime_error("Invalid dataset file: " + path);
+        }
+        // 按文件实际剩余大小校验头部的count，避免损坏的头部触发超大分配或读入未初始化数据
+        std::streamoff data_start = file.tellg();
+        file.seekg(0, std::ios::end);
+        uint64_t remaining = static_cast<uint64_t>(file.tellg() - data_start);
+        file.seekg(data_start);
+        if (static_cast<uint64_t>(cnt) > remaining / (static_cast<uint64_t>(dim) * sizeof(scalar_t))) {
+            throw std::runtime_error("Truncated dataset file: " + path);
+        }
+        VectorDataset dataset(static_cast<int>(dim));
+        dataset.data_.resize(dim * cnt);
+        file.read(reinterpret_cast<char*>(dataset.data_.data()), dataset.data_.size() * sizeof(scalar_t));
+        if (!file) throw std::runtime_error("Truncated dataset file: " + path);
+        dataset.cnt_ = cnt;
+        return dataset;
+    }
+
     /**
      * @brief   获取指定索引的向量
      * @param   i       向量索引
@@ -63,7 +151,21 @@ public:
      * @return  向量总数
      */
     int64_t get_count() const { return cnt_; }
+
+    /**
+     * @brief   获取向量数据的内存占用
+     * @return  扁平数组的使用量与分配量
+     */
+    MemoryUsage memory_usage() const { return vector_memory(data_); }
+
+    /**
+     * @brief   释放扩容留下的空闲容量
+     */
+    void shrink_to_fit() { data_.shrink_to_fit(); }
     
+    /// 数据集文件头的魔数
+    static constexpr char kFileMagic[4] = {'M', 'M', 'V', 'D'};
+
 private:
     int64_t dim_ = 0;      ///< 向量维度
     int64_t cnt_ = 0;      ///< 向量数量
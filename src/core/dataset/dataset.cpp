@@ -4,6 +4,8 @@
  */
 
 #include "dataset.hpp"
+#include <fstream>
+#include <limits>
 
 namespace minimilvus {
 
@@ -13,6 +15,57 @@ void VectorDataset::add(const std::vector<float>& vec) {
     cnt_++;
 }
 
+void VectorDataset::add_batch(std::span<const float> data) {
+    if (data.size() % dim_ != 0) throw std::invalid_argument("Dimension Mismatch");
+    data_.insert(data_.end(), data.begin(), data.end());
+    cnt_ += data.size() / dim_;
+}
+
+std::span<float> VectorDataset::extend(idx_t n) {
+    size_t old_size = data_.size();
+    data_.resize(old_size + n * dim_);
+    cnt_ += n;
+    return {data_.data() + old_size, static_cast<size_t>(n * dim_)};
+}
+
+void VectorDataset::save(const std::string& path) const {
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+    if (!file.is_open()) throw std::runtime_error("Failed to open dataset file: " + path);
+    file.write(kFileMagic, 4);
+    file.write(reinterpret_cast<const char*>(&dim_), sizeof(dim_));
+    file.write(reinterpret_cast<const char*>(&cnt_), sizeof(cnt_));
+    file.write(reinterpret_cast<const char*>(data_.data()), data_.size() * sizeof(float));
+    if (!file) throw std::runtime_error("Failed to write dataset file: " + path);
+}
+
+VectorDataset VectorDataset::load(const std::string& path) {
+    std::ifstream file(path, std::ios::binary);
+    if (!file.is_open()) throw std::runtime_error("Failed to open dataset file: " + path);
+    char magic[4];
+    int64_t dim = 0, cnt = 0;
+    file.read(magic, 4);
+    file.read(reinterpret_cast<char*>(&dim), sizeof(dim));
+    file.read(reinterpret_cast<char*>(&cnt), sizeof(cnt));
+    if (!file || std::string(magic, 4) != std::string(kFileMagic, 4) || dim <= 0 || cnt < 0 ||
+        dim > std::numeric_limits<int>::max()) {
+        throw std::runtime_error("Invalid dataset file: " + path);
+    }
+    // 按文件实际剩余大小校验头部的count，避免损坏的头部触发超大分配或读入未初始化数据
+    std::streamoff data_start = file.tellg();
+    file.seekg(0, std::ios::end);
+    uint64_t remaining = static_cast<uint64_t>(file.tellg() - data_start);
+    file.seekg(data_start);
+    if (static_cast<uint64_t>(cnt) > remaining / (static_cast<uint64_t>(dim) * sizeof(float))) {
+        throw std::runtime_error("Truncated dataset file: " + path);
+    }
+    VectorDataset dataset(static_cast<int>(dim));
+    dataset.data_.resize(dim * cnt);
+    file.read(reinterpret_cast<char*>(dataset.data_.data()), dataset.data_.size() * sizeof(float));
+    if (!file) throw std::runtime_error("Truncated dataset file: " + path);
+    dataset.cnt_ = cnt;
+    return dataset;
+}
+
 std::span<const float> VectorDataset::get_vector(idx_t i) const {
     return {data_.data() + i * dim_, static_cast<size_t>(dim_)};
 }
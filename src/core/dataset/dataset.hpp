@@ -8,6 +8,9 @@
 #include <vector>
 #include <stdexcept>
 #include <span>
+#include <string>
+#include <cstdint>
+#include "../memory_stats.hpp"
 
 namespace minimilvus {
 
@@ -23,11 +26,27 @@ public:
 
     void add(const std::vector<scalar_t>& vec);
 
+    void add_batch(std::span<const scalar_t> data);
+
+    std::span<scalar_t> extend(idx_t n);
+
+    void reserve(idx_t n) { data_.reserve(n * dim_); }
+
+    void save(const std::string& path) const;
+
+    static VectorDataset load(const std::string& path);
+
     std::span<const scalar_t> get_vector(idx_t i) const;
 
     int64_t get_dim() const { return dim_; }
 
     int64_t get_count() const { return cnt_; }
+
+    MemoryUsage memory_usage() const { return vector_memory(data_); }
+
+    void shrink_to_fit() { data_.shrink_to_fit(); }
+
+    static constexpr char kFileMagic[4] = {'M', 'M', 'V', 'D'};
     
 private:
     int64_t dim_ = 0;
@@ -0,0 +1,347 @@
+/**
+ * @file    event_loop.hpp
+ * @brief   基于epoll的协程事件循环
+ * @details 协程可以在循环上等待fd可读/可写、定时器以及io_uring完成事件，
+ *          挂起期间不占用线程，一个循环线程即可复用成千上万个在途请求
+ * @author  Tyooughtul
+ */
+
+#pragma once
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <coroutine>
+#include <cstring>
+#include <functional>
+#include <mutex>
+#include <queue>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+#include "task.hpp"
+#include "io_uring.hpp"
+#include "mpmc_queue.hpp"
+#include "cpu_affinity.hpp"
+
+namespace minimilvus {
+
+/**
+ * @brief   协程事件循环
+ * @details run()所在线程为循环线程：readable/writable/sleep_for只能在循环线程中co_await；
+ *          post/schedule/stop可以在任意线程调用。跨线程投递走无锁MPMC队列，
+ *          只有循环即将或已经阻塞在epoll_wait时才写eventfd唤醒
+ */
+class EventLoop {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    /// 默认投递队列容量，超出部分进入加锁的溢出队列
+    static constexpr size_t kDefaultQueueCapacity = 1 << 14;
+
+    /**
+     * @brief   构造函数
+     * @param   queue_capacity  跨线程投递队列的容量
+     * @throws  std::runtime_error 当epoll或eventfd创建失败时
+     */
+    explicit EventLoop(size_t queue_capacity = kDefaultQueueCapacity) : ready_(queue_capacity) {
+        epoll_fd_ = ::epoll_create1(EPOLL_CLOEXEC);
+        wake_fd_ = ::eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+        if (epoll_fd_ < 0 || wake_fd_ < 0) {
+            if (epoll_fd_ >= 0) ::close(epoll_fd_);
+            if (wake_fd_ >= 0) ::close(wake_fd_);
+            throw std::runtime_error("EventLoop init failed");
+        }
+        epoll_event ev{};
+        ev.events = EPOLLIN;
+        ev.data.ptr = &wake_tag_;
+        ::epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, wake_fd_, &ev);
+    }
+
+    /**
+     * @brief   析构函数
+     * @note    仍挂起在本循环上的协程不会被恢复，调用方应先让它们退出
+     */
+    ~EventLoop() {
+        ::close(wake_fd_);
+        ::close(epoll_fd_);
+    }
+
+    EventLoop(const EventLoop&) = delete;
+    EventLoop& operator=(const EventLoop&) = delete;
+
+    /**
+     * @brief   设置循环线程绑定的CPU，在run()开始时生效
+     * @param   cpus    CPU列表，为空表示不绑核
+     * @note    通常取CoreLayout::io，使网络线程与搜索线程不争抢同一个核
+     */
+    void set_affinity(std::vector<int> cpus) { affinity_ = std::move(cpus); }
+
+    /**
+     * @brief   运行事件循环直到stop()
+     * @note    stop()之后循环不能再次运行
+     */
+    void run() {
+        loop_thread_ = std::this_thread::get_id();
+        if (!affinity_.empty()) pin_current_thread(affinity_);
+        std::vector<epoll_event> events(256);
+        while (running_) {
+            run_ready();
+            fire_timers();
+            if (ring_ && ring_->pending() > 0) ring_->submit(0);
+
+            int timeout = next_timeout_ms();
+            if (timeout != 0) {
+                // 与post()中的栅栏配对：要么post看到sleeping_并唤醒，要么这里看到新任务
+                sleeping_.store(true, std::memory_order_relaxed);
+                std::atomic_thread_fence(std::memory_order_seq_cst);
+                if (has_ready() || !running_) timeout = 0;
+            }
+            int n = ::epoll_wait(epoll_fd_, events.data(), static_cast<int>(events.size()), timeout);
+            sleeping_.store(false, std::memory_order_relaxed);
+            if (n < 0 && errno != EINTR) throw std::runtime_error("epoll_wait failed");
+            for (int i = 0; i < n; ++i) {
+                void* tag = events[i].data.ptr;
+                if (tag == &wake_tag_) {
+                    uint64_t value;
+                    while (::read(wake_fd_, &value, sizeof(value)) > 0) {}
+                } else if (tag == &ring_tag_) {
+                    ring_->process_completions();
+                } else {
+                    static_cast<FdWaiter*>(tag)->handle.resume();
+                }
+            }
+        }
+        loop_thread_ = std::thread::id();
+    }
+
+    /**
+     * @brief   请求循环退出（线程安全）
+     */
+    void stop() {
+        running_ = false;
+        wake();
+    }
+
+    /**
+     * @brief   在循环线程中执行一个函数（线程安全）
+     * @note    溢出队列非空期间新任务一律进入溢出队列，直到其被取空，
+     *          保证同一线程投递的任务按投递顺序执行
+     */
+    void post(std::function<void()> fn) {
+        if (overflow_size_.load(std::memory_order_acquire) > 0 || !ready_.try_push(std::move(fn))) {
+            std::lock_guard<std::mutex> lock(overflow_mutex_);
+            overflow_.push_back(std::move(fn));
+            overflow_size_.fetch_add(1, std::memory_order_release);
+        }
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (sleeping_.load(std::memory_order_relaxed)) wake();
+    }
+
+    /**
+     * @brief   当前线程是否为循环线程
+     */
+    bool in_loop_thread() const { return loop_thread_ == std::this_thread::get_id(); }
+
+    /**
+     * @brief   转移到循环线程继续执行，例如在线程池完成搜索后回到循环写响应
+     */
+    auto schedule() {
+        struct Awaiter {
+            EventLoop& loop;
+            bool await_ready() const noexcept { return false; }
+            void await_suspend(std::coroutine_handle<> handle) {
+                loop.post([handle] { handle.resume(); });
+            }
+            void await_resume() const noexcept {}
+        };
+        return Awaiter{*this};
+    }
+
+    /**
+     * @brief   等待fd可读
+     * @note    同一个fd同一时刻只能有一个协程在等待
+     */
+    auto readable(int fd) { return FdAwaiter{*this, fd, EPOLLIN}; }
+
+    /**
+     * @brief   等待fd可写
+     */
+    auto writable(int fd) { return FdAwaiter{*this, fd, EPOLLOUT}; }
+
+    /**
+     * @brief   挂起一段时间（如批处理窗口），期间循环继续处理其他协程
+     */
+    auto sleep_for(std::chrono::nanoseconds duration) {
+        struct Awaiter {
+            EventLoop& loop;
+            Clock::time_point deadline;
+            bool await_ready() const noexcept { return deadline <= Clock::now(); }
+            void await_suspend(std::coroutine_handle<> handle) {
+                loop.timers_.push({deadline, loop.timer_seq_++, handle});
+            }
+            void await_resume() const noexcept {}
+        };
+        return Awaiter{*this, Clock::now() + duration};
+    }
+
+    /**
+     * @brief   由本循环驱动io_uring
+     * @param   ring    io_uring实例，之后只能在循环线程中使用
+     * @details 循环在每轮等待前提交排队的请求，ring fd可读时处理完成事件并恢复co_await的协程
+     */
+    void attach(IoUring& ring) {
+        ring_ = &ring;
+        epoll_event ev{};
+        ev.events = EPOLLIN;
+        ev.data.ptr = &ring_tag_;
+        if (::epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, ring.fd(), &ev) != 0) {
+            ring_ = nullptr;
+            throw std::runtime_error("Failed to attach io_uring to event loop");
+        }
+    }
+
+private:
+    struct FdWaiter {
+        std::coroutine_handle<> handle;
+    };
+
+    struct FdAwaiter {
+        EventLoop& loop;
+        int fd;
+        uint32_t events;
+        FdWaiter waiter{};
+
+        bool await_ready() const noexcept { return false; }
+
+        bool await_suspend(std::coroutine_handle<> handle) {
+            waiter.handle = handle;
+            epoll_event ev{};
+            ev.events = events | EPOLLONESHOT;
+            ev.data.ptr = &waiter;
+            if (::epoll_ctl(loop.epoll_fd_, EPOLL_CTL_MOD, fd, &ev) != 0) {
+                if (errno != ENOENT || ::epoll_ctl(loop.epoll_fd_, EPOLL_CTL_ADD, fd, &ev) != 0) {
+                    return false;   // 无法等待（如fd已关闭），直接继续，由后续I/O报告错误
+                }
+            }
+            return true;
+        }
+
+        void await_resume() const noexcept {}
+    };
+
+    struct Timer {
+        Clock::time_point deadline;
+        uint64_t seq;
+        std::coroutine_handle<> handle;
+        bool operator>(const Timer& other) const {
+            return deadline != other.deadline ? deadline > other.deadline : seq > other.seq;
+        }
+    };
+
+    int epoll_fd_ = -1;
+    int wake_fd_ = -1;
+    char wake_tag_ = 0;
+    char ring_tag_ = 0;
+    IoUring* ring_ = nullptr;
+    std::vector<int> affinity_;                 ///< 循环线程绑定的CPU
+    std::atomic<bool> running_{true};
+    std::atomic<bool> sleeping_{false};         ///< 循环是否可能阻塞在epoll_wait
+    std::atomic<std::thread::id> loop_thread_{};
+    MPMCQueue<std::function<void()>> ready_;    ///< 跨线程投递的任务
+    std::mutex overflow_mutex_;
+    std::vector<std::function<void()>> overflow_;
+    std::atomic<size_t> overflow_size_{0};
+    std::priority_queue<Timer, std::vector<Timer>, std::greater<Timer>> timers_;
+    uint64_t timer_seq_ = 0;
+
+    void wake() {
+        uint64_t one = 1;
+        [[maybe_unused]] ssize_t n = ::write(wake_fd_, &one, sizeof(one));
+    }
+
+    bool has_ready() const {
+        return ready_.size_approx() > 0 || overflow_size_.load(std::memory_order_relaxed) > 0;
+    }
+
+    /**
+     * @brief   执行已投递的任务
+     * @note    只执行本轮开始时已有的任务，避免任务不断投递新任务导致饿死I/O；
+     *          溢出队列中的任务都晚于无锁队列中的任务，先取空无锁队列再执行它们
+     *          （溢出期间新任务不进入无锁队列，取空所需次数以队列容量为界）
+     */
+    void run_ready() {
+        std::function<void()> fn;
+        for (size_t n = ready_.size_approx(); n > 0 && ready_.try_pop(fn); --n) {
+            fn();
+        }
+        if (overflow_size_.load(std::memory_order_acquire) > 0) {
+            while (ready_.try_pop(fn)) fn();
+            std::vector<std::function<void()>> overflow;
+            {
+                std::lock_guard<std::mutex> lock(overflow_mutex_);
+                overflow.swap(overflow_);
+                overflow_size_.store(0, std::memory_order_relaxed);
+            }
+            for (auto& f : overflow) f();
+        }
+    }
+
+    void fire_timers() {
+        auto now = Clock::now();
+        while (!timers_.empty() && timers_.top().deadline <= now) {
+            auto handle = timers_.top().handle;
+            timers_.pop();
+            handle.resume();
+        }
+    }
+
+    int next_timeout_ms() const {
+        if (timers_.empty()) return -1;
+        auto wait = timers_.top().deadline - Clock::now();
+        if (wait <= Clock::duration::zero()) return 0;
+        // 向上取整，避免提前醒来空转
+        return static_cast<int>(std::chrono::ceil<std::chrono::milliseconds>(wait).count());
+    }
+};
+
+/**
+ * @brief   从非阻塞socket读取一些数据
+ * @return  读取的字节数，0表示对端关闭，负数表示出错
+ */
+inline Task<ssize_t> async_recv(EventLoop& loop, int fd, void* buf, size_t len) {
+    while (true) {
+        ssize_t n = ::recv(fd, buf, len, 0);
+        if (n >= 0) co_return n;
+        if (errno == EINTR) continue;
+        if (errno != EAGAIN && errno != EWOULDBLOCK) co_return -1;
+        co_await loop.readable(fd);
+    }
+}
+
+/**
+ * @brief   向非阻塞socket写满数据
+ * @return  是否成功
+ */
+inline Task<bool> async_send(EventLoop& loop, int fd, const std::string& data) {
+    size_t sent = 0;
+    while (sent < data.size()) {
+        ssize_t n = ::send(fd, data.data() + sent, data.size() - sent, MSG_NOSIGNAL);
+        if (n > 0) {
+            sent += n;
+        } else if (n < 0 && errno == EINTR) {
+            continue;
+        } else if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+            co_await loop.writable(fd);
+        } else {
+            co_return false;
+        }
+    }
+    co_return true;
+}
+
+} // namespace minimilvus
@@ -0,0 +1,735 @@
+/**
+ * @file    hnsw.hpp
+ * @brief   HNSW图索引
+ * @details 分层可导航小世界图：高层稀疏、用于贪心快速下降，第0层包含全部节点。
+ *          为构建和搜索的吞吐做了以下安排：
+ *          - 第0层节点按固定步长放在一块64字节对齐的连续内存中，向量与邻居表相邻，
+ *            访问一个节点只需连续的几条缓存行；高层邻居表很少访问，单独存放
+ *          - 批量插入由OpenMP线程并行完成，每个节点一把1字节自旋锁保护其邻居表，
+ *            只有新节点层数超过当前最高层时才需要全局锁
+ *          - 访问标记用按轮次打标的数组代替哈希集合，每次搜索只需递增轮次；
+ *            标记数组放在池中供并发搜索复用
+ *          - 扩展节点时预取下一个邻居的向量与访问标记
+ * @author  Tyooughtul
+ */
+
+#pragma once
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include <omp.h>
+#include "codecs.hpp"
+#include "data_generator.hpp"
+#include "dataset.hpp"
+#include "ivf_index.hpp"
+#include "memory_stats.hpp"
+#include "metrics.hpp"
+#include "profiler.hpp"
+#include "reorder.hpp"
+#include "rwlock.hpp"
+
+namespace minimilvus {
+
+/**
+ * @brief   按轮次打标的访问标记
+ * @details tag等于当前轮次即视为已访问；开始新一轮只需递增轮次，
+ *          16位轮次回绕时才整体清零一次
+ */
+class VisitedTable {
+public:
+    explicit VisitedTable(size_t n = 0) : tags_(n, 0) {}
+
+    /**
+     * @brief   保证至少能标记n个节点，新增部分视为未访问
+     */
+    void ensure(size_t n) {
+        if (tags_.size() < n) tags_.resize(n, 0);
+    }
+
+    /**
+     * @brief   开始新一轮，之前的标记全部失效
+     */
+    void next_epoch() {
+        if (++epoch_ == 0) {
+            std::fill(tags_.begin(), tags_.end(), 0);
+            epoch_ = 1;
+        }
+    }
+
+    /**
+     * @brief   标记节点
+     * @return  本轮是否首次访问
+     */
+    bool visit(uint32_t id) {
+        if (tags_[id] == epoch_) return false;
+        tags_[id] = epoch_;
+        return true;
+    }
+
+    const uint16_t* tag_address(uint32_t id) const { return tags_.data() + id; }
+
+    size_t capacity() const { return tags_.size(); }
+
+    uint16_t epoch() const { return epoch_; }
+
+private:
+    std::vector<uint16_t> tags_;
+    uint16_t epoch_ = 0;
+};
+
+/**
+ * @brief   访问标记池，供并发的构建线程和查询复用，避免每次搜索分配O(N)内存
+ */
+class VisitedTablePool {
+public:
+    /**
+     * @brief   取出一张至少能标记n个节点、已开始新一轮的标记表
+     */
+    std::unique_ptr<VisitedTable> acquire(size_t n) {
+        std::unique_ptr<VisitedTable> table;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (!free_.empty()) {
+                table = std::move(free_.back());
+                free_.pop_back();
+            }
+        }
+        if (!table) table = std::make_unique<VisitedTable>();
+        table->ensure(n);
+        table->next_epoch();
+        return table;
+    }
+
+    void release(std::unique_ptr<VisitedTable> table) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        free_.push_back(std::move(table));
+    }
+
+    MemoryUsage memory_usage() const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        MemoryUsage usage = vector_memory(free_);
+        for (const auto& table : free_) usage += {table->capacity() * sizeof(uint16_t), table->capacity() * sizeof(uint16_t)};
+        return usage;
+    }
+
+private:
+    mutable std::mutex mutex_;
+    std::vector<std::unique_ptr<VisitedTable>> free_;
+};
+
+/**
+ * @brief   HNSW索引
+ * @tparam  Metric  L2Metric / IPMetric
+ * @details 外部ID保存在labels_中，内部以32位编号寻址（插入顺序，reorder后为重排顺序）。
+ *          search可被多个线程并发调用，但不能与add并发
+ */
+template<typename Metric = L2Metric>
+class HNSW {
+public:
+    using metric_type = Metric;
+
+    /// 无效节点编号
+    static constexpr uint32_t kInvalid = std::numeric_limits<uint32_t>::max();
+    /// 第0层节点的对齐粒度
+    static constexpr size_t kNodeAlignment = 64;
+
+    /**
+     * @brief   构造函数
+     * @param   dim               向量维度
+     * @param   m                 高层每个节点的邻居数，第0层为2m
+     * @param   ef_construction   插入时每层搜索的候选数
+     * @param   seed              层数随机种子
+     * @throws  std::invalid_argument 当参数非法时
+     */
+    HNSW(int dim, int m = 16, int ef_construction = 200, uint64_t seed = 100)
+        : dim_(dim), m_(m), m0_(2 * m), ef_construction_(ef_construction), seed_(seed),
+          entry_mutex_(std::make_unique<std::mutex>()), visited_(std::make_unique<VisitedTablePool>()) {
+        if (dim <= 0 || m < 2 || ef_construction <= 0) throw std::invalid_argument("Invalid HNSW parameters");
+        level_mult_ = 1.0 / std::log(static_cast<double>(m));
+        vector_bytes_ = static_cast<size_t>(dim) * sizeof(float);
+        stride_ = (vector_bytes_ + (1 + m0_) * sizeof(uint32_t) + kNodeAlignment - 1) / kNodeAlignment * kNodeAlignment;
+    }
+
+    /**
+     * @brief   图索引无需训练
+     */
+    void train(const VectorDataset&) {}
+
+    /**
+     * @brief   并行插入一批向量
+     * @param   dataset     向量数据
+     * @param   first_id    第i个向量的ID为 first_id + i
+     */
+    void add(const VectorDataset& dataset, idx_t first_id = 0) {
+        if (dataset.get_dim() != dim_) throw std::invalid_argument("Dimension mismatch");
+        const size_t n = dataset.get_count();
+        if (n == 0) return;
+        const size_t begin = ntotal_;
+        reserve(begin + n);
+        levels_.resize(begin + n);
+        labels_.resize(begin + n);
+        #pragma omp parallel for schedule(static)
+        for (size_t i = 0; i < n; ++i) {
+            uint32_t node = static_cast<uint32_t>(begin + i);
+            init_node(node, dataset.get_vector(i), first_id + static_cast<idx_t>(i));
+        }
+        int64_t computed = 0;
+        #pragma omp parallel for schedule(dynamic, 64) reduction(+:computed)
+        for (size_t i = 0; i < n; ++i) insert(static_cast<uint32_t>(begin + i), computed);
+        ntotal_ = begin + n;
+        build_distances_ += computed;
+    }
+
+    /**
+     * @brief   插入单个向量
+     */
+    void add(std::span<const float> vec, idx_t id) {
+        if (vec.size() != static_cast<size_t>(dim_)) throw std::invalid_argument("Dimension mismatch");
+        if (ntotal_ == capacity_) reserve(std::max<size_t>(capacity_ * 2, 1024));
+        uint32_t node = static_cast<uint32_t>(ntotal_);
+        levels_.resize(ntotal_ + 1);
+        labels_.resize(ntotal_ + 1);
+        init_node(node, vec, id);
+        int64_t computed = 0;
+        insert(node, computed);
+        ntotal_++;
+        build_distances_ += computed;
+    }
+
+    void build(const VectorDataset& dataset) { add(dataset); }
+
+    /**
+     * @brief   预分配节点容量，避免批量插入中途扩容
+     * @throws  std::length_error 当节点数超出32位编号范围时
+     */
+    void reserve(size_t capacity) {
+        if (capacity <= capacity_) return;
+        if (capacity >= kInvalid) throw std::length_error("HNSW capacity exceeds 32-bit node ids");
+        size_t bytes = capacity * stride_;
+        std::unique_ptr<char, FreeDeleter> level0(static_cast<char*>(std::aligned_alloc(kNodeAlignment, bytes)));
+        if (!level0) throw std::bad_alloc();
+        std::memset(level0.get(), 0, bytes);
+        if (ntotal_) std::memcpy(level0.get(), level0_.get(), ntotal_ * stride_);
+        level0_ = std::move(level0);
+        locks_.reset(new SpinLock[capacity]);
+        upper_.resize(capacity);
+        capacity_ = capacity;
+    }
+
+    /**
+     * @brief   搜索最近邻
+     * @param   query     查询向量
+     * @param   k         返回结果数量
+     * @param   ef        第0层搜索的候选数（efSearch），小于k时按k计；作为VectorIndex时由nprobe传入
+     * @param   profile   剖析结果输出，可为空；距离计算次数记入vectors_scanned
+     * @return  按距离升序的结果（IP度量下距离为负内积）
+     */
+    std::vector<SearchResult> search(std::span<const float> query, int k, int ef = 64,
+                                     QueryProfile* profile = nullptr) const {
+        if (ntotal_ == 0 || k <= 0) return {};
+        if (query.size() != static_cast<size_t>(dim_)) throw std::invalid_argument("Dimension mismatch");
+        int64_t computed = 1;
+        MaxHeap top;
+        {
+            ScopedStageTimer timer(profile, ProfileStage::BucketScan);
+            uint32_t cur = entry_point_;
+            float cur_dist = distance(query, cur);
+            cur = greedy_descend<false>(query, cur, cur_dist, max_level_, 0, computed);
+            auto visited = visited_->acquire(ntotal_);
+            search_layer<false>(query, cur, cur_dist, 0, std::max(ef, k), *visited, top, computed);
+            visited_->release(std::move(visited));
+        }
+
+        ScopedStageTimer timer(profile, ProfileStage::TopK);
+        while (top.size() > static_cast<size_t>(k)) top.pop();
+        std::vector<SearchResult> results(top.size());
+        for (size_t i = results.size(); i-- > 0;) {
+            results[i] = {labels_[top.top().second], top.top().first};
+            top.pop();
+        }
+        if (profile) {
+            profile->vectors_scanned += computed;
+            profile->results_returned += results.size();
+        }
+        return results;
+    }
+
+    bool is_trained() const { return true; }
+    int get_dim() const { return dim_; }
+    size_t size() const { return ntotal_; }
+    int get_m() const { return m_; }
+    int ef_construction() const { return ef_construction_; }
+    int max_level() const { return max_level_; }
+
+    /**
+     * @brief   构建过程累计的距离计算次数
+     */
+    int64_t build_distances() const { return build_distances_; }
+
+    /**
+     * @brief   第0层每个节点占用的字节数（向量 + 邻居表，按64字节对齐）
+     */
+    size_t node_stride() const { return stride_; }
+
+    /**
+     * @brief   节点在第0层的邻居（外部ID），用于检查图结构
+     */
+    std::vector<idx_t> neighbors(size_t node) const {
+        const uint32_t* list = links(static_cast<uint32_t>(node), 0);
+        std::vector<idx_t> result;
+        for (uint32_t j = 0; j < list[0]; ++j) result.push_back(labels_[list[1 + j]]);
+        return result;
+    }
+
+    /**
+     * @brief   第0层的邻居图（内部编号），供计算重排顺序
+     */
+    KnnGraph level0_graph() const {
+        std::vector<uint64_t> offsets(ntotal_ + 1, 0);
+        for (size_t i = 0; i < ntotal_; ++i) offsets[i + 1] = offsets[i] + links(static_cast<uint32_t>(i), 0)[0];
+        std::vector<idx_t> neighbors;
+        neighbors.reserve(offsets.back());
+        for (size_t i = 0; i < ntotal_; ++i) {
+            const uint32_t* list = links(static_cast<uint32_t>(i), 0);
+            neighbors.insert(neighbors.end(), list + 1, list + 1 + list[0]);
+        }
+        return KnnGraph(std::move(offsets), std::move(neighbors));
+    }
+
+    /**
+     * @brief   按排列重排节点的内部编号
+     * @param   perm    内部编号的排列，通常为 rcm_order(level0_graph())
+     * @throws  std::invalid_argument 当排列大小与节点数不符时
+     * @details 第0层节点块（向量 + 邻居表）按新顺序搬动，各层邻居编号、层数、入口点一并改写；
+     *          外部ID随节点移动，搜索结果不变，只是图上相邻的节点在内存中也相邻
+     * @note    不能与search或add并发
+     */
+    void reorder(const IdPermutation& perm) {
+        if (perm.size() != static_cast<idx_t>(ntotal_)) throw std::invalid_argument("Permutation size mismatch");
+        if (ntotal_ == 0) return;
+        size_t bytes = capacity_ * stride_;
+        std::unique_ptr<char, FreeDeleter> level0(static_cast<char*>(std::aligned_alloc(kNodeAlignment, bytes)));
+        if (!level0) throw std::bad_alloc();
+        std::memset(level0.get(), 0, bytes);
+        std::vector<std::vector<uint32_t>> upper(capacity_);
+        std::vector<int32_t> levels(ntotal_);
+        std::vector<idx_t> labels(ntotal_);
+        #pragma omp parallel for schedule(static)
+        for (size_t i = 0; i < ntotal_; ++i) {
+            uint32_t old_node = static_cast<uint32_t>(perm.to_old(i));
+            char* block = level0.get() + i * stride_;
+            std::memcpy(block, level0_.get() + old_node * stride_, stride_);
+            uint32_t* list = reinterpret_cast<uint32_t*>(block + vector_bytes_);
+            for (uint32_t j = 0; j < list[0]; ++j) list[1 + j] = static_cast<uint32_t>(perm.to_new(list[1 + j]));
+            levels[i] = levels_[old_node];
+            labels[i] = labels_[old_node];
+            upper[i] = std::move(upper_[old_node]);
+            for (int l = 0; l < levels[i]; ++l) {
+                uint32_t* level_list = upper[i].data() + l * (m_ + 1);
+                for (uint32_t j = 0; j < level_list[0]; ++j) {
+                    level_list[1 + j] = static_cast<uint32_t>(perm.to_new(level_list[1 + j]));
+                }
+            }
+        }
+        level0_ = std::move(level0);
+        upper_ = std::move(upper);
+        levels_ = std::move(levels);
+        labels_ = std::move(labels);
+        entry_point_ = static_cast<uint32_t>(perm.to_new(entry_point_));
+    }
+
+    /**
+     * @brief   节点向量的地址，用于检查对齐与相邻布局
+     */
+    const float* node_vector(size_t node) const { return vector_of(static_cast<uint32_t>(node)); }
+
+    /**
+     * @brief   描述串，如 "HNSW32"
+     */
+    std::string description() const { return "HNSW" + std::to_string(m_); }
+
+    /**
+     * @brief   统计索引各部分的内存占用
+     */
+    MemoryReport memory_report() const {
+        MemoryReport report;
+        report.add("level0", {ntotal_ * stride_, capacity_ * stride_});
+        MemoryUsage upper = vector_memory(upper_);
+        for (const auto& list : upper_) upper += vector_memory(list);
+        report.add("upper_links", upper);
+        MemoryUsage nodes = vector_memory(labels_);
+        nodes += vector_memory(levels_);
+        nodes += {ntotal_ * sizeof(SpinLock), capacity_ * sizeof(SpinLock)};
+        report.add("node_meta", nodes);
+        report.add("visited_tables", visited_->memory_usage());
+        return report;
+    }
+
+    void save(const std::string& path) const {
+        std::ofstream file(path, std::ios::binary | std::ios::trunc);
+        if (!file.is_open()) throw std::runtime_error("Failed to open index file: " + path);
+        save(file);
+        if (!file) throw std::runtime_error("Failed to write index file: " + path);
+    }
+
+    /**
+     * @brief   写入流
+     * @note    文件格式：magic(4B) | 度量名 | dim | m | ef_construction | 节点数 | 入口 | 最高层 |
+     *          各节点层数 | 外部ID | 第0层节点块 | 各节点的高层邻居表
+     */
+    void save(std::ostream& file) const {
+        file.write(kFileMagic, 4);
+        detail::write_string(file, Metric::kName);
+        detail::write_pod(file, static_cast<int32_t>(dim_));
+        detail::write_pod(file, static_cast<int32_t>(m_));
+        detail::write_pod(file, static_cast<int32_t>(ef_construction_));
+        detail::write_pod(file, static_cast<int64_t>(ntotal_));
+        detail::write_pod(file, entry_point_);
+        detail::write_pod(file, static_cast<int32_t>(max_level_));
+        detail::write_vector(file, levels_);
+        detail::write_vector(file, labels_);
+        file.write(level0_.get(), ntotal_ * stride_);
+        for (size_t i = 0; i < ntotal_; ++i) {
+            if (levels_[i] > 0) detail::write_vector(file, upper_[i]);
+        }
+    }
+
+    static HNSW load(const std::string& path) {
+        std::ifstream file(path, std::ios::binary);
+        if (!file.is_open()) throw std::runtime_error("Failed to open index file: " + path);
+        return load(file, path);
+    }
+
+    /**
+     * @brief   从流的当前位置加载
+     * @param   path    仅用于错误信息
+     * @throws  std::runtime_error 当格式错误、度量不符或被截断时
+     */
+    static HNSW load(std::istream& file, const std::string& path) {
+        char magic[4];
+        file.read(magic, 4);
+        if (!file || std::string(magic, 4) != std::string(kFileMagic, 4)) {
+            throw std::runtime_error("Invalid index file: " + path);
+        }
+        if (detail::read_string(file) != Metric::kName) throw std::runtime_error("Index metric mismatch: " + path);
+        int32_t dim = 0, m = 0, ef_construction = 0, max_level = 0;
+        int64_t ntotal = -1;
+        uint32_t entry = kInvalid;
+        detail::read_pod(file, dim);
+        detail::read_pod(file, m);
+        detail::read_pod(file, ef_construction);
+        detail::read_pod(file, ntotal);
+        detail::read_pod(file, entry);
+        detail::read_pod(file, max_level);
+        if (!file || dim <= 0 || m < 2 || ef_construction <= 0 || ntotal < 0 || max_level < 0 ||
+            (ntotal > 0 && entry >= ntotal)) {
+            throw std::runtime_error("Invalid index file: " + path);
+        }
+        HNSW index(dim, m, ef_construction);
+        detail::read_vector(file, index.levels_);
+        detail::read_vector(file, index.labels_);
+        if (!file || index.levels_.size() != static_cast<size_t>(ntotal) || index.labels_.size() != index.levels_.size()) {
+            throw std::runtime_error("Truncated index file: " + path);
+        }
+        if (ntotal) {
+            index.reserve(ntotal);
+            file.read(index.level0_.get(), ntotal * index.stride_);
+        }
+        for (int64_t i = 0; i < ntotal; ++i) {
+            int32_t level = index.levels_[i];
+            if (level < 0 || level > max_level) throw std::runtime_error("Invalid index file: " + path);
+            if (level > 0) detail::read_vector(file, index.upper_[i]);
+            if (!file || index.upper_[i].size() != static_cast<size_t>(level) * (m + 1)) {
+                throw std::runtime_error("Truncated index file: " + path);
+            }
+            for (int l = 0; l <= level; ++l) {
+                const uint32_t* list = index.links(static_cast<uint32_t>(i), l);
+                if (list[0] > static_cast<uint32_t>(index.max_links(l))) throw std::runtime_error("Invalid index file: " + path);
+                for (uint32_t j = 0; j < list[0]; ++j) {
+                    if (list[1 + j] >= ntotal) throw std::runtime_error("Invalid index file: " + path);
+                }
+            }
+        }
+        index.ntotal_ = ntotal;
+        index.entry_point_ = ntotal ? entry : kInvalid;
+        index.max_level_ = max_level;
+        return index;
+    }
+
+    /// 索引文件头的魔数
+    static constexpr char kFileMagic[4] = {'M', 'M', 'H', 'N'};
+
+private:
+    struct FreeDeleter {
+        void operator()(char* p) const { std::free(p); }
+    };
+
+    using Candidate = std::pair<float, uint32_t>;
+    using MaxHeap = std::priority_queue<Candidate>;
+    using MinHeap = std::priority_queue<Candidate, std::vector<Candidate>, std::greater<>>;
+
+    int dim_;
+    int m_;                         ///< 高层邻居数
+    int m0_;                        ///< 第0层邻居数
+    int ef_construction_;
+    uint64_t seed_;
+    double level_mult_;             ///< 层数分布参数 1/ln(m)
+    size_t vector_bytes_;
+    size_t stride_;                 ///< 第0层每个节点的字节数：向量 | 邻居数 | 邻居编号
+    size_t ntotal_ = 0;
+    size_t capacity_ = 0;
+    std::unique_ptr<char, FreeDeleter> level0_;         ///< 第0层节点块，64字节对齐
+    std::vector<std::vector<uint32_t>> upper_;          ///< 第1..level层邻居表，每层 邻居数 + m个编号
+    std::vector<int32_t> levels_;                       ///< 各节点的最高层
+    std::vector<idx_t> labels_;                         ///< 内部编号 -> 外部ID
+    std::unique_ptr<SpinLock[]> locks_;                 ///< 每个节点一把锁，保护其各层邻居表
+    std::unique_ptr<std::mutex> entry_mutex_;           ///< 保护入口点与最高层
+    uint32_t entry_point_ = kInvalid;
+    int max_level_ = 0;
+    int64_t build_distances_ = 0;
+    std::unique_ptr<VisitedTablePool> visited_;
+
+    float* vector_of(uint32_t node) const {
+        return reinterpret_cast<float*>(level0_.get() + node * stride_);
+    }
+
+    /**
+     * @brief   节点在某层的邻居表：[邻居数, 编号...]
+     */
+    uint32_t* links(uint32_t node, int level) const {
+        if (level == 0) return reinterpret_cast<uint32_t*>(level0_.get() + node * stride_ + vector_bytes_);
+        return const_cast<uint32_t*>(upper_[node].data()) + (level - 1) * (m_ + 1);
+    }
+
+    int max_links(int level) const { return level == 0 ? m0_ : m_; }
+
+    float distance(std::span<const float> query, uint32_t node) const {
+        return Metric::distance(query, {vector_of(node), static_cast<size_t>(dim_)});
+    }
+
+    /**
+     * @brief   预取节点的向量（及紧随其后的邻居表）
+     */
+    void prefetch_node(uint32_t node) const {
+#if defined(__x86_64__) || defined(__i386__)
+        const char* p = level0_.get() + node * stride_;
+        for (size_t off = 0; off < stride_; off += kNodeAlignment) _mm_prefetch(p + off, _MM_HINT_T0);
+#else
+        (void)node;
+#endif
+    }
+
+    /**
+     * @brief   写入节点向量与外部ID，并按几何分布抽取层数
+     * @details 层数由(种子, 节点编号)决定，与插入线程无关
+     */
+    void init_node(uint32_t node, std::span<const float> vec, idx_t id) {
+        std::memcpy(vector_of(node), vec.data(), vector_bytes_);
+        links(node, 0)[0] = 0;
+        CounterRng rng(seed_, node);
+        float u = std::max(rng.uniform(), 1e-7f);
+        int level = static_cast<int>(-std::log(u) * level_mult_);
+        levels_[node] = level;
+        labels_[node] = id;
+        upper_[node].assign(static_cast<size_t>(level) * (m_ + 1), 0);
+    }
+
+    /**
+     * @brief   拷贝节点某层的邻居表
+     * @tparam  kLocked     构建期间其他线程可能同时修改邻居表，需加锁拷贝
+     */
+    template<bool kLocked>
+    uint32_t read_links(uint32_t node, int level, std::vector<uint32_t>& buffer) const {
+        const uint32_t* list = links(node, level);
+        if constexpr (kLocked) {
+            std::lock_guard<SpinLock> guard(locks_[node]);
+            buffer.assign(list + 1, list + 1 + list[0]);
+        } else {
+            buffer.assign(list + 1, list + 1 + list[0]);
+        }
+        return static_cast<uint32_t>(buffer.size());
+    }
+
+    /**
+     * @brief   在from_level到to_level（不含）之间逐层贪心下降
+     * @return  最接近查询的节点，cur_dist同步更新
+     */
+    template<bool kLocked>
+    uint32_t greedy_descend(std::span<const float> query, uint32_t cur, float& cur_dist,
+                            int from_level, int to_level, int64_t& computed) const {
+        std::vector<uint32_t> buffer;
+        for (int level = from_level; level > to_level; --level) {
+            bool changed = true;
+            while (changed) {
+                changed = false;
+                read_links<kLocked>(cur, level, buffer);
+                for (uint32_t nb : buffer) {
+                    float d = distance(query, nb);
+                    computed++;
+                    if (d < cur_dist) {
+                        cur_dist = d;
+                        cur = nb;
+                        changed = true;
+                    }
+                }
+            }
+        }
+        return cur;
+    }
+
+    /**
+     * @brief   单层best-first搜索
+     * @param   top     输出：至多ef个最近节点（大顶堆）
+     */
+    template<bool kLocked>
+    void search_layer(std::span<const float> query, uint32_t entry, float entry_dist, int level, size_t ef,
+                      VisitedTable& visited, MaxHeap& top, int64_t& computed) const {
+        MinHeap candidates;
+        std::vector<uint32_t> buffer;
+        buffer.reserve(max_links(level));
+        visited.visit(entry);
+        top.emplace(entry_dist, entry);
+        candidates.emplace(entry_dist, entry);
+        while (!candidates.empty()) {
+            auto [dist, node] = candidates.top();
+            if (top.size() >= ef && dist > top.top().first) break;
+            candidates.pop();
+            uint32_t count = read_links<kLocked>(node, level, buffer);
+            if (count) {
+                prefetch_node(buffer[0]);
+#if defined(__x86_64__) || defined(__i386__)
+                _mm_prefetch(reinterpret_cast<const char*>(visited.tag_address(buffer[0])), _MM_HINT_T0);
+#endif
+            }
+            for (uint32_t j = 0; j < count; ++j) {
+                uint32_t nb = buffer[j];
+                if (j + 1 < count) {
+                    prefetch_node(buffer[j + 1]);
+#if defined(__x86_64__) || defined(__i386__)
+                    _mm_prefetch(reinterpret_cast<const char*>(visited.tag_address(buffer[j + 1])), _MM_HINT_T0);
+#endif
+                }
+                if (!visited.visit(nb)) continue;
+                float d = distance(query, nb);
+                computed++;
+                if (top.size() < ef || d < top.top().first) {
+                    candidates.emplace(d, nb);
+                    top.emplace(d, nb);
+                    if (top.size() > ef) top.pop();
+                }
+            }
+        }
+    }
+
+    /**
+     * @brief   启发式邻居选择：候选只有在比所有已选邻居都更接近基准点时才保留，
+     *          使邻居分散在不同方向上
+     * @param   candidates  (到基准点的距离, 节点)，原地替换为选中的邻居
+     */
+    void select_neighbors(std::vector<Candidate>& candidates, size_t max_count) const {
+        if (candidates.size() <= max_count) return;
+        std::sort(candidates.begin(), candidates.end());
+        std::vector<Candidate> selected;
+        selected.reserve(max_count);
+        for (const auto& [dist, node] : candidates) {
+            if (selected.size() >= max_count) break;
+            std::span<const float> vec(vector_of(node), dim_);
+            bool keep = true;
+            for (const auto& chosen : selected) {
+                if (distance(vec, chosen.second) < dist) {
+                    keep = false;
+                    break;
+                }
+            }
+            if (keep) selected.push_back({dist, node});
+        }
+        candidates = std::move(selected);
+    }
+
+    /**
+     * @brief   设置节点在某层的邻居，并把节点加入各邻居的邻居表（满时按启发式裁剪）
+     */
+    void connect(uint32_t node, int level, const std::vector<Candidate>& neighbors) {
+        const uint32_t limit = max_links(level);
+        {
+            std::lock_guard<SpinLock> guard(locks_[node]);
+            uint32_t* own = links(node, level);
+            own[0] = static_cast<uint32_t>(neighbors.size());
+            for (size_t j = 0; j < neighbors.size(); ++j) own[1 + j] = neighbors[j].second;
+        }
+        std::vector<Candidate> pruned;
+        for (const auto& [dist, nb] : neighbors) {
+            std::lock_guard<SpinLock> guard(locks_[nb]);
+            uint32_t* list = links(nb, level);
+            if (list[0] < limit) {
+                list[1 + list[0]] = node;
+                list[0]++;
+                continue;
+            }
+            std::span<const float> base(vector_of(nb), dim_);
+            pruned.assign(1, {dist, node});
+            for (uint32_t j = 0; j < list[0]; ++j) pruned.push_back({distance(base, list[1 + j]), list[1 + j]});
+            select_neighbors(pruned, limit);
+            list[0] = static_cast<uint32_t>(pruned.size());
+            for (size_t j = 0; j < pruned.size(); ++j) list[1 + j] = pruned[j].second;
+        }
+    }
+
+    /**
+     * @brief   把已初始化的节点接入图中，可被多个线程并发调用
+     */
+    void insert(uint32_t node, int64_t& computed) {
+        const int level = levels_[node];
+        std::unique_lock<std::mutex> entry_lock(*entry_mutex_);
+        const uint32_t entry = entry_point_;
+        const int max_level = max_level_;
+        if (entry == kInvalid) {
+            entry_point_ = node;
+            max_level_ = level;
+            return;
+        }
+        // 只有新节点成为新的最高层时才在整个插入期间持有全局锁
+        if (level <= max_level) entry_lock.unlock();
+
+        std::span<const float> vec(vector_of(node), dim_);
+        float cur_dist = distance(vec, entry);
+        computed++;
+        uint32_t cur = greedy_descend<true>(vec, entry, cur_dist, max_level, level, computed);
+
+        auto visited = visited_->acquire(capacity_);
+        std::vector<Candidate> neighbors;
+        for (int l = std::min(level, max_level); l >= 0; --l) {
+            MaxHeap top;
+            search_layer<true>(vec, cur, cur_dist, l, ef_construction_, *visited, top, computed);
+            visited->next_epoch();
+            neighbors.clear();
+            while (!top.empty()) {
+                if (top.top().second != node) neighbors.push_back(top.top());
+                top.pop();
+            }
+            if (neighbors.empty()) continue;
+            cur_dist = neighbors.back().first;
+            cur = neighbors.back().second;
+            select_neighbors(neighbors, m_);
+            connect(node, l, neighbors);
+        }
+        visited_->release(std::move(visited));
+
+        if (level > max_level) {
+            entry_point_ = node;
+            max_level_ = level;
+        }
+    }
+};
+
+} // namespace minimilvus
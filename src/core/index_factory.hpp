@@ -0,0 +1,551 @@
+/**
+ * @file    index_factory.hpp
+ * @brief   按描述串在运行时选择索引组合
+ * @details "IVF1024,SQ8" 形式的描述串映射到对应的 IVF<Metric, Codec, ListStorage> 实例，
+ *          通过虚接口VectorIndex使用；虚调用只发生在每次查询的入口，扫描循环仍是内联的。
+ *          描述串可带预处理变换前缀，如 "PCA256,IVF1024,SQ8"，变换与索引保存在同一文件。
+ *          DiskRefineIndex把原始向量留在磁盘文件中，只为少量候选读盘精排。
+ *          "HNSW32" 形式的描述串创建图索引，nprobe作为efSearch使用
+ * @author  Tyooughtul
+ */
+
+#pragma once
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <variant>
+#include <vector>
+#include "hnsw.hpp"
+#include "ivf.hpp"
+#include "opq.hpp"
+#include "uring_storage.hpp"
+#include "vector_transform.hpp"
+
+namespace minimilvus {
+
+/**
+ * @brief   索引的类型擦除接口
+ */
+class VectorIndex {
+public:
+    virtual ~VectorIndex() = default;
+
+    virtual void train(const VectorDataset& dataset) = 0;
+    virtual void add(const VectorDataset& dataset, idx_t first_id = 0) = 0;
+    virtual void add(std::span<const float> vec, idx_t id) = 0;
+    virtual std::vector<SearchResult> search(std::span<const float> query, int k, int nprobe = 16,
+                                             QueryProfile* profile = nullptr) const = 0;
+    virtual void save(std::ostream& out) const = 0;
+
+    virtual bool is_trained() const = 0;
+    virtual int get_dim() const = 0;
+    virtual size_t size() const = 0;
+    virtual MetricType metric() const = 0;
+    virtual std::string description() const = 0;
+    virtual MemoryReport memory_report() const = 0;
+
+    virtual void build(const VectorDataset& dataset) {
+        train(dataset);
+        add(dataset);
+    }
+
+    /**
+     * @throws  std::runtime_error 当文件无法写入时
+     */
+    void save(const std::string& path) const {
+        std::ofstream file(path, std::ios::binary | std::ios::trunc);
+        if (!file.is_open()) throw std::runtime_error("Failed to open index file: " + path);
+        save(file);
+        if (!file) throw std::runtime_error("Failed to write index file: " + path);
+    }
+};
+
+/**
+ * @brief   把具体索引类型包装成VectorIndex
+ */
+template<typename Index>
+class IndexAdapter final : public VectorIndex {
+public:
+    explicit IndexAdapter(Index index) : index_(std::move(index)) {}
+
+    void train(const VectorDataset& dataset) override { index_.train(dataset); }
+    void add(const VectorDataset& dataset, idx_t first_id = 0) override { index_.add(dataset, first_id); }
+    void add(std::span<const float> vec, idx_t id) override { index_.add(vec, id); }
+    std::vector<SearchResult> search(std::span<const float> query, int k, int nprobe = 16,
+                                     QueryProfile* profile = nullptr) const override {
+        return index_.search(query, k, nprobe, profile);
+    }
+    using VectorIndex::save;
+    void save(std::ostream& out) const override { index_.save(out); }
+
+    bool is_trained() const override { return index_.is_trained(); }
+    int get_dim() const override { return index_.get_dim(); }
+    size_t size() const override { return index_.size(); }
+    MetricType metric() const override { return Index::metric_type::kType; }
+    std::string description() const override { return index_.description(); }
+    MemoryReport memory_report() const override { return index_.memory_report(); }
+
+    Index& get() { return index_; }
+    const Index& get() const { return index_; }
+
+private:
+    Index index_;
+};
+
+/**
+ * @brief   带预处理变换的索引：数据库向量和查询先经过变换，再交给内层索引
+ * @details 训练时先在原始数据上训练变换，再在变换后的数据上训练内层索引。
+ *          文件格式：magic "MMTX" | 变换参数 | 内层索引
+ */
+class TransformedIndex final : public VectorIndex {
+public:
+    /**
+     * @param   transform   预处理变换，未训练时在train中训练
+     * @param   index       内层索引，维度须等于transform.out_dim()
+     * @throws  std::invalid_argument 当维度不匹配时
+     */
+    TransformedIndex(VectorTransform transform, std::unique_ptr<VectorIndex> index)
+        : transform_(std::move(transform)), index_(std::move(index)) {
+        if (!index_ || index_->get_dim() != transform_.out_dim()) {
+            throw std::invalid_argument("Transform output dimension does not match index");
+        }
+    }
+
+    void train(const VectorDataset& dataset) override {
+        if (!transform_.is_trained()) transform_.train(dataset);
+        index_->train(transform_.apply(dataset));
+    }
+
+    void add(const VectorDataset& dataset, idx_t first_id = 0) override {
+        index_->add(transform_.apply(dataset), first_id);
+    }
+
+    void add(std::span<const float> vec, idx_t id) override { index_->add(transform_.apply(vec), id); }
+
+    /**
+     * @brief   只变换一次数据集
+     */
+    void build(const VectorDataset& dataset) override {
+        if (!transform_.is_trained()) transform_.train(dataset);
+        VectorDataset transformed = transform_.apply(dataset);
+        index_->train(transformed);
+        index_->add(transformed);
+    }
+
+    std::vector<SearchResult> search(std::span<const float> query, int k, int nprobe = 16,
+                                     QueryProfile* profile = nullptr) const override {
+        return index_->search(transform_.apply(query), k, nprobe, profile);
+    }
+
+    using VectorIndex::save;
+    void save(std::ostream& out) const override {
+        out.write(kFileMagic, 4);
+        transform_.save(out);
+        index_->save(out);
+    }
+
+    bool is_trained() const override { return transform_.is_trained() && index_->is_trained(); }
+    int get_dim() const override { return transform_.in_dim(); }
+    size_t size() const override { return index_->size(); }
+    MetricType metric() const override { return index_->metric(); }
+    std::string description() const override { return transform_.name() + "," + index_->description(); }
+
+    MemoryReport memory_report() const override {
+        MemoryReport report = index_->memory_report();
+        report.add("transform", transform_.memory_usage());
+        return report;
+    }
+
+    const VectorTransform& transform() const { return transform_; }
+    const VectorIndex& index() const { return *index_; }
+
+    /// 文件头的魔数，区别于不带变换的IVF文件
+    static constexpr char kFileMagic[4] = {'M', 'M', 'T', 'X'};
+
+private:
+    VectorTransform transform_;
+    std::unique_ptr<VectorIndex> index_;
+};
+
+/**
+ * @brief   磁盘精排索引：内存中只有压缩编码，原始向量在VectorDataset格式的文件里
+ * @details 内层索引按编码距离取 k * refine_factor 个候选，候选ID排序后用一次VectorFile::fetch
+ *          批量读取（相邻行合并为一次读取，全部请求一次提交），再按精确距离排序截断为k个。
+ *          内存只需编码（SQ8为原始向量的1/4，PQ更小），最终顺序与精确距离一致。
+ *          文件格式：magic "MMRF" | refine_factor | 向量文件路径 | 内层索引
+ */
+class DiskRefineIndex final : public VectorIndex {
+public:
+    static constexpr int kDefaultRefineFactor = 4;
+
+    /**
+     * @param   index           内层索引（通常为有损编码的IVF）
+     * @param   vectors_path    VectorDataset::save写出的文件，第i行为ID i的原始向量
+     * @param   refine_factor   候选倍数
+     * @param   ring            读盘使用的io_uring，为空时使用pread
+     * @throws  std::invalid_argument 当维度不匹配或refine_factor非法时
+     * @throws  std::runtime_error 当向量文件无法打开时
+     */
+    DiskRefineIndex(std::unique_ptr<VectorIndex> index, const std::string& vectors_path,
+                    int refine_factor = kDefaultRefineFactor, IoUring* ring = nullptr)
+        : index_(std::move(index)), path_(vectors_path), refine_factor_(refine_factor),
+          file_(std::make_unique<VectorFile>(vectors_path, ring)), ring_(ring) {
+        if (!index_ || index_->get_dim() != file_->get_dim()) {
+            throw std::invalid_argument("Vector file dimension does not match index");
+        }
+        if (refine_factor_ < 1) throw std::invalid_argument("Refine factor must be at least 1");
+    }
+
+    void train(const VectorDataset& dataset) override { index_->train(dataset); }
+
+    /**
+     * @throws  std::out_of_range 当ID超出向量文件的行数时
+     */
+    void add(const VectorDataset& dataset, idx_t first_id = 0) override {
+        if (first_id < 0 || first_id + dataset.get_count() > file_->get_count()) {
+            throw std::out_of_range("Vector ids exceed the refine file");
+        }
+        index_->add(dataset, first_id);
+    }
+
+    /**
+     * @throws  std::out_of_range 当ID超出向量文件的行数时
+     */
+    void add(std::span<const float> vec, idx_t id) override {
+        if (id < 0 || id >= file_->get_count()) throw std::out_of_range("Vector id exceeds the refine file");
+        index_->add(vec, id);
+    }
+
+    void build(const VectorDataset& dataset) override {
+        train(dataset);
+        add(dataset);
+    }
+
+    std::vector<SearchResult> search(std::span<const float> query, int k, int nprobe = 16,
+                                     QueryProfile* profile = nullptr) const override {
+        if (k <= 0) return {};
+        auto candidates = index_->search(query, k * refine_factor_, nprobe, profile);
+        ScopedStageTimer timer(profile, ProfileStage::Refine);
+        std::vector<idx_t> ids(candidates.size());
+        for (size_t i = 0; i < candidates.size(); ++i) ids[i] = candidates[i].id;
+        std::sort(ids.begin(), ids.end());
+        const size_t dim = static_cast<size_t>(file_->get_dim());
+        std::vector<float> vectors(ids.size() * dim);
+        {
+            // io_uring实例不能被多个线程同时提交，pread可以并发
+            std::unique_lock<std::mutex> lock(io_mutex_, std::defer_lock);
+            if (ring_) lock.lock();
+            file_->fetch(ids, vectors);
+        }
+
+        std::vector<SearchResult> results(ids.size());
+        const bool ip = index_->metric() == MetricType::IP;
+        for (size_t i = 0; i < ids.size(); ++i) {
+            std::span<const float> vec(vectors.data() + i * dim, dim);
+            results[i] = {ids[i], ip ? IPMetric::distance(query, vec) : L2Metric::distance(query, vec)};
+        }
+        size_t n = std::min(results.size(), static_cast<size_t>(k));
+        std::partial_sort(results.begin(), results.begin() + n, results.end());
+        results.resize(n);
+        return results;
+    }
+
+    using VectorIndex::save;
+    void save(std::ostream& out) const override {
+        out.write(kFileMagic, 4);
+        detail::write_pod(out, static_cast<int32_t>(refine_factor_));
+        detail::write_string(out, path_);
+        index_->save(out);
+    }
+
+    bool is_trained() const override { return index_->is_trained(); }
+    int get_dim() const override { return index_->get_dim(); }
+    size_t size() const override { return index_->size(); }
+    MetricType metric() const override { return index_->metric(); }
+    std::string description() const override { return index_->description() + ",RefineDisk"; }
+    MemoryReport memory_report() const override { return index_->memory_report(); }
+
+    int refine_factor() const { return refine_factor_; }
+    void set_refine_factor(int factor) {
+        if (factor < 1) throw std::invalid_argument("Refine factor must be at least 1");
+        refine_factor_ = factor;
+    }
+    const std::string& vectors_path() const { return path_; }
+    const VectorIndex& index() const { return *index_; }
+
+    /// 文件头的魔数
+    static constexpr char kFileMagic[4] = {'M', 'M', 'R', 'F'};
+
+private:
+    std::unique_ptr<VectorIndex> index_;
+    std::string path_;
+    int refine_factor_;
+    std::unique_ptr<VectorFile> file_;
+    IoUring* ring_;
+    mutable std::mutex io_mutex_;
+};
+
+/**
+ * @brief   解析后的索引描述
+ */
+struct IndexSpec {
+    std::string transform;          ///< 预处理变换：空 / RR / PCA，PCA可带W（白化）、R（降维后旋转）
+    int transform_dim = 0;          ///< PCA输出维度
+    bool whiten = false;
+    bool rotate = false;
+    int n_lists = 0;
+    std::string codec = "Flat";     ///< Flat / FP16 / SQ8 / PQ / OPQ
+    int pq_segments = 0;            ///< PQ/OPQ分段数
+    ResidualMode residual = ResidualMode::None;
+    bool paged = false;             ///< 是否使用PagedListStorage
+
+    /**
+     * @brief   解析描述串
+     * @param   description     "[<transform>,]IVF<n>,<codec>[,Residual|ResidualPerList][,Paged]"，
+     *                          codec为Flat、FP16、SQ8、PQ<m>或OPQ<m>，transform为RR或PCA[W][R]<d>
+     * @throws  std::invalid_argument 当格式错误时
+     */
+    static IndexSpec parse(const std::string& description) {
+        IndexSpec spec;
+        std::vector<std::string> parts;
+        std::stringstream ss(description);
+        std::string part;
+        while (std::getline(ss, part, ',')) parts.push_back(part);
+        auto fail = [&] { return std::invalid_argument("Invalid index description: " + description); };
+        if (!parts.empty() && parts[0].rfind("IVF", 0) != 0) {
+            const std::string& t = parts[0];
+            if (t == "RR") {
+                spec.transform = t;
+            } else if (t.rfind("PCA", 0) == 0) {
+                spec.transform = "PCA";
+                size_t prefix = 3;
+                if (prefix < t.size() && t[prefix] == 'W') spec.whiten = true, ++prefix;
+                if (prefix < t.size() && t[prefix] == 'R') spec.rotate = true, ++prefix;
+                try {
+                    size_t pos = 0;
+                    spec.transform_dim = std::stoi(t.substr(prefix), &pos);
+                    if (pos != t.size() - prefix || spec.transform_dim <= 0) throw fail();
+                } catch (const std::logic_error&) {
+                    throw fail();
+                }
+            } else {
+                throw fail();
+            }
+            parts.erase(parts.begin());
+        }
+        if (parts.empty() || parts.size() > 4 || parts[0].rfind("IVF", 0) != 0) throw fail();
+        try {
+            size_t pos = 0;
+            spec.n_lists = std::stoi(parts[0].substr(3), &pos);
+            if (pos != parts[0].size() - 3 || spec.n_lists <= 0) throw fail();
+        } catch (const std::logic_error&) {
+            throw fail();
+        }
+        if (parts.size() >= 2) {
+            const std::string& codec = parts[1];
+            if (codec == "Flat" || codec == "FP16" || codec == "SQ8") {
+                spec.codec = codec;
+            } else if (codec.rfind("PQ", 0) == 0 || codec.rfind("OPQ", 0) == 0) {
+                spec.codec = codec[0] == 'O' ? "OPQ" : "PQ";
+                size_t prefix = spec.codec.size();
+                try {
+                    size_t pos = 0;
+                    spec.pq_segments = std::stoi(codec.substr(prefix), &pos);
+                    if (pos != codec.size() - prefix || spec.pq_segments <= 0) throw fail();
+                } catch (const std::logic_error&) {
+                    throw fail();
+                }
+            } else {
+                throw fail();
+            }
+        }
+        size_t next = 2;
+        if (next < parts.size()) {
+            if (parts[next] == residual_mode_name(ResidualMode::Global)) {
+                spec.residual = ResidualMode::Global;
+                ++next;
+            } else if (parts[next] == residual_mode_name(ResidualMode::PerList)) {
+                spec.residual = ResidualMode::PerList;
+                ++next;
+            }
+        }
+        if (next < parts.size()) {
+            if (parts[next] != PagedListStorage::kName) throw fail();
+            spec.paged = true;
+            ++next;
+        }
+        if (next != parts.size()) throw fail();
+        return spec;
+    }
+
+    /**
+     * @brief   不含变换前缀的IVF部分描述串
+     */
+    static std::string format_ivf(const IndexSpec& spec) {
+        std::string codec = spec.codec;
+        if (codec == "PQ" || codec == "OPQ") codec += std::to_string(spec.pq_segments);
+        std::string description = "IVF" + std::to_string(spec.n_lists) + "," + codec;
+        if (spec.residual != ResidualMode::None) description += std::string(",") + residual_mode_name(spec.residual);
+        if (spec.paged) description += std::string(",") + PagedListStorage::kName;
+        return description;
+    }
+};
+
+namespace detail {
+
+template<typename T>
+struct TypeTag {
+    using type = T;
+};
+
+using AnyCodec = std::variant<FlatCodec, FP16Codec, SQ8Codec, PQCodec, OPQCodec>;
+using AnyStorage = std::variant<TypeTag<VectorListStorage>, TypeTag<PagedListStorage>>;
+
+/**
+ * @brief   解析 "HNSW<m>" 形式的描述串
+ * @return  邻居数m，描述串不以HNSW开头时返回0
+ * @throws  std::invalid_argument 当m缺失或非法时
+ */
+inline int parse_hnsw(const std::string& description) {
+    if (description.rfind("HNSW", 0) != 0) return 0;
+    auto fail = [&] { return std::invalid_argument("Invalid index description: " + description); };
+    try {
+        size_t pos = 0;
+        int m = std::stoi(description.substr(4), &pos);
+        if (pos != description.size() - 4 || m < 2) throw fail();
+        return m;
+    } catch (const std::logic_error&) {
+        throw fail();
+    }
+}
+
+/**
+ * @brief   按描述创建未训练的预处理变换
+ * @throws  std::invalid_argument 当PCA输出维度超过输入维度时
+ */
+inline VectorTransform make_transform(const IndexSpec& spec, int dim) {
+    if (spec.transform == "RR") return VectorTransform::random_rotation(dim);
+    return VectorTransform::pca(dim, spec.transform_dim, spec.whiten, spec.rotate);
+}
+
+inline AnyCodec make_codec(const IndexSpec& spec, int dim) {
+    if (spec.codec == "FP16") return FP16Codec(dim);
+    if (spec.codec == "SQ8") return SQ8Codec(dim);
+    if (spec.codec == "PQ") return PQCodec(dim, spec.pq_segments);
+    if (spec.codec == "OPQ") return OPQCodec(dim, spec.pq_segments);
+    return FlatCodec(dim);
+}
+
+/**
+ * @brief   按度量、编码器、布局三个运行时选择实例化对应的模板，并交给回调
+ * @param   f   f(auto index)，index为构造好的 IVF<...>
+ */
+template<typename F>
+auto visit_ivf(int dim, const IndexSpec& spec, MetricType metric, F&& f) {
+    AnyStorage storage = spec.paged ? AnyStorage(TypeTag<PagedListStorage>{})
+                                    : AnyStorage(TypeTag<VectorListStorage>{});
+    return std::visit([&](auto codec, auto storage_tag) {
+        using Codec = decltype(codec);
+        using Storage = typename decltype(storage_tag)::type;
+        if (metric == MetricType::IP) {
+            return f(IVF<IPMetric, Codec, Storage>(dim, spec.n_lists, std::move(codec), spec.residual));
+        }
+        return f(IVF<L2Metric, Codec, Storage>(dim, spec.n_lists, std::move(codec), spec.residual));
+    }, make_codec(spec, dim), storage);
+}
+
+} // namespace detail
+
+/**
+ * @brief   按描述串创建索引
+ * @param   dim             向量维度
+ * @param   description     如 "IVF1024,SQ8"、"IVF256,OPQ16"、"IVF100,Flat,Paged"、"PCA128,IVF1024,SQ8"、"HNSW32"
+ * @param   metric          距离度量
+ * @return  未训练的索引
+ * @throws  std::invalid_argument 当描述串或参数非法时
+ */
+inline std::unique_ptr<VectorIndex> index_factory(int dim, const std::string& description,
+                                                  MetricType metric = MetricType::L2) {
+    if (int m = detail::parse_hnsw(description)) {
+        if (metric == MetricType::IP) return std::make_unique<IndexAdapter<HNSW<IPMetric>>>(HNSW<IPMetric>(dim, m));
+        return std::make_unique<IndexAdapter<HNSW<L2Metric>>>(HNSW<L2Metric>(dim, m));
+    }
+    IndexSpec spec = IndexSpec::parse(description);
+    if (spec.transform.empty()) {
+        return detail::visit_ivf(dim, spec, metric, [](auto index) -> std::unique_ptr<VectorIndex> {
+            return std::make_unique<IndexAdapter<decltype(index)>>(std::move(index));
+        });
+    }
+    VectorTransform transform = detail::make_transform(spec, dim);
+    spec.transform.clear();
+    auto inner = index_factory(transform.out_dim(), IndexSpec::format_ivf(spec), metric);
+    return std::make_unique<TransformedIndex>(std::move(transform), std::move(inner));
+}
+
+namespace detail {
+
+/**
+ * @brief   从流的当前位置加载索引，根据魔数区分带变换的索引、磁盘精排索引、HNSW和IVF
+ * @param   path    仅用于错误信息
+ */
+inline std::unique_ptr<VectorIndex> load_index(std::istream& file, const std::string& path) {
+    std::streampos start = file.tellg();
+    char magic[4] = {};
+    file.read(magic, 4);
+    if (file && std::string(magic, 4) == std::string(TransformedIndex::kFileMagic, 4)) {
+        VectorTransform transform = VectorTransform::load(file);
+        return std::make_unique<TransformedIndex>(std::move(transform), load_index(file, path));
+    }
+    if (file && std::string(magic, 4) == std::string(DiskRefineIndex::kFileMagic, 4)) {
+        int32_t refine_factor = 0;
+        read_pod(file, refine_factor);
+        std::string vectors_path = read_string(file);
+        if (!file || refine_factor < 1) throw std::runtime_error("Invalid refine header in index file: " + path);
+        return std::make_unique<DiskRefineIndex>(load_index(file, path), vectors_path, refine_factor);
+    }
+    if (file && std::string(magic, 4) == std::string(HNSW<>::kFileMagic, 4)) {
+        std::string metric_name = read_string(file);
+        file.seekg(start);
+        if (metric_name == IPMetric::kName) {
+            return std::make_unique<IndexAdapter<HNSW<IPMetric>>>(HNSW<IPMetric>::load(file, path));
+        }
+        return std::make_unique<IndexAdapter<HNSW<L2Metric>>>(HNSW<L2Metric>::load(file, path));
+    }
+    file.clear();
+    file.seekg(start);
+
+    int32_t dim = 0, n_lists = 0;
+    IVF<>::read_header(file, path, dim, n_lists);
+    std::string metric_name = read_string(file);
+    std::string description = read_string(file);
+    if (metric_name != L2Metric::kName && metric_name != IPMetric::kName) {
+        throw std::runtime_error("Unknown metric in index file: " + path);
+    }
+    MetricType metric = metric_name == IPMetric::kName ? MetricType::IP : MetricType::L2;
+    IndexSpec spec;
+    try {
+        spec = IndexSpec::parse(description);
+    } catch (const std::invalid_argument&) {
+        throw std::runtime_error("Invalid index description in file: " + path);
+    }
+    file.seekg(start);
+    return visit_ivf(dim, spec, metric, [&](auto index) -> std::unique_ptr<VectorIndex> {
+        using Index = decltype(index);
+        return std::make_unique<IndexAdapter<Index>>(Index::load(file, path));
+    });
+}
+
+} // namespace detail
+
+/**
+ * @brief   加载VectorIndex::save保存的任意组合的索引
+ * @throws  std::runtime_error 当文件不存在或格式错误时
+ */
+inline std::unique_ptr<VectorIndex> load_index(const std::string& path) {
+    std::ifstream file(path, std::ios::binary);
+    if (!file.is_open()) throw std::runtime_error("Failed to open index file: " + path);
+    return detail::load_index(file, path);
+}
+
+} // namespace minimilvus
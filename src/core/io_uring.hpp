@@ -0,0 +1,385 @@
+/**
+ * @file    io_uring.hpp
+ * @brief   基于io_uring的异步I/O环
+ * @details 直接使用io_uring_setup/enter/register系统调用（不依赖liburing），
+ *          支持注册缓冲区、批量提交，以及可在协程中co_await的I/O操作
+ * @author  Tyooughtul
+ */
+
+#pragma once
+#include <linux/io_uring.h>
+#include <sys/syscall.h>
+#include <sys/mman.h>
+#include <sys/uio.h>
+#include <unistd.h>
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <coroutine>
+#include <cstring>
+#include <cstdint>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace minimilvus {
+
+/**
+ * @brief   一次I/O操作的完成状态
+ * @details 其地址作为SQE的user_data，完成时由IoUring回填结果；
+ *          设置了waiter的操作在完成后恢复对应协程
+ */
+struct IoCompletion {
+    int result = 0;                     ///< 与同步系统调用相同：字节数或负的errno
+    bool done = false;                  ///< 是否已完成
+    std::coroutine_handle<> waiter;     ///< 等待该操作的协程（可为空）
+};
+
+/**
+ * @brief   I/O请求描述
+ */
+struct IoRequest {
+    uint8_t opcode = IORING_OP_NOP;     ///< 操作码
+    int fd = -1;                        ///< 文件描述符
+    uint64_t addr = 0;                  ///< 缓冲区地址
+    uint32_t len = 0;                   ///< 长度
+    uint64_t offset = 0;                ///< 文件偏移
+    int buf_index = -1;                 ///< 注册缓冲区编号（仅FIXED操作）
+    uint32_t op_flags = 0;              ///< 操作相关标志（如fsync_flags）
+    bool link = false;                  ///< 是否与下一个请求链接（前一个成功后才执行下一个）
+
+    static IoRequest read(int fd, void* buf, uint32_t len, uint64_t offset) {
+        return {IORING_OP_READ, fd, reinterpret_cast<uint64_t>(buf), len, offset};
+    }
+
+    static IoRequest read_fixed(int fd, void* buf, uint32_t len, uint64_t offset, int buf_index) {
+        return {IORING_OP_READ_FIXED, fd, reinterpret_cast<uint64_t>(buf), len, offset, buf_index};
+    }
+
+    static IoRequest write(int fd, const void* buf, uint32_t len, uint64_t offset) {
+        return {IORING_OP_WRITE, fd, reinterpret_cast<uint64_t>(buf), len, offset};
+    }
+
+    static IoRequest write_fixed(int fd, const void* buf, uint32_t len, uint64_t offset, int buf_index) {
+        return {IORING_OP_WRITE_FIXED, fd, reinterpret_cast<uint64_t>(buf), len, offset, buf_index};
+    }
+
+    static IoRequest fdatasync(int fd) {
+        return {IORING_OP_FSYNC, fd, 0, 0, 0, -1, IORING_FSYNC_DATASYNC};
+    }
+};
+
+class IoUring;
+
+/**
+ * @brief   可co_await的I/O操作
+ * @details 挂起时只把请求放入提交队列，不立即进入内核；
+ *          由驱动方调用IoUring::poll()批量提交，完成后恢复协程，co_await得到结果
+ */
+class IoAwaitable {
+public:
+    IoAwaitable(IoUring& ring, IoRequest request) : ring_(ring), request_(request) {}
+
+    bool await_ready() const noexcept { return false; }
+    inline void await_suspend(std::coroutine_handle<> handle);
+    int await_resume() const noexcept { return completion_.result; }
+
+private:
+    IoUring& ring_;
+    IoRequest request_;
+    IoCompletion completion_;
+};
+
+/**
+ * @brief   io_uring实例
+ * @details 提交队列和完成队列通过mmap与内核共享；
+ *          实例不是线程安全的，约定每个工作线程持有一个
+ */
+class IoUring {
+public:
+    /**
+     * @brief   创建io_uring
+     * @param   entries     提交队列深度（内核向上取整为2的幂）
+     * @throws  std::runtime_error 当内核不支持或资源不足时
+     */
+    explicit IoUring(unsigned entries = 256) {
+        io_uring_params params{};
+        ring_fd_ = static_cast<int>(::syscall(__NR_io_uring_setup, entries, &params));
+        if (ring_fd_ < 0) {
+            throw std::runtime_error(std::string("io_uring_setup failed: ") + std::strerror(errno));
+        }
+
+        sq_ring_size_ = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+        cq_ring_size_ = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+        single_mmap_ = params.features & IORING_FEAT_SINGLE_MMAP;
+        if (single_mmap_) sq_ring_size_ = cq_ring_size_ = std::max(sq_ring_size_, cq_ring_size_);
+
+        sq_ring_ = ::mmap(nullptr, sq_ring_size_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                          ring_fd_, IORING_OFF_SQ_RING);
+        cq_ring_ = single_mmap_ ? sq_ring_
+                                : ::mmap(nullptr, cq_ring_size_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                                         ring_fd_, IORING_OFF_CQ_RING);
+        sqes_size_ = params.sq_entries * sizeof(io_uring_sqe);
+        void* sqes = ::mmap(nullptr, sqes_size_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                            ring_fd_, IORING_OFF_SQES);
+        if (sq_ring_ == MAP_FAILED || cq_ring_ == MAP_FAILED || sqes == MAP_FAILED) {
+            if (sqes != MAP_FAILED) ::munmap(sqes, sqes_size_);
+            release();
+            throw std::runtime_error("io_uring mmap failed");
+        }
+        sqes_ = static_cast<io_uring_sqe*>(sqes);
+
+        char* sq = static_cast<char*>(sq_ring_);
+        sq_head_ = reinterpret_cast<unsigned*>(sq + params.sq_off.head);
+        sq_tail_ = reinterpret_cast<unsigned*>(sq + params.sq_off.tail);
+        sq_mask_ = *reinterpret_cast<unsigned*>(sq + params.sq_off.ring_mask);
+        sq_array_ = reinterpret_cast<unsigned*>(sq + params.sq_off.array);
+        sq_entries_ = params.sq_entries;
+
+        char* cq = static_cast<char*>(cq_ring_);
+        cq_head_ = reinterpret_cast<unsigned*>(cq + params.cq_off.head);
+        cq_tail_ = reinterpret_cast<unsigned*>(cq + params.cq_off.tail);
+        cq_mask_ = *reinterpret_cast<unsigned*>(cq + params.cq_off.ring_mask);
+        cqes_ = reinterpret_cast<io_uring_cqe*>(cq + params.cq_off.cqes);
+        cq_entries_ = params.cq_entries;
+
+        sqe_tail_ = *sq_tail_;
+    }
+
+    /**
+     * @note    先等待已提交请求全部完成再关闭ring，避免内核在调用方释放缓冲区后仍向其读写
+     */
+    ~IoUring() {
+        drain();
+        if (sqes_) ::munmap(sqes_, sqes_size_);
+        release();
+    }
+
+    IoUring(const IoUring&) = delete;
+    IoUring& operator=(const IoUring&) = delete;
+
+    /**
+     * @brief   当前内核/沙箱是否允许使用io_uring
+     * @note    结果在首次调用时探测并缓存，不支持时上层回退到pread/ofstream
+     */
+    static bool supported() {
+        static const bool ok = [] {
+            try {
+                IoUring probe(2);
+                return true;
+            } catch (const std::exception&) {
+                return false;
+            }
+        }();
+        return ok;
+    }
+
+    /**
+     * @brief   注册固定缓冲区
+     * @param   buffers     缓冲区列表，FIXED操作以下标引用
+     * @return  是否成功（超过RLIMIT_MEMLOCK或已有注册时失败）
+     * @note    注册后内核预先锁定页面，省去每次I/O的页表查找和引用计数
+     */
+    bool register_buffers(std::span<const iovec> buffers) {
+        return ::syscall(__NR_io_uring_register, ring_fd_, IORING_REGISTER_BUFFERS,
+                         buffers.data(), static_cast<unsigned>(buffers.size())) == 0;
+    }
+
+    /**
+     * @brief   取消注册固定缓冲区
+     */
+    void unregister_buffers() {
+        ::syscall(__NR_io_uring_register, ring_fd_, IORING_UNREGISTER_BUFFERS, nullptr, 0);
+    }
+
+    /**
+     * @brief   将请求放入提交队列（不进入内核）
+     * @param   request     请求
+     * @param   completion  完成状态，在完成前必须保持有效
+     * @note    提交队列满时先提交已有请求；在途请求达到完成队列容量时先等待完成
+     */
+    void prepare(const IoRequest& request, IoCompletion* completion) {
+        while (in_flight_ + pending_ >= cq_entries_) {
+            submit(1);
+            process_completions();
+        }
+        if (sqe_tail_ - __atomic_load_n(sq_head_, __ATOMIC_ACQUIRE) >= sq_entries_) submit(0);
+
+        io_uring_sqe* sqe = &sqes_[sqe_tail_ & sq_mask_];
+        std::memset(sqe, 0, sizeof(*sqe));
+        sqe->opcode = request.opcode;
+        sqe->fd = request.fd;
+        sqe->addr = request.addr;
+        sqe->len = request.len;
+        sqe->off = request.offset;
+        sqe->rw_flags = request.op_flags;
+        if (request.buf_index >= 0) sqe->buf_index = static_cast<uint16_t>(request.buf_index);
+        if (request.link) sqe->flags |= IOSQE_IO_LINK;
+        sqe->user_data = reinterpret_cast<uint64_t>(completion);
+        sq_array_[sqe_tail_ & sq_mask_] = sqe_tail_ & sq_mask_;
+        sqe_tail_++;
+        pending_++;
+    }
+
+    /**
+     * @brief   提交所有待提交请求（一次系统调用）
+     * @param   wait_nr     至少等待完成的数量
+     * @return  本次提交的请求数
+     * @throws  std::runtime_error 当io_uring_enter失败时
+     */
+    unsigned submit(unsigned wait_nr = 0) {
+        unsigned to_submit = pending_;
+        if (to_submit == 0 && wait_nr == 0) return 0;
+        __atomic_store_n(sq_tail_, sqe_tail_, __ATOMIC_RELEASE);
+        unsigned flags = wait_nr > 0 ? IORING_ENTER_GETEVENTS : 0;
+        int ret;
+        do {
+            ret = static_cast<int>(::syscall(__NR_io_uring_enter, ring_fd_, to_submit, wait_nr, flags, nullptr, 0));
+        } while (ret < 0 && errno == EINTR);
+        if (ret < 0) throw std::runtime_error(std::string("io_uring_enter failed: ") + std::strerror(errno));
+        pending_ -= static_cast<unsigned>(ret);
+        in_flight_ += static_cast<unsigned>(ret);
+        return static_cast<unsigned>(ret);
+    }
+
+    /**
+     * @brief   处理完成队列中已有的完成事件
+     * @return  处理的事件数
+     * @note    先回填全部结果并推进队头，再依次恢复等待的协程，
+     *          协程恢复后可以继续在本实例上发起新的I/O
+     */
+    size_t process_completions() {
+        unsigned head = *cq_head_;
+        unsigned tail = __atomic_load_n(cq_tail_, __ATOMIC_ACQUIRE);
+        std::vector<std::coroutine_handle<>> ready;
+        size_t count = 0;
+        for (; head != tail; ++head, ++count) {
+            const io_uring_cqe& cqe = cqes_[head & cq_mask_];
+            auto* completion = reinterpret_cast<IoCompletion*>(cqe.user_data);
+            completion->result = cqe.res;
+            completion->done = true;
+            if (completion->waiter) ready.push_back(completion->waiter);
+        }
+        __atomic_store_n(cq_head_, head, __ATOMIC_RELEASE);
+        in_flight_ -= static_cast<unsigned>(count);
+        for (auto handle : ready) handle.resume();
+        return count;
+    }
+
+    /**
+     * @brief   提交并处理完成事件（协程驱动循环的一步）
+     * @param   wait    没有就绪事件时是否阻塞等待至少一个完成
+     * @return  处理的事件数
+     */
+    size_t poll(bool wait = true) {
+        submit(wait && in_flight_ + pending_ > 0 ? 1 : 0);
+        return process_completions();
+    }
+
+    /**
+     * @brief   等待某个操作完成
+     */
+    void wait(const IoCompletion& completion) {
+        while (!completion.done) {
+            submit(1);
+            process_completions();
+        }
+    }
+
+    /**
+     * @brief   批量执行请求并等待全部完成
+     * @param   requests    请求列表
+     * @return  每个请求的结果
+     * @note    所有请求尽量在一次io_uring_enter中提交，适合一次查询的多个随机读
+     */
+    std::vector<int> execute(std::span<const IoRequest> requests) {
+        std::vector<IoCompletion> completions(requests.size());
+        for (size_t i = 0; i < requests.size(); ++i) prepare(requests[i], &completions[i]);
+        for (const auto& c : completions) wait(c);
+        std::vector<int> results(requests.size());
+        for (size_t i = 0; i < requests.size(); ++i) results[i] = completions[i].result;
+        return results;
+    }
+
+    /**
+     * @brief   构造可co_await的I/O操作
+     */
+    IoAwaitable async(const IoRequest& request) { return {*this, request}; }
+
+    /**
+     * @brief   已提交但未完成的请求数
+     */
+    unsigned in_flight() const { return in_flight_; }
+
+    /**
+     * @brief   已放入队列但尚未提交的请求数
+     */
+    unsigned pending() const { return pending_; }
+
+    /**
+     * @brief   ring的fd，有完成事件时可读，可加入epoll
+     */
+    int fd() const { return ring_fd_; }
+
+private:
+    int ring_fd_ = -1;
+    bool single_mmap_ = false;
+    void* sq_ring_ = MAP_FAILED;
+    void* cq_ring_ = MAP_FAILED;
+    size_t sq_ring_size_ = 0;
+    size_t cq_ring_size_ = 0;
+    io_uring_sqe* sqes_ = nullptr;
+    size_t sqes_size_ = 0;
+
+    unsigned* sq_head_ = nullptr;
+    unsigned* sq_tail_ = nullptr;
+    unsigned* sq_array_ = nullptr;
+    unsigned sq_mask_ = 0;
+    unsigned sq_entries_ = 0;
+    unsigned sqe_tail_ = 0;         ///< 本地提交队列尾，submit时发布给内核
+
+    unsigned* cq_head_ = nullptr;
+    unsigned* cq_tail_ = nullptr;
+    io_uring_cqe* cqes_ = nullptr;
+    unsigned cq_mask_ = 0;
+    unsigned cq_entries_ = 0;
+
+    unsigned pending_ = 0;          ///< 已入队未提交
+    unsigned in_flight_ = 0;        ///< 已提交未完成
+
+    /**
+     * @brief   等待在途请求全部完成并丢弃其完成事件
+     * @note    只推进完成队列，不回填IoCompletion、不恢复协程（它们可能已销毁）；
+     *          未提交的请求内核尚未看到，直接丢弃
+     */
+    void drain() noexcept {
+        while (in_flight_ > 0 && ring_fd_ >= 0) {
+            unsigned head = *cq_head_;
+            unsigned tail = __atomic_load_n(cq_tail_, __ATOMIC_ACQUIRE);
+            if (head == tail) {
+                int ret = static_cast<int>(::syscall(__NR_io_uring_enter, ring_fd_, 0, 1, IORING_ENTER_GETEVENTS,
+                                                     nullptr, 0));
+                if (ret < 0 && errno != EINTR) break;
+                continue;
+            }
+            in_flight_ -= std::min(in_flight_, tail - head);
+            __atomic_store_n(cq_head_, tail, __ATOMIC_RELEASE);
+        }
+    }
+
+    void release() {
+        if (cq_ring_ != MAP_FAILED && !single_mmap_) ::munmap(cq_ring_, cq_ring_size_);
+        if (sq_ring_ != MAP_FAILED) ::munmap(sq_ring_, sq_ring_size_);
+        sq_ring_ = cq_ring_ = MAP_FAILED;
+        if (ring_fd_ >= 0) ::close(ring_fd_);
+        ring_fd_ = -1;
+    }
+};
+
+inline void IoAwaitable::await_suspend(std::coroutine_handle<> handle) {
+    completion_.waiter = handle;
+    ring_.prepare(request_, &completion_);
+}
+
+} // namespace minimilvus
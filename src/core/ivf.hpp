@@ -0,0 +1,685 @@
+/**
+ * @file    ivf.hpp
+ * @brief   策略模板化的IVF索引
+ * @details IVF<Metric, Codec, ListStorage>：度量、向量编码和倒排桶布局都是编译期参数，
+ *          每种组合都会生成一份距离计算完全内联的扫描循环。
+ *          运行时按描述串选择组合见 index_factory.hpp
+ * @author  Tyooughtul
+ */
+
+#pragma once
+#include <algorithm>
+#include <fstream>
+#include <memory>
+#include <queue>
+#include <string>
+#include <type_traits>
+#include <vector>
+#include <omp.h>
+#include "codecs.hpp"
+#include "ivf_index.hpp"
+#include "kmeans.hpp"
+#include "profiler.hpp"
+#include "memory_stats.hpp"
+
+namespace minimilvus {
+
+/**
+ * @brief   每个桶一对vector（ID数组 + 编码数组）
+ * @details 扫描一个桶是两段连续内存；add会触发vector扩容，
+ *          批量构建前按桶大小reserve即可避免空闲容量
+ */
+class VectorListStorage {
+public:
+    static constexpr const char* kName = "";    ///< 描述串中的布局后缀，默认布局为空
+
+    void init(size_t n_lists, size_t code_size) {
+        ids_.assign(n_lists, {});
+        codes_.assign(n_lists, {});
+        code_size_ = code_size;
+    }
+
+    size_t n_lists() const { return ids_.size(); }
+    size_t list_size(size_t list) const { return ids_[list].size(); }
+
+    void reserve(size_t list, size_t n) {
+        ids_[list].reserve(n);
+        codes_[list].reserve(n * code_size_);
+    }
+
+    void append(size_t list, idx_t id, const uint8_t* code) {
+        ids_[list].push_back(id);
+        codes_[list].insert(codes_[list].end(), code, code + code_size_);
+    }
+
+    /**
+     * @brief   按连续块遍历一个桶
+     * @param   f   f(const idx_t* ids, const uint8_t* codes, size_t n)
+     */
+    template<typename F>
+    void scan(size_t list, F&& f) const {
+        f(ids_[list].data(), codes_[list].data(), ids_[list].size());
+    }
+
+    void shrink_to_fit() {
+        for (auto& ids : ids_) ids.shrink_to_fit();
+        for (auto& codes : codes_) codes.shrink_to_fit();
+    }
+
+    MemoryReport memory_report() const {
+        MemoryReport report;
+        MemoryUsage ids, codes;
+        for (const auto& list : ids_) ids += vector_memory(list);
+        for (const auto& list : codes_) codes += vector_memory(list);
+        report.add("list_ids", ids);
+        report.add("list_codes", codes);
+        MemoryUsage headers = vector_memory(ids_);
+        headers += vector_memory(codes_);
+        report.add("list_headers", headers);
+        return report;
+    }
+
+private:
+    std::vector<std::vector<idx_t>> ids_;
+    std::vector<std::vector<uint8_t>> codes_;
+    size_t code_size_ = 0;
+};
+
+/**
+ * @brief   定长页链表布局
+ * @details 每页存kPageEntries个条目，页内ID和编码相邻；桶是页号列表。
+ *          追加时不搬移已有数据，每个桶最多浪费一页内的空位，适合持续写入的场景
+ */
+class PagedListStorage {
+public:
+    static constexpr const char* kName = "Paged";
+    static constexpr size_t kPageEntries = 256;
+
+    void init(size_t n_lists, size_t code_size) {
+        pages_.clear();
+        lists_.assign(n_lists, {});
+        sizes_.assign(n_lists, 0);
+        code_size_ = code_size;
+    }
+
+    size_t n_lists() const { return lists_.size(); }
+    size_t list_size(size_t list) const { return sizes_[list]; }
+
+    void reserve(size_t list, size_t n) { lists_[list].reserve((n + kPageEntries - 1) / kPageEntries); }
+
+    void append(size_t list, idx_t id, const uint8_t* code) {
+        size_t slot = sizes_[list] % kPageEntries;
+        if (slot == 0) {
+            lists_[list].push_back(static_cast<uint32_t>(pages_.size()));
+            pages_.push_back(std::make_unique<uint8_t[]>(page_bytes()));
+        }
+        uint8_t* page = pages_[lists_[list].back()].get();
+        std::memcpy(page + slot * sizeof(idx_t), &id, sizeof(idx_t));
+        std::memcpy(page + kPageEntries * sizeof(idx_t) + slot * code_size_, code, code_size_);
+        sizes_[list]++;
+    }
+
+    template<typename F>
+    void scan(size_t list, F&& f) const {
+        size_t remaining = sizes_[list];
+        for (uint32_t page_id : lists_[list]) {
+            const uint8_t* page = pages_[page_id].get();
+            size_t n = std::min(remaining, kPageEntries);
+            f(reinterpret_cast<const idx_t*>(page), page + kPageEntries * sizeof(idx_t), n);
+            remaining -= n;
+        }
+    }
+
+    void shrink_to_fit() {
+        for (auto& pages : lists_) pages.shrink_to_fit();
+    }
+
+    MemoryReport memory_report() const {
+        MemoryReport report;
+        size_t entries = 0;
+        for (size_t n : sizes_) entries += n;
+        report.add("list_pages", {entries * (sizeof(idx_t) + code_size_), pages_.size() * page_bytes()});
+        MemoryUsage headers = vector_memory(pages_);
+        for (const auto& pages : lists_) headers += vector_memory(pages);
+        headers += vector_memory(lists_);
+        headers += vector_memory(sizes_);
+        report.add("list_headers", headers);
+        return report;
+    }
+
+private:
+    std::vector<std::unique_ptr<uint8_t[]>> pages_;
+    std::vector<std::vector<uint32_t>> lists_;  ///< 桶 -> 页号
+    std::vector<size_t> sizes_;
+    size_t code_size_ = 0;
+
+    size_t page_bytes() const { return kPageEntries * (sizeof(idx_t) + code_size_); }
+};
+
+/**
+ * @brief   残差编码方式
+ * @details 直接编码原始向量时，码本的精度有很大一部分花在表示"属于哪个簇"上；
+ *          残差编码对 x - centroid[list] 编码，码本只需覆盖簇内的偏移
+ */
+enum class ResidualMode : int32_t {
+    None = 0,       ///< 编码原始向量
+    Global = 1,     ///< 所有桶共享一个残差码本
+    PerList = 2,    ///< 每个桶单独训练码本，样本不足的桶退回全局码本
+};
+
+/**
+ * @brief   残差模式在描述串中的名字，None为空串
+ */
+inline const char* residual_mode_name(ResidualMode mode) {
+    switch (mode) {
+        case ResidualMode::Global: return "Residual";
+        case ResidualMode::PerList: return "ResidualPerList";
+        default: return "";
+    }
+}
+
+/**
+ * @brief   策略模板化的IVF索引
+ * @tparam  Metric       L2Metric / IPMetric
+ * @tparam  Codec        FlatCodec / FP16Codec / SQ8Codec / PQCodec
+ * @tparam  ListStorage  VectorListStorage / PagedListStorage
+ * @details 与IVFIndex不同，向量以编码形式保存在桶内，搜索不再访问原始数据集；
+ *          距离来自编码，有损编码的结果距离是近似值。
+ *          残差模式下桶内保存 x - centroid 的编码，查询按探测的桶调整距离表
+ */
+template<typename Metric = L2Metric, typename Codec = FlatCodec, typename ListStorage = VectorListStorage>
+class IVF {
+public:
+    using metric_type = Metric;
+    using codec_type = Codec;
+    using storage_type = ListStorage;
+
+    /// 批量add时每块编码的向量数，限制临时编码缓冲区大小
+    static constexpr idx_t kAddChunk = 65536;
+    /// 残差码本的训练样本上限
+    static constexpr idx_t kMaxResidualTrainSamples = 131072;
+    /// PQ残差预计算表（n_lists * m * 256个float）的大小上限，超过时查询时逐桶计算
+    static constexpr size_t kMaxPrecomputedTableBytes = size_t(256) << 20;
+
+    /**
+     * @brief   构造函数
+     * @param   dim       向量维度
+     * @param   n_lists   桶数量
+     */
+    IVF(int dim, int n_lists) : IVF(dim, n_lists, Codec(dim)) {}
+
+    /**
+     * @brief   构造函数（自定义编码器参数，如PQ分段数）
+     * @param   residual  残差编码方式
+     * @throws  std::invalid_argument 当参数非法或编码器维度不符时
+     */
+    IVF(int dim, int n_lists, Codec codec, ResidualMode residual = ResidualMode::None)
+        : dim_(dim), n_lists_(n_lists), kmeans_(n_lists, 5, dim), codec_(std::move(codec)), residual_(residual) {
+        if (dim <= 0 || n_lists <= 0) throw std::invalid_argument("IVF dim and n_lists must be positive");
+        if (codec_.get_dim() != dim) throw std::invalid_argument("Codec dim mismatch");
+        kmeans_.set_verbose(false);
+        lists_.init(n_lists, codec_.code_size());
+    }
+
+    /**
+     * @brief   训练桶中心和编码器
+     */
+    void train(const VectorDataset& dataset) {
+        kmeans_.train(dataset);
+        if (residual_ == ResidualMode::None) {
+            codec_.train(dataset);
+        } else {
+            train_residual_codecs(dataset);
+        }
+        trained_ = true;
+    }
+
+    /**
+     * @brief   编码并加入一批向量
+     * @param   dataset     向量数据
+     * @param   first_id    第i个向量的ID为 first_id + i
+     * @throws  std::logic_error 当索引尚未训练时
+     */
+    void add(const VectorDataset& dataset, idx_t first_id = 0) {
+        if (!trained_) throw std::logic_error("IVF index is not trained");
+        const size_t cs = codec_.code_size();
+        std::vector<int> assignments;
+        std::vector<uint8_t> codes;
+        for (idx_t begin = 0; begin < dataset.get_count(); begin += kAddChunk) {
+            idx_t n = std::min(kAddChunk, dataset.get_count() - begin);
+            assignments.resize(n);
+            codes.resize(n * cs);
+            #pragma omp parallel for
+            for (idx_t i = 0; i < n; ++i) {
+                auto vec = dataset.get_vector(begin + i);
+                assignments[i] = nearest_list(vec);
+                encode(assignments[i], vec, codes.data() + i * cs);
+            }
+            std::vector<size_t> list_sizes(n_lists_, 0);
+            for (idx_t i = 0; i < n; ++i) list_sizes[assignments[i]]++;
+            for (int c = 0; c < n_lists_; ++c) {
+                if (list_sizes[c]) lists_.reserve(c, lists_.list_size(c) + list_sizes[c]);
+            }
+            for (idx_t i = 0; i < n; ++i) {
+                lists_.append(assignments[i], first_id + begin + i, codes.data() + i * cs);
+            }
+            ntotal_ += n;
+        }
+    }
+
+    /**
+     * @brief   加入单个向量
+     * @throws  std::logic_error 当索引尚未训练时
+     */
+    void add(std::span<const float> vec, idx_t id) {
+        if (!trained_) throw std::logic_error("IVF index is not trained");
+        std::vector<uint8_t> code(codec_.code_size());
+        int list = nearest_list(vec);
+        encode(list, vec, code.data());
+        lists_.append(list, id, code.data());
+        ntotal_++;
+    }
+
+    /**
+     * @brief   训练并加入数据集中全部向量（ID为行号）
+     */
+    void build(const VectorDataset& dataset) {
+        train(dataset);
+        add(dataset);
+    }
+
+    /**
+     * @brief   搜索最近邻
+     * @param   query     查询向量
+     * @param   k         返回结果数量
+     * @param   nprobe    探测的桶数量
+     * @param   profile   剖析结果输出，可为空
+     * @return  按距离升序的结果（IP度量下距离为负内积）
+     */
+    std::vector<SearchResult> search(std::span<const float> query, int k, int nprobe = 16,
+                                     QueryProfile* profile = nullptr) const {
+        if (!trained_ || k <= 0) return {};
+        const auto& centroids = kmeans_.get_centroids();
+        std::vector<std::pair<float, int>> clusters_scores(n_lists_);
+        {
+            ScopedStageTimer timer(profile, ProfileStage::CentroidScoring);
+            for (int c = 0; c < n_lists_; ++c) {
+                std::span<const float> center(centroids.data() + static_cast<size_t>(c) * dim_, dim_);
+                clusters_scores[c] = {Metric::distance(query, center), c};
+            }
+            if (profile) profile->centroids_scored += n_lists_;
+        }
+
+        nprobe = std::clamp(nprobe, 1, n_lists_);
+        {
+            ScopedStageTimer timer(profile, ProfileStage::ProbeSelection);
+            std::partial_sort(clusters_scores.begin(), clusters_scores.begin() + nprobe, clusters_scores.end());
+        }
+
+        std::priority_queue<SearchResult> heap;
+        const size_t cs = codec_.code_size();
+        // 扫描中的入堆与距离计算交错，整体计入BucketScan，只统计入堆次数，避免逐次读TSC放大开销
+        int64_t scanned = 0, heap_pushes = 0;
+        auto scan_list = [&](int list, const auto& scanner, float bias) {
+            lists_.scan(list, [&](const idx_t* ids, const uint8_t* codes, size_t n) {
+                for (size_t i = 0; i < n; ++i) {
+                    float dist = bias + scanner(codes + i * cs);
+                    bool full = heap.size() >= static_cast<size_t>(k);
+                    if (full && dist >= heap.top().distance) continue;
+                    if (full) heap.pop();
+                    heap.push({ids[i], dist});
+                    heap_pushes++;
+                }
+                scanned += n;
+            });
+        };
+        {
+            ScopedStageTimer timer(profile, ProfileStage::BucketScan);
+            if (residual_ == ResidualMode::None) {
+                auto scanner = codec_.template scanner<Metric>(query);
+                for (int p = 0; p < nprobe; ++p) scan_list(clusters_scores[p].second, scanner, 0.0f);
+            } else if (!residual_tables_.empty()) {
+                scan_precomputed(query, clusters_scores, nprobe, scan_list);
+            } else if constexpr (Metric::kInnerProduct) {
+                // <q, c + r> = <q, c> + <q, r>：残差部分的距离表与桶无关，桶中心项即粗排距离
+                if (residual_ == ResidualMode::Global) {
+                    auto scanner = codec_.template scanner<Metric>(query);
+                    for (int p = 0; p < nprobe; ++p) {
+                        scan_list(clusters_scores[p].second, scanner, clusters_scores[p].first);
+                    }
+                } else {
+                    for (int p = 0; p < nprobe; ++p) {
+                        int list = clusters_scores[p].second;
+                        auto scanner = codec_for(list).template scanner<Metric>(query);
+                        scan_list(list, scanner, clusters_scores[p].first);
+                    }
+                }
+            } else {
+                std::vector<float> residual(dim_);
+                for (int p = 0; p < nprobe; ++p) {
+                    int list = clusters_scores[p].second;
+                    const float* center = centroids.data() + static_cast<size_t>(list) * dim_;
+                    for (int d = 0; d < dim_; ++d) residual[d] = query[d] - center[d];
+                    auto scanner = codec_for(list).template scanner<Metric>(residual);
+                    scan_list(list, scanner, 0.0f);
+                }
+            }
+        }
+        if (profile) {
+            profile->buckets_probed += nprobe;
+            profile->vectors_scanned += scanned;
+            profile->heap_pushes += heap_pushes;
+        }
+
+        ScopedStageTimer timer(profile, ProfileStage::TopK);
+        std::vector<SearchResult> results(heap.size());
+        for (size_t i = results.size(); i-- > 0;) {
+            results[i] = heap.top();
+            heap.pop();
+        }
+        if (profile) profile->results_returned += results.size();
+        return results;
+    }
+
+    bool is_trained() const { return trained_; }
+    int get_dim() const { return dim_; }
+    int get_n_lists() const { return n_lists_; }
+    size_t size() const { return ntotal_; }
+    const Codec& codec() const { return codec_; }
+    const std::vector<float>& centroids() const { return kmeans_.get_centroids(); }
+    ResidualMode residual_mode() const { return residual_; }
+
+    /**
+     * @brief   编码第list个桶使用的码本
+     */
+    const Codec& codec_for(int list) const {
+        if (list_codec_.empty() || list_codec_[list] < 0) return codec_;
+        return list_codecs_[list_codec_[list]];
+    }
+    const ListStorage& lists() const { return lists_; }
+
+    /**
+     * @brief   描述串，如 "IVF1024,SQ8"、"IVF256,PQ16,Residual,Paged"，可交给index_factory重建同类索引
+     */
+    std::string description() const {
+        std::string desc = "IVF" + std::to_string(n_lists_) + "," + codec_.name();
+        if (residual_ != ResidualMode::None) desc += std::string(",") + residual_mode_name(residual_);
+        if (std::string(ListStorage::kName).size()) desc += std::string(",") + ListStorage::kName;
+        return desc;
+    }
+
+    /**
+     * @brief   统计索引各部分的内存占用
+     */
+    MemoryReport memory_report() const {
+        MemoryReport report;
+        report.add("centroids", vector_memory(kmeans_.get_centroids()));
+        report.add("codec", codec_.memory_usage());
+        if (!list_codecs_.empty()) {
+            MemoryUsage list_codecs = vector_memory(list_codec_);
+            for (const auto& codec : list_codecs_) list_codecs += codec.memory_usage();
+            report.add("list_codecs", list_codecs);
+        }
+        if (!residual_tables_.empty()) report.add("residual_tables", vector_memory(residual_tables_));
+        report.merge(lists_.memory_report());
+        return report;
+    }
+
+    /**
+     * @brief   回收倒排桶的空闲容量
+     */
+    void shrink_to_fit() { lists_.shrink_to_fit(); }
+
+    /**
+     * @brief   保存索引到文件
+     * @throws  std::runtime_error 当文件无法写入时
+     * @note    文件格式：magic(4B) | dim | n_lists | 度量名 | 描述串 | centroids | 编码器参数 |
+     *          残差模式 [| 各桶码本编号 | 各桶码本] | 每个桶的 size + ids + codes。
+     *          桶内容与布局无关，可由其他布局加载；PQ残差预计算表在加载时重建
+     */
+    void save(const std::string& path) const {
+        std::ofstream file(path, std::ios::binary | std::ios::trunc);
+        if (!file.is_open()) throw std::runtime_error("Failed to open index file: " + path);
+        save(file);
+        if (!file) throw std::runtime_error("Failed to write index file: " + path);
+    }
+
+    /**
+     * @brief   写入流，供外层容器（如带预处理变换的索引）把IVF嵌入同一文件
+     */
+    void save(std::ostream& file) const {
+        file.write(kFileMagic, 4);
+        detail::write_pod(file, static_cast<int32_t>(dim_));
+        detail::write_pod(file, static_cast<int32_t>(n_lists_));
+        detail::write_string(file, Metric::kName);
+        detail::write_string(file, description());
+        detail::write_vector(file, kmeans_.get_centroids());
+        codec_.save(file);
+        detail::write_pod(file, static_cast<int32_t>(residual_));
+        if (residual_ == ResidualMode::PerList) {
+            detail::write_vector(file, list_codec_);
+            for (const auto& codec : list_codecs_) codec.save(file);
+        }
+        const size_t cs = codec_.code_size();
+        for (int c = 0; c < n_lists_; ++c) {
+            detail::write_pod(file, static_cast<int64_t>(lists_.list_size(c)));
+            lists_.scan(c, [&](const idx_t* ids, const uint8_t*, size_t n) {
+                file.write(reinterpret_cast<const char*>(ids), n * sizeof(idx_t));
+            });
+            lists_.scan(c, [&](const idx_t*, const uint8_t* codes, size_t n) {
+                file.write(reinterpret_cast<const char*>(codes), n * cs);
+            });
+        }
+    }
+
+    /**
+     * @brief   从文件加载索引
+     * @throws  std::runtime_error 当文件不存在、格式错误、度量不符或被截断时
+     */
+    static IVF load(const std::string& path) {
+        std::ifstream file(path, std::ios::binary);
+        if (!file.is_open()) throw std::runtime_error("Failed to open index file: " + path);
+        return load(file, path);
+    }
+
+    /**
+     * @brief   从流的当前位置加载索引
+     * @param   path    仅用于错误信息
+     */
+    static IVF load(std::istream& file, const std::string& path) {
+        int32_t dim = 0, n_lists = 0;
+        read_header(file, path, dim, n_lists);
+        if (detail::read_string(file) != Metric::kName) {
+            throw std::runtime_error("Index metric mismatch: " + path);
+        }
+        detail::read_string(file);
+
+        std::vector<float> centroids;
+        detail::read_vector(file, centroids);
+        Codec codec = Codec::load(file, dim);
+        int32_t residual = -1;
+        detail::read_pod(file, residual);
+        if (!file || residual < 0 || residual > static_cast<int32_t>(ResidualMode::PerList)) {
+            throw std::runtime_error("Invalid residual mode in index file: " + path);
+        }
+        IVF index(dim, n_lists, std::move(codec), static_cast<ResidualMode>(residual));
+        index.kmeans_.set_centroids(std::move(centroids));
+        if (index.residual_ == ResidualMode::PerList) {
+            detail::read_vector(file, index.list_codec_);
+            if (index.list_codec_.size() != static_cast<size_t>(n_lists)) {
+                throw std::runtime_error("Invalid per-list codec table in index file: " + path);
+            }
+            int32_t n_codecs = 0;
+            for (int32_t id : index.list_codec_) {
+                if (id < -1) throw std::runtime_error("Invalid per-list codec table in index file: " + path);
+                n_codecs = std::max(n_codecs, id + 1);
+            }
+            for (int32_t i = 0; i < n_codecs; ++i) index.list_codecs_.push_back(Codec::load(file, dim));
+        }
+        index.build_residual_tables();
+
+        const size_t cs = index.codec_.code_size();
+        std::vector<idx_t> ids;
+        std::vector<uint8_t> codes;
+        for (int c = 0; c < n_lists; ++c) {
+            int64_t size = -1;
+            detail::read_pod(file, size);
+            if (!file || size < 0 ||
+                static_cast<uint64_t>(size) > detail::remaining_bytes(file) / (sizeof(idx_t) + cs)) {
+                throw std::runtime_error("Truncated index file: " + path);
+            }
+            ids.resize(size);
+            codes.resize(size * cs);
+            file.read(reinterpret_cast<char*>(ids.data()), size * sizeof(idx_t));
+            file.read(reinterpret_cast<char*>(codes.data()), size * cs);
+            if (!file) throw std::runtime_error("Truncated index file: " + path);
+            index.lists_.reserve(c, size);
+            for (int64_t i = 0; i < size; ++i) index.lists_.append(c, ids[i], codes.data() + i * cs);
+            index.ntotal_ += size;
+        }
+        index.trained_ = true;
+        return index;
+    }
+
+    /**
+     * @brief   读取并校验文件头
+     * @throws  std::runtime_error 当格式错误时
+     */
+    static void read_header(std::istream& file, const std::string& path, int32_t& dim, int32_t& n_lists) {
+        char magic[4];
+        file.read(magic, 4);
+        detail::read_pod(file, dim);
+        detail::read_pod(file, n_lists);
+        if (!file || std::string(magic, 4) != std::string(kFileMagic, 4) || dim <= 0 || n_lists <= 0) {
+            throw std::runtime_error("Invalid index file: " + path);
+        }
+    }
+
+    /// 索引文件头的魔数
+    static constexpr char kFileMagic[4] = {'M', 'M', 'I', 'T'};
+
+private:
+    int dim_;
+    int n_lists_;
+    KMeans kmeans_;
+    Codec codec_;
+    ResidualMode residual_;
+    std::vector<int32_t> list_codec_;           ///< PerList：桶 -> list_codecs_下标，-1表示用全局码本
+    std::vector<Codec> list_codecs_;
+    std::vector<float> residual_tables_;        ///< PQ + L2 + Global：[n_lists][m][256] 桶项表
+    ListStorage lists_;
+    size_t ntotal_ = 0;
+    bool trained_ = false;
+
+    /**
+     * @brief   按桶编码：残差模式下编码 vec - centroid[list]
+     */
+    void encode(int list, std::span<const float> vec, uint8_t* code) const {
+        if (residual_ == ResidualMode::None) {
+            codec_.encode(vec, code);
+            return;
+        }
+        const float* center = kmeans_.get_centroids().data() + static_cast<size_t>(list) * dim_;
+        std::vector<float> residual(dim_);
+        for (int d = 0; d < dim_; ++d) residual[d] = vec[d] - center[d];
+        codec_for(list).encode(residual, code);
+    }
+
+    /**
+     * @brief   在训练样本的残差上训练全局码本，PerList模式下再为样本足够的桶各训练一个码本
+     */
+    void train_residual_codecs(const VectorDataset& dataset) {
+        idx_t n = std::min(dataset.get_count(), kMaxResidualTrainSamples);
+        idx_t step = std::max<idx_t>(1, dataset.get_count() / std::max<idx_t>(n, 1));
+        const auto& centroids = kmeans_.get_centroids();
+        std::vector<int> assignments(n);
+        VectorDataset residuals(dim_);
+        auto rows = residuals.extend(n);
+        #pragma omp parallel for
+        for (idx_t i = 0; i < n; ++i) {
+            auto vec = dataset.get_vector(i * step);
+            assignments[i] = nearest_list(vec);
+            const float* center = centroids.data() + static_cast<size_t>(assignments[i]) * dim_;
+            for (int d = 0; d < dim_; ++d) rows[i * dim_ + d] = vec[d] - center[d];
+        }
+        codec_.train(residuals);
+
+        list_codec_.clear();
+        list_codecs_.clear();
+        if (residual_ == ResidualMode::PerList) {
+            std::vector<VectorDataset> per_list(n_lists_, VectorDataset(dim_));
+            for (idx_t i = 0; i < n; ++i) {
+                auto r = residuals.get_vector(i);
+                per_list[assignments[i]].add_batch(r);
+            }
+            list_codec_.assign(n_lists_, -1);
+            for (int c = 0; c < n_lists_; ++c) {
+                if (per_list[c].get_count() == 0 || per_list[c].get_count() < Codec::kMinTrainSamples) continue;
+                Codec codec = codec_;
+                codec.train(per_list[c]);
+                list_codec_[c] = static_cast<int32_t>(list_codecs_.size());
+                list_codecs_.push_back(std::move(codec));
+            }
+        }
+        build_residual_tables();
+    }
+
+    /**
+     * @brief   PQ + L2 + 全局残差码本时，预计算每个桶的 ||r||² + 2<c, r> 表
+     */
+    void build_residual_tables() {
+        residual_tables_.clear();
+        if constexpr (std::is_same_v<Codec, PQCodec> && !Metric::kInnerProduct) {
+            if (residual_ != ResidualMode::Global) return;
+            size_t table_size = static_cast<size_t>(codec_.segments()) * PQCodec::kCentroids;
+            if (n_lists_ * table_size * sizeof(float) > kMaxPrecomputedTableBytes) return;
+            residual_tables_.resize(n_lists_ * table_size);
+            const auto& centroids = kmeans_.get_centroids();
+            #pragma omp parallel for
+            for (int c = 0; c < n_lists_; ++c) {
+                std::span<const float> center(centroids.data() + static_cast<size_t>(c) * dim_, dim_);
+                auto table = codec_.residual_term_table(center);
+                std::copy(table.begin(), table.end(), residual_tables_.begin() + c * table_size);
+            }
+        }
+    }
+
+    /**
+     * @brief   用预计算表扫描：查询项 -2<q, r> 只算一次，每个桶的距离表 = 桶项表 + 查询项，
+     *          再加上粗排距离 ||q - c||²
+     */
+    template<typename ScanList>
+    void scan_precomputed(std::span<const float> query, const std::vector<std::pair<float, int>>& clusters_scores,
+                          int nprobe, ScanList& scan_list) const {
+        if constexpr (std::is_same_v<Codec, PQCodec>) {
+            std::vector<float> query_term = codec_.inner_product_table(query);
+            const size_t table_size = query_term.size();
+            for (int p = 0; p < nprobe; ++p) {
+                int list = clusters_scores[p].second;
+                const float* precomputed = residual_tables_.data() + list * table_size;
+                std::vector<float> table(table_size);
+                for (size_t i = 0; i < table_size; ++i) table[i] = precomputed[i] - 2.0f * query_term[i];
+                PQCodec::Scanner<Metric> scanner(codec_.segments(), std::move(table),
+                                                  clusters_scores[p].first);
+                scan_list(list, scanner, 0.0f);
+            }
+        }
+    }
+
+    int nearest_list(std::span<const float> vec) const {
+        const auto& centroids = kmeans_.get_centroids();
+        int best = 0;
+        float best_dist = std::numeric_limits<float>::max();
+        for (int c = 0; c < n_lists_; ++c) {
+            std::span<const float> center(centroids.data() + static_cast<size_t>(c) * dim_, dim_);
+            float dist = Metric::distance(vec, center);
+            if (dist < best_dist) {
+                best_dist = dist;
+                best = c;
+            }
+        }
+        return best;
+    }
+};
+
+} // namespace minimilvus
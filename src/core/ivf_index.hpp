@@ -9,10 +9,19 @@
 #include <vector>
 #include <algorithm>
 #include <queue>
+#include <fstream>
+#include <string>
+#include <memory>
+#include <unordered_set>
 #include <omp.h>
 #include "kmeans.hpp"
 #include "dataset.hpp"
 #include "metrics.hpp"
+#include "profiler.hpp"
+#include "memory_stats.hpp"
+#include "access_tracker.hpp"
+#include "knn_graph.hpp"
+#include "reorder.hpp"
 
 namespace minimilvus {
 
@@ -41,47 +50,288 @@ public:
      * @param   n_lists   桶数量设为数据量的√倍，100万数据用1000桶
      */
     IVFIndex(int dim, int n_lists) 
-        : dim_(dim), n_lists_(n_lists), kmeans_(n_lists, 5, dim) {
+        : dim_(dim), n_lists_(n_lists), kmeans_(n_lists, 5, dim), access_(n_lists) {
         inverted_lists_.resize(n_lists);
     }
 
     /**
      * @brief   构建IVF索引
      * @param   dataset   待索引的向量数据集
-     * @note    包含训练KMeans和填充倒排桶两个阶段
+     * @note    包含训练KMeans和填充倒排桶两个阶段；开启溢出分配时边界向量同时进入两个桶
      */
     void build(const VectorDataset& dataset) {
         std::cout << "Training IVF centroids..." << std::endl;
         kmeans_.train(dataset);
         
         std::cout << "Populating inverted lists..." << std::endl;
-        const auto& centroids = kmeans_.get_centroids();
         
-        // 预先计算分配结果，便于并行
+        // 预先计算分配结果，便于并行；spill为-1表示不溢出
         std::vector<int> assignments(dataset.get_count());
+        std::vector<int> spills(dataset.get_count());
         
         // 并行计算归属桶
         #pragma omp parallel for
         for (idx_t i = 0; i < dataset.get_count(); ++i) {
-            auto vec = dataset.get_vector(i);
-            int best_cluster = 0;
-            float min_dist = std::numeric_limits<float>::max();
-            
-            for (int c = 0; c < n_lists_; ++c) {
-                std::span<const float> center(centroids.data() + c * dim_, dim_);
-                float dist = l2_distance(vec, center);
-                if (dist < min_dist) {
-                    min_dist = dist;
-                    best_cluster = c;
-                }
-            }
-            assignments[i] = best_cluster;
+            auto [primary, spill] = assign_lists(dataset.get_vector(i));
+            assignments[i] = primary;
+            spills[i] = spill;
+        }
+
+        // 先统计每个桶的大小并一次性reserve，避免push_back扩容留下空闲容量
+        std::vector<size_t> list_sizes(n_lists_, 0);
+        for (idx_t i = 0; i < dataset.get_count(); ++i) {
+            list_sizes[assignments[i]]++;
+            if (spills[i] >= 0) list_sizes[spills[i]]++;
+        }
+        for (int c = 0; c < n_lists_; ++c) {
+            inverted_lists_[c].reserve(inverted_lists_[c].size() + list_sizes[c]);
         }
 
         // 串行填充vector（这步很快，无需并行）
         for (idx_t i = 0; i < dataset.get_count(); ++i) {
             inverted_lists_[assignments[i]].push_back(i);
+            if (spills[i] >= 0) {
+                inverted_lists_[spills[i]].push_back(i);
+                has_spill_ = true;
+            }
+        }
+        trained_ = true;
+    }
+
+    /**
+     * @brief   增量插入一个已训练索引之外的向量
+     * @param   vec     向量数据
+     * @param   id      向量在数据集中的ID
+     * @throws  std::logic_error 当索引尚未训练时
+     */
+    void add(std::span<const float> vec, idx_t id) {
+        if (!trained_) throw std::logic_error("IVF index is not trained");
+        auto [primary, spill] = assign_lists(vec);
+        inverted_lists_[primary].push_back(id);
+        if (spill >= 0) {
+            inverted_lists_[spill].push_back(id);
+            has_spill_ = true;
+        }
+    }
+
+    /**
+     * @brief   设置溢出分配比例（SOAR式冗余分配）
+     * @param   ratio   次近桶中心的距离不超过最近距离的ratio倍时，向量同时放入次近桶；
+     *                  距离为L2平方距离，0表示关闭
+     * @throws  std::invalid_argument 当ratio不为0且小于1时
+     * @details 桶边界附近的向量到两个中心的距离相近，查询落在哪一侧都可能探测不到另一侧；
+     *          冗余存一份ID后低nprobe下召回明显提升，代价是倒排桶内存和扫描量的小幅增长。
+     *          需在build/add之前设置，比例随索引保存，加载后继续add时沿用
+     */
+    void set_spill_ratio(float ratio) {
+        if (ratio != 0.0f && ratio < 1.0f) throw std::invalid_argument("Spill ratio must be 0 or >= 1");
+        spill_ratio_ = ratio;
+    }
+
+    float spill_ratio() const { return spill_ratio_; }
+
+    /**
+     * @brief   是否有向量被溢出分配到两个桶（搜索时据此决定是否按ID去重）
+     */
+    bool has_spill() const { return has_spill_; }
+
+    /**
+     * @brief   索引是否已训练（build或load之后）
+     */
+    bool is_trained() const { return trained_; }
+
+    /**
+     * @brief   获取向量维度
+     */
+    int get_dim() const { return dim_; }
+
+    /**
+     * @brief   获取桶数量
+     */
+    int get_n_lists() const { return n_lists_; }
+
+    /**
+     * @brief   每个桶被搜索探测的次数，用于分析查询分布的倾斜程度
+     */
+    const ListAccessTracker& access_stats() const { return access_; }
+
+    /**
+     * @brief   挂载数据集上的kNN图，搜索在扫描桶之后沿图扩展候选
+     * @param   graph   与搜索时传入的数据集同一ID空间的kNN图，为空则关闭扩展
+     * @param   expand  扩展距离最近的前expand个候选的邻居，0表示扩展前k个
+     * @details 落在桶边界附近的近邻常被分到未探测的桶中，只有增大max_nprobe才能找回；
+     *          而它们通常是已找到结果的图邻居，沿图走一步只需少量额外的距离计算
+     * @note    图不随索引保存，加载后需重新挂载
+     */
+    void set_graph(std::shared_ptr<const KnnGraph> graph, int expand = 0) {
+        graph_ = std::move(graph);
+        graph_expand_ = std::max(expand, 0);
+    }
+
+    /**
+     * @brief   当前挂载的kNN图，未挂载时为空
+     */
+    const KnnGraph* graph() const { return graph_.get(); }
+
+    /**
+     * @brief   按倒排桶重排数据集，使同一个桶的向量在内存中连续
+     * @param   dataset     build/add时使用的数据集
+     * @return  重排后的数据集，之后的search须传入它
+     * @throws  std::invalid_argument 当已挂载的kNN图与数据集大小不符时
+     * @details 按桶顺序给向量重新编号（溢出分配的向量取首次出现的位置），桶内ID改为新行号，
+     *          映射表记录新行号 -> 原ID，search返回的仍是原ID；已挂载的kNN图同步改写。
+     *          扫描一个桶由随机访问变为顺序读取，缓存和页命中率随之提高。
+     *          之后add的向量应追加在重排后数据集的末尾并以其行号作为ID，这些ID不经过映射
+     */
+    VectorDataset reorder(const VectorDataset& dataset) {
+        const idx_t n = dataset.get_count();
+        if (graph_ && graph_->size() != n) throw std::invalid_argument("kNN graph does not match dataset");
+        std::vector<idx_t> order;
+        order.reserve(n);
+        std::vector<char> placed(n, 0);
+        for (const auto& list : inverted_lists_) {
+            for (idx_t id : list) {
+                if (id >= 0 && id < n && !placed[id]) {
+                    placed[id] = 1;
+                    order.push_back(id);
+                }
+            }
+        }
+        for (idx_t i = 0; i < n; ++i) {
+            if (!placed[i]) order.push_back(i);
+        }
+        IdPermutation perm(std::move(order));
+
+        for (auto& list : inverted_lists_) {
+            for (idx_t& id : list) {
+                if (id >= 0 && id < n) id = perm.to_new(id);
+            }
+        }
+        std::vector<idx_t> labels(n);
+        for (idx_t i = 0; i < n; ++i) labels[i] = external_id(perm.to_old(i));
+        labels_ = std::move(labels);
+        if (graph_) graph_ = std::make_shared<const KnnGraph>(permute_graph(*graph_, perm));
+        return permute_rows(dataset, perm);
+    }
+
+    /**
+     * @brief   行号 -> 原ID的映射表，未重排时为空
+     */
+    const std::vector<idx_t>& labels() const { return labels_; }
+
+    /**
+     * @brief   保存索引到文件
+     * @param   path    文件路径
+     * @throws  std::runtime_error 当文件无法写入时
+     * @note    文件格式：magic(4B) | dim | n_lists | centroids | 每个桶的 size + ids
+     *          [| 映射表 size + ids [| spill_ratio(float) | has_spill(u8)]]，
+     *          未重排时映射表size为0；旧文件可能没有映射表或溢出标记
+     */
+    void save(const std::string& path) const {
+        std::ofstream file(path, std::ios::binary | std::ios::trunc);
+        if (!file.is_open()) throw std::runtime_error("Failed to open index file: " + path);
+        const auto& centroids = kmeans_.get_centroids();
+        int32_t header[2] = {dim_, n_lists_};
+        file.write(kFileMagic, 4);
+        file.write(reinterpret_cast<const char*>(header), sizeof(header));
+        file.write(reinterpret_cast<const char*>(centroids.data()), centroids.size() * sizeof(float));
+        for (const auto& list : inverted_lists_) {
+            int64_t size = static_cast<int64_t>(list.size());
+            file.write(reinterpret_cast<const char*>(&size), sizeof(size));
+            file.write(reinterpret_cast<const char*>(list.data()), list.size() * sizeof(idx_t));
+        }
+        int64_t label_count = static_cast<int64_t>(labels_.size());
+        file.write(reinterpret_cast<const char*>(&label_count), sizeof(label_count));
+        file.write(reinterpret_cast<const char*>(labels_.data()), labels_.size() * sizeof(idx_t));
+        uint8_t has_spill = has_spill_;
+        file.write(reinterpret_cast<const char*>(&spill_ratio_), sizeof(spill_ratio_));
+        file.write(reinterpret_cast<const char*>(&has_spill), sizeof(has_spill));
+        if (!file) throw std::runtime_error("Failed to write index file: " + path);
+    }
+
+    /**
+     * @brief   从文件加载索引
+     * @param   path    文件路径
+     * @return  已训练的索引
+     * @throws  std::runtime_error 当文件不存在、格式错误或被截断时
+     */
+    static IVFIndex load(const std::string& path) {
+        std::ifstream file(path, std::ios::binary);
+        if (!file.is_open()) throw std::runtime_error("Failed to open index file: " + path);
+        char magic[4];
+        int32_t header[2] = {0, 0};
+        file.read(magic, 4);
+        file.read(reinterpret_cast<char*>(header), sizeof(header));
+        if (!file || std::string(magic, 4) != std::string(kFileMagic, 4) || header[0] <= 0 || header[1] <= 0) {
+            throw std::runtime_error("Invalid index file: " + path);
+        }
+        // 头部和各段长度按文件实际大小校验，损坏的文件不能触发超大分配
+        const std::streamoff data_start = file.tellg();
+        file.seekg(0, std::ios::end);
+        const uint64_t file_size = static_cast<uint64_t>(file.tellg());
+        file.seekg(data_start);
+        auto fits = [&](int64_t count, size_t item) {
+            uint64_t remaining = file_size - static_cast<uint64_t>(file.tellg());
+            return count >= 0 && static_cast<uint64_t>(count) <= remaining / item;
+        };
+        if (!fits(static_cast<int64_t>(header[0]) * header[1], sizeof(float))) {
+            throw std::runtime_error("Truncated index file: " + path);
+        }
+        IVFIndex index(header[0], header[1]);
+        std::vector<float> centroids(static_cast<size_t>(header[0]) * header[1]);
+        file.read(reinterpret_cast<char*>(centroids.data()), centroids.size() * sizeof(float));
+        index.kmeans_.set_centroids(std::move(centroids));
+        for (auto& list : index.inverted_lists_) {
+            int64_t size = 0;
+            file.read(reinterpret_cast<char*>(&size), sizeof(size));
+            if (!file || !fits(size, sizeof(idx_t))) throw std::runtime_error("Truncated index file: " + path);
+            list.resize(size);
+            file.read(reinterpret_cast<char*>(list.data()), size * sizeof(idx_t));
+        }
+        if (file && file.peek() != std::ifstream::traits_type::eof()) {
+            int64_t size = 0;
+            file.read(reinterpret_cast<char*>(&size), sizeof(size));
+            if (!file || !fits(size, sizeof(idx_t))) throw std::runtime_error("Truncated index file: " + path);
+            index.labels_.resize(size);
+            file.read(reinterpret_cast<char*>(index.labels_.data()), size * sizeof(idx_t));
+        }
+        if (file && file.peek() != std::ifstream::traits_type::eof()) {
+            uint8_t has_spill = 0;
+            file.read(reinterpret_cast<char*>(&index.spill_ratio_), sizeof(index.spill_ratio_));
+            file.read(reinterpret_cast<char*>(&has_spill), sizeof(has_spill));
+            index.has_spill_ = has_spill != 0;
+        } else {
+            // 旧文件不知道是否溢出过，保守地在搜索时去重
+            index.has_spill_ = true;
         }
+        if (!file) throw std::runtime_error("Truncated index file: " + path);
+        index.trained_ = true;
+        return index;
+    }
+
+    /**
+     * @brief   统计索引各部分的内存占用
+     * @return  centroids、倒排桶数据以及桶头（vector对象本身）的占用
+     */
+    MemoryReport memory_report() const {
+        MemoryReport report;
+        report.add("centroids", vector_memory(kmeans_.get_centroids()));
+        MemoryUsage lists;
+        for (const auto& list : inverted_lists_) lists += vector_memory(list);
+        report.add("inverted_lists", lists);
+        report.add("inverted_list_headers", vector_memory(inverted_lists_));
+        if (!labels_.empty()) report.add("labels", vector_memory(labels_));
+        return report;
+    }
+
+    /**
+     * @brief   回收倒排桶扩容留下的空闲容量
+     * @return  回收的字节数
+     */
+    size_t shrink_to_fit() {
+        size_t before = memory_report().total().allocated_bytes;
+        for (auto& list : inverted_lists_) list.shrink_to_fit();
+        return before - memory_report().total().allocated_bytes;
     }
 
     /**
@@ -92,6 +342,7 @@ public:
      * @param   probe_ratio    探测比例（默认0.2，即距离扩大20%内的桶都搜索）
      * @param   max_nprobe     最大探测桶数
      * @param   refinery_factor  精排因子（预选候选数 = k * factor）
+     * @param   profile        剖析结果输出（为空则不记录，开销可忽略）
      * @return  按距离排序的K个最近邻
      * @note    采用两阶段策略：先粗筛候选，再精排选出最终结果
      */
@@ -100,16 +351,23 @@ public:
                                      int k, 
                                      float probe_ratio = 0.2f, 
                                      int max_nprobe = 20,
-                                     int refinery_factor = 5) {
+                                     int refinery_factor = 5,
+                                     QueryProfile* profile = nullptr) {
         const auto& centroids = kmeans_.get_centroids();
         std::vector<std::pair<float, int>> clusters_scores; 
         
         // 计算查询向量到所有桶中心的距离
-        for (int c = 0; c < n_lists_; ++c) {
-            std::span<const float> center(centroids.data() + c * dim_, dim_);
-            float dist = l2_distance(query, center);
-            clusters_scores.push_back({dist, c});
+        {
+            ScopedStageTimer timer(profile, ProfileStage::CentroidScoring);
+            for (int c = 0; c < n_lists_; ++c) {
+                std::span<const float> center(centroids.data() + c * dim_, dim_);
+                float dist = l2_distance(query, center);
+                clusters_scores.push_back({dist, c});
+            }
+            if (profile) profile->centroids_scored += n_lists_;
         }
+
+        uint64_t select_start = profile ? read_tsc() : 0;
         // 按距离排序，最近的桶排在前面
         std::sort(clusters_scores.begin(), clusters_scores.end());
 
@@ -117,12 +375,21 @@ public:
         float best_center_dist = clusters_scores[0].first;
         // 动态阈值：距离最佳桶一定比例内的桶都搜索
         float dist_threshold = best_center_dist * (1.0f + probe_ratio) + 1e-6f;
+        if (profile) profile->add(ProfileStage::ProbeSelection, read_tsc() - select_start);
 
         // 粗筛 - 从多个桶中收集候选向量
         std::priority_queue<SearchResult> top_candidates;
         size_t candidates_limit = k * refinery_factor;
+        // 溢出分配的向量可能在两个被探测的桶中各出现一次，入堆前按ID去重；
+        // 没有溢出的索引每个ID只出现一次，不建哈希集合
+        const bool dedup = has_spill_;
+        std::unordered_set<idx_t> in_heap;
+        if (dedup) in_heap.reserve(candidates_limit * 2);
         
         int probed_count = 0;
+        int64_t heap_pushes = 0;
+        // 入堆与距离计算交错，整个扫描只计时一次并计入BucketScan，入堆只统计次数
+        uint64_t scan_start = profile ? read_tsc() : 0;
         for (const auto& bucket_info : clusters_scores) {
             float center_dist = bucket_info.first;
             int cluster_id = bucket_info.second;
@@ -133,6 +400,7 @@ public:
 
             const auto& bucket = inverted_lists_[cluster_id];
             probed_count++;
+            access_.record(cluster_id);
 
             // 遍历桶内所有向量
             for (idx_t vec_id : bucket) {
@@ -140,41 +408,133 @@ public:
                 float dist = l2_distance(query, vec);
 
                 // 使用最小堆维护Top-K候选
-                if (top_candidates.size() < candidates_limit) {
-                    top_candidates.push({vec_id, dist});
-                } else if (dist < top_candidates.top().distance) {
-                    top_candidates.pop();
+                bool full = top_candidates.size() >= candidates_limit;
+                if (full && dist >= top_candidates.top().distance) continue;
+                if (!dedup || in_heap.insert(vec_id).second) {
+                    if (full) {
+                        if (dedup) in_heap.erase(top_candidates.top().id);
+                        top_candidates.pop();
+                    }
                     top_candidates.push({vec_id, dist});
+                    heap_pushes++;
                 }
             }
+            if (profile) {
+                profile->vectors_scanned += bucket.size();
+                profile->buckets_probed++;
+            }
+        }
+        if (profile) {
+            profile->add(ProfileStage::BucketScan, read_tsc() - scan_start);
+            profile->heap_pushes += heap_pushes;
         }
 
         // 精排 - 从候选中选出最终的K个结果
         std::vector<SearchResult> all_candidates;
-        while(!top_candidates.empty()) {
-            all_candidates.push_back(top_candidates.top());
-            top_candidates.pop();
+        {
+            ScopedStageTimer timer(profile, ProfileStage::TopK);
+            while(!top_candidates.empty()) {
+                all_candidates.push_back(top_candidates.top());
+                top_candidates.pop();
+            }
         }
-        
+
         // 按距离升序排序
-        std::sort(all_candidates.begin(), all_candidates.end(), [](const SearchResult& a, const SearchResult& b){
+        auto by_distance = [](const SearchResult& a, const SearchResult& b){
             return a.distance < b.distance;
-        });
+        };
+        if (graph_) {
+            ScopedStageTimer timer(profile, ProfileStage::GraphExpand);
+            std::sort(all_candidates.begin(), all_candidates.end(), by_distance);
+            expand_with_graph(query, dataset, k, all_candidates, profile);
+        }
+
+        ScopedStageTimer refine_timer(profile, ProfileStage::Refine);
+        std::sort(all_candidates.begin(), all_candidates.end(), by_distance);
 
         // 返回前K个结果
         std::vector<SearchResult> results;
         for (size_t i = 0; i < std::min((size_t)k, all_candidates.size()); ++i) {
-            results.push_back(all_candidates[i]);
+            results.push_back({external_id(all_candidates[i].id), all_candidates[i].distance});
         }
+        if (profile) profile->results_returned += results.size();
         
         return results;
     }
 
+    /// 索引文件头的魔数
+    static constexpr char kFileMagic[4] = {'M', 'M', 'I', 'V'};
+
 private:
     int dim_;                              ///< 向量维度
     int n_lists_;                          ///< IVF桶数量
     KMeans kmeans_;                        ///< KMeans聚类器，用于生成桶中心
     std::vector<std::vector<idx_t>> inverted_lists_;  ///< 倒排桶列表，存储向量ID
+    bool trained_ = false;                 ///< 是否已训练
+    ListAccessTracker access_;             ///< 各桶的访问计数
+    std::shared_ptr<const KnnGraph> graph_;  ///< 可选的kNN图，用于扫描后扩展候选
+    int graph_expand_ = 0;                 ///< 扩展的候选数，0表示k
+    float spill_ratio_ = 0.0f;             ///< 溢出分配比例，0表示每个向量只进一个桶
+    bool has_spill_ = false;               ///< 是否有向量进入了两个桶
+    std::vector<idx_t> labels_;            ///< 重排后的行号 -> 原ID，为空表示未重排
+
+    /**
+     * @brief   行号对应的原ID，映射表之外的行号原样返回
+     */
+    idx_t external_id(idx_t row) const {
+        return row >= 0 && row < static_cast<idx_t>(labels_.size()) ? labels_[row] : row;
+    }
+
+    /**
+     * @brief   把前若干个候选的图邻居补入候选集
+     * @param   candidates  按距离升序的候选，扩展得到的向量追加在末尾
+     * @note    已在候选集中的向量不重复计算；图中不存在或超出数据集的ID被跳过
+     */
+    void expand_with_graph(std::span<const float> query, const VectorDataset& dataset, int k,
+                           std::vector<SearchResult>& candidates, QueryProfile* profile) const {
+        size_t seeds = std::min(candidates.size(), static_cast<size_t>(graph_expand_ > 0 ? graph_expand_ : k));
+        std::unordered_set<idx_t> seen;
+        seen.reserve(candidates.size() * 2);
+        for (const auto& c : candidates) seen.insert(c.id);
+        int64_t expanded = 0;
+        for (size_t i = 0; i < seeds; ++i) {
+            idx_t node = candidates[i].id;
+            if (node >= graph_->size()) continue;
+            for (idx_t neighbor : graph_->neighbors(node)) {
+                if (neighbor >= dataset.get_count() || !seen.insert(neighbor).second) continue;
+                candidates.push_back({neighbor, l2_distance(query, dataset.get_vector(neighbor))});
+                expanded++;
+            }
+        }
+        if (profile) profile->graph_expanded += expanded;
+    }
+
+    /**
+     * @brief   计算向量的归属桶与溢出桶
+     * @param   vec     向量数据
+     * @return  (最近桶, 溢出桶)，未开启溢出或次近桶超出比例时溢出桶为-1
+     */
+    std::pair<int, int> assign_lists(std::span<const float> vec) const {
+        const auto& centroids = kmeans_.get_centroids();
+        int best_cluster = 0, second_cluster = -1;
+        float min_dist = std::numeric_limits<float>::max();
+        float second_dist = std::numeric_limits<float>::max();
+        for (int c = 0; c < n_lists_; ++c) {
+            std::span<const float> center(centroids.data() + c * dim_, dim_);
+            float dist = l2_distance(vec, center);
+            if (dist < min_dist) {
+                second_dist = min_dist;
+                second_cluster = best_cluster;
+                min_dist = dist;
+                best_cluster = c;
+            } else if (dist < second_dist) {
+                second_dist = dist;
+                second_cluster = c;
+            }
+        }
+        if (spill_ratio_ <= 0.0f || n_lists_ < 2 || second_dist > min_dist * spill_ratio_) second_cluster = -1;
+        return {best_cluster, second_cluster};
+    }
 };
 
 } // namespace minimilvus
\ No newline at end of file
@@ -80,7 +80,7 @@ public:
 
             // 当没有向量切换簇时，提前结束
             if (changed_count == 0 && iter > 0) {
-                std::cout << "KMeans converged at iteration " << iter << std::endl;
+                if (verbose_) std::cout << "KMeans converged at iteration " << iter << std::endl;
                 break;
             }
 
@@ -109,7 +109,7 @@ public:
             centroids_ = std::move(new_centroids);
             
             // 打印训练进度
-            if (iter % 2 == 0) std::cout << "KMeans iter " << iter << "/" << max_iter_ << "..." << std::endl;
+            if (verbose_ && iter % 2 == 0) std::cout << "KMeans iter " << iter << "/" << max_iter_ << "..." << std::endl;
         }
     }
 
@@ -121,11 +121,29 @@ public:
         return centroids_;
     }
 
+    /**
+     * @brief   设置聚类中心（用于从文件恢复已训练的模型）
+     * @param   centroids   k * dim 个float，按行优先存储
+     * @throws  std::invalid_argument 当大小不匹配时
+     */
+    void set_centroids(std::vector<float> centroids) {
+        if (centroids.size() != static_cast<size_t>(k_) * dim_) {
+            throw std::invalid_argument("Centroid size mismatch");
+        }
+        centroids_ = std::move(centroids);
+    }
+
+    /**
+     * @brief   是否打印训练进度（PQ等需要训练大量小KMeans时关闭）
+     */
+    void set_verbose(bool verbose) { verbose_ = verbose; }
+
 private:
     int k_;                    ///< 聚类数量
     int max_iter_;             ///< 最大迭代次数
     int dim_;                  ///< 向量维度
     std::vector<float> centroids_;  ///< 聚类中心向量
+    bool verbose_ = true;           ///< 是否打印训练进度
 
     /**
      * @brief   初始化质心
@@ -38,6 +38,13 @@ public:
         return centroids_;
     }
 
+    void set_centroids(std::vector<float> centroids) {
+        if (centroids.size() != static_cast<size_t>(k_) * dim_) {
+            throw std::invalid_argument("Centroid size mismatch");
+        }
+        centroids_ = std::move(centroids);
+    }
+
 private:
     int k_;
     int max_iter_;
@@ -0,0 +1,396 @@
+/**
+ * @file    knn_graph.hpp
+ * @brief   数据集上的近似kNN图
+ * @details 以CSR（偏移数组 + 邻居数组）紧凑存储，每个节点的邻居按距离升序排列，
+ *          可供IVF候选扩展、图索引初始化等复用。
+ *          构建采用NN-descent：从随机邻居出发，反复让同一节点的邻居两两比较
+ *          （"邻居的邻居很可能也是邻居"），几轮迭代即可收敛到高召回的kNN图，
+ *          代价远低于O(N²)的暴力构建
+ * @author  Tyooughtul
+ */
+
+#pragma once
+#include <algorithm>
+#include <cstdint>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include <omp.h>
+#include "dataset.hpp"
+#include "data_generator.hpp"
+#include "metrics.hpp"
+#include "memory_stats.hpp"
+#include "rwlock.hpp"
+
+namespace minimilvus {
+
+/**
+ * @brief   CSR格式的邻居图
+ * @details 节点i的邻居为 neighbors_[offsets_[i], offsets_[i + 1])
+ */
+class KnnGraph {
+public:
+    KnnGraph() : offsets_(1, 0) {}
+
+    /**
+     * @brief   由CSR数组构造
+     * @throws  std::invalid_argument 当偏移数组不单调或与邻居数组长度不符时
+     */
+    KnnGraph(std::vector<uint64_t> offsets, std::vector<idx_t> neighbors)
+        : offsets_(std::move(offsets)), neighbors_(std::move(neighbors)) {
+        if (offsets_.empty() || offsets_.front() != 0 || offsets_.back() != neighbors_.size()) {
+            throw std::invalid_argument("Invalid CSR offsets");
+        }
+        for (size_t i = 1; i < offsets_.size(); ++i) {
+            if (offsets_[i] < offsets_[i - 1]) throw std::invalid_argument("Invalid CSR offsets");
+        }
+    }
+
+    /**
+     * @brief   由每个节点的邻居列表压缩为CSR
+     */
+    static KnnGraph from_lists(const std::vector<std::vector<idx_t>>& lists) {
+        std::vector<uint64_t> offsets(lists.size() + 1, 0);
+        for (size_t i = 0; i < lists.size(); ++i) offsets[i + 1] = offsets[i] + lists[i].size();
+        std::vector<idx_t> neighbors;
+        neighbors.reserve(offsets.back());
+        for (const auto& list : lists) neighbors.insert(neighbors.end(), list.begin(), list.end());
+        return KnnGraph(std::move(offsets), std::move(neighbors));
+    }
+
+    /**
+     * @brief   暴力构建精确kNN图
+     * @param   dataset     数据集
+     * @param   k           每个节点的邻居数
+     * @note    O(N²)，只适合小数据集或作为NN-descent的召回基准
+     */
+    template <typename Metric = L2Metric>
+    static KnnGraph exact(const VectorDataset& dataset, int k) {
+        const idx_t n = dataset.get_count();
+        std::vector<std::vector<idx_t>> lists(n);
+        #pragma omp parallel for schedule(dynamic, 64)
+        for (idx_t i = 0; i < n; ++i) {
+            std::vector<std::pair<float, idx_t>> all;
+            all.reserve(n);
+            for (idx_t j = 0; j < n; ++j) {
+                if (j != i) all.push_back({Metric::distance(dataset.get_vector(i), dataset.get_vector(j)), j});
+            }
+            size_t keep = std::min<size_t>(k, all.size());
+            std::partial_sort(all.begin(), all.begin() + keep, all.end());
+            lists[i].reserve(keep);
+            for (size_t j = 0; j < keep; ++j) lists[i].push_back(all[j].second);
+        }
+        return from_lists(lists);
+    }
+
+    /**
+     * @brief   节点数量
+     */
+    idx_t size() const { return static_cast<idx_t>(offsets_.size()) - 1; }
+
+    /**
+     * @brief   边的总数
+     */
+    size_t num_edges() const { return neighbors_.size(); }
+
+    /**
+     * @brief   节点的邻居，按距离升序
+     */
+    std::span<const idx_t> neighbors(idx_t node) const {
+        return {neighbors_.data() + offsets_[node], static_cast<size_t>(offsets_[node + 1] - offsets_[node])};
+    }
+
+    const std::vector<uint64_t>& offsets() const { return offsets_; }
+
+    const std::vector<idx_t>& neighbor_array() const { return neighbors_; }
+
+    MemoryUsage memory_usage() const {
+        MemoryUsage usage = vector_memory(offsets_);
+        usage += vector_memory(neighbors_);
+        return usage;
+    }
+
+    /**
+     * @brief   保存到文件
+     * @throws  std::runtime_error 当文件无法写入时
+     * @note    文件格式：magic(4B) | 节点数 | 边数 | offsets | neighbors
+     */
+    void save(const std::string& path) const {
+        std::ofstream file(path, std::ios::binary | std::ios::trunc);
+        if (!file.is_open()) throw std::runtime_error("Failed to open graph file: " + path);
+        int64_t header[2] = {size(), static_cast<int64_t>(num_edges())};
+        file.write(kFileMagic, 4);
+        file.write(reinterpret_cast<const char*>(header), sizeof(header));
+        file.write(reinterpret_cast<const char*>(offsets_.data()), offsets_.size() * sizeof(uint64_t));
+        file.write(reinterpret_cast<const char*>(neighbors_.data()), neighbors_.size() * sizeof(idx_t));
+        if (!file) throw std::runtime_error("Failed to write graph file: " + path);
+    }
+
+    /**
+     * @brief   从文件加载
+     * @throws  std::runtime_error 当文件不存在、格式错误或被截断时
+     */
+    static KnnGraph load(const std::string& path) {
+        std::ifstream file(path, std::ios::binary);
+        if (!file.is_open()) throw std::runtime_error("Failed to open graph file: " + path);
+        char magic[4];
+        int64_t header[2] = {-1, -1};
+        file.read(magic, 4);
+        file.read(reinterpret_cast<char*>(header), sizeof(header));
+        if (!file || std::string(magic, 4) != std::string(kFileMagic, 4) || header[0] < 0 || header[1] < 0) {
+            throw std::runtime_error("Invalid graph file: " + path);
+        }
+        std::vector<uint64_t> offsets(header[0] + 1);
+        std::vector<idx_t> neighbors(header[1]);
+        file.read(reinterpret_cast<char*>(offsets.data()), offsets.size() * sizeof(uint64_t));
+        file.read(reinterpret_cast<char*>(neighbors.data()), neighbors.size() * sizeof(idx_t));
+        if (!file) throw std::runtime_error("Truncated graph file: " + path);
+        try {
+            return KnnGraph(std::move(offsets), std::move(neighbors));
+        } catch (const std::invalid_argument&) {
+            throw std::runtime_error("Invalid graph file: " + path);
+        }
+    }
+
+    /// 图文件头的魔数
+    static constexpr char kFileMagic[4] = {'M', 'M', 'K', 'G'};
+
+private:
+    std::vector<uint64_t> offsets_;   ///< 节点数 + 1 个偏移
+    std::vector<idx_t> neighbors_;    ///< 所有节点的邻居首尾相接
+};
+
+/**
+ * @brief   NN-descent构建参数
+ */
+struct NNDescentConfig {
+    int k = 16;              ///< 每个节点的邻居数
+    int max_iters = 10;      ///< 最大迭代轮数
+    double rho = 1.0;        ///< 采样比例：每轮每个节点最多取 rho * k 个新邻居（及同样多的反向邻居）参与local join
+    double delta = 0.001;    ///< 一轮的更新次数低于 delta * N * k 时提前收敛
+    uint64_t seed = 42;      ///< 随机初始化与采样的种子
+};
+
+/**
+ * @brief   NN-descent构建统计
+ */
+struct NNDescentStats {
+    int iterations = 0;                 ///< 实际迭代轮数
+    int64_t distance_computations = 0;  ///< 距离计算次数（含初始化）
+    int64_t last_updates = 0;           ///< 最后一轮邻居池的更新次数
+};
+
+namespace detail {
+
+/**
+ * @brief   NN-descent中的候选邻居
+ */
+struct NNDescentNeighbor {
+    idx_t id;
+    float distance;
+    bool is_new;    ///< 尚未参与过local join
+};
+
+/**
+ * @brief   尝试把候选插入按距离升序、容量为k的邻居池
+ * @return  是否插入（已存在或比池中最远者更远时不插入）
+ */
+inline bool insert_neighbor(std::vector<NNDescentNeighbor>& pool, int k, idx_t id, float distance) {
+    if (static_cast<int>(pool.size()) >= k && distance >= pool.back().distance) return false;
+    for (const auto& nb : pool) {
+        if (nb.id == id) return false;
+    }
+    auto pos = std::upper_bound(pool.begin(), pool.end(), distance,
+                                [](float d, const NNDescentNeighbor& nb) { return d < nb.distance; });
+    pool.insert(pos, {id, distance, true});
+    if (static_cast<int>(pool.size()) > k) pool.pop_back();
+    return true;
+}
+
+/**
+ * @brief   随机保留列表中的至多n个元素（部分Fisher-Yates）
+ */
+inline void sample_in_place(std::vector<idx_t>& list, size_t n, CounterRng& rng) {
+    if (list.size() <= n) return;
+    for (size_t i = 0; i < n; ++i) {
+        size_t j = i + rng.next_u64() % (list.size() - i);
+        std::swap(list[i], list[j]);
+    }
+    list.resize(n);
+}
+
+/**
+ * @brief   候选块内两两距离：out[i * m + j] = d(rows_i, rows_j)，i < n_rows
+ * @param   rows    m个连续存放的向量，前n_rows个为新邻居
+ * @param   norms   各行范数平方（仅L2使用）
+ */
+template <typename Metric>
+void block_distances(const float* rows, size_t n_rows, size_t m, size_t dim, const float* norms, float* out) {
+    if constexpr (Metric::kInnerProduct) {
+        inner_product_block(rows, n_rows, rows, m, dim, out);
+        for (size_t i = 0; i < n_rows * m; ++i) out[i] = -out[i];
+    } else {
+        l2_distance_block(rows, n_rows, rows, m, dim, norms, norms, out);
+    }
+}
+
+} // namespace detail
+
+/**
+ * @brief   用并行NN-descent构建近似kNN图
+ * @param   dataset     数据集
+ * @param   config      构建参数
+ * @param   stats       构建统计输出（可为空）
+ * @return  每个节点min(k, N-1)个邻居的CSR图
+ * @details 每轮：
+ *          1. 采样：各节点从未参与过join的"新"邻居中随机取至多 rho * k 个，其余邻居为"旧"
+ *          2. 反向：把自己加入新/旧邻居的反向列表，同样采样截断，避免热点节点的列表无限增长
+ *          3. local join：把节点的新、旧候选拷成连续块，用分块内积核一次算出新×(新 ∪ 旧)的距离矩阵，
+ *             再让每对候选互相尝试插入对方的邻居池；旧×旧在之前的轮次中已比较过，跳过
+ *          各节点的local join由OpenMP线程并行处理，邻居池的插入由每节点一把自旋锁保护。
+ *          随机数按(种子, 轮次, 节点)生成，采样结果与线程数无关
+ */
+template <typename Metric = L2Metric>
+KnnGraph nn_descent(const VectorDataset& dataset, const NNDescentConfig& config = {},
+                    NNDescentStats* stats = nullptr) {
+    if (config.k <= 0) throw std::invalid_argument("NN-descent k must be positive");
+    if (!(config.rho > 0.0 && config.rho <= 1.0)) throw std::invalid_argument("NN-descent rho must be in (0, 1]");
+    const idx_t n = dataset.get_count();
+    if (n <= 1) return KnnGraph::from_lists(std::vector<std::vector<idx_t>>(n));
+    const int k = static_cast<int>(std::min<idx_t>(config.k, n - 1));
+    const size_t sample = std::max<size_t>(1, static_cast<size_t>(config.rho * k + 0.5));
+    const size_t dim = dataset.get_dim();
+    using detail::NNDescentNeighbor;
+    std::vector<std::vector<NNDescentNeighbor>> pools(n);
+    std::unique_ptr<SpinLock[]> locks(new SpinLock[n]);
+    int64_t distance_computations = 0;
+
+    auto locked_insert = [&](idx_t node, idx_t id, float distance) {
+        std::lock_guard<SpinLock> guard(locks[node]);
+        return detail::insert_neighbor(pools[node], k, id, distance);
+    };
+
+    std::vector<float> norms;
+    if constexpr (!Metric::kInnerProduct) {
+        norms.resize(n);
+        #pragma omp parallel for schedule(static)
+        for (idx_t v = 0; v < n; ++v) norms[v] = ip_distance(dataset.get_vector(v), dataset.get_vector(v));
+    }
+
+    // 随机初始化：每个节点只写自己的邻居池，无需加锁
+    #pragma omp parallel for schedule(static) reduction(+:distance_computations)
+    for (idx_t v = 0; v < n; ++v) {
+        CounterRng rng(config.seed, v);
+        pools[v].reserve(k + 1);
+        while (static_cast<int>(pools[v].size()) < k) {
+            idx_t u = static_cast<idx_t>(rng.next_u64() % n);
+            if (u == v) continue;
+            detail::insert_neighbor(pools[v], k, u, Metric::distance(dataset.get_vector(v), dataset.get_vector(u)));
+            distance_computations++;
+        }
+    }
+
+    std::vector<std::vector<idx_t>> new_lists(n), old_lists(n);
+    std::vector<std::vector<idx_t>> reverse_new(n), reverse_old(n);
+    int iterations = 0;
+    int64_t updates = 0;
+    for (int iter = 0; iter < config.max_iters; ++iter) {
+        iterations++;
+        const uint64_t stream_base = static_cast<uint64_t>(iter + 1) * static_cast<uint64_t>(n);
+
+        // 1. 采样新邻居，被采中的转为旧；未采中的新邻居留到下一轮
+        #pragma omp parallel for schedule(static)
+        for (idx_t v = 0; v < n; ++v) {
+            CounterRng rng(config.seed, stream_base + v);
+            auto& fresh = new_lists[v];
+            auto& old = old_lists[v];
+            fresh.clear();
+            old.clear();
+            for (const auto& nb : pools[v]) (nb.is_new ? fresh : old).push_back(nb.id);
+            detail::sample_in_place(fresh, sample, rng);
+            for (auto& nb : pools[v]) {
+                if (nb.is_new && std::find(fresh.begin(), fresh.end(), nb.id) != fresh.end()) nb.is_new = false;
+            }
+        }
+
+        // 2. 反向邻居：串行分发（O(N * k)次追加），再并行采样合并
+        for (idx_t v = 0; v < n; ++v) {
+            reverse_new[v].clear();
+            reverse_old[v].clear();
+        }
+        for (idx_t v = 0; v < n; ++v) {
+            for (idx_t u : new_lists[v]) reverse_new[u].push_back(v);
+            for (idx_t u : old_lists[v]) reverse_old[u].push_back(v);
+        }
+        #pragma omp parallel for schedule(static)
+        for (idx_t v = 0; v < n; ++v) {
+            CounterRng rng(config.seed ^ 0x5bd1e995ull, stream_base + v);
+            auto merge = [&](std::vector<idx_t>& list, std::vector<idx_t>& reverse) {
+                detail::sample_in_place(reverse, sample, rng);
+                list.insert(list.end(), reverse.begin(), reverse.end());
+                std::sort(list.begin(), list.end());
+                list.erase(std::unique(list.begin(), list.end()), list.end());
+            };
+            merge(new_lists[v], reverse_new[v]);
+            merge(old_lists[v], reverse_old[v]);
+        }
+
+        // 3. local join
+        updates = 0;
+        #pragma omp parallel reduction(+:updates, distance_computations)
+        {
+            std::vector<idx_t> ids;
+            std::vector<float> rows, row_norms, dists;
+            #pragma omp for schedule(dynamic, 64)
+            for (idx_t v = 0; v < n; ++v) {
+                const auto& fresh = new_lists[v];
+                const auto& old = old_lists[v];
+                if (fresh.empty()) continue;
+                ids.assign(fresh.begin(), fresh.end());
+                ids.insert(ids.end(), old.begin(), old.end());
+                const size_t n_new = fresh.size(), m = ids.size();
+                rows.resize(m * dim);
+                row_norms.resize(m);
+                for (size_t i = 0; i < m; ++i) {
+                    auto vec = dataset.get_vector(ids[i]);
+                    std::copy(vec.begin(), vec.end(), rows.begin() + i * dim);
+                    if constexpr (!Metric::kInnerProduct) row_norms[i] = norms[ids[i]];
+                }
+                dists.resize(n_new * m);
+                detail::block_distances<Metric>(rows.data(), n_new, m, dim, row_norms.data(), dists.data());
+                distance_computations += static_cast<int64_t>(n_new * m);
+
+                for (size_t i = 0; i < n_new; ++i) {
+                    for (size_t j = i + 1; j < m; ++j) {
+                        if (ids[i] == ids[j]) continue;
+                        float d = dists[i * m + j];
+                        updates += locked_insert(ids[i], ids[j], d);
+                        updates += locked_insert(ids[j], ids[i], d);
+                    }
+                }
+            }
+        }
+        if (updates <= config.delta * n * k) break;
+    }
+
+    if (stats) {
+        stats->iterations = iterations;
+        stats->distance_computations = distance_computations;
+        stats->last_updates = updates;
+    }
+
+    std::vector<uint64_t> offsets(n + 1, 0);
+    for (idx_t v = 0; v < n; ++v) offsets[v + 1] = offsets[v] + pools[v].size();
+    std::vector<idx_t> neighbors(offsets.back());
+    #pragma omp parallel for schedule(static)
+    for (idx_t v = 0; v < n; ++v) {
+        for (size_t j = 0; j < pools[v].size(); ++j) neighbors[offsets[v] + j] = pools[v][j].id;
+    }
+    return KnnGraph(std::move(offsets), std::move(neighbors));
+}
+
+} // namespace minimilvus
@@ -0,0 +1,410 @@
+/**
+ * @file    linalg.hpp
+ * @brief   稠密线性代数
+ * @details 行主序矩阵、分块SIMD矩阵向量乘、单边Jacobi奇异值分解、对称矩阵的并行Jacobi特征分解和正交Procrustes问题，
+ *          供OPQ旋转、PCA等向量变换使用，不依赖外部LAPACK
+ * @author  Tyooughtul
+ */
+
+#pragma once
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <random>
+#include <stdexcept>
+#include <vector>
+#include <immintrin.h>
+#include <omp.h>
+#include "metrics.hpp"
+
+namespace minimilvus {
+
+/**
+ * @brief   行主序float矩阵
+ */
+struct Matrix {
+    int rows = 0;
+    int cols = 0;
+    std::vector<float> data;
+
+    Matrix() = default;
+    Matrix(int r, int c) : rows(r), cols(c), data(static_cast<size_t>(r) * c, 0.0f) {}
+
+    float& operator()(int i, int j) { return data[static_cast<size_t>(i) * cols + j]; }
+    float operator()(int i, int j) const { return data[static_cast<size_t>(i) * cols + j]; }
+    float* row(int i) { return data.data() + static_cast<size_t>(i) * cols; }
+    const float* row(int i) const { return data.data() + static_cast<size_t>(i) * cols; }
+
+    static Matrix identity(int n) {
+        Matrix m(n, n);
+        for (int i = 0; i < n; ++i) m(i, i) = 1.0f;
+        return m;
+    }
+
+    Matrix transpose() const {
+        Matrix t(cols, rows);
+        for (int i = 0; i < rows; ++i) {
+            for (int j = 0; j < cols; ++j) t(j, i) = (*this)(i, j);
+        }
+        return t;
+    }
+};
+
+/**
+ * @brief   y = M x
+ * @param   m   rows × cols 矩阵
+ * @param   x   长度cols
+ * @param   y   长度rows，不能与x重叠
+ * @details 每次处理4行：x的每个8维块只加载一次，与4行同时做FMA，
+ *          相比逐行点积减少3/4的x读取，4个独立累加器也隐藏了FMA延迟
+ */
+inline void matvec(const Matrix& m, const float* x, float* y) {
+    const int cols = m.cols;
+    int i = 0;
+#if defined(__AVX2__) && defined(__FMA__)
+    for (; i + 4 <= m.rows; i += 4) {
+        const float* r0 = m.row(i);
+        const float* r1 = r0 + cols;
+        const float* r2 = r1 + cols;
+        const float* r3 = r2 + cols;
+        __m256 a0 = _mm256_setzero_ps(), a1 = _mm256_setzero_ps();
+        __m256 a2 = _mm256_setzero_ps(), a3 = _mm256_setzero_ps();
+        int j = 0;
+        for (; j + 8 <= cols; j += 8) {
+            __m256 xv = _mm256_loadu_ps(x + j);
+            a0 = _mm256_fmadd_ps(_mm256_loadu_ps(r0 + j), xv, a0);
+            a1 = _mm256_fmadd_ps(_mm256_loadu_ps(r1 + j), xv, a1);
+            a2 = _mm256_fmadd_ps(_mm256_loadu_ps(r2 + j), xv, a2);
+            a3 = _mm256_fmadd_ps(_mm256_loadu_ps(r3 + j), xv, a3);
+        }
+        float s0 = detail::hsum256(a0), s1 = detail::hsum256(a1);
+        float s2 = detail::hsum256(a2), s3 = detail::hsum256(a3);
+        for (; j < cols; ++j) {
+            s0 += r0[j] * x[j];
+            s1 += r1[j] * x[j];
+            s2 += r2[j] * x[j];
+            s3 += r3[j] * x[j];
+        }
+        y[i] = s0;
+        y[i + 1] = s1;
+        y[i + 2] = s2;
+        y[i + 3] = s3;
+    }
+#endif
+    for (; i < m.rows; ++i) {
+        const float* r = m.row(i);
+        float s = 0;
+        for (int j = 0; j < cols; ++j) s += r[j] * x[j];
+        y[i] = s;
+    }
+}
+
+/**
+ * @brief   对n个向量批量做 y_i = M x_i
+ * @param   x   n × cols，行主序
+ * @param   y   n × rows，行主序
+ */
+inline void matvec_batch(const Matrix& m, const float* x, float* y, int64_t n) {
+    #pragma omp parallel for schedule(static)
+    for (int64_t i = 0; i < n; ++i) {
+        matvec(m, x + i * m.cols, y + i * m.rows);
+    }
+}
+
+/**
+ * @brief   C = A B
+ */
+inline Matrix matmul(const Matrix& a, const Matrix& b) {
+    if (a.cols != b.rows) throw std::invalid_argument("matmul dimension mismatch");
+    Matrix bt = b.transpose();
+    Matrix c(a.rows, b.cols);
+    #pragma omp parallel for schedule(static)
+    for (int i = 0; i < a.rows; ++i) matvec(bt, a.row(i), c.row(i));
+    return c;
+}
+
+/**
+ * @brief   C = Aᵀ B，A为n × p，B为n × q（逐行累加，适合n远大于p、q的数据矩阵）
+ */
+inline Matrix crossprod(const float* a, int p, const float* b, int q, int64_t n) {
+    std::vector<double> sum(static_cast<size_t>(p) * q, 0.0);
+    #pragma omp parallel
+    {
+        std::vector<double> local(static_cast<size_t>(p) * q, 0.0);
+        #pragma omp for schedule(static)
+        for (int64_t r = 0; r < n; ++r) {
+            const float* ar = a + r * p;
+            const float* br = b + r * q;
+            for (int i = 0; i < p; ++i) {
+                double ai = ar[i];
+                double* out = local.data() + static_cast<size_t>(i) * q;
+                for (int j = 0; j < q; ++j) out[j] += ai * br[j];
+            }
+        }
+        #pragma omp critical
+        for (size_t i = 0; i < sum.size(); ++i) sum[i] += local[i];
+    }
+    Matrix c(p, q);
+    for (size_t i = 0; i < sum.size(); ++i) c.data[i] = static_cast<float>(sum[i]);
+    return c;
+}
+
+/**
+ * @brief   奇异值分解结果 M = U diag(S) Vᵀ
+ */
+struct SVDResult {
+    Matrix U;               ///< rows × cols，列正交
+    std::vector<float> S;   ///< 奇异值，降序
+    Matrix V;               ///< cols × cols，正交
+};
+
+/**
+ * @brief   单边Jacobi奇异值分解（要求 rows >= cols）
+ * @param   m           待分解矩阵
+ * @param   max_sweeps  最大扫描轮数
+ * @details 反复对列对做平面旋转直到所有列两两正交，此时列范数即奇异值；
+ *          内部使用double，对OPQ/PCA中几百维的方阵足够快且数值稳定。
+ *          零奇异值对应的U列用Gram-Schmidt补全为正交基
+ * @throws  std::invalid_argument 当rows < cols时
+ */
+inline SVDResult svd(const Matrix& m, int max_sweeps = 60) {
+    const int rows = m.rows, cols = m.cols;
+    if (rows < cols) throw std::invalid_argument("svd requires rows >= cols");
+    // 按列存储，便于列旋转
+    std::vector<double> a(static_cast<size_t>(cols) * rows), v(static_cast<size_t>(cols) * cols, 0.0);
+    for (int i = 0; i < rows; ++i) {
+        for (int j = 0; j < cols; ++j) a[static_cast<size_t>(j) * rows + i] = m(i, j);
+    }
+    for (int j = 0; j < cols; ++j) v[static_cast<size_t>(j) * cols + j] = 1.0;
+
+    const double eps = 1e-12;
+    for (int sweep = 0; sweep < max_sweeps; ++sweep) {
+        bool rotated = false;
+        for (int p = 0; p < cols - 1; ++p) {
+            for (int q = p + 1; q < cols; ++q) {
+                double* ap = a.data() + static_cast<size_t>(p) * rows;
+                double* aq = a.data() + static_cast<size_t>(q) * rows;
+                double alpha = 0, beta = 0, gamma = 0;
+                for (int i = 0; i < rows; ++i) {
+                    alpha += ap[i] * ap[i];
+                    beta += aq[i] * aq[i];
+                    gamma += ap[i] * aq[i];
+                }
+                if (std::fabs(gamma) <= eps * std::sqrt(alpha * beta) || gamma == 0.0) continue;
+                rotated = true;
+                double zeta = (beta - alpha) / (2.0 * gamma);
+                double t = (zeta >= 0 ? 1.0 : -1.0) / (std::fabs(zeta) + std::sqrt(1.0 + zeta * zeta));
+                double c = 1.0 / std::sqrt(1.0 + t * t);
+                double s = c * t;
+                for (int i = 0; i < rows; ++i) {
+                    double x = ap[i], y = aq[i];
+                    ap[i] = c * x - s * y;
+                    aq[i] = s * x + c * y;
+                }
+                double* vp = v.data() + static_cast<size_t>(p) * cols;
+                double* vq = v.data() + static_cast<size_t>(q) * cols;
+                for (int i = 0; i < cols; ++i) {
+                    double x = vp[i], y = vq[i];
+                    vp[i] = c * x - s * y;
+                    vq[i] = s * x + c * y;
+                }
+            }
+        }
+        if (!rotated) break;
+    }
+
+    // 列范数为奇异值，按降序排列
+    std::vector<double> norms(cols);
+    for (int j = 0; j < cols; ++j) {
+        double n2 = 0;
+        const double* aj = a.data() + static_cast<size_t>(j) * rows;
+        for (int i = 0; i < rows; ++i) n2 += aj[i] * aj[i];
+        norms[j] = std::sqrt(n2);
+    }
+    std::vector<int> order(cols);
+    for (int j = 0; j < cols; ++j) order[j] = j;
+    std::sort(order.begin(), order.end(), [&](int x, int y) { return norms[x] > norms[y]; });
+
+    SVDResult result{Matrix(rows, cols), std::vector<float>(cols), Matrix(cols, cols)};
+    const double tiny = (norms.empty() ? 0.0 : norms[order[0]]) * 1e-10;
+    std::vector<std::vector<double>> basis;   // 已确定的U列，用于补全
+    for (int k = 0; k < cols; ++k) {
+        int j = order[k];
+        result.S[k] = static_cast<float>(norms[j]);
+        for (int i = 0; i < cols; ++i) result.V(i, k) = static_cast<float>(v[static_cast<size_t>(j) * cols + i]);
+        std::vector<double> u(rows);
+        const double* aj = a.data() + static_cast<size_t>(j) * rows;
+        if (norms[j] > tiny) {
+            for (int i = 0; i < rows; ++i) u[i] = aj[i] / norms[j];
+        } else {
+            // 零奇异值：取与已有列正交的单位向量
+            for (int e = 0; e < rows; ++e) {
+                std::fill(u.begin(), u.end(), 0.0);
+                u[e] = 1.0;
+                for (const auto& b : basis) {
+                    double dot = 0;
+                    for (int i = 0; i < rows; ++i) dot += u[i] * b[i];
+                    for (int i = 0; i < rows; ++i) u[i] -= dot * b[i];
+                }
+                double n2 = 0;
+                for (double x : u) n2 += x * x;
+                if (n2 > 1e-6) {
+                    for (double& x : u) x /= std::sqrt(n2);
+                    break;
+                }
+            }
+        }
+        for (int i = 0; i < rows; ++i) result.U(i, k) = static_cast<float>(u[i]);
+        basis.push_back(std::move(u));
+    }
+    return result;
+}
+
+/**
+ * @brief   对称矩阵特征分解结果 M = V diag(values) Vᵀ
+ */
+struct EigenResult {
+    std::vector<float> values;  ///< 特征值，降序
+    Matrix vectors;             ///< n × n，第k列为values[k]对应的单位特征向量
+};
+
+/**
+ * @brief   对称矩阵的循环Jacobi特征分解
+ * @param   m           对称方阵（只读取上三角）
+ * @param   max_sweeps  最大扫描轮数
+ * @param   tolerance   非对角元素Frobenius范数降到矩阵范数的该比例以下时停止
+ * @details 每轮按轮转赛程把n个下标分成n/2个互不相交的(p, q)对，同一组内的旋转互不影响，
+ *          先并行更新各对的列、再并行更新各对的行，n-1组覆盖全部下标对。
+ *          每次旋转只改动两行两列（O(n)），而单边Jacobi SVD每对还要做三次长度为n的点积；
+ *          每轮开始前检查非对角范数，降到阈值以下即停止，远小于当前非对角均方根的元素跳过旋转；
+ *          默认阈值对应float精度，特征值密集的协方差矩阵约10轮收敛
+ * @throws  std::invalid_argument 当m不是方阵时
+ */
+inline EigenResult symmetric_eigen(const Matrix& m, int max_sweeps = 30, double tolerance = 1e-7) {
+    if (m.rows != m.cols) throw std::invalid_argument("symmetric_eigen requires a square matrix");
+    const int n = m.rows;
+    // vt按行存储特征向量（即Vᵀ），使其更新与A的行更新一样连续
+    std::vector<double> a(static_cast<size_t>(n) * n), vt(static_cast<size_t>(n) * n, 0.0);
+    for (int i = 0; i < n; ++i) {
+        for (int j = i; j < n; ++j) a[static_cast<size_t>(i) * n + j] = a[static_cast<size_t>(j) * n + i] = m(i, j);
+        vt[static_cast<size_t>(i) * n + i] = 1.0;
+    }
+    auto at = [&](int i, int j) -> double& { return a[static_cast<size_t>(i) * n + j]; };
+
+    double total = 0;
+    for (double x : a) total += x * x;
+    // 轮转赛程：奇数维补一个空位
+    const int slots = n + (n & 1);
+    std::vector<int> ring(slots);
+    for (int i = 0; i < slots; ++i) ring[i] = i;
+    struct Rotation { int p, q; double c, s; };
+    std::vector<Rotation> rotations;
+    rotations.reserve(slots / 2);
+
+    for (int sweep = 0; sweep < max_sweeps && n > 1; ++sweep) {
+        double off = 0;
+        #pragma omp parallel for reduction(+:off) schedule(static)
+        for (int i = 0; i < n; ++i) {
+            for (int j = i + 1; j < n; ++j) off += 2.0 * at(i, j) * at(i, j);
+        }
+        if (off <= tolerance * tolerance * total) break;
+        const double skip = std::sqrt(off / (static_cast<double>(n) * n)) * 1e-3;
+
+        for (int round = 0; round < slots - 1; ++round) {
+            rotations.clear();
+            for (int k = 0; k < slots / 2; ++k) {
+                int p = ring[k], q = ring[slots - 1 - k];
+                if (p >= n || q >= n) continue;
+                if (p > q) std::swap(p, q);
+                double apq = at(p, q);
+                if (std::fabs(apq) <= skip) continue;
+                double theta = (at(q, q) - at(p, p)) / (2.0 * apq);
+                double t = (theta >= 0 ? 1.0 : -1.0) / (std::fabs(theta) + std::sqrt(theta * theta + 1.0));
+                double c = 1.0 / std::sqrt(t * t + 1.0);
+                rotations.push_back({p, q, c, t * c});
+            }
+            // 固定ring[0]，其余位置轮转一格
+            std::rotate(ring.begin() + 1, ring.end() - 1, ring.end());
+            if (rotations.empty()) continue;
+            const int count = static_cast<int>(rotations.size());
+
+            // A ← A J：逐行处理，每行连续地应用本组全部旋转（各对只改动自己的两列）
+            #pragma omp parallel for schedule(static)
+            for (int k = 0; k < n; ++k) {
+                double* row = a.data() + static_cast<size_t>(k) * n;
+                for (const auto& [p, q, c, s] : rotations) {
+                    double x = row[p], y = row[q];
+                    row[p] = c * x - s * y;
+                    row[q] = s * x + c * y;
+                }
+            }
+            // A ← Jᵀ A，Vᵀ ← Jᵀ Vᵀ：各对只改动自己的两行，连续访问可向量化
+            #pragma omp parallel for schedule(static)
+            for (int r = 0; r < count; ++r) {
+                const auto [p, q, c, s] = rotations[r];
+                for (double* m : {a.data(), vt.data()}) {
+                    double* rp = m + static_cast<size_t>(p) * n;
+                    double* rq = m + static_cast<size_t>(q) * n;
+                    for (int k = 0; k < n; ++k) {
+                        double x = rp[k], y = rq[k];
+                        rp[k] = c * x - s * y;
+                        rq[k] = s * x + c * y;
+                    }
+                }
+                at(p, q) = at(q, p) = 0.0;
+            }
+        }
+    }
+
+    std::vector<int> order(n);
+    for (int j = 0; j < n; ++j) order[j] = j;
+    std::sort(order.begin(), order.end(), [&](int x, int y) { return at(x, x) > at(y, y); });
+    EigenResult result{std::vector<float>(n), Matrix(n, n)};
+    for (int k = 0; k < n; ++k) {
+        int j = order[k];
+        result.values[k] = static_cast<float>(at(j, j));
+        for (int i = 0; i < n; ++i) result.vectors(i, k) = static_cast<float>(vt[static_cast<size_t>(j) * n + i]);
+    }
+    return result;
+}
+
+/**
+ * @brief   正交Procrustes：求正交矩阵R使 ||R - M||_F 最小，即 R = U Vᵀ（M = U S Vᵀ）
+ * @note    OPQ中M = Ŷᵀ X，所得R最小化 ||X Rᵀ - Ŷ||_F
+ */
+inline Matrix orthogonal_procrustes(const Matrix& m) {
+    SVDResult r = svd(m);
+    return matmul(r.U, r.V.transpose());
+}
+
+/**
+ * @brief   随机正交矩阵（高斯矩阵做Gram-Schmidt正交化）
+ * @param   n       维度
+ * @param   seed    随机种子
+ */
+inline Matrix random_orthogonal(int n, uint64_t seed) {
+    std::mt19937_64 rng(seed);
+    std::normal_distribution<double> dist(0.0, 1.0);
+    std::vector<std::vector<double>> rows;
+    while (static_cast<int>(rows.size()) < n) {
+        std::vector<double> r(n);
+        for (double& x : r) x = dist(rng);
+        for (const auto& b : rows) {
+            double dot = 0;
+            for (int i = 0; i < n; ++i) dot += r[i] * b[i];
+            for (int i = 0; i < n; ++i) r[i] -= dot * b[i];
+        }
+        double n2 = 0;
+        for (double x : r) n2 += x * x;
+        if (n2 < 1e-8) continue;
+        for (double& x : r) x /= std::sqrt(n2);
+        rows.push_back(std::move(r));
+    }
+    Matrix m(n, n);
+    for (int i = 0; i < n; ++i) {
+        for (int j = 0; j < n; ++j) m(i, j) = static_cast<float>(rows[i][j]);
+    }
+    return m;
+}
+
+} // namespace minimilvus
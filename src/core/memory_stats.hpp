@@ -0,0 +1,80 @@
+/**
+ * @file    memory_stats.hpp
+ * @brief   内存占用统计
+ * @details 统计各组件实际使用和已分配的内存，区分std::vector扩容留下的空闲容量
+ * @author  Tyooughtul
+ */
+
+#pragma once
+#include <vector>
+#include <string>
+#include <map>
+#include <cstddef>
+
+namespace minimilvus {
+
+/**
+ * @brief   单个组件的内存占用
+ */
+struct MemoryUsage {
+    size_t used_bytes = 0;       ///< 实际存储数据占用的字节数（size）
+    size_t allocated_bytes = 0;  ///< 已向分配器申请的字节数（capacity + 元数据）
+
+    /**
+     * @brief   扩容留下的空闲字节数
+     */
+    size_t slack_bytes() const {
+        return allocated_bytes > used_bytes ? allocated_bytes - used_bytes : 0;
+    }
+
+    MemoryUsage& operator+=(const MemoryUsage& other) {
+        used_bytes += other.used_bytes;
+        allocated_bytes += other.allocated_bytes;
+        return *this;
+    }
+};
+
+/**
+ * @brief   统计std::vector的堆内存占用
+ * @param   v   待统计的vector
+ * @return  size对应的使用量和capacity对应的分配量（不含vector对象本身）
+ */
+template <typename T>
+MemoryUsage vector_memory(const std::vector<T>& v) {
+    return {v.size() * sizeof(T), v.capacity() * sizeof(T)};
+}
+
+/**
+ * @brief   按组件汇总的内存报告
+ * @details 组件名使用 "<模块>.<部分>" 的形式，如 "ivf.inverted_lists"
+ */
+struct MemoryReport {
+    std::map<std::string, MemoryUsage> components;  ///< 组件名 -> 占用
+
+    /**
+     * @brief   添加或累加一个组件
+     */
+    void add(const std::string& name, const MemoryUsage& usage) {
+        components[name] += usage;
+    }
+
+    /**
+     * @brief   合并另一份报告，组件名加上前缀
+     */
+    void merge(const MemoryReport& other, const std::string& prefix = "") {
+        for (const auto& [name, usage] : other.components) {
+            add(prefix + name, usage);
+        }
+    }
+
+    /**
+     * @brief   所有组件的合计
+     */
+    MemoryUsage total() const {
+        MemoryUsage sum;
+        for (const auto& [name, usage] : components) sum += usage;
+        return sum;
+    }
+};
+
+} // namespace minimilvus
@@ -14,6 +14,33 @@
 
 namespace minimilvus {
 
+#ifdef __AVX2__
+namespace detail {
+
+/**
+ * @brief   8个float水平求和
+ */
+inline float hsum256(__m256 v) {
+    __m128 lo = _mm_add_ps(_mm256_castps256_ps128(v), _mm256_extractf128_ps(v, 1));
+    lo = _mm_add_ps(lo, _mm_movehl_ps(lo, lo));
+    lo = _mm_add_ss(lo, _mm_movehdup_ps(lo));
+    return _mm_cvtss_f32(lo);
+}
+
+/**
+ * @brief   c + a * b，有FMA时合并为一条指令
+ */
+inline __m256 madd256(__m256 a, __m256 b, __m256 c) {
+#ifdef __FMA__
+    return _mm256_fmadd_ps(a, b, c);
+#else
+    return _mm256_add_ps(_mm256_mul_ps(a, b), c);
+#endif
+}
+
+} // namespace detail
+#endif
+
 /**
  * @brief   计算两个向量的L2欧氏距离
  * @param   a  第一个向量
@@ -81,4 +108,108 @@ inline float ip_distance(std::span<const float> a, std::span<const float> b) {
     }
     return sum;
 }
-}
\ No newline at end of file
+
+/**
+ * @brief   批量内积：out[i * ny + j] = <x_i, y_j>
+ * @param   x       nx个连续存放的dim维向量
+ * @param   y       ny个连续存放的dim维向量
+ * @param   out     nx × ny 的结果矩阵，行主序
+ * @details 每次取4个y_j分块，x_i的每段只加载一次、与4个y_j同时累加，
+ *          比逐对调用ip_distance少3/4的x访存；适合候选集内两两求距离
+ */
+inline void inner_product_block(const float* x, size_t nx, const float* y, size_t ny, size_t dim, float* out) {
+    for (size_t i = 0; i < nx; ++i) {
+        const float* xi = x + i * dim;
+        float* row = out + i * ny;
+        size_t j = 0;
+    #ifdef __AVX2__
+        for (; j + 4 <= ny; j += 4) {
+            const float* y0 = y + j * dim;
+            const float* y1 = y0 + dim;
+            const float* y2 = y1 + dim;
+            const float* y3 = y2 + dim;
+            __m256 acc0 = _mm256_setzero_ps(), acc1 = _mm256_setzero_ps();
+            __m256 acc2 = _mm256_setzero_ps(), acc3 = _mm256_setzero_ps();
+            size_t d = 0;
+            for (; d + 8 <= dim; d += 8) {
+                __m256 vx = _mm256_loadu_ps(xi + d);
+                acc0 = detail::madd256(vx, _mm256_loadu_ps(y0 + d), acc0);
+                acc1 = detail::madd256(vx, _mm256_loadu_ps(y1 + d), acc1);
+                acc2 = detail::madd256(vx, _mm256_loadu_ps(y2 + d), acc2);
+                acc3 = detail::madd256(vx, _mm256_loadu_ps(y3 + d), acc3);
+            }
+            float s0 = detail::hsum256(acc0), s1 = detail::hsum256(acc1);
+            float s2 = detail::hsum256(acc2), s3 = detail::hsum256(acc3);
+            for (; d < dim; ++d) {
+                s0 += xi[d] * y0[d];
+                s1 += xi[d] * y1[d];
+                s2 += xi[d] * y2[d];
+                s3 += xi[d] * y3[d];
+            }
+            row[j] = s0;
+            row[j + 1] = s1;
+            row[j + 2] = s2;
+            row[j + 3] = s3;
+        }
+    #endif
+        for (; j < ny; ++j) {
+            const float* yj = y + j * dim;
+            float sum = 0;
+            for (size_t d = 0; d < dim; ++d) sum += xi[d] * yj[d];
+            row[j] = sum;
+        }
+    }
+}
+
+/**
+ * @brief   批量L2距离平方：out[i * ny + j] = ||x_i||² + ||y_j||² - 2<x_i, y_j>
+ * @param   x_norms     x各行的范数平方
+ * @param   y_norms     y各行的范数平方
+ * @note    展开式存在舍入误差，结果截断到不小于0；需要逐位精确的距离时仍用l2_distance
+ */
+inline void l2_distance_block(const float* x, size_t nx, const float* y, size_t ny, size_t dim,
+                              const float* x_norms, const float* y_norms, float* out) {
+    inner_product_block(x, nx, y, ny, dim, out);
+    for (size_t i = 0; i < nx; ++i) {
+        float* row = out + i * ny;
+        for (size_t j = 0; j < ny; ++j) row[j] = std::max(x_norms[i] + y_norms[j] - 2.0f * row[j], 0.0f);
+    }
+}
+
+/**
+ * @brief   距离度量类型
+ */
+enum class MetricType {
+    L2,   ///< 欧氏距离平方，越小越相似
+    IP    ///< 内积，越大越相似（结果中以负内积作为距离）
+};
+
+/**
+ * @brief   L2度量策略
+ * @details 作为模板参数在编译期选择度量，扫描循环中的距离计算可完全内联
+ */
+struct L2Metric {
+    static constexpr MetricType kType = MetricType::L2;
+    static constexpr bool kInnerProduct = false;
+    static constexpr const char* kName = "L2";
+
+    static float distance(std::span<const float> a, std::span<const float> b) {
+        return l2_distance(a, b);
+    }
+};
+
+/**
+ * @brief   内积度量策略
+ * @note    返回负内积，使所有度量都是"越小越相似"
+ */
+struct IPMetric {
+    static constexpr MetricType kType = MetricType::IP;
+    static constexpr bool kInnerProduct = true;
+    static constexpr const char* kName = "IP";
+
+    static float distance(std::span<const float> a, std::span<const float> b) {
+        return -ip_distance(a, b);
+    }
+};
+
+} // namespace minimilvus
@@ -0,0 +1,257 @@
+/**
+ * @file    mpmc_queue.hpp
+ * @brief   有界无锁多生产者多消费者队列
+ * @details MPMCQueue为Vyukov风格的环形缓冲区：每个槽位带序号，生产者和消费者
+ *          各自通过一次CAS领取位置，无需互斥锁；BlockingMPMCQueue在其上增加
+ *          先自旋后休眠（futex）的等待，队列空/满时不占用CPU
+ * @author  Tyooughtul
+ */
+
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <stdexcept>
+#include <thread>
+#include <utility>
+
+namespace minimilvus {
+
+/// 缓存行大小，用于隔离生产者和消费者的热点计数器
+constexpr size_t kCacheLineSize = 64;
+
+/**
+ * @brief   有界无锁MPMC队列
+ * @tparam  T   元素类型，需可移动构造
+ * @details 槽位i的序号语义：
+ *          - seq == pos       槽位空闲，可由位置pos的生产者写入
+ *          - seq == pos + 1   槽位已写入，可由位置pos的消费者读取
+ *          消费者读完后把序号设为 pos + capacity，供下一轮生产者使用
+ */
+template<typename T>
+class MPMCQueue {
+public:
+    /**
+     * @brief   构造函数
+     * @param   capacity    容量，向上取整为2的幂
+     * @throws  std::invalid_argument 当容量为0时
+     */
+    explicit MPMCQueue(size_t capacity) {
+        if (capacity == 0) throw std::invalid_argument("MPMCQueue capacity must be positive");
+        capacity_ = 1;
+        while (capacity_ < capacity) capacity_ <<= 1;
+        mask_ = capacity_ - 1;
+        cells_ = std::make_unique<Cell[]>(capacity_);
+        for (size_t i = 0; i < capacity_; ++i) cells_[i].sequence.store(i, std::memory_order_relaxed);
+    }
+
+    ~MPMCQueue() {
+        T discarded;
+        while (try_pop(discarded)) {}
+    }
+
+    MPMCQueue(const MPMCQueue&) = delete;
+    MPMCQueue& operator=(const MPMCQueue&) = delete;
+
+    /**
+     * @brief   尝试入队
+     * @return  队列已满时返回false，value保持不变
+     */
+    template<typename U>
+    bool try_push(U&& value) {
+        size_t pos = enqueue_pos_.load(std::memory_order_relaxed);
+        Cell* cell;
+        while (true) {
+            cell = &cells_[pos & mask_];
+            size_t seq = cell->sequence.load(std::memory_order_acquire);
+            auto diff = static_cast<intptr_t>(seq) - static_cast<intptr_t>(pos);
+            if (diff == 0) {
+                if (enqueue_pos_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) break;
+            } else if (diff < 0) {
+                return false;
+            } else {
+                pos = enqueue_pos_.load(std::memory_order_relaxed);
+            }
+        }
+        new (cell->storage) T(std::forward<U>(value));
+        cell->sequence.store(pos + 1, std::memory_order_release);
+        return true;
+    }
+
+    /**
+     * @brief   尝试出队
+     * @return  队列为空时返回false
+     */
+    bool try_pop(T& out) {
+        size_t pos = dequeue_pos_.load(std::memory_order_relaxed);
+        Cell* cell;
+        while (true) {
+            cell = &cells_[pos & mask_];
+            size_t seq = cell->sequence.load(std::memory_order_acquire);
+            auto diff = static_cast<intptr_t>(seq) - static_cast<intptr_t>(pos + 1);
+            if (diff == 0) {
+                if (dequeue_pos_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) break;
+            } else if (diff < 0) {
+                return false;
+            } else {
+                pos = dequeue_pos_.load(std::memory_order_relaxed);
+            }
+        }
+        T* item = std::launder(reinterpret_cast<T*>(cell->storage));
+        out = std::move(*item);
+        item->~T();
+        cell->sequence.store(pos + capacity_, std::memory_order_release);
+        return true;
+    }
+
+    /**
+     * @brief   近似元素个数（并发修改时仅供监控）
+     */
+    size_t size_approx() const {
+        size_t enq = enqueue_pos_.load(std::memory_order_relaxed);
+        size_t deq = dequeue_pos_.load(std::memory_order_relaxed);
+        return enq > deq ? enq - deq : 0;
+    }
+
+    size_t capacity() const { return capacity_; }
+
+private:
+    struct alignas(kCacheLineSize) Cell {
+        std::atomic<size_t> sequence;
+        alignas(T) unsigned char storage[sizeof(T)];
+    };
+
+    std::unique_ptr<Cell[]> cells_;
+    size_t capacity_ = 0;
+    size_t mask_ = 0;
+    alignas(kCacheLineSize) std::atomic<size_t> enqueue_pos_{0};
+    alignas(kCacheLineSize) std::atomic<size_t> dequeue_pos_{0};
+};
+
+/**
+ * @brief   带阻塞等待的MPMC队列
+ * @details 快路径只有无锁的try_push/try_pop；失败时先自旋若干次，
+ *          仍失败才在事件计数上futex休眠。对端只在确有等待者时才notify，
+ *          因此忙碌时每次push/pop都不进入内核
+ */
+template<typename T>
+class BlockingMPMCQueue {
+public:
+    /**
+     * @brief   构造函数
+     * @param   capacity    容量
+     * @param   spin_count  休眠前的自旋次数
+     */
+    explicit BlockingMPMCQueue(size_t capacity, int spin_count = 256)
+        : queue_(capacity), spin_count_(spin_count) {}
+
+    /**
+     * @brief   入队，队列满时等待
+     * @return  队列已关闭时返回false
+     */
+    template<typename U>
+    bool push(U&& value) {
+        while (true) {
+            if (closed_.load(std::memory_order_acquire)) return false;
+            for (int i = 0; i <= spin_count_; ++i) {
+                if (try_push(std::forward<U>(value))) return true;
+                cpu_relax(i);
+            }
+            uint32_t epoch = not_full_.load(std::memory_order_acquire);
+            push_waiters_.fetch_add(1, std::memory_order_seq_cst);
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            bool pushed = try_push(std::forward<U>(value));
+            if (!pushed && !closed_.load(std::memory_order_acquire)) not_full_.wait(epoch);
+            push_waiters_.fetch_sub(1, std::memory_order_relaxed);
+            if (pushed) return true;
+        }
+    }
+
+    /**
+     * @brief   尝试入队，不等待
+     * @return  队列已满或已关闭时返回false
+     */
+    template<typename U>
+    bool try_push(U&& value) {
+        if (closed_.load(std::memory_order_acquire) || !queue_.try_push(std::forward<U>(value))) return false;
+        wake(not_empty_, pop_waiters_);
+        return true;
+    }
+
+    /**
+     * @brief   出队，队列空时等待
+     * @return  队列已关闭且为空时返回false
+     */
+    bool pop(T& out) {
+        while (true) {
+            for (int i = 0; i <= spin_count_; ++i) {
+                if (try_pop(out)) return true;
+                cpu_relax(i);
+            }
+            uint32_t epoch = not_empty_.load(std::memory_order_acquire);
+            pop_waiters_.fetch_add(1, std::memory_order_seq_cst);
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            bool popped = try_pop(out);
+            bool closed = closed_.load(std::memory_order_acquire);
+            if (!popped && !closed) not_empty_.wait(epoch);
+            pop_waiters_.fetch_sub(1, std::memory_order_relaxed);
+            if (popped) return true;
+            if (closed) return try_pop(out);
+        }
+    }
+
+    /**
+     * @brief   尝试出队，不等待
+     */
+    bool try_pop(T& out) {
+        if (!queue_.try_pop(out)) return false;
+        wake(not_full_, push_waiters_);
+        return true;
+    }
+
+    /**
+     * @brief   关闭队列：唤醒所有等待者，之后push失败，pop取完剩余元素后返回false
+     */
+    void close() {
+        closed_.store(true, std::memory_order_release);
+        not_empty_.fetch_add(1, std::memory_order_release);
+        not_full_.fetch_add(1, std::memory_order_release);
+        not_empty_.notify_all();
+        not_full_.notify_all();
+    }
+
+    bool closed() const { return closed_.load(std::memory_order_acquire); }
+    size_t size_approx() const { return queue_.size_approx(); }
+    size_t capacity() const { return queue_.capacity(); }
+
+private:
+    MPMCQueue<T> queue_;
+    int spin_count_;
+    std::atomic<bool> closed_{false};
+    alignas(kCacheLineSize) std::atomic<uint32_t> not_empty_{0};   ///< 事件计数：有新元素
+    std::atomic<uint32_t> pop_waiters_{0};
+    alignas(kCacheLineSize) std::atomic<uint32_t> not_full_{0};    ///< 事件计数：有空位
+    std::atomic<uint32_t> push_waiters_{0};
+
+    /**
+     * @brief   有等待者时推进事件计数并唤醒一个
+     * @note    seq_cst栅栏与等待方的 waiters++ / 重试 配对，保证不会错过唤醒
+     */
+    static void wake(std::atomic<uint32_t>& event, std::atomic<uint32_t>& waiters) {
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (waiters.load(std::memory_order_relaxed) == 0) return;
+        event.fetch_add(1, std::memory_order_release);
+        event.notify_one();
+    }
+
+    static void cpu_relax(int iteration) {
+#if defined(__x86_64__) || defined(__i386__)
+        __builtin_ia32_pause();
+#endif
+        if (iteration >= 64) std::this_thread::yield();
+    }
+};
+
+} // namespace minimilvus
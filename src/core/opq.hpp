@@ -0,0 +1,179 @@
+/**
+ * @file    opq.hpp
+ * @brief   OPQ：带正交旋转的乘积量化
+ * @details 相关性强的维度被PQ切到不同段时，每段的码本无法利用这种相关性，量化误差大。
+ *          OPQ先用正交矩阵R旋转向量再做PQ，R与码本交替优化：
+ *          固定R训练码本，固定码本用Procrustes求最优R。
+ *          R正交，旋转不改变L2距离和内积，因此索引的其余部分不受影响
+ * @author  Tyooughtul
+ */
+
+#pragma once
+#include <iostream>
+#include "codecs.hpp"
+#include "linalg.hpp"
+
+namespace minimilvus {
+
+/**
+ * @brief   OPQ编码器：旋转 + PQCodec
+ */
+class OPQCodec {
+public:
+    static constexpr const char* kName = "OPQ";
+    static constexpr idx_t kMaxTrainSamples = 32768;
+    static constexpr idx_t kMinTrainSamples = PQCodec::kMinTrainSamples;
+    static constexpr int kTrainIterations = 8;      ///< 交替优化轮数
+    static constexpr int kInnerKMeansIterations = 4; ///< 每轮训练码本的KMeans迭代次数
+
+    /**
+     * @brief   构造函数
+     * @param   dim     向量维度
+     * @param   m       PQ分段数，需整除dim
+     */
+    OPQCodec(int dim, int m = 8)
+        : dim_(dim), pq_(dim, m), rotation_(Matrix::identity(dim)), rotation_t_(Matrix::identity(dim)) {}
+
+    /**
+     * @brief   交替训练旋转矩阵和码本
+     * @param   dataset     训练数据
+     * @param   n_iter      交替优化轮数
+     * @throws  std::invalid_argument 当训练样本少于256个或维度不符时
+     * @note    R从单位阵开始，第一轮等价于普通PQ，之后量化误差逐轮下降
+     */
+    void train(const VectorDataset& dataset, int n_iter = kTrainIterations) {
+        if (dataset.get_count() < PQCodec::kCentroids || dataset.get_dim() != dim_) {
+            throw std::invalid_argument("OPQ training requires at least 256 vectors of matching dim");
+        }
+        idx_t n = std::min(dataset.get_count(), kMaxTrainSamples);
+        idx_t step = dataset.get_count() / n;
+        std::vector<float> x(static_cast<size_t>(n) * dim_);
+        for (idx_t i = 0; i < n; ++i) {
+            auto vec = dataset.get_vector(i * step);
+            std::copy(vec.begin(), vec.end(), x.begin() + i * dim_);
+        }
+
+        std::vector<float> y(x.size()), y_hat(x.size());
+        rotation_ = Matrix::identity(dim_);
+        for (int iter = 0; iter < n_iter; ++iter) {
+            matvec_batch(rotation_, x.data(), y.data(), n);
+            VectorDataset rotated(dim_);
+            rotated.add_batch(y);
+            pq_.train(rotated, kInnerKMeansIterations);
+
+            double distortion = 0;
+            #pragma omp parallel for reduction(+:distortion)
+            for (idx_t i = 0; i < n; ++i) {
+                std::vector<uint8_t> code(pq_.code_size());
+                pq_.encode({y.data() + i * dim_, static_cast<size_t>(dim_)}, code.data());
+                pq_.decode(code.data(), y_hat.data() + i * dim_);
+                distortion += l2_distance({y.data() + i * dim_, static_cast<size_t>(dim_)},
+                                          {y_hat.data() + i * dim_, static_cast<size_t>(dim_)});
+            }
+            if (verbose_) std::cout << "OPQ iter " << iter << "/" << n_iter << ", distortion " << distortion / n << std::endl;
+
+            // 固定码本：R = argmin ||X Rᵀ - Ŷ||，即 Ŷᵀ X 的Procrustes解
+            rotation_ = orthogonal_procrustes(crossprod(y_hat.data(), dim_, x.data(), dim_, n));
+        }
+
+        matvec_batch(rotation_, x.data(), y.data(), n);
+        VectorDataset rotated(dim_);
+        rotated.add_batch(y);
+        pq_.train(rotated);
+        rotation_t_ = rotation_.transpose();
+    }
+
+    bool is_trained() const { return pq_.is_trained(); }
+    int get_dim() const { return dim_; }
+    size_t code_size() const { return pq_.code_size(); }
+    std::string name() const { return kName + std::to_string(pq_.segments()); }
+    const Matrix& rotation() const { return rotation_; }
+    const PQCodec& pq() const { return pq_; }
+
+    /**
+     * @brief   是否打印每轮交替优化的量化误差（默认关闭，索引构建时不刷屏）
+     */
+    void set_verbose(bool verbose) { verbose_ = verbose; }
+
+    /**
+     * @brief   out = R x
+     */
+    void rotate(std::span<const float> x, float* out) const { matvec(rotation_, x.data(), out); }
+
+    void encode(std::span<const float> vec, uint8_t* code) const {
+        std::vector<float> rotated(dim_);
+        rotate(vec, rotated.data());
+        pq_.encode(rotated, code);
+    }
+
+    /**
+     * @brief   解码并旋转回原空间：x = Rᵀ ŷ
+     */
+    void decode(const uint8_t* code, float* out) const {
+        std::vector<float> rotated(dim_);
+        pq_.decode(code, rotated.data());
+        matvec(rotation_t_, rotated.data(), out);
+    }
+
+    /**
+     * @brief   扫描器：查询旋转一次后构建PQ距离表，之后与PQ完全相同
+     */
+    template<typename Metric>
+    class Scanner {
+    public:
+        Scanner(const OPQCodec& codec, std::span<const float> query)
+            : inner_(codec.pq_, rotated_query(codec, query)) {}
+
+        float operator()(const uint8_t* code) const { return inner_(code); }
+
+    private:
+        PQCodec::Scanner<Metric> inner_;
+
+        static std::vector<float> rotated_query(const OPQCodec& codec, std::span<const float> query) {
+            std::vector<float> rotated(codec.dim_);
+            codec.rotate(query, rotated.data());
+            return rotated;
+        }
+    };
+
+    template<typename Metric>
+    Scanner<Metric> scanner(std::span<const float> query) const { return Scanner<Metric>(*this, query); }
+
+    void save(std::ostream& out) const {
+        detail::write_vector(out, rotation_.data);
+        pq_.save(out);
+    }
+
+    /**
+     * @throws  std::runtime_error 当旋转矩阵或码本与维度不符时
+     */
+    static OPQCodec load(std::istream& in, int dim) {
+        Matrix rotation(dim, dim);
+        detail::read_vector(in, rotation.data);
+        if (rotation.data.size() != static_cast<size_t>(dim) * dim) {
+            throw std::runtime_error("OPQ rotation size mismatch");
+        }
+        PQCodec pq = PQCodec::load(in, dim);
+        OPQCodec codec(dim, pq.segments());
+        codec.pq_ = std::move(pq);
+        codec.rotation_t_ = rotation.transpose();
+        codec.rotation_ = std::move(rotation);
+        return codec;
+    }
+
+    MemoryUsage memory_usage() const {
+        MemoryUsage usage = pq_.memory_usage();
+        usage += vector_memory(rotation_.data);
+        usage += vector_memory(rotation_t_.data);
+        return usage;
+    }
+
+private:
+    int dim_;
+    PQCodec pq_;
+    Matrix rotation_;       ///< R，dim × dim
+    Matrix rotation_t_;     ///< Rᵀ，用于解码
+    bool verbose_ = false;  ///< 是否打印训练进度
+};
+
+} // namespace minimilvus
@@ -0,0 +1,142 @@
+/**
+ * @file    profiler.hpp
+ * @brief   单次查询的性能剖析
+ * @details 基于rdtsc记录查询各阶段耗时和计数器，未开启时几乎零开销
+ * @author  Tyooughtul
+ */
+
+#pragma once
+#include <cstdint>
+#include <chrono>
+#include <thread>
+#ifdef __x86_64__
+#include <x86intrin.h>
+#endif
+
+namespace minimilvus {
+
+/**
+ * @brief   读取时间戳计数器
+ * @return  当前周期数（非x86平台退化为纳秒时钟）
+ */
+inline uint64_t read_tsc() {
+#ifdef __x86_64__
+    return __rdtsc();
+#else
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+#endif
+}
+
+/**
+ * @brief   估算TSC频率（周期/纳秒）
+ * @return  每纳秒的周期数，首次调用时校准一次
+ * @note    用10ms的睡眠窗口对齐steady_clock，精度足够用于耗时展示
+ */
+inline double tsc_per_ns() {
+    static const double ratio = [] {
+        auto t0 = std::chrono::steady_clock::now();
+        uint64_t c0 = read_tsc();
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        uint64_t c1 = read_tsc();
+        auto t1 = std::chrono::steady_clock::now();
+        double ns = std::chrono::duration<double, std::nano>(t1 - t0).count();
+        return ns > 0 ? static_cast<double>(c1 - c0) / ns : 1.0;
+    }();
+    return ratio;
+}
+
+/**
+ * @brief   查询剖析阶段
+ */
+enum class ProfileStage {
+    CentroidScoring = 0,  ///< 计算查询到所有桶中心的距离
+    ProbeSelection,       ///< 桶排序与探测范围确定
+    BucketScan,           ///< 扫描被探测桶内的向量
+    TopK,                 ///< 从候选堆取出结果（扫描中的入堆计入BucketScan，次数见heap_pushes）
+    GraphExpand,          ///< 沿kNN图扩展候选
+    Refine,               ///< 精排并截断为K个结果
+    Serialization,        ///< 结果序列化（含生成JSON文本）
+    Count
+};
+
+/**
+ * @brief   获取阶段名称
+ * @param   stage   阶段
+ * @return  用于输出的阶段名
+ */
+inline const char* profile_stage_name(ProfileStage stage) {
+    switch (stage) {
+        case ProfileStage::CentroidScoring: return "centroid_scoring";
+        case ProfileStage::ProbeSelection:  return "probe_selection";
+        case ProfileStage::BucketScan:      return "bucket_scan";
+        case ProfileStage::TopK:            return "top_k";
+        case ProfileStage::GraphExpand:     return "graph_expand";
+        case ProfileStage::Refine:          return "refine";
+        case ProfileStage::Serialization:   return "serialization";
+        default:                            return "unknown";
+    }
+}
+
+/**
+ * @brief   单次查询的剖析结果
+ * @details 记录各阶段累计周期数以及扫描相关的计数器
+ */
+struct QueryProfile {
+    static constexpr int kStageCount = static_cast<int>(ProfileStage::Count);
+
+    uint64_t stage_cycles[kStageCount] = {};  ///< 各阶段累计周期数
+    int64_t centroids_scored = 0;              ///< 计算距离的桶中心数量
+    int64_t buckets_probed = 0;                ///< 实际探测的桶数量
+    int64_t vectors_scanned = 0;               ///< 扫描的向量数量
+    int64_t heap_pushes = 0;                   ///< 候选堆的插入次数
+    int64_t graph_expanded = 0;                ///< 沿kNN图补充计算距离的向量数量
+    int64_t results_returned = 0;              ///< 返回的结果数量
+
+    /**
+     * @brief   累加某阶段的周期数
+     */
+    void add(ProfileStage stage, uint64_t cycles) {
+        stage_cycles[static_cast<int>(stage)] += cycles;
+    }
+
+    /**
+     * @brief   获取某阶段耗时（微秒）
+     */
+    double stage_us(ProfileStage stage) const {
+        return stage_cycles[static_cast<int>(stage)] / tsc_per_ns() / 1000.0;
+    }
+
+    /**
+     * @brief   全部阶段总耗时（微秒）
+     */
+    double total_us() const {
+        uint64_t total = 0;
+        for (uint64_t c : stage_cycles) total += c;
+        return total / tsc_per_ns() / 1000.0;
+    }
+};
+
+/**
+ * @brief   阶段计时器（RAII）
+ * @details profile为空时构造和析构都只是一次判空，保证关闭剖析时的开销可忽略
+ */
+class ScopedStageTimer {
+public:
+    ScopedStageTimer(QueryProfile* profile, ProfileStage stage)
+        : profile_(profile), stage_(stage), start_(profile ? read_tsc() : 0) {}
+
+    ~ScopedStageTimer() {
+        if (profile_) profile_->add(stage_, read_tsc() - start_);
+    }
+
+    ScopedStageTimer(const ScopedStageTimer&) = delete;
+    ScopedStageTimer& operator=(const ScopedStageTimer&) = delete;
+
+private:
+    QueryProfile* profile_;
+    ProfileStage stage_;
+    uint64_t start_;
+};
+
+} // namespace minimilvus
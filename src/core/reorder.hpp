@@ -0,0 +1,198 @@
+/**
+ * @file    reorder.hpp
+ * @brief   ID重排：让一起被访问的向量在内存中相邻
+ * @details 数据集按插入顺序编号时，同一个桶或图上相邻的向量散落在整个数据区，
+ *          每次距离计算都可能是一次缓存/TLB甚至缺页未命中。
+ *          重排给出一个新的行顺序（排列），按它搬动数据集的行并改写索引内的ID，
+ *          索引另存"新行号 -> 原ID"的映射表，使对外返回的ID保持不变。
+ *          图上的顺序：
+ *          - BFS：按广度优先的访问顺序编号，邻居大多落在相近的位置
+ *          - RCM（逆Cuthill-McKee）：每个连通分量从度最小的节点出发BFS，
+ *            邻居按度升序入队，最后整体反转，进一步压缩边的编号跨度
+ * @author  Tyooughtul
+ */
+
+#pragma once
+#include <algorithm>
+#include <cstdint>
+#include <numeric>
+#include <stdexcept>
+#include <vector>
+#include <omp.h>
+#include "dataset.hpp"
+#include "knn_graph.hpp"
+#include "memory_stats.hpp"
+
+namespace minimilvus {
+
+/**
+ * @brief   行号排列及其逆
+ */
+class IdPermutation {
+public:
+    IdPermutation() = default;
+
+    /**
+     * @brief   由新顺序构造
+     * @param   new_to_old  新位置i上放原来的第new_to_old[i]行
+     * @throws  std::invalid_argument 当不是0..n-1的排列时
+     */
+    explicit IdPermutation(std::vector<idx_t> new_to_old) : new_to_old_(std::move(new_to_old)) {
+        const idx_t n = static_cast<idx_t>(new_to_old_.size());
+        old_to_new_.assign(n, -1);
+        for (idx_t i = 0; i < n; ++i) {
+            idx_t old_id = new_to_old_[i];
+            if (old_id < 0 || old_id >= n || old_to_new_[old_id] != -1) {
+                throw std::invalid_argument("Not a permutation");
+            }
+            old_to_new_[old_id] = i;
+        }
+    }
+
+    static IdPermutation identity(idx_t n) {
+        std::vector<idx_t> order(n);
+        std::iota(order.begin(), order.end(), 0);
+        return IdPermutation(std::move(order));
+    }
+
+    idx_t size() const { return static_cast<idx_t>(new_to_old_.size()); }
+    idx_t to_new(idx_t old_id) const { return old_to_new_[old_id]; }
+    idx_t to_old(idx_t new_id) const { return new_to_old_[new_id]; }
+    const std::vector<idx_t>& new_to_old() const { return new_to_old_; }
+    const std::vector<idx_t>& old_to_new() const { return old_to_new_; }
+
+    MemoryUsage memory_usage() const {
+        MemoryUsage usage = vector_memory(new_to_old_);
+        usage += vector_memory(old_to_new_);
+        return usage;
+    }
+
+private:
+    std::vector<idx_t> new_to_old_;
+    std::vector<idx_t> old_to_new_;
+};
+
+namespace detail {
+
+/**
+ * @brief   从start出发沿出边做BFS，把访问到的节点追加到order
+ * @param   degree  非空时邻居按度升序入队（Cuthill-McKee）
+ */
+inline void bfs_component(const KnnGraph& graph, idx_t start, const std::vector<uint32_t>* degree,
+                          std::vector<char>& visited, std::vector<idx_t>& order) {
+    size_t head = order.size();
+    visited[start] = 1;
+    order.push_back(start);
+    std::vector<idx_t> next;
+    while (head < order.size()) {
+        idx_t node = order[head++];
+        next.clear();
+        for (idx_t nb : graph.neighbors(node)) {
+            if (nb >= 0 && nb < graph.size() && !visited[nb]) {
+                visited[nb] = 1;
+                next.push_back(nb);
+            }
+        }
+        if (degree) {
+            std::stable_sort(next.begin(), next.end(),
+                             [&](idx_t a, idx_t b) { return (*degree)[a] < (*degree)[b]; });
+        }
+        order.insert(order.end(), next.begin(), next.end());
+    }
+}
+
+} // namespace detail
+
+/**
+ * @brief   广度优先顺序
+ * @details 依次从编号最小的未访问节点出发，保证不连通的图也覆盖全部节点
+ */
+inline IdPermutation bfs_order(const KnnGraph& graph) {
+    const idx_t n = graph.size();
+    std::vector<char> visited(n, 0);
+    std::vector<idx_t> order;
+    order.reserve(n);
+    for (idx_t v = 0; v < n; ++v) {
+        if (!visited[v]) detail::bfs_component(graph, v, nullptr, visited, order);
+    }
+    return IdPermutation(std::move(order));
+}
+
+/**
+ * @brief   逆Cuthill-McKee顺序
+ * @details kNN图每个节点的出度相同，度取出度与入度之和；
+ *          每个连通分量从度最小的未访问节点出发
+ */
+inline IdPermutation rcm_order(const KnnGraph& graph) {
+    const idx_t n = graph.size();
+    std::vector<uint32_t> degree(n, 0);
+    for (idx_t v = 0; v < n; ++v) {
+        auto nbs = graph.neighbors(v);
+        degree[v] += static_cast<uint32_t>(nbs.size());
+        for (idx_t nb : nbs) {
+            if (nb >= 0 && nb < n) degree[nb]++;
+        }
+    }
+    std::vector<idx_t> by_degree(n);
+    std::iota(by_degree.begin(), by_degree.end(), 0);
+    std::stable_sort(by_degree.begin(), by_degree.end(), [&](idx_t a, idx_t b) { return degree[a] < degree[b]; });
+
+    std::vector<char> visited(n, 0);
+    std::vector<idx_t> order;
+    order.reserve(n);
+    for (idx_t start : by_degree) {
+        if (!visited[start]) detail::bfs_component(graph, start, &degree, visited, order);
+    }
+    std::reverse(order.begin(), order.end());
+    return IdPermutation(std::move(order));
+}
+
+/**
+ * @brief   按排列搬动数据集的行：新数据集第i行为原数据集第perm.to_old(i)行
+ * @throws  std::invalid_argument 当排列大小与数据集不符时
+ */
+inline VectorDataset permute_rows(const VectorDataset& dataset, const IdPermutation& perm) {
+    if (perm.size() != dataset.get_count()) throw std::invalid_argument("Permutation size mismatch");
+    const int dim = static_cast<int>(dataset.get_dim());
+    VectorDataset result(dim);
+    auto rows = result.extend(dataset.get_count());
+    #pragma omp parallel for schedule(static)
+    for (idx_t i = 0; i < dataset.get_count(); ++i) {
+        auto vec = dataset.get_vector(perm.to_old(i));
+        std::copy(vec.begin(), vec.end(), rows.begin() + i * dim);
+    }
+    return result;
+}
+
+/**
+ * @brief   按排列给图重新编号，节点与邻居ID一并改写，邻居顺序不变
+ */
+inline KnnGraph permute_graph(const KnnGraph& graph, const IdPermutation& perm) {
+    if (perm.size() != graph.size()) throw std::invalid_argument("Permutation size mismatch");
+    const idx_t n = graph.size();
+    std::vector<uint64_t> offsets(n + 1, 0);
+    for (idx_t i = 0; i < n; ++i) offsets[i + 1] = offsets[i] + graph.neighbors(perm.to_old(i)).size();
+    std::vector<idx_t> neighbors(offsets.back());
+    #pragma omp parallel for schedule(static)
+    for (idx_t i = 0; i < n; ++i) {
+        auto nbs = graph.neighbors(perm.to_old(i));
+        for (size_t j = 0; j < nbs.size(); ++j) {
+            neighbors[offsets[i] + j] = nbs[j] >= 0 && nbs[j] < n ? perm.to_new(nbs[j]) : nbs[j];
+        }
+    }
+    return KnnGraph(std::move(offsets), std::move(neighbors));
+}
+
+/**
+ * @brief   边两端编号差的平均值，越小说明相邻节点在内存中越接近
+ */
+inline double average_edge_gap(const KnnGraph& graph) {
+    if (graph.num_edges() == 0) return 0.0;
+    double total = 0.0;
+    for (idx_t v = 0; v < graph.size(); ++v) {
+        for (idx_t nb : graph.neighbors(v)) total += static_cast<double>(nb > v ? nb - v : v - nb);
+    }
+    return total / graph.num_edges();
+}
+
+} // namespace minimilvus
@@ -0,0 +1,261 @@
+/**
+ * @file    replica.hpp
+ * @brief   基于WAL传送的只读副本
+ * @details 副本进程通过共享目录读取主节点的快照和WAL，增量重放新记录到自己的数据集/索引，
+ *          无需在每个副本上重建索引即可扩展读能力
+ * @author  Tyooughtul
+ */
+
+#pragma once
+#include <string>
+#include <vector>
+#include <memory>
+#include <thread>
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <condition_variable>
+#include <fstream>
+#include <filesystem>
+#include "collection.hpp"
+
+namespace minimilvus {
+
+/**
+ * @brief   集合的只读副本
+ * @details 副本维护 (快照代数, WAL字节偏移) 作为复制位点：
+ *          - manifest代数变化时重新加载快照，WAL偏移归零
+ *          - 否则从偏移处读取完整的新行并重放
+ *          主节点flush的顺序是 快照 -> manifest -> 清空WAL，
+ *          因此读WAL前后manifest代数一致，就说明读到的记录属于当前代；
+ *          同理加载快照前后manifest一致且行数与数据集相符，才说明数据集与索引属于同一代
+ */
+class CollectionReplica {
+public:
+    /**
+     * @brief   构造函数
+     * @param   config          与主节点相同的集合配置（data_dir为共享目录）
+     * @param   max_staleness   搜索允许的最大数据陈旧时间
+     */
+    CollectionReplica(CollectionConfig config,
+                      std::chrono::milliseconds max_staleness = std::chrono::milliseconds(100))
+        : config_(std::move(config)), max_staleness_(max_staleness), dataset_(config_.dim) {
+        sync();
+    }
+
+    ~CollectionReplica() { stop(); }
+
+    CollectionReplica(const CollectionReplica&) = delete;
+    CollectionReplica& operator=(const CollectionReplica&) = delete;
+
+    /**
+     * @brief   启动后台同步线程
+     * @param   poll_interval   轮询共享目录的间隔
+     */
+    void start(std::chrono::milliseconds poll_interval = std::chrono::milliseconds(10)) {
+        if (running_.exchange(true)) return;
+        sync_thread_ = std::thread([this, poll_interval] {
+            std::unique_lock<std::mutex> lock(stop_mutex_);
+            while (running_) {
+                lock.unlock();
+                try {
+                    sync();
+                } catch (const std::exception& e) {
+                    std::cerr << "Replica sync failed: " << e.what() << std::endl;
+                }
+                lock.lock();
+                stop_cv_.wait_for(lock, poll_interval, [this] { return !running_; });
+            }
+        });
+    }
+
+    /**
+     * @brief   停止后台同步线程
+     */
+    void stop() {
+        {
+            std::lock_guard<std::mutex> lock(stop_mutex_);
+            if (!running_.exchange(false)) return;
+        }
+        stop_cv_.notify_all();
+        if (sync_thread_.joinable()) sync_thread_.join();
+    }
+
+    /**
+     * @brief   从共享目录拉取并应用新数据
+     * @return  本次应用的WAL记录数（重新加载快照时为快照后的记录数）
+     */
+    size_t sync() {
+        std::lock_guard<std::mutex> sync_lock(sync_mutex_);
+        if (!loaded_ || Collection::read_generation(config_) != generation_) {
+            // 主节点flush过于频繁、始终没能读到一致的快照：保持当前状态，下次同步再试
+            if (!load_snapshot()) return 0;
+        }
+
+        std::vector<std::pair<idx_t, std::vector<float>>> records;
+        size_t consumed = read_new_records(records);
+
+        // WAL在读取期间被新一代flush截断，丢弃本次结果，下次从新快照开始
+        if (Collection::read_generation(config_) != generation_) return 0;
+
+        size_t applied = 0;
+        bool gap = false;
+        {
+            StdRWLock::WriteLock lock(lock_);
+            for (const auto& [record_id, vec] : records) {
+                // 快照已包含的记录（主节点flush清空WAL之前）不再重放
+                if (record_id >= 0 && record_id < dataset_.get_count()) continue;
+                // 漏掉了记录：快照在manifest更新后、WAL截断前加载，读取位置越过了截断后重写的内容
+                if (record_id > dataset_.get_count()) {
+                    gap = true;
+                    break;
+                }
+                idx_t id = dataset_.get_count();
+                dataset_.add(vec);
+                if (index_) index_->add(vec, id);
+                applied++;
+            }
+        }
+        // 出现缺口时下次从头扫描WAL，已应用的ID会被跳过
+        wal_offset_ = gap ? 0 : wal_offset_ + consumed;
+        last_sync_ = std::chrono::steady_clock::now().time_since_epoch().count();
+        return applied;
+    }
+
+    /**
+     * @brief   搜索最近邻
+     * @note    数据陈旧超过max_staleness时先同步一次再搜索
+     */
+    std::vector<SearchResult> search(std::span<const float> query, int k) {
+        if (staleness() > max_staleness_) sync();
+        StdRWLock::ReadLock lock(lock_);
+        if (index_) return index_->search(query, dataset_, k);
+
+        std::priority_queue<SearchResult> top;
+        for (idx_t i = 0; i < dataset_.get_count(); ++i) {
+            float d = config_.metric == MetricType::L2
+                      ? l2_distance(query, dataset_.get_vector(i))
+                      : -ip_distance(query, dataset_.get_vector(i));
+            if (top.size() < static_cast<size_t>(k)) top.push({i, d});
+            else if (d < top.top().distance) { top.pop(); top.push({i, d}); }
+        }
+        std::vector<SearchResult> results(top.size());
+        for (size_t i = results.size(); i-- > 0;) {
+            results[i] = top.top();
+            top.pop();
+        }
+        return results;
+    }
+
+    /**
+     * @brief   距上次成功同步的时间
+     */
+    std::chrono::milliseconds staleness() const {
+        auto now = std::chrono::steady_clock::now().time_since_epoch().count();
+        return std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::steady_clock::duration(now - last_sync_.load()));
+    }
+
+    /**
+     * @brief   副本中的向量数量
+     */
+    idx_t size() const {
+        StdRWLock::ReadLock lock(lock_);
+        return dataset_.get_count();
+    }
+
+    /**
+     * @brief   当前应用到的快照代数
+     */
+    uint64_t generation() const { return generation_; }
+
+private:
+    CollectionConfig config_;
+    std::chrono::milliseconds max_staleness_;
+    VectorDataset dataset_;
+    std::unique_ptr<IVFIndex> index_;
+    mutable StdRWLock lock_;            ///< 保护dataset_/index_
+    std::mutex sync_mutex_;             ///< 串行化sync
+    uint64_t generation_ = 0;
+    uint64_t wal_offset_ = 0;
+    bool loaded_ = false;
+    std::atomic<int64_t> last_sync_{0};
+
+    std::atomic<bool> running_{false};
+    std::thread sync_thread_;
+    std::mutex stop_mutex_;
+    std::condition_variable stop_cv_;
+
+    static constexpr int kSnapshotRetries = 6;
+
+    /**
+     * @brief   加载主节点的快照
+     * @details 加载期间主节点可能正在flush，读到新数据集配旧索引（或反之）；
+     *          加载后重新读取manifest，代数变化或行数与数据集不符时丢弃本次结果，
+     *          退避后重试（等待主节点写完manifest）
+     * @return  是否加载了一致的快照
+     */
+    bool load_snapshot() {
+        for (int attempt = 0; attempt < kSnapshotRetries; ++attempt) {
+            if (attempt > 0) std::this_thread::sleep_for(std::chrono::milliseconds(1 << attempt));
+            Collection::Manifest before = Collection::read_manifest(config_);
+            VectorDataset dataset(config_.dim);
+            std::unique_ptr<IVFIndex> index;
+            // 快照文件以rename原子替换，已打开的文件总是完整的某一代
+            if (std::filesystem::exists(Collection::dataset_path(config_))) {
+                dataset = VectorDataset::load(Collection::dataset_path(config_));
+            }
+            if (config_.index_type == IndexType::IVF && std::filesystem::exists(Collection::index_path(config_))) {
+                index = std::make_unique<IVFIndex>(IVFIndex::load(Collection::index_path(config_)));
+            }
+            Collection::Manifest after = Collection::read_manifest(config_);
+            if (after.generation != before.generation ||
+                (after.count >= 0 && after.count != dataset.get_count())) {
+                continue;
+            }
+
+            StdRWLock::WriteLock lock(lock_);
+            dataset_ = std::move(dataset);
+            index_ = std::move(index);
+            generation_ = after.generation;
+            wal_offset_ = 0;
+            loaded_ = true;
+            return true;
+        }
+        return false;
+    }
+
+    /**
+     * @brief   从wal_offset_开始读取完整的ADD_VECTOR记录
+     * @return  消费的字节数（不含末尾未写完的半行）
+     */
+    size_t read_new_records(std::vector<std::pair<idx_t, std::vector<float>>>& records) {
+        std::ifstream file(Collection::wal_path(config_), std::ios::binary);
+        if (!file.is_open()) return 0;
+        file.seekg(0, std::ios::end);
+        auto size = static_cast<uint64_t>(file.tellg());
+        // 文件比读取位置短：同一代内WAL被截断过，从头读取
+        if (size < wal_offset_) wal_offset_ = 0;
+        if (size <= wal_offset_) return 0;
+        file.seekg(static_cast<std::streamoff>(wal_offset_));
+
+        std::string chunk(size - wal_offset_, '\0');
+        file.read(chunk.data(), chunk.size());
+        chunk.resize(file.gcount());
+
+        size_t consumed = 0;
+        size_t line_end;
+        while ((line_end = chunk.find('\n', consumed)) != std::string::npos) {
+            std::string line = chunk.substr(consumed, line_end - consumed);
+            consumed = line_end + 1;
+            size_t pos = line.find('|');
+            if (pos == std::string::npos) continue;
+            if (line.compare(0, pos, "ADD_VECTOR") == 0) {
+                records.push_back(Collection::parse_record(line.substr(pos + 1)));
+            }
+        }
+        return consumed;
+    }
+};
+
+} // namespace minimilvus
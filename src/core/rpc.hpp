@@ -0,0 +1,461 @@
+/**
+ * @file    rpc.hpp
+ * @brief   引擎二进制协议与分片服务端
+ * @details 基于TCP的长度前缀帧协议：| u32 长度 | u8 类型 | payload |，
+ *          用于协调节点与分片进程之间的搜索请求转发
+ * @author  Tyooughtul
+ */
+
+#pragma once
+#include <string>
+#include <vector>
+#include <cstring>
+#include <cerrno>
+#include <cstdint>
+#include <functional>
+#include <thread>
+#include <list>
+#include <mutex>
+#include <atomic>
+#include <span>
+#include <stdexcept>
+#include <algorithm>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+#include <unistd.h>
+#include "dataset.hpp"
+#include "ivf_index.hpp"
+
+namespace minimilvus {
+
+/**
+ * @brief   消息类型
+ */
+enum class MessageType : uint8_t {
+    SearchRequest = 1,   ///< 搜索请求
+    SearchResponse = 2,  ///< 搜索响应
+    Error = 3,           ///< 错误（payload为错误信息）
+    InsertRequest = 4,   ///< 插入请求
+    InsertResponse = 5   ///< 插入响应（分片内的本地ID）
+};
+
+/// 单帧最大长度，防止异常数据导致巨量分配
+constexpr uint32_t kMaxFrameSize = 64u << 20;
+
+/// 单次搜索请求允许的最大K
+constexpr int kMaxSearchK = 1 << 16;
+
+/**
+ * @brief   写满len字节
+ * @return  是否成功（对端关闭或出错时返回false）
+ */
+inline bool write_all(int fd, const void* buf, size_t len) {
+    const char* p = static_cast<const char*>(buf);
+    while (len > 0) {
+        ssize_t n = ::send(fd, p, len, MSG_NOSIGNAL);
+        if (n <= 0) return false;
+        p += n;
+        len -= n;
+    }
+    return true;
+}
+
+/**
+ * @brief   读满len字节
+ * @return  是否成功（对端关闭或出错时返回false）
+ */
+inline bool read_all(int fd, void* buf, size_t len) {
+    char* p = static_cast<char*>(buf);
+    while (len > 0) {
+        ssize_t n = ::recv(fd, p, len, 0);
+        if (n <= 0) return false;
+        p += n;
+        len -= n;
+    }
+    return true;
+}
+
+/**
+ * @brief   编码一帧（帧头 + payload）
+ */
+inline std::string encode_frame(MessageType type, const std::string& payload) {
+    std::string frame(5 + payload.size(), '\0');
+    uint32_t len = static_cast<uint32_t>(payload.size() + 1);
+    std::memcpy(frame.data(), &len, 4);
+    frame[4] = static_cast<char>(type);
+    std::memcpy(frame.data() + 5, payload.data(), payload.size());
+    return frame;
+}
+
+/**
+ * @brief   发送一帧
+ * @note    帧头和payload合并为一次send，避免Nagle与延迟ACK叠加
+ */
+inline bool send_frame(int fd, MessageType type, const std::string& payload) {
+    std::string frame = encode_frame(type, payload);
+    return write_all(fd, frame.data(), frame.size());
+}
+
+/**
+ * @brief   接收一帧
+ * @return  是否成功
+ */
+inline bool recv_frame(int fd, MessageType& type, std::string& payload) {
+    uint32_t len = 0;
+    if (!read_all(fd, &len, 4) || len == 0 || len > kMaxFrameSize) return false;
+    uint8_t t = 0;
+    if (!read_all(fd, &t, 1)) return false;
+    type = static_cast<MessageType>(t);
+    payload.resize(len - 1);
+    return read_all(fd, payload.data(), payload.size());
+}
+
+/**
+ * @brief   非阻塞地读入当前可读的数据，并尝试拆出一帧
+ * @param   buffer  该连接已收到但尚未成帧的数据，跨调用保留
+ * @return  1表示拆出了完整的一帧，0表示数据不足、需等下次可读，-1表示对端关闭、出错或帧非法
+ * @note    不会阻塞：poll报告可读后只读取已到达的数据，慢连接不会拖住调用线程
+ */
+inline int try_recv_frame(int fd, std::string& buffer, MessageType& type, std::string& payload) {
+    char chunk[64 * 1024];
+    while (true) {
+        ssize_t n = ::recv(fd, chunk, sizeof(chunk), MSG_DONTWAIT);
+        if (n > 0) {
+            buffer.append(chunk, n);
+            continue;
+        }
+        if (n == 0) return -1;
+        if (errno == EAGAIN || errno == EWOULDBLOCK) break;
+        if (errno != EINTR) return -1;
+    }
+    if (buffer.size() < 4) return 0;
+    uint32_t len = 0;
+    std::memcpy(&len, buffer.data(), 4);
+    if (len == 0 || len > kMaxFrameSize) return -1;
+    if (buffer.size() < 4 + static_cast<size_t>(len)) return 0;
+    type = static_cast<MessageType>(buffer[4]);
+    payload.assign(buffer, 5, len - 1);
+    buffer.erase(0, 4 + static_cast<size_t>(len));
+    return 1;
+}
+
+// ---- payload 编解码（小端，同机部署） ----
+
+/**
+ * @brief   编码搜索请求：| u64 request_id | i32 k | i32 dim | float * dim |
+ */
+inline std::string encode_search_request(uint64_t request_id, int k, std::span<const float> query) {
+    int32_t header[2] = {k, static_cast<int32_t>(query.size())};
+    std::string out(8 + sizeof(header) + query.size_bytes(), '\0');
+    std::memcpy(out.data(), &request_id, 8);
+    std::memcpy(out.data() + 8, header, sizeof(header));
+    std::memcpy(out.data() + 8 + sizeof(header), query.data(), query.size_bytes());
+    return out;
+}
+
+/**
+ * @brief   解码搜索请求
+ * @throws  std::runtime_error 当payload格式错误或k不在[1, kMaxSearchK]内时
+ */
+inline void decode_search_request(const std::string& payload, uint64_t& request_id,
+                                  int& k, std::vector<float>& query) {
+    int32_t header[2];
+    if (payload.size() < 8 + sizeof(header)) throw std::runtime_error("Malformed search request");
+    std::memcpy(&request_id, payload.data(), 8);
+    std::memcpy(header, payload.data() + 8, sizeof(header));
+    k = header[0];
+    if (header[1] < 0 || payload.size() != 8 + sizeof(header) + header[1] * sizeof(float)) {
+        throw std::runtime_error("Malformed search request");
+    }
+    if (k <= 0 || k > kMaxSearchK) throw std::runtime_error("Invalid k in search request");
+    query.resize(header[1]);
+    std::memcpy(query.data(), payload.data() + 8 + sizeof(header), header[1] * sizeof(float));
+}
+
+/**
+ * @brief   编码搜索响应：| u64 request_id | i32 n | (i64 id, f32 distance) * n |
+ */
+inline std::string encode_search_response(uint64_t request_id, const std::vector<SearchResult>& results) {
+    const size_t item = sizeof(idx_t) + sizeof(float);
+    int32_t n = static_cast<int32_t>(results.size());
+    std::string out(12 + results.size() * item, '\0');
+    std::memcpy(out.data(), &request_id, 8);
+    std::memcpy(out.data() + 8, &n, 4);
+    char* p = out.data() + 12;
+    for (const auto& r : results) {
+        std::memcpy(p, &r.id, sizeof(idx_t));
+        std::memcpy(p + sizeof(idx_t), &r.distance, sizeof(float));
+        p += item;
+    }
+    return out;
+}
+
+/**
+ * @brief   解码搜索响应
+ * @throws  std::runtime_error 当payload格式错误时
+ */
+inline void decode_search_response(const std::string& payload, uint64_t& request_id,
+                                   std::vector<SearchResult>& results) {
+    const size_t item = sizeof(idx_t) + sizeof(float);
+    int32_t n = 0;
+    if (payload.size() < 12) throw std::runtime_error("Malformed search response");
+    std::memcpy(&request_id, payload.data(), 8);
+    std::memcpy(&n, payload.data() + 8, 4);
+    if (n < 0 || payload.size() != 12 + n * item) throw std::runtime_error("Malformed search response");
+    results.resize(n);
+    const char* p = payload.data() + 12;
+    for (auto& r : results) {
+        std::memcpy(&r.id, p, sizeof(idx_t));
+        std::memcpy(&r.distance, p + sizeof(idx_t), sizeof(float));
+        p += item;
+    }
+}
+
+/**
+ * @brief   编码插入请求：| u64 request_id | i32 dim | float * dim |
+ */
+inline std::string encode_insert_request(uint64_t request_id, std::span<const float> vec) {
+    int32_t dim = static_cast<int32_t>(vec.size());
+    std::string out(12 + vec.size_bytes(), '\0');
+    std::memcpy(out.data(), &request_id, 8);
+    std::memcpy(out.data() + 8, &dim, 4);
+    std::memcpy(out.data() + 12, vec.data(), vec.size_bytes());
+    return out;
+}
+
+/**
+ * @brief   解码插入请求
+ * @throws  std::runtime_error 当payload格式错误时
+ */
+inline void decode_insert_request(const std::string& payload, uint64_t& request_id, std::vector<float>& vec) {
+    int32_t dim = 0;
+    if (payload.size() < 12) throw std::runtime_error("Malformed insert request");
+    std::memcpy(&request_id, payload.data(), 8);
+    std::memcpy(&dim, payload.data() + 8, 4);
+    if (dim <= 0 || payload.size() != 12 + dim * sizeof(float)) throw std::runtime_error("Malformed insert request");
+    vec.resize(dim);
+    std::memcpy(vec.data(), payload.data() + 12, dim * sizeof(float));
+}
+
+/**
+ * @brief   编码插入响应：| u64 request_id | i64 local_id |
+ */
+inline std::string encode_insert_response(uint64_t request_id, idx_t local_id) {
+    std::string out(8 + sizeof(idx_t), '\0');
+    std::memcpy(out.data(), &request_id, 8);
+    std::memcpy(out.data() + 8, &local_id, sizeof(idx_t));
+    return out;
+}
+
+/**
+ * @brief   解码插入响应
+ * @throws  std::runtime_error 当payload格式错误时
+ */
+inline void decode_insert_response(const std::string& payload, uint64_t& request_id, idx_t& local_id) {
+    if (payload.size() != 8 + sizeof(idx_t)) throw std::runtime_error("Malformed insert response");
+    std::memcpy(&request_id, payload.data(), 8);
+    std::memcpy(&local_id, payload.data() + 8, sizeof(idx_t));
+}
+
+/**
+ * @brief   连接到TCP服务端
+ * @return  socket fd，失败返回-1
+ */
+inline int connect_tcp(const std::string& host, int port) {
+    int fd = ::socket(AF_INET, SOCK_STREAM, 0);
+    if (fd < 0) return -1;
+    sockaddr_in addr{};
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(static_cast<uint16_t>(port));
+    if (inet_pton(AF_INET, host.c_str(), &addr.sin_addr) != 1 ||
+        ::connect(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0) {
+        ::close(fd);
+        return -1;
+    }
+    int one = 1;
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+    return fd;
+}
+
+/**
+ * @brief   分片服务端
+ * @details 每个连接一个线程，按帧顺序处理请求；搜索与插入逻辑由外部注入，
+ *          可以是本地IVFIndex、Collection或任何返回SearchResult的函数。
+ *          返回的ID都是分片内的本地ID，由协调节点映射回全局ID。
+ *          连接关闭后其线程在下一次accept时回收
+ */
+class ShardServer {
+public:
+    using SearchFn = std::function<std::vector<SearchResult>(std::span<const float>, int)>;
+    /// 插入函数：写入一个向量并返回其分片内的本地ID
+    using InsertFn = std::function<idx_t(std::span<const float>)>;
+
+    /**
+     * @brief   分片的请求处理函数
+     */
+    struct Handlers {
+        SearchFn search;   ///< 搜索
+        InsertFn insert;   ///< 插入，为空时插入请求返回错误
+    };
+
+    explicit ShardServer(SearchFn search_fn, InsertFn insert_fn = nullptr)
+        : search_fn_(std::move(search_fn)), insert_fn_(std::move(insert_fn)) {}
+
+    explicit ShardServer(Handlers handlers)
+        : ShardServer(std::move(handlers.search), std::move(handlers.insert)) {}
+
+    ~ShardServer() { stop(); }
+
+    ShardServer(const ShardServer&) = delete;
+    ShardServer& operator=(const ShardServer&) = delete;
+
+    /**
+     * @brief   在127.0.0.1上监听并开始服务
+     * @param   port    端口，0表示由系统分配
+     * @return  实际监听的端口
+     * @throws  std::runtime_error 当监听失败时
+     */
+    int start(int port = 0) {
+        listen_fd_ = ::socket(AF_INET, SOCK_STREAM, 0);
+        int one = 1;
+        setsockopt(listen_fd_, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+        sockaddr_in addr{};
+        addr.sin_family = AF_INET;
+        addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        addr.sin_port = htons(static_cast<uint16_t>(port));
+        socklen_t addr_len = sizeof(addr);
+        if (::bind(listen_fd_, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0 ||
+            ::listen(listen_fd_, 128) != 0 ||
+            ::getsockname(listen_fd_, reinterpret_cast<sockaddr*>(&addr), &addr_len) != 0) {
+            ::close(listen_fd_);
+            listen_fd_ = -1;
+            throw std::runtime_error("ShardServer failed to listen");
+        }
+        running_ = true;
+        accept_thread_ = std::thread([this] { accept_loop(); });
+        return ntohs(addr.sin_port);
+    }
+
+    /**
+     * @brief   停止服务，关闭所有连接并等待线程退出
+     */
+    void stop() {
+        if (!running_.exchange(false)) return;
+        ::shutdown(listen_fd_, SHUT_RDWR);
+        ::close(listen_fd_);
+        if (accept_thread_.joinable()) accept_thread_.join();
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            for (auto& client : clients_) {
+                if (!client.finished) ::shutdown(client.fd, SHUT_RDWR);
+            }
+        }
+        // accept线程已退出，不会再有新连接加入；服务线程结束时会获取mutex_，不能持锁join
+        for (auto& client : clients_) {
+            if (client.thread.joinable()) client.thread.join();
+        }
+        clients_.clear();
+    }
+
+    /**
+     * @brief   阻塞直到服务停止（供分片进程的main使用）
+     */
+    void wait() {
+        if (accept_thread_.joinable()) accept_thread_.join();
+    }
+
+    /**
+     * @brief   尚未回收的连接线程数
+     */
+    size_t client_threads() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return clients_.size();
+    }
+
+private:
+    /**
+     * @brief   一个客户端连接及其服务线程
+     */
+    struct Client {
+        int fd = -1;
+        std::thread thread;
+        bool finished = false;  ///< serve已返回且fd已移交关闭，可以join
+    };
+
+    SearchFn search_fn_;
+    InsertFn insert_fn_;
+    int listen_fd_ = -1;
+    std::atomic<bool> running_{false};
+    std::thread accept_thread_;
+    std::mutex mutex_;
+    std::list<Client> clients_;   ///< list保证迭代器在增删其他元素时不失效
+
+    void accept_loop() {
+        while (running_) {
+            int fd = ::accept(listen_fd_, nullptr, nullptr);
+            if (fd < 0) {
+                if (!running_) break;
+                continue;
+            }
+            int one = 1;
+            setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+            std::lock_guard<std::mutex> lock(mutex_);
+            reap_finished();
+            auto it = clients_.emplace(clients_.end());
+            it->fd = fd;
+            it->thread = std::thread([this, it] { serve(it); });
+        }
+    }
+
+    /// 回收已结束的连接线程，调用方需持有mutex_
+    void reap_finished() {
+        for (auto it = clients_.begin(); it != clients_.end();) {
+            if (!it->finished) {
+                ++it;
+                continue;
+            }
+            it->thread.join();
+            it = clients_.erase(it);
+        }
+    }
+
+    void serve(std::list<Client>::iterator client) {
+        const int fd = client->fd;
+        MessageType type;
+        std::string payload;
+        std::vector<float> query;
+        while (recv_frame(fd, type, payload)) {
+            if (type != MessageType::SearchRequest && !(type == MessageType::InsertRequest && insert_fn_)) {
+                send_frame(fd, MessageType::Error, "unsupported message type");
+                continue;
+            }
+            uint64_t request_id = 0;
+            int k = 0;
+            try {
+                bool sent;
+                if (type == MessageType::InsertRequest) {
+                    decode_insert_request(payload, request_id, query);
+                    idx_t local_id = insert_fn_(query);
+                    sent = send_frame(fd, MessageType::InsertResponse, encode_insert_response(request_id, local_id));
+                } else {
+                    decode_search_request(payload, request_id, k, query);
+                    auto results = search_fn_(query, k);
+                    sent = send_frame(fd, MessageType::SearchResponse, encode_search_response(request_id, results));
+                }
+                if (!sent) break;
+            } catch (const std::exception& e) {
+                if (!send_frame(fd, MessageType::Error, e.what())) break;
+            }
+        }
+        // 先标记结束再关闭，避免stop()对已复用的fd执行shutdown
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            client->finished = true;
+        }
+        ::close(fd);
+    }
+};
+
+} // namespace minimilvus
@@ -8,9 +8,13 @@
 
 #pragma once
 
+#include <atomic>
 #include <mutex>
 #include <condition_variable>
 #include <shared_mutex>
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#endif
 
 namespace minimilvus {
 
@@ -248,4 +252,40 @@ private:
     std::shared_mutex mtx_;  ///< C++17 标准库的读写锁
 };
 
+
+// ============================================================
+// 自旋锁：保护极短临界区（如图节点的邻居表）
+// ============================================================
+
+/**
+ * @brief   单字节自旋锁
+ * @details 满足BasicLockable，可配合std::lock_guard使用；
+ *          只占1字节，适合按节点分配上百万把锁的场景，临界区必须很短
+ */
+class SpinLock {
+public:
+    SpinLock() = default;
+
+    SpinLock(const SpinLock&) = delete;
+    SpinLock& operator=(const SpinLock&) = delete;
+
+    void lock() {
+        while (flag_.test_and_set(std::memory_order_acquire)) {
+            // 先只读等待，避免在缓存行上反复做写操作
+            while (flag_.test(std::memory_order_relaxed)) {
+#if defined(__x86_64__) || defined(__i386__)
+                _mm_pause();
+#endif
+            }
+        }
+    }
+
+    bool try_lock() { return !flag_.test_and_set(std::memory_order_acquire); }
+
+    void unlock() { flag_.clear(std::memory_order_release); }
+
+private:
+    std::atomic_flag flag_;
+};
+
 }  // namespace minimilvus
\ No newline at end of file
@@ -0,0 +1,238 @@
+/**
+ * @file    task.hpp
+ * @brief   C++20协程任务类型
+ * @details Task<T>是惰性启动的协程：被co_await时才开始执行，结束时通过对称转移恢复等待者；
+ *          spawn分离执行一个任务，sync_wait在普通线程中阻塞等待任务结果，
+ *          resume_on把协程的后续部分转移到线程池执行
+ * @author  Tyooughtul
+ */
+
+#pragma once
+#include <coroutine>
+#include <exception>
+#include <optional>
+#include <utility>
+#include <mutex>
+#include <condition_variable>
+#include <iostream>
+#include "thread_pool.hpp"
+
+namespace minimilvus {
+
+template<typename T = void>
+class Task;
+
+namespace detail {
+
+/**
+ * @brief   Task的promise公共部分
+ */
+struct TaskPromiseBase {
+    std::coroutine_handle<> continuation = std::noop_coroutine();   ///< 结束后恢复的协程
+    std::exception_ptr exception;
+
+    /// 结束时直接转移到等待者，不经过调度器，也不增加栈深度
+    struct FinalAwaiter {
+        bool await_ready() noexcept { return false; }
+        template<typename Promise>
+        std::coroutine_handle<> await_suspend(std::coroutine_handle<Promise> handle) noexcept {
+            return handle.promise().continuation;
+        }
+        void await_resume() noexcept {}
+    };
+
+    std::suspend_always initial_suspend() noexcept { return {}; }
+    FinalAwaiter final_suspend() noexcept { return {}; }
+    void unhandled_exception() { exception = std::current_exception(); }
+};
+
+template<typename T>
+struct TaskPromise : TaskPromiseBase {
+    std::optional<T> value;
+
+    Task<T> get_return_object();
+
+    template<typename U>
+    void return_value(U&& v) { value.emplace(std::forward<U>(v)); }
+
+    T result() {
+        if (exception) std::rethrow_exception(exception);
+        return std::move(*value);
+    }
+};
+
+template<>
+struct TaskPromise<void> : TaskPromiseBase {
+    Task<void> get_return_object();
+    void return_void() {}
+
+    void result() {
+        if (exception) std::rethrow_exception(exception);
+    }
+};
+
+/**
+ * @brief   立即执行、结束后自行销毁的协程，用于spawn和sync_wait的外层
+ */
+struct DetachedTask {
+    struct promise_type {
+        DetachedTask get_return_object() { return {}; }
+        std::suspend_never initial_suspend() noexcept { return {}; }
+        std::suspend_never final_suspend() noexcept { return {}; }
+        void return_void() {}
+        void unhandled_exception() { std::terminate(); }
+    };
+};
+
+} // namespace detail
+
+/**
+ * @brief   协程任务
+ * @tparam  T   结果类型
+ * @details 任务对象拥有协程帧；co_await一个Task会启动它并在其完成后得到结果（或重新抛出异常）
+ */
+template<typename T>
+class [[nodiscard]] Task {
+public:
+    using promise_type = detail::TaskPromise<T>;
+
+    explicit Task(std::coroutine_handle<promise_type> handle) : handle_(handle) {}
+
+    Task(Task&& other) noexcept : handle_(std::exchange(other.handle_, {})) {}
+
+    Task& operator=(Task&& other) noexcept {
+        if (this != &other) {
+            if (handle_) handle_.destroy();
+            handle_ = std::exchange(other.handle_, {});
+        }
+        return *this;
+    }
+
+    ~Task() {
+        if (handle_) handle_.destroy();
+    }
+
+    Task(const Task&) = delete;
+    Task& operator=(const Task&) = delete;
+
+    auto operator co_await() noexcept {
+        struct Awaiter {
+            std::coroutine_handle<promise_type> handle;
+
+            bool await_ready() const noexcept { return handle.done(); }
+
+            std::coroutine_handle<> await_suspend(std::coroutine_handle<> awaiting) noexcept {
+                handle.promise().continuation = awaiting;
+                return handle;
+            }
+
+            T await_resume() { return handle.promise().result(); }
+        };
+        return Awaiter{handle_};
+    }
+
+    /**
+     * @brief   任务是否已执行完
+     */
+    bool done() const { return !handle_ || handle_.done(); }
+
+private:
+    std::coroutine_handle<promise_type> handle_;
+};
+
+namespace detail {
+
+template<typename T>
+Task<T> TaskPromise<T>::get_return_object() {
+    return Task<T>{std::coroutine_handle<TaskPromise<T>>::from_promise(*this)};
+}
+
+inline Task<void> TaskPromise<void>::get_return_object() {
+    return Task<void>{std::coroutine_handle<TaskPromise<void>>::from_promise(*this)};
+}
+
+inline DetachedTask run_detached(Task<void> task) {
+    try {
+        co_await task;
+    } catch (const std::exception& e) {
+        std::cerr << "Detached task failed: " << e.what() << std::endl;
+    }
+}
+
+template<typename T>
+struct SyncWaitState {
+    std::mutex mutex;
+    std::condition_variable cv;
+    bool done = false;
+    std::optional<T> value;
+    std::exception_ptr exception;
+};
+
+template<>
+struct SyncWaitState<void> {
+    std::mutex mutex;
+    std::condition_variable cv;
+    bool done = false;
+    std::exception_ptr exception;
+};
+
+template<typename T>
+DetachedTask run_sync_wait(Task<T>& task, SyncWaitState<T>& state) {
+    try {
+        if constexpr (std::is_void_v<T>) {
+            co_await task;
+        } else {
+            state.value.emplace(co_await task);
+        }
+    } catch (...) {
+        state.exception = std::current_exception();
+    }
+    std::lock_guard<std::mutex> lock(state.mutex);
+    state.done = true;
+    state.cv.notify_all();
+}
+
+} // namespace detail
+
+/**
+ * @brief   分离执行一个任务
+ * @param   task    任务，在当前线程启动，直到第一次挂起
+ * @note    任务的协程帧在结束时自动释放，未捕获的异常打印到标准错误
+ */
+inline void spawn(Task<void> task) {
+    detail::run_detached(std::move(task));
+}
+
+/**
+ * @brief   阻塞当前线程直到任务完成
+ * @return  任务结果
+ * @note    不能在事件循环线程中调用，否则该循环上挂起的任务永远不会被恢复
+ */
+template<typename T>
+T sync_wait(Task<T> task) {
+    detail::SyncWaitState<T> state;
+    detail::run_sync_wait(task, state);
+    std::unique_lock<std::mutex> lock(state.mutex);
+    state.cv.wait(lock, [&] { return state.done; });
+    if (state.exception) std::rethrow_exception(state.exception);
+    if constexpr (!std::is_void_v<T>) return std::move(*state.value);
+}
+
+/**
+ * @brief   将当前协程转移到线程池中继续执行
+ * @details 用于在事件循环中把CPU密集的搜索卸载到工作线程：
+ *          co_await resume_on(pool) 之后的代码运行在线程池的某个线程上
+ */
+inline auto resume_on(ThreadPool& pool) {
+    struct Awaiter {
+        ThreadPool& pool;
+        bool await_ready() const noexcept { return false; }
+        void await_suspend(std::coroutine_handle<> handle) {
+            pool.post([handle] { handle.resume(); });
+        }
+        void await_resume() const noexcept {}
+    };
+    return Awaiter{pool};
+}
+
+} // namespace minimilvus
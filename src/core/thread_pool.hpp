@@ -1,108 +1,295 @@
 /**
  * @file    thread_pool.hpp
  * @brief   线程池实现
- * @details 提供高效的并行任务执行，支持工作窃取负载均衡
+ * @details 提供高效的并行任务执行，任务通过有界无锁MPMC队列分发；
+ *          工作线程数可在运行时增减，并暴露队列深度与利用率供调度决策
  * @author  Tyooughtul
  */
 
- #pragma once
+#pragma once
 
- #include <vector>
- #include <queue>
- #include <memory>
- #include <thread>
- #include <mutex>
- #include <condition_variable>
- #include <functional>
- #include <atomic>
- #include <optional>
+#include <vector>
+#include <memory>
+#include <thread>
+#include <functional>
+#include <atomic>
+#include <chrono>
+#include <future>
+#include <mutex>
+#include <type_traits>
+#include <algorithm>
+#include <stdexcept>
+#include "mpmc_queue.hpp"
+#include "cpu_affinity.hpp"
+
+namespace minimilvus {
+
+/**
+ * @brief   线程池运行指标
+ */
+struct ThreadPoolStats {
+    int num_threads = 0;            ///< 目标工作线程数
+    int busy_threads = 0;           ///< 正在执行任务的线程数
+    size_t queue_depth = 0;         ///< 等待执行的任务数
+    size_t queue_capacity = 0;
+    uint64_t tasks_completed = 0;   ///< 累计完成的任务数
+    uint64_t tasks_failed = 0;      ///< 其中抛出异常的post任务数
+    double utilization = 0.0;       ///< 自上次stats()以来的利用率：任务执行时间 / (墙钟时间 × 线程数)
+};
 
- namespace minimilvus {
 /**
  * @brief   线程池类
- * @details 预先创建一组工作线程，任务通过队列分发
- *          支持工作窃取，以实现负载均衡
+ * @details 预先创建一组工作线程，任务通过队列分发；
+ *          提交和取任务走无锁快路径，只有队列空（工作线程）或满（提交方）时才休眠。
+ *          缩容时向队列投递退出令牌，排在已提交任务之后，领到令牌的线程执行完手头任务后退出
  */
+class ThreadPool {
+public:
+    /// 默认任务队列容量
+    static constexpr size_t kDefaultQueueCapacity = 1 << 16;
 
- class ThreadPool {
- public:
- explic ThreadPool(int num_threads = 0) {
-    if (num_threads == 0) {
-        num_threads = static_cast<int>(std::thread::hardware_concurrency());
-    }
-    if (num_threads <= 0) num_threads = 1;
-    num_threads_ = num_threads;
-    for(int i = 0; i < num_threads_; i++) {
-        workers_.emplace_back([this]{ worker_loop(); });
+    /**
+     * @brief   构造函数
+     * @param   num_threads     工作线程数，0表示按cgroup配额和CPU亲和性取实际可用核数
+     * @param   queue_capacity  任务队列容量，队列满时submit等待
+     * @param   affinity        绑核方案，第i个工作线程启动时绑定到affinity.for_thread(i)
+     */
+    explicit ThreadPool(int num_threads = 0, size_t queue_capacity = kDefaultQueueCapacity,
+                        AffinityPlan affinity = {})
+        : tasks_(queue_capacity), affinity_(std::move(affinity)),
+          last_sample_time_(std::chrono::steady_clock::now()) {
+        resize(num_threads);
     }
- }
- 
- ~ThreadPool() {
-    running_ = false;
-    cv_task_.notify_all();
-    for(auto& worker: workers_) {
-        if (worker.joinable()) {
-            worker.join();
+
+    /**
+     * @brief   析构函数
+     * @note    已提交的任务会先执行完再退出
+     */
+    ~ThreadPool() {
+        tasks_.close();
+        std::lock_guard<std::mutex> lock(resize_mutex_);
+        for (auto& worker : workers_) {
+            if (worker->thread.joinable()) {
+                worker->thread.join();
+            }
         }
     }
- }
-
- ThreadPool(const ThreadPool&) = delete;
- ThreadPool& operator=(const ThreadPool&) = delete;
- 
- template<typename F,typename... Args>
- auto submit(F&&, Args... args) -> std::future<decltype(f(args...))> {
-    using ReturnType = decltype(f(args...));
-    auto task_ptr = std::make_shared<std::packaged_task<ReturnType()>>(std::bind(std::forward<F>f,std::forward<Args>(args)...));
-    std::function<void()> wrapper = [task_ptr]() {
-            (*task_ptr)(); 
-        };
-        push_task(wrapper);
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    /**
+     * @brief   提交任务
+     * @return  任务结果的future
+     * @note    队列满时阻塞等待空位；在工作线程内提交大量任务可能因此互相等待
+     */
+    template<typename F, typename... Args>
+    auto submit(F&& f, Args&&... args) -> std::future<std::invoke_result_t<F, Args...>> {
+        using ReturnType = std::invoke_result_t<F, Args...>;
+        auto task_ptr = std::make_shared<std::packaged_task<ReturnType()>>(
+            std::bind(std::forward<F>(f), std::forward<Args>(args)...));
+        push_task([task_ptr]() { (*task_ptr)(); });
         return task_ptr->get_future();
- }
- 
- size_t task_count() const {
-        std::lock_guard<std::mutex> lock(mutex_);
-        return tasks_.size();
     }
 
- private:
-    std::vector<<std::thread> workers_;
-    std::queue<tsd::function<void()>> tasks_;
-    mutable std::mutex mutex_;
-    std::condition_variable cv_task_;
-    std::atomic<bool> running_ {true};
-    int num_threads_;
+    /**
+     * @brief   提交不需要返回值的任务
+     * @note    不创建packaged_task和future，适合恢复协程等高频小任务；
+     *          任务抛出的异常由工作线程吞掉并计入stats().tasks_failed，不会终止进程
+     * @throws  std::invalid_argument 当task为空时
+     */
+    void post(std::function<void()> task) {
+        if (!task) throw std::invalid_argument("ThreadPool::post requires a callable");
+        push_task(std::move(task));
+    }
+
+    /**
+     * @brief   调整工作线程数
+     * @param   num_threads     目标线程数，0表示按effective_cpu_count()
+     * @details 扩容立即启动新线程；缩容投递退出令牌后即返回，
+     *          多余线程在执行完排在令牌之前的任务后退出，并在下次resize或析构时回收
+     * @note    缩容时队列满会等待空位
+     */
+    void resize(int num_threads) {
+        if (num_threads <= 0) num_threads = effective_cpu_count();
+        std::lock_guard<std::mutex> lock(resize_mutex_);
+        if (tasks_.closed()) throw std::runtime_error("ThreadPool is shutting down");
+        reap_exited();
+        int current = num_threads_.load(std::memory_order_relaxed);
+        for (int i = current; i < num_threads; ++i) {
+            auto worker = std::make_unique<Worker>();
+            worker->index = acquire_slot();
+            Worker* self = worker.get();
+            worker->thread = std::thread([this, self] {
+                affinity_.apply(self->index);
+                worker_loop(self);
+            });
+            workers_.push_back(std::move(worker));
+        }
+        for (int i = num_threads; i < current; ++i) {
+            tasks_.push(std::function<void()>());
+        }
+        num_threads_.store(num_threads, std::memory_order_relaxed);
+    }
+
+    /**
+     * @brief   按当前cgroup配额重新调整线程数
+     * @return  调整后的线程数
+     * @note    容器的CPU配额在运行时变化后调用
+     */
+    int resize_to_cpu_quota() {
+        int n = effective_cpu_count();
+        resize(n);
+        return n;
+    }
+
+    /**
+     * @brief   队列中等待执行的任务数
+     */
+    size_t task_count() const {
+        return tasks_.size_approx();
+    }
+
+    /**
+     * @brief   工作线程数（缩容时为目标值，多余线程可能仍在退出中）
+     */
+    int num_threads() const { return num_threads_.load(std::memory_order_relaxed); }
+
+    /**
+     * @brief   采样运行指标
+     * @note    utilization统计的是与上一次调用之间的区间，监控方应按固定周期调用
+     */
+    ThreadPoolStats stats() {
+        ThreadPoolStats s;
+        s.num_threads = num_threads();
+        s.busy_threads = busy_threads_.load(std::memory_order_relaxed);
+        s.queue_depth = tasks_.size_approx();
+        s.queue_capacity = tasks_.capacity();
+        s.tasks_completed = tasks_completed_.load(std::memory_order_relaxed);
+        s.tasks_failed = tasks_failed_.load(std::memory_order_relaxed);
+
+        std::lock_guard<std::mutex> lock(stats_mutex_);
+        auto now = std::chrono::steady_clock::now();
+        uint64_t busy_ns = busy_ns_.load(std::memory_order_relaxed);
+        double wall_ns = std::chrono::duration<double, std::nano>(now - last_sample_time_).count();
+        if (wall_ns > 0 && s.num_threads > 0) {
+            s.utilization = std::min(1.0, (busy_ns - last_busy_ns_) / (wall_ns * s.num_threads));
+        }
+        last_sample_time_ = now;
+        last_busy_ns_ = busy_ns;
+        return s;
+    }
+
+    /**
+     * @brief   绑核方案
+     */
+    const AffinityPlan& affinity() const { return affinity_; }
+
+private:
+    struct Worker {
+        std::thread thread;
+        size_t index = 0;                   ///< 绑核槽位，退出时归还
+        std::atomic<bool> exited{false};
+    };
+
+    BlockingMPMCQueue<std::function<void()>> tasks_;   ///< 空函数为退出令牌
+    AffinityPlan affinity_;
+    std::mutex resize_mutex_;                           ///< 保护workers_
+    std::vector<std::unique_ptr<Worker>> workers_;
+    std::mutex slot_mutex_;                             ///< 保护槽位分配（叶子锁，工作线程退出时获取）
+    std::vector<size_t> free_slots_;                    ///< 已退出线程归还的槽位
+    size_t next_slot_ = 0;
+    std::atomic<int> num_threads_{0};
+
+    std::atomic<int> busy_threads_{0};
+    std::atomic<uint64_t> tasks_completed_{0};
+    std::atomic<uint64_t> tasks_failed_{0};
+    std::atomic<uint64_t> busy_ns_{0};
+    std::mutex stats_mutex_;
+    std::chrono::steady_clock::time_point last_sample_time_;
+    uint64_t last_busy_ns_ = 0;
 
     void push_task(std::function<void()> task) {
-        {
-            std::lock_guard<std::mutex> lock(mutex_);
-            tasks_.push(std::move(task));
+        if (!tasks_.push(std::move(task))) {
+            throw std::runtime_error("ThreadPool is shutting down");
         }
-        cv_task_.notify_one();
     }
-    void worker_loop() {
-        while(running_) {
-            std::optional<std::function<void()>> = tasks_.pop_task();
-            if (task.has_value()) {
-                task.value()();
+
+    /**
+     * @brief   为新线程分配绑核槽位
+     * @details 优先复用已退出线程归还的最小槽位，缩容后再扩容时
+     *          新线程按 for_thread(index) 落在空出的核上，而不是与存活线程叠在同一个核
+     */
+    size_t acquire_slot() {
+        std::lock_guard<std::mutex> lock(slot_mutex_);
+        if (free_slots_.empty()) return next_slot_++;
+        auto it = std::min_element(free_slots_.begin(), free_slots_.end());
+        size_t slot = *it;
+        free_slots_.erase(it);
+        return slot;
+    }
+
+    void release_slot(size_t slot) {
+        std::lock_guard<std::mutex> lock(slot_mutex_);
+        free_slots_.push_back(slot);
+    }
+
+    /**
+     * @brief   回收已退出的工作线程，调用方需持有resize_mutex_
+     */
+    void reap_exited() {
+        for (auto it = workers_.begin(); it != workers_.end();) {
+            if ((*it)->exited.load(std::memory_order_acquire)) {
+                (*it)->thread.join();
+                it = workers_.erase(it);
+            } else {
+                ++it;
             }
         }
     }
 
-    std::optional<std::function<void()>> pop_task() {
-        std::unique_lock<std::mutex> lock(mutex_);
-        cv_task_.wait(lock, [this] {
-            return !running_ || !tasks_.empty();
-        })
-        if(!running_ || tasks_.empty()) {
-            return std::nullopt;
+    /**
+     * @brief   工作线程主循环
+     * @details 连续取到任务的一段时间记为忙碌，每个任务结束只读一次时钟；
+     *          队列取空时结算并进入阻塞等待，避免高频小任务为统计付出两次计时开销
+     * @note    队列关闭后先执行完剩余任务再退出；取到退出令牌时立即退出
+     */
+    void worker_loop(Worker* self) {
+        using Clock = std::chrono::steady_clock;
+        std::function<void()> task;
+        bool busy = false;
+        Clock::time_point last = {};
+        while (true) {
+            if (!tasks_.try_pop(task)) {
+                if (busy) {
+                    busy = false;
+                    busy_threads_.fetch_sub(1, std::memory_order_relaxed);
+                }
+                if (!tasks_.pop(task)) break;
+            }
+            if (!task) break;
+            if (!busy) {
+                busy = true;
+                busy_threads_.fetch_add(1, std::memory_order_relaxed);
+                last = Clock::now();
+            }
+            try {
+                task();
+            } catch (...) {
+                // submit的任务异常已存入future；这里只会是post的任务，吞掉以免终止进程
+                tasks_failed_.fetch_add(1, std::memory_order_relaxed);
+            }
+            task = nullptr;
+            auto now = Clock::now();
+            busy_ns_.fetch_add(std::chrono::duration_cast<std::chrono::nanoseconds>(now - last).count(),
+                               std::memory_order_relaxed);
+            last = now;
+            tasks_completed_.fetch_add(1, std::memory_order_relaxed);
         }
-        auto task = std::move(tasks_.front());
-        tasks_.pop();
-        return task;
+        if (busy) busy_threads_.fetch_sub(1, std::memory_order_relaxed);
+        release_slot(self->index);
+        self->exited.store(true, std::memory_order_release);
     }
+};
 
- };
-
- }
\ No newline at end of file
+} // namespace minimilvus
@@ -0,0 +1,451 @@
+/**
+ * @file    tiered_ivf.hpp
+ * @brief   冷热分层的IVF索引
+ * @details 查询分布高度倾斜时，少数桶承担了大部分扫描。所有桶常驻SQ8编码（冷层），
+ *          访问频率高的桶额外在内存中保存全精度向量（热层），扫描时用精确距离；
+ *          全精度向量的来源是磁盘上的VectorDataset文件，晋升时批量读盘，降级时直接释放。
+ *          热层总字节数受预算约束，重平衡按衰减后的访问频率贪心选择热桶
+ * @author  Tyooughtul
+ */
+
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <numeric>
+#include <queue>
+#include <string>
+#include <thread>
+#include <vector>
+#include "access_tracker.hpp"
+#include "codecs.hpp"
+#include "ivf_index.hpp"
+#include "kmeans.hpp"
+#include "rwlock.hpp"
+#include "uring_storage.hpp"
+
+namespace minimilvus {
+
+/**
+ * @brief   分层配置
+ */
+struct TieredConfig {
+    size_t hot_budget_bytes = size_t(256) << 20;    ///< 热层全精度向量的内存预算
+    double decay = 0.5;                             ///< 每次重平衡时历史频率的衰减系数
+    int64_t rebalance_interval = 0;                 ///< 每多少次查询由后台线程重平衡一次，0为只手动
+};
+
+/**
+ * @brief   分层状态统计
+ */
+struct TierStats {
+    int hot_lists = 0;
+    int cold_lists = 0;
+    size_t hot_bytes = 0;           ///< 热层全精度向量占用
+    size_t budget_bytes = 0;
+    uint64_t promotions = 0;        ///< 累计晋升次数
+    uint64_t demotions = 0;         ///< 累计降级次数
+    uint64_t rebalances = 0;
+};
+
+/**
+ * @brief   冷热分层IVF
+ * @tparam  Metric  L2Metric / IPMetric
+ * @details 搜索可并发执行，与add、重平衡之间由读写锁保护；
+ *          重平衡在读锁下读盘，只在替换桶内容时短暂持有写锁。train不能与搜索并发。
+ *          配置了rebalance_interval时由维护线程执行自动重平衡，查询线程只负责唤醒它
+ */
+template<typename Metric = L2Metric>
+class TieredIVF {
+public:
+    /**
+     * @brief   构造函数
+     * @param   dim             向量维度
+     * @param   n_lists         桶数量
+     * @param   vectors_path    VectorDataset::save写出的文件，第i行为ID i的全精度向量
+     * @param   config          分层配置
+     * @param   ring            读盘使用的io_uring，为空时使用pread
+     * @throws  std::invalid_argument 当参数非法或文件维度不符时
+     * @throws  std::runtime_error 当向量文件无法打开时
+     */
+    TieredIVF(int dim, int n_lists, const std::string& vectors_path, TieredConfig config = {},
+              IoUring* ring = nullptr)
+        : dim_(dim), n_lists_(n_lists), kmeans_(n_lists, 5, dim), codec_(dim), config_(config),
+          file_(std::make_unique<VectorFile>(vectors_path, ring)), access_(n_lists), lists_(n_lists) {
+        if (dim <= 0 || n_lists <= 0) throw std::invalid_argument("IVF dim and n_lists must be positive");
+        if (file_->get_dim() != dim) throw std::invalid_argument("Vector file dimension does not match index");
+        if (config_.decay < 0.0 || config_.decay >= 1.0) throw std::invalid_argument("Decay factor must be in [0, 1)");
+        kmeans_.set_verbose(false);
+        if (config_.rebalance_interval > 0) maintenance_thread_ = std::thread([this] { maintenance_loop(); });
+    }
+
+    ~TieredIVF() {
+        {
+            std::lock_guard<std::mutex> lock(maintenance_mutex_);
+            maintenance_stop_ = true;
+        }
+        maintenance_cv_.notify_all();
+        if (maintenance_thread_.joinable()) maintenance_thread_.join();
+    }
+
+    TieredIVF(const TieredIVF&) = delete;
+    TieredIVF& operator=(const TieredIVF&) = delete;
+
+    /**
+     * @brief   训练桶中心和冷层SQ8编码器，清空所有桶
+     */
+    void train(const VectorDataset& dataset) {
+        StdRWLock::WriteLock lock(lock_);
+        kmeans_.train(dataset);
+        codec_.train(dataset);
+        lists_.assign(n_lists_, List{});
+        access_.reset(n_lists_);
+        trained_ = true;
+    }
+
+    /**
+     * @brief   加入一批向量，第i个向量的ID为 first_id + i
+     * @throws  std::logic_error 当索引尚未训练时
+     * @throws  std::out_of_range 当ID超出向量文件的行数时
+     * @note    新向量进入热桶时同时写入全精度副本，热层可能暂时超出预算，下次重平衡时纠正
+     */
+    void add(const VectorDataset& dataset, idx_t first_id = 0) {
+        if (!trained_) throw std::logic_error("IVF index is not trained");
+        if (first_id < 0 || first_id + dataset.get_count() > file_->get_count()) {
+            throw std::out_of_range("Vector ids exceed the vector file");
+        }
+        const size_t cs = codec_.code_size();
+        std::vector<int> assignments(dataset.get_count());
+        std::vector<uint8_t> codes(dataset.get_count() * cs);
+        #pragma omp parallel for
+        for (idx_t i = 0; i < dataset.get_count(); ++i) {
+            auto vec = dataset.get_vector(i);
+            assignments[i] = nearest_list(vec);
+            codec_.encode(vec, codes.data() + i * cs);
+        }
+        StdRWLock::WriteLock lock(lock_);
+        for (idx_t i = 0; i < dataset.get_count(); ++i) {
+            List& list = lists_[assignments[i]];
+            list.ids.push_back(first_id + i);
+            list.codes.insert(list.codes.end(), codes.begin() + i * cs, codes.begin() + (i + 1) * cs);
+            if (list.hot) {
+                auto vec = dataset.get_vector(i);
+                list.vectors.insert(list.vectors.end(), vec.begin(), vec.end());
+            }
+        }
+        ntotal_ += dataset.get_count();
+    }
+
+    /**
+     * @brief   训练并加入数据集中全部向量（ID为行号）
+     */
+    void build(const VectorDataset& dataset) {
+        train(dataset);
+        add(dataset);
+    }
+
+    /**
+     * @brief   搜索最近邻
+     * @return  按距离升序的结果；热桶中的结果为精确距离，冷桶中的为SQ8近似距离
+     * @note    可并发调用；配置了rebalance_interval时，每第interval次查询唤醒维护线程重平衡，
+     *          查询本身不等待读盘和写锁
+     */
+    std::vector<SearchResult> search(std::span<const float> query, int k, int nprobe = 16,
+                                     QueryProfile* profile = nullptr) {
+        if (!trained_ || k <= 0) return {};
+        const auto& centroids = kmeans_.get_centroids();
+        std::vector<std::pair<float, int>> clusters_scores(n_lists_);
+        {
+            ScopedStageTimer timer(profile, ProfileStage::CentroidScoring);
+            for (int c = 0; c < n_lists_; ++c) {
+                std::span<const float> center(centroids.data() + static_cast<size_t>(c) * dim_, dim_);
+                clusters_scores[c] = {Metric::distance(query, center), c};
+            }
+            if (profile) profile->centroids_scored += n_lists_;
+        }
+        nprobe = std::clamp(nprobe, 1, n_lists_);
+        {
+            ScopedStageTimer timer(profile, ProfileStage::ProbeSelection);
+            std::partial_sort(clusters_scores.begin(), clusters_scores.begin() + nprobe, clusters_scores.end());
+        }
+
+        std::priority_queue<SearchResult> heap;
+        // 入堆与扫描交错，整体计入BucketScan，只统计入堆次数
+        int64_t heap_pushes = 0;
+        auto push = [&](idx_t id, float dist) {
+            bool full = heap.size() >= static_cast<size_t>(k);
+            if (full && dist >= heap.top().distance) return;
+            if (full) heap.pop();
+            heap.push({id, dist});
+            heap_pushes++;
+        };
+        int64_t scanned = 0;
+        {
+            ScopedStageTimer timer(profile, ProfileStage::BucketScan);
+            StdRWLock::ReadLock lock(lock_);
+            auto scanner = codec_.template scanner<Metric>(query);
+            const size_t cs = codec_.code_size();
+            for (int p = 0; p < nprobe; ++p) {
+                int c = clusters_scores[p].second;
+                access_.record(c);
+                const List& list = lists_[c];
+                if (list.hot) {
+                    for (size_t i = 0; i < list.ids.size(); ++i) {
+                        std::span<const float> vec(list.vectors.data() + i * dim_, dim_);
+                        push(list.ids[i], Metric::distance(query, vec));
+                    }
+                } else {
+                    for (size_t i = 0; i < list.ids.size(); ++i) push(list.ids[i], scanner(list.codes.data() + i * cs));
+                }
+                scanned += list.ids.size();
+            }
+        }
+        if (profile) {
+            profile->buckets_probed += nprobe;
+            profile->vectors_scanned += scanned;
+            profile->heap_pushes += heap_pushes;
+        }
+
+        std::vector<SearchResult> results(heap.size());
+        {
+            ScopedStageTimer timer(profile, ProfileStage::TopK);
+            for (size_t i = results.size(); i-- > 0;) {
+                results[i] = heap.top();
+                heap.pop();
+            }
+            if (profile) profile->results_returned += results.size();
+        }
+
+        if (config_.rebalance_interval > 0 &&
+            (queries_.fetch_add(1, std::memory_order_relaxed) + 1) % config_.rebalance_interval == 0) {
+            {
+                std::lock_guard<std::mutex> lock(maintenance_mutex_);
+                rebalance_pending_ = true;
+            }
+            maintenance_cv_.notify_all();
+        }
+        return results;
+    }
+
+    /**
+     * @brief   按访问频率重新划分冷热层
+     * @return  本次晋升与降级的桶数之和
+     * @details 衰减访问频率后，按 频率 / 全精度字节数 从高到低贪心选择热桶直到预算用完
+     *          （同样的内存优先给单位字节访问最多的桶）；新晋升的桶在读锁下一次批量读盘，
+     *          随后在写锁下替换。读盘期间若桶被add改变，该桶本轮不晋升
+     */
+    int rebalance() {
+        std::lock_guard<std::mutex> guard(rebalance_mutex_);
+        std::vector<double> scores = access_.decay(config_.decay);
+
+        std::vector<int> order(n_lists_);
+        std::vector<bool> want_hot(n_lists_, false);
+        std::vector<int> promote;
+        std::vector<idx_t> fetch_ids;
+        std::vector<size_t> fetch_sizes;
+        {
+            StdRWLock::ReadLock lock(lock_);
+            std::iota(order.begin(), order.end(), 0);
+            auto density = [&](int c) {
+                return scores[c] / static_cast<double>(std::max<size_t>(1, lists_[c].ids.size()));
+            };
+            std::stable_sort(order.begin(), order.end(), [&](int a, int b) { return density(a) > density(b); });
+            size_t used = 0;
+            for (int c : order) {
+                if (scores[c] <= 0.0) break;
+                if (lists_[c].ids.empty()) continue;
+                size_t bytes = vector_bytes(lists_[c].ids.size());
+                if (used + bytes > config_.hot_budget_bytes) continue;
+                used += bytes;
+                want_hot[c] = true;
+                if (!lists_[c].hot) {
+                    promote.push_back(c);
+                    fetch_ids.insert(fetch_ids.end(), lists_[c].ids.begin(), lists_[c].ids.end());
+                    fetch_sizes.push_back(lists_[c].ids.size());
+                }
+            }
+        }
+
+        // 所有晋升桶的向量一次提交读取
+        std::vector<float> fetched(fetch_ids.size() * dim_);
+        if (!fetch_ids.empty()) file_->fetch(fetch_ids, fetched);
+
+        StdRWLock::WriteLock lock(lock_);
+        int changes = 0;
+        for (int c = 0; c < n_lists_; ++c) {
+            if (lists_[c].hot && !want_hot[c]) {
+                lists_[c].hot = false;
+                std::vector<float>().swap(lists_[c].vectors);
+                demotions_++;
+                changes++;
+            }
+        }
+        size_t offset = 0;
+        for (size_t i = 0; i < promote.size(); ++i) {
+            List& list = lists_[promote[i]];
+            size_t n = fetch_sizes[i];
+            if (list.ids.size() == n && !list.hot) {
+                list.vectors.assign(fetched.begin() + offset * dim_, fetched.begin() + (offset + n) * dim_);
+                list.hot = true;
+                promotions_++;
+                changes++;
+            }
+            offset += n;
+        }
+        rebalances_++;
+        return changes;
+    }
+
+    /**
+     * @brief   等待已请求的自动重平衡全部完成
+     * @note    维护线程把执行期间到来的多次请求合并为一次
+     */
+    void wait_for_maintenance() {
+        std::unique_lock<std::mutex> lock(maintenance_mutex_);
+        maintenance_cv_.wait(lock, [this] { return !rebalance_pending_ && !maintenance_running_; });
+    }
+
+    /**
+     * @brief   当前分层状态
+     */
+    TierStats stats() const {
+        StdRWLock::ReadLock lock(lock_);
+        TierStats s;
+        for (const auto& list : lists_) {
+            if (list.hot) {
+                s.hot_lists++;
+                s.hot_bytes += list.vectors.size() * sizeof(float);
+            } else {
+                s.cold_lists++;
+            }
+        }
+        s.budget_bytes = config_.hot_budget_bytes;
+        s.promotions = promotions_;
+        s.demotions = demotions_;
+        s.rebalances = rebalances_;
+        return s;
+    }
+
+    /**
+     * @brief   第list个桶是否在热层
+     */
+    bool is_hot(int list) const {
+        StdRWLock::ReadLock lock(lock_);
+        return lists_[list].hot;
+    }
+
+    /**
+     * @brief   修改热层预算，下次重平衡时生效
+     */
+    void set_hot_budget(size_t bytes) {
+        std::lock_guard<std::mutex> guard(rebalance_mutex_);
+        config_.hot_budget_bytes = bytes;
+    }
+
+    const ListAccessTracker& access_stats() const { return access_; }
+    bool is_trained() const { return trained_; }
+    int get_dim() const { return dim_; }
+    int get_n_lists() const { return n_lists_; }
+    size_t size() const { return ntotal_; }
+
+    /**
+     * @brief   向量所属的桶
+     */
+    int assign(std::span<const float> vec) const { return nearest_list(vec); }
+
+    /**
+     * @brief   统计索引各部分的内存占用
+     */
+    MemoryReport memory_report() const {
+        StdRWLock::ReadLock lock(lock_);
+        MemoryReport report;
+        report.add("centroids", vector_memory(kmeans_.get_centroids()));
+        report.add("codec", codec_.memory_usage());
+        MemoryUsage ids, codes, vectors;
+        for (const auto& list : lists_) {
+            ids += vector_memory(list.ids);
+            codes += vector_memory(list.codes);
+            vectors += vector_memory(list.vectors);
+        }
+        report.add("list_ids", ids);
+        report.add("cold_codes", codes);
+        report.add("hot_vectors", vectors);
+        return report;
+    }
+
+private:
+    struct List {
+        std::vector<idx_t> ids;
+        std::vector<uint8_t> codes;     ///< SQ8编码，所有桶常驻
+        std::vector<float> vectors;     ///< 全精度向量，仅热桶
+        bool hot = false;
+    };
+
+    int dim_;
+    int n_lists_;
+    KMeans kmeans_;
+    SQ8Codec codec_;
+    TieredConfig config_;
+    std::unique_ptr<VectorFile> file_;
+    ListAccessTracker access_;
+    std::vector<List> lists_;
+    size_t ntotal_ = 0;
+    bool trained_ = false;
+    mutable StdRWLock lock_;            ///< 保护lists_
+    std::mutex rebalance_mutex_;        ///< 同一时间只有一个重平衡
+    std::atomic<int64_t> queries_{0};
+    uint64_t promotions_ = 0;
+    uint64_t demotions_ = 0;
+    uint64_t rebalances_ = 0;
+
+    std::thread maintenance_thread_;    ///< 自动重平衡线程（仅rebalance_interval > 0）
+    std::mutex maintenance_mutex_;
+    std::condition_variable maintenance_cv_;
+    bool rebalance_pending_ = false;
+    bool maintenance_running_ = false;
+    bool maintenance_stop_ = false;
+
+    /**
+     * @brief   维护线程主循环：等待查询线程的重平衡请求
+     */
+    void maintenance_loop() {
+        std::unique_lock<std::mutex> lock(maintenance_mutex_);
+        while (true) {
+            maintenance_cv_.wait(lock, [this] { return rebalance_pending_ || maintenance_stop_; });
+            if (maintenance_stop_) return;
+            rebalance_pending_ = false;
+            maintenance_running_ = true;
+            lock.unlock();
+            try {
+                rebalance();
+            } catch (const std::exception& e) {
+                std::cerr << "Tiered rebalance failed: " << e.what() << std::endl;
+            }
+            lock.lock();
+            maintenance_running_ = false;
+            maintenance_cv_.notify_all();
+        }
+    }
+
+    size_t vector_bytes(size_t n) const { return n * dim_ * sizeof(float); }
+
+    int nearest_list(std::span<const float> vec) const {
+        const auto& centroids = kmeans_.get_centroids();
+        int best = 0;
+        float best_dist = std::numeric_limits<float>::max();
+        for (int c = 0; c < n_lists_; ++c) {
+            std::span<const float> center(centroids.data() + static_cast<size_t>(c) * dim_, dim_);
+            float dist = Metric::distance(vec, center);
+            if (dist < best_dist) {
+                best_dist = dist;
+                best = c;
+            }
+        }
+        return best;
+    }
+};
+
+} // namespace minimilvus
@@ -0,0 +1,402 @@
+/**
+ * @file    uring_storage.hpp
+ * @brief   基于io_uring的向量文件读取与日志写入
+ * @details VectorFile按行随机读取数据集文件（精排阶段取原始向量）或整段加载（段加载），
+ *          UringLogWriter以注册缓冲区 + 链接的write/fdatasync批量追加日志，
+ *          其io_uring与缓冲区从进程共享的UringWriterPool中借用；
+ *          io_uring不可用时退化为pread/write
+ * @author  Tyooughtul
+ */
+
+#pragma once
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <cstdlib>
+#include <cstring>
+#include <cerrno>
+#include <algorithm>
+#include <string>
+#include <vector>
+#include <span>
+#include <memory>
+#include <mutex>
+#include <condition_variable>
+#include <utility>
+#include <stdexcept>
+#include "dataset.hpp"
+#include "io_uring.hpp"
+
+namespace minimilvus {
+
+/**
+ * @brief   数据集文件的只读访问
+ * @details 文件格式与VectorDataset::save一致：| "MMVD" | i64 dim | i64 count | float * dim * count |
+ */
+class VectorFile {
+public:
+    /// 文件头长度
+    static constexpr size_t kHeaderSize = 4 + 2 * sizeof(int64_t);
+
+    /**
+     * @brief   打开数据集文件
+     * @param   path    文件路径
+     * @param   ring    用于异步读取的io_uring，为空时使用pread
+     * @throws  std::runtime_error 当文件不存在或格式错误时
+     */
+    VectorFile(const std::string& path, IoUring* ring = nullptr) : ring_(ring) {
+        fd_ = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+        if (fd_ < 0) throw std::runtime_error("Failed to open dataset file: " + path);
+        char header[kHeaderSize];
+        if (::pread(fd_, header, kHeaderSize, 0) != static_cast<ssize_t>(kHeaderSize) ||
+            std::memcmp(header, VectorDataset::kFileMagic, 4) != 0) {
+            ::close(fd_);
+            throw std::runtime_error("Invalid dataset file: " + path);
+        }
+        std::memcpy(&dim_, header + 4, sizeof(dim_));
+        std::memcpy(&cnt_, header + 4 + sizeof(dim_), sizeof(cnt_));
+        struct stat st{};
+        if (dim_ <= 0 || cnt_ < 0 || ::fstat(fd_, &st) != 0 ||
+            static_cast<uint64_t>(st.st_size) < kHeaderSize + row_bytes() * cnt_) {
+            ::close(fd_);
+            throw std::runtime_error("Truncated dataset file: " + path);
+        }
+    }
+
+    ~VectorFile() {
+        if (fd_ >= 0) ::close(fd_);
+    }
+
+    VectorFile(const VectorFile&) = delete;
+    VectorFile& operator=(const VectorFile&) = delete;
+
+    int64_t get_dim() const { return dim_; }
+    int64_t get_count() const { return cnt_; }
+
+    /**
+     * @brief   批量读取若干行
+     * @param   ids     行号
+     * @param   out     输出，长度为 ids.size() * dim，第i行写到 out[i*dim]
+     * @throws  std::out_of_range 当行号越界时
+     * @throws  std::runtime_error 当读取失败时
+     * @note    相邻的行号合并成一次读取，所有读取在一次io_uring_enter中提交
+     */
+    void fetch(std::span<const idx_t> ids, std::span<float> out) const {
+        if (out.size() < ids.size() * static_cast<size_t>(dim_)) throw std::invalid_argument("Output too small");
+        std::vector<IoRequest> requests;
+        requests.reserve(ids.size());
+        for (size_t i = 0; i < ids.size();) {
+            check_id(ids[i]);
+            size_t run = 1;
+            while (i + run < ids.size() && ids[i + run] == ids[i] + static_cast<idx_t>(run)) run++;
+            requests.push_back(IoRequest::read(fd_, out.data() + i * dim_,
+                                               static_cast<uint32_t>(run * row_bytes()), row_offset(ids[i])));
+            i += run;
+        }
+        run_all(requests);
+    }
+
+    /**
+     * @brief   异步读取一行，供协程co_await
+     * @param   id      行号
+     * @param   out     输出，长度至少为dim
+     * @return  co_await的结果为读取的字节数或负的errno
+     * @throws  std::logic_error 当未提供io_uring时
+     */
+    IoAwaitable async_fetch(idx_t id, std::span<float> out) const {
+        if (!ring_) throw std::logic_error("async_fetch requires an io_uring");
+        check_id(id);
+        return ring_->async(IoRequest::read(fd_, out.data(), static_cast<uint32_t>(row_bytes()), row_offset(id)));
+    }
+
+    /**
+     * @brief   整段加载为内存数据集
+     * @param   chunk_bytes     单次读取的大小，多个分块同时在途
+     * @return  加载的数据集
+     * @note    目标内存能注册为固定缓冲区时使用READ_FIXED
+     */
+    VectorDataset load(size_t chunk_bytes = 1 << 20) const {
+        VectorDataset dataset(static_cast<int>(dim_));
+        std::span<float> data = dataset.extend(cnt_);
+        char* base = reinterpret_cast<char*>(data.data());
+        const size_t total = data.size_bytes();
+
+        // 单个注册缓冲区上限为1GB
+        bool fixed = false;
+        if (ring_ && total > 0 && total <= (1ull << 30)) {
+            iovec iov{base, total};
+            fixed = ring_->register_buffers({&iov, 1});
+        }
+        std::vector<IoRequest> requests;
+        for (size_t done = 0; done < total; done += chunk_bytes) {
+            auto len = static_cast<uint32_t>(std::min(chunk_bytes, total - done));
+            requests.push_back(fixed ? IoRequest::read_fixed(fd_, base + done, len, kHeaderSize + done, 0)
+                                     : IoRequest::read(fd_, base + done, len, kHeaderSize + done));
+        }
+        try {
+            run_all(requests);
+        } catch (...) {
+            if (fixed) ring_->unregister_buffers();
+            throw;
+        }
+        if (fixed) ring_->unregister_buffers();
+        return dataset;
+    }
+
+private:
+    int fd_ = -1;
+    int64_t dim_ = 0;
+    int64_t cnt_ = 0;
+    IoUring* ring_;
+
+    size_t row_bytes() const { return dim_ * sizeof(float); }
+    uint64_t row_offset(idx_t id) const { return kHeaderSize + id * row_bytes(); }
+
+    void check_id(idx_t id) const {
+        if (id < 0 || id >= cnt_) throw std::out_of_range("Vector id out of range");
+    }
+
+    /**
+     * @brief   执行读取并检查每个请求都读满
+     * @throws  std::runtime_error 当读取失败或读到文件末尾时
+     */
+    void run_all(const std::vector<IoRequest>& requests) const {
+        std::vector<int> results;
+        if (ring_) results = ring_->execute(requests);
+        for (size_t i = 0; i < requests.size(); ++i) {
+            const IoRequest& r = requests[i];
+            ssize_t n = ring_ ? results[i] : ::pread(r.fd, reinterpret_cast<void*>(r.addr), r.len, r.offset);
+            if (n < 0) {
+                throw std::runtime_error(std::string("Dataset read failed: ") + std::strerror(ring_ ? -n : errno));
+            }
+            if (n != static_cast<ssize_t>(r.len)) throw std::runtime_error("Short read from dataset file");
+        }
+    }
+};
+
+/**
+ * @brief   日志写入共享的io_uring与注册缓冲区池
+ * @details 每个槽位持有一个io_uring及注册在其上的缓冲区（首次借用时创建），
+ *          写入器每批借用一个槽位，写完即归还；槽位都被占用时等待。
+ *          这样打开再多的WAL也只占用固定数量的ring与锁定内存
+ */
+class UringWriterPool {
+public:
+    /**
+     * @brief   借用中的槽位，析构时归还
+     */
+    class Lease {
+    public:
+        Lease(UringWriterPool& pool, size_t slot) : pool_(&pool), slot_(slot) {}
+        Lease(Lease&& other) noexcept : pool_(std::exchange(other.pool_, nullptr)), slot_(other.slot_) {}
+        Lease(const Lease&) = delete;
+        Lease& operator=(const Lease&) = delete;
+        Lease& operator=(Lease&&) = delete;
+        ~Lease() {
+            if (pool_) pool_->release(slot_);
+        }
+
+        /// 槽位的io_uring，不支持io_uring时为空
+        IoUring* ring() const { return pool_->slots_[slot_].ring.get(); }
+        /// 槽位的缓冲区
+        char* buffer() const { return pool_->slots_[slot_].buffer.get(); }
+        /// 缓冲区是否已注册为固定缓冲区（下标0）
+        bool fixed() const { return pool_->slots_[slot_].fixed; }
+
+    private:
+        UringWriterPool* pool_;
+        size_t slot_;
+    };
+
+    /**
+     * @brief   构造写入池
+     * @param   slots           槽位数（同时进行的批量写入数上限）
+     * @param   buffer_size     每个槽位的缓冲区大小
+     */
+    explicit UringWriterPool(size_t slots = 2, size_t buffer_size = 1 << 20)
+        : buffer_size_(buffer_size), slots_(std::max<size_t>(slots, 1)) {}
+
+    UringWriterPool(const UringWriterPool&) = delete;
+    UringWriterPool& operator=(const UringWriterPool&) = delete;
+
+    /**
+     * @brief   进程共享的写入池（所有WAL共用）
+     */
+    static UringWriterPool& shared() {
+        static UringWriterPool pool;
+        return pool;
+    }
+
+    /**
+     * @brief   借用一个空闲槽位，必要时等待
+     * @throws  std::bad_alloc 当缓冲区分配失败时
+     */
+    Lease acquire() {
+        std::unique_lock<std::mutex> lock(mutex_);
+        size_t slot = 0;
+        cv_.wait(lock, [&] {
+            for (slot = 0; slot < slots_.size(); ++slot) {
+                if (!slots_[slot].busy) return true;
+            }
+            return false;
+        });
+        Slot& s = slots_[slot];
+        s.busy = true;
+        lock.unlock();
+        Lease lease(*this, slot);
+        if (!s.buffer) init(s);
+        return lease;
+    }
+
+    /**
+     * @brief   每个槽位的缓冲区大小
+     */
+    size_t buffer_size() const { return buffer_size_; }
+
+    /**
+     * @brief   槽位数
+     */
+    size_t slots() const { return slots_.size(); }
+
+    /**
+     * @brief   已创建的io_uring数
+     */
+    size_t rings() const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        size_t n = 0;
+        for (const auto& s : slots_) n += s.ring != nullptr;
+        return n;
+    }
+
+private:
+    struct FreeDeleter {
+        void operator()(char* p) const { std::free(p); }
+    };
+
+    struct Slot {
+        std::unique_ptr<IoUring> ring;
+        std::unique_ptr<char, FreeDeleter> buffer;
+        bool fixed = false;
+        bool busy = false;
+    };
+
+    size_t buffer_size_;
+    std::vector<Slot> slots_;
+    mutable std::mutex mutex_;
+    std::condition_variable cv_;
+
+    /**
+     * @brief   首次借用时创建槽位的缓冲区与io_uring（调用方独占该槽位）
+     */
+    void init(Slot& s) {
+        std::unique_ptr<char, FreeDeleter> buffer(
+            static_cast<char*>(std::aligned_alloc(4096, (buffer_size_ + 4095) / 4096 * 4096)));
+        if (!buffer) throw std::bad_alloc();
+        if (IoUring::supported()) {
+            s.ring = std::make_unique<IoUring>(8);
+            iovec iov{buffer.get(), buffer_size_};
+            s.fixed = s.ring->register_buffers({&iov, 1});
+        }
+        s.buffer = std::move(buffer);
+    }
+
+    void release(size_t slot) {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            slots_[slot].busy = false;
+        }
+        cv_.notify_one();
+    }
+};
+
+/**
+ * @brief   追加写日志文件
+ * @details 记录先序列化到借来的注册缓冲区，再以 WRITE_FIXED -> FDATASYNC 的链接请求提交，
+ *          一批记录只需一次系统调用即可写入并落盘（组提交）
+ */
+class UringLogWriter {
+public:
+    /**
+     * @brief   打开日志文件（追加模式）
+     * @param   path    日志文件路径
+     * @param   pool    io_uring与缓冲区池，不支持io_uring时使用write + fdatasync
+     * @throws  std::runtime_error 当文件无法打开时
+     */
+    explicit UringLogWriter(const std::string& path, UringWriterPool& pool = UringWriterPool::shared())
+        : pool_(pool) {
+        fd_ = ::open(path.c_str(), O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+        if (fd_ < 0) throw std::runtime_error("Failed to open log file: " + path);
+    }
+
+    ~UringLogWriter() {
+        if (fd_ >= 0) ::close(fd_);
+    }
+
+    UringLogWriter(const UringLogWriter&) = delete;
+    UringLogWriter& operator=(const UringLogWriter&) = delete;
+
+    /**
+     * @brief   追加一批 "OPERATION|DATA\n" 格式的记录并落盘
+     * @param   records     (操作类型, 数据) 列表
+     * @return  是否全部写入成功
+     * @note    O_APPEND保证即使与其他写入者交替，每次写入也追加在文件末尾；
+     *          缓冲区写满时提前写入并落盘一次
+     */
+    bool append_batch(const std::vector<std::pair<std::string, std::string>>& records) {
+        auto lease = pool_.acquire();
+        const size_t buffer_size = pool_.buffer_size();
+        char* buffer = lease.buffer();
+        size_t used = 0;
+        for (const auto& [op, data] : records) {
+            size_t len = op.size() + data.size() + 2;
+            if (used + len > buffer_size && used > 0) {
+                if (!write_and_sync(lease.ring(), buffer, used, lease.fixed())) return false;
+                used = 0;
+            }
+            if (len > buffer_size) {
+                // 超大记录不经过缓冲区
+                std::string line = op + "|" + data + "\n";
+                if (!write_and_sync(lease.ring(), line.data(), line.size(), false)) return false;
+                continue;
+            }
+            char* p = buffer + used;
+            std::memcpy(p, op.data(), op.size());
+            p[op.size()] = '|';
+            std::memcpy(p + op.size() + 1, data.data(), data.size());
+            p[len - 1] = '\n';
+            used += len;
+        }
+        return used == 0 || write_and_sync(lease.ring(), buffer, used, lease.fixed());
+    }
+
+private:
+    int fd_ = -1;
+    UringWriterPool& pool_;
+
+    /**
+     * @brief   写入并落盘
+     * @note    io_uring下write与fdatasync以IOSQE_IO_LINK链接，一次系统调用完成；
+     *          短写会打断链接，剩余部分以普通写重新提交
+     */
+    bool write_and_sync(IoUring* ring, const char* data, size_t len, bool fixed) {
+        if (!ring) {
+            while (len > 0) {
+                ssize_t n = ::write(fd_, data, len);
+                if (n <= 0) return false;
+                data += n;
+                len -= n;
+            }
+            return ::fdatasync(fd_) == 0;
+        }
+        auto n = static_cast<uint32_t>(len);
+        IoRequest requests[2] = {fixed ? IoRequest::write_fixed(fd_, data, n, 0, 0) : IoRequest::write(fd_, data, n, 0),
+                                 IoRequest::fdatasync(fd_)};
+        requests[0].link = true;
+        auto results = ring->execute(requests);
+        if (results[0] == static_cast<int>(n)) return results[1] == 0;
+        if (results[0] <= 0) return false;
+        return write_and_sync(ring, data + results[0], len - results[0], false);
+    }
+};
+
+} // namespace minimilvus
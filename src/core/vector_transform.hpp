@@ -0,0 +1,300 @@
+/**
+ * @file    vector_transform.hpp
+ * @brief   向量预处理变换：随机旋转、PCA降维与白化
+ * @details 高维embedding的方差往往集中在少数方向上，低方差维度对距离贡献很小却占据同样的扫描开销。
+ *          变换在建索引前作用于数据库向量、在搜索前作用于查询：
+ *          - 随机正交旋转：不改变距离，把方差均匀摊到各维，便于SQ/PQ分段量化
+ *          - PCA：投影到协方差矩阵前out_dim个特征向量上，丢弃低方差方向
+ *          - 白化：PCA后按 1/√λ 缩放各维，使各维方差相同
+ * @author  Tyooughtul
+ */
+
+#pragma once
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <string>
+#include <vector>
+#include "codecs.hpp"
+#include "dataset.hpp"
+#include "linalg.hpp"
+#include "memory_stats.hpp"
+
+namespace minimilvus {
+
+/**
+ * @brief   线性向量变换 y = M (x - mean)
+ */
+class VectorTransform {
+public:
+    enum class Type : int32_t {
+        RandomRotation = 0,     ///< 随机正交旋转，维度不变
+        PCA = 1,                ///< PCA降维，可选白化与降维后旋转
+    };
+
+    static constexpr idx_t kMaxTrainSamples = 65536;
+    static constexpr float kWhitenEpsilon = 1e-6f;  ///< 白化时加到特征值上，避免除零
+    static constexpr int kCovarianceBlock = 32;     ///< 协方差累加时每块的样本数
+
+    /**
+     * @brief   随机正交旋转
+     * @param   dim     向量维度
+     * @param   seed    随机种子
+     */
+    static VectorTransform random_rotation(int dim, uint64_t seed = 1234) {
+        if (dim <= 0) throw std::invalid_argument("Transform dimension must be positive");
+        VectorTransform t(Type::RandomRotation, dim, dim);
+        t.seed_ = seed;
+        return t;
+    }
+
+    /**
+     * @brief   PCA降维
+     * @param   in_dim      输入维度
+     * @param   out_dim     输出维度，不超过in_dim
+     * @param   whiten      是否按特征值白化
+     * @param   rotate      降维后是否再做一次随机旋转，使各维方差均衡（利于PQ分段）
+     * @throws  std::invalid_argument 当维度非法时
+     */
+    static VectorTransform pca(int in_dim, int out_dim, bool whiten = false, bool rotate = false) {
+        if (in_dim <= 0 || out_dim <= 0 || out_dim > in_dim) {
+            throw std::invalid_argument("PCA output dimension must be in [1, input dimension]");
+        }
+        VectorTransform t(Type::PCA, in_dim, out_dim);
+        t.whiten_ = whiten;
+        t.rotate_ = rotate;
+        return t;
+    }
+
+    /**
+     * @brief   在数据集的采样上训练
+     * @throws  std::invalid_argument 当维度不符或PCA样本少于out_dim时
+     * @note    随机旋转不依赖数据，只需生成矩阵。PCA直接在数据集上并行累加协方差上三角（O(n·d²/2)，
+     *          不复制采样），再对d×d协方差做并行的对称Jacobi特征分解（每轮O(d³)，约10轮收敛）。
+     *          单核上128维约0.2秒，1536维约两分钟（其中特征分解约1.5分钟），随核数近似线性下降，
+     *          只在建索引时执行一次
+     */
+    void train(const VectorDataset& dataset) {
+        if (dataset.get_dim() != in_dim_) {
+            throw std::invalid_argument("Transform training data dimension mismatch");
+        }
+        if (type_ == Type::RandomRotation) {
+            matrix_ = random_orthogonal(in_dim_, seed_);
+            mean_.assign(in_dim_, 0.0f);
+            trained_ = true;
+            return;
+        }
+        if (dataset.get_count() < out_dim_) {
+            throw std::invalid_argument("PCA training requires at least out_dim vectors");
+        }
+
+        idx_t n = std::min(dataset.get_count(), kMaxTrainSamples);
+        idx_t step = dataset.get_count() / n;
+        const int d = in_dim_;
+        std::vector<double> mean(d, 0.0);
+        #pragma omp parallel
+        {
+            std::vector<double> local(d, 0.0);
+            #pragma omp for schedule(static)
+            for (idx_t i = 0; i < n; ++i) {
+                auto vec = dataset.get_vector(i * step);
+                for (int j = 0; j < d; ++j) local[j] += vec[j];
+            }
+            #pragma omp critical
+            for (int j = 0; j < d; ++j) mean[j] += local[j];
+        }
+        mean_.resize(d);
+        for (int j = 0; j < d; ++j) {
+            mean[j] /= n;
+            mean_[j] = static_cast<float>(mean[j]);
+        }
+
+        // 协方差对称，每个线程只累加上三角；样本按块读取并就地减去均值，不复制整个采样，
+        // 同一块的样本连续累加到同一行，累加矩阵每块只过一遍缓存
+        Matrix cov(d, d);
+        std::vector<double> sum(static_cast<size_t>(d) * d, 0.0);
+        const idx_t n_blocks = (n + kCovarianceBlock - 1) / kCovarianceBlock;
+        #pragma omp parallel
+        {
+            std::vector<double> local(static_cast<size_t>(d) * d, 0.0);
+            std::vector<double> block(static_cast<size_t>(kCovarianceBlock) * d);
+            #pragma omp for schedule(static)
+            for (idx_t blk = 0; blk < n_blocks; ++blk) {
+                idx_t begin = blk * kCovarianceBlock, end = std::min(n, begin + kCovarianceBlock);
+                int rows = static_cast<int>(end - begin);
+                for (int r = 0; r < rows; ++r) {
+                    auto vec = dataset.get_vector((begin + r) * step);
+                    double* dst = block.data() + static_cast<size_t>(r) * d;
+                    for (int j = 0; j < d; ++j) dst[j] = static_cast<double>(vec[j]) - mean[j];
+                }
+                for (int a = 0; a < d; ++a) {
+                    double* out = local.data() + static_cast<size_t>(a) * d;
+                    for (int r = 0; r < rows; ++r) {
+                        const double* x = block.data() + static_cast<size_t>(r) * d;
+                        double xa = x[a];
+                        for (int b = a; b < d; ++b) out[b] += xa * x[b];
+                    }
+                }
+            }
+            #pragma omp critical
+            for (int a = 0; a < d; ++a) {
+                for (int b = a; b < d; ++b) sum[static_cast<size_t>(a) * d + b] += local[static_cast<size_t>(a) * d + b];
+            }
+        }
+        for (int a = 0; a < d; ++a) {
+            for (int b = a; b < d; ++b) cov(a, b) = cov(b, a) = static_cast<float>(sum[static_cast<size_t>(a) * d + b] / n);
+        }
+
+        EigenResult eig = symmetric_eigen(cov);
+        eigenvalues_ = eig.values;
+        // 半正定矩阵的特征值理论上非负，数值误差可能给出极小的负值
+        for (float& e : eigenvalues_) e = std::max(e, 0.0f);
+
+        matrix_ = Matrix(out_dim_, in_dim_);
+        for (int k = 0; k < out_dim_; ++k) {
+            float scale = whiten_ ? 1.0f / std::sqrt(eigenvalues_[k] + kWhitenEpsilon) : 1.0f;
+            for (int j = 0; j < in_dim_; ++j) matrix_(k, j) = eig.vectors(j, k) * scale;
+        }
+        if (rotate_) matrix_ = matmul(random_orthogonal(out_dim_, seed_), matrix_);
+        trained_ = true;
+    }
+
+    bool is_trained() const { return trained_; }
+    Type type() const { return type_; }
+    int in_dim() const { return in_dim_; }
+    int out_dim() const { return out_dim_; }
+    const Matrix& matrix() const { return matrix_; }
+    const std::vector<float>& mean() const { return mean_; }
+
+    /**
+     * @brief   协方差矩阵特征值（降序），仅PCA训练后有效
+     */
+    const std::vector<float>& eigenvalues() const { return eigenvalues_; }
+
+    /**
+     * @brief   保留的前out_dim个方向所占的方差比例
+     */
+    double explained_variance_ratio() const {
+        if (eigenvalues_.empty()) return 1.0;
+        double kept = 0, total = 0;
+        for (size_t i = 0; i < eigenvalues_.size(); ++i) {
+            total += eigenvalues_[i];
+            if (i < static_cast<size_t>(out_dim_)) kept += eigenvalues_[i];
+        }
+        return total > 0 ? kept / total : 1.0;
+    }
+
+    /**
+     * @brief   描述串中的名字：RR、PCA<d>、PCAW<d>、PCAR<d>、PCAWR<d>
+     */
+    std::string name() const {
+        if (type_ == Type::RandomRotation) return "RR";
+        return std::string("PCA") + (whiten_ ? "W" : "") + (rotate_ ? "R" : "") + std::to_string(out_dim_);
+    }
+
+    /**
+     * @brief   变换单个向量
+     * @param   x       长度in_dim
+     * @param   out     长度out_dim
+     * @throws  std::logic_error 当尚未训练时
+     */
+    void apply(std::span<const float> x, float* out) const {
+        if (!trained_) throw std::logic_error("Vector transform is not trained");
+        if (type_ == Type::RandomRotation) {
+            matvec(matrix_, x.data(), out);
+            return;
+        }
+        std::vector<float> centered(in_dim_);
+        for (int j = 0; j < in_dim_; ++j) centered[j] = x[j] - mean_[j];
+        matvec(matrix_, centered.data(), out);
+    }
+
+    std::vector<float> apply(std::span<const float> x) const {
+        std::vector<float> out(out_dim_);
+        apply(x, out.data());
+        return out;
+    }
+
+    /**
+     * @brief   并行变换整个数据集
+     */
+    VectorDataset apply(const VectorDataset& dataset) const {
+        VectorDataset out(out_dim_);
+        auto dst = out.extend(dataset.get_count());
+        #pragma omp parallel for schedule(static)
+        for (idx_t i = 0; i < dataset.get_count(); ++i) {
+            apply(dataset.get_vector(i), dst.data() + i * out_dim_);
+        }
+        return out;
+    }
+
+    /**
+     * @note    格式：type | in_dim | out_dim | whiten | rotate | seed | mean | matrix | eigenvalues
+     */
+    void save(std::ostream& out) const {
+        detail::write_pod(out, static_cast<int32_t>(type_));
+        detail::write_pod(out, static_cast<int32_t>(in_dim_));
+        detail::write_pod(out, static_cast<int32_t>(out_dim_));
+        detail::write_pod(out, static_cast<uint8_t>(whiten_));
+        detail::write_pod(out, static_cast<uint8_t>(rotate_));
+        detail::write_pod(out, seed_);
+        detail::write_vector(out, mean_);
+        detail::write_vector(out, matrix_.data);
+        detail::write_vector(out, eigenvalues_);
+    }
+
+    /**
+     * @throws  std::runtime_error 当数据损坏或与维度不符时
+     */
+    static VectorTransform load(std::istream& in) {
+        int32_t type = -1, in_dim = 0, out_dim = 0;
+        uint8_t whiten = 0, rotate = 0;
+        uint64_t seed = 0;
+        detail::read_pod(in, type);
+        detail::read_pod(in, in_dim);
+        detail::read_pod(in, out_dim);
+        detail::read_pod(in, whiten);
+        detail::read_pod(in, rotate);
+        detail::read_pod(in, seed);
+        if (!in || (type != 0 && type != 1) || in_dim <= 0 || out_dim <= 0 || out_dim > in_dim) {
+            throw std::runtime_error("Invalid vector transform header");
+        }
+        VectorTransform t(static_cast<Type>(type), in_dim, out_dim);
+        t.whiten_ = whiten;
+        t.rotate_ = rotate;
+        t.seed_ = seed;
+        t.matrix_ = Matrix(out_dim, in_dim);
+        detail::read_vector(in, t.mean_);
+        detail::read_vector(in, t.matrix_.data);
+        detail::read_vector(in, t.eigenvalues_);
+        if (!in || t.mean_.size() != static_cast<size_t>(in_dim) ||
+            t.matrix_.data.size() != static_cast<size_t>(out_dim) * in_dim) {
+            throw std::runtime_error("Vector transform size mismatch");
+        }
+        t.trained_ = true;
+        return t;
+    }
+
+    MemoryUsage memory_usage() const {
+        MemoryUsage usage = vector_memory(matrix_.data);
+        usage += vector_memory(mean_);
+        usage += vector_memory(eigenvalues_);
+        return usage;
+    }
+
+private:
+    Type type_;
+    int in_dim_;
+    int out_dim_;
+    bool whiten_ = false;
+    bool rotate_ = false;
+    uint64_t seed_ = 1234;
+    bool trained_ = false;
+    Matrix matrix_;                     ///< out_dim × in_dim
+    std::vector<float> mean_;           ///< 输入均值，随机旋转时为0
+    std::vector<float> eigenvalues_;    ///< PCA特征值，降序
+
+    VectorTransform(Type type, int in_dim, int out_dim) : type_(type), in_dim_(in_dim), out_dim_(out_dim) {}
+};
+
+} // namespace minimilvus
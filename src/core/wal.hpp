@@ -12,6 +12,11 @@
 #include <vector>
 #include <mutex>
 #include <iostream>
+#include <functional>
+#include <memory>
+#include <utility>
+#include "memory_stats.hpp"
+#include "uring_storage.hpp"
 
 namespace minimilvus {
 
@@ -24,10 +29,14 @@ public:
     /**
      * @brief   构造函数
      * @param   log_file_path   日志文件路径
+     * @param   verbose         是否打印恢复过程和检查点信息
+     * @note    recover()只打印日志内容，不修改任何状态；自行重放日志的调用方
+     *          （如Collection通过for_each_record）应传false，避免整份日志被读两遍并输出到stdout
      */
-    explicit WAL(const std::string& log_file_path) : log_file_path_(log_file_path) {
+    explicit WAL(const std::string& log_file_path, bool verbose = true)
+        : log_file_path_(log_file_path), verbose_(verbose) {
         // 尝试从日志恢复数据
-        recover();
+        if (verbose_) recover();
     }
     
     /**
@@ -69,6 +78,58 @@ public:
         return true;
     }
     
+    /**
+     * @brief   批量追加日志并落盘（组提交）
+     * @param   records     (操作类型, 数据) 列表
+     * @return  是否成功
+     * @note    首次调用时打开写入器，每批从共享池借用io_uring与注册缓冲区，
+     *          整批记录一次提交并fdatasync；io_uring不可用时退化为write + fdatasync
+     */
+    bool append_batch(const std::vector<std::pair<std::string, std::string>>& records) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        try {
+            if (!writer_) writer_ = std::make_unique<UringLogWriter>(log_file_path_);
+            return writer_->append_batch(records);
+        } catch (const std::exception& e) {
+            std::cerr << "WAL batch append failed: " << e.what() << std::endl;
+            return false;
+        }
+    }
+
+    /**
+     * @brief   按顺序遍历日志中的所有记录
+     * @param   handler     记录处理函数，参数为 (操作类型, 数据)
+     * @return  遍历的记录数
+     * @note    供上层（如Collection）重放日志恢复数据
+     */
+    size_t for_each_record(const std::function<void(const std::string&, const std::string&)>& handler) const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        std::ifstream file(log_file_path_);
+        if (!file.is_open()) return 0;
+
+        size_t count = 0;
+        std::string line;
+        while (std::getline(file, line)) {
+            size_t pos = line.find('|');
+            if (line.empty() || pos == std::string::npos) continue;
+            handler(line.substr(0, pos), line.substr(pos + 1));
+            count++;
+        }
+        return count;
+    }
+
+    /**
+     * @brief   获取WAL的内存占用
+     * @return  路径等元数据的占用
+     * @note    append每次打开文件并立即刷盘，不在用户态保留写缓冲；
+     *          批量写缓冲区属于进程共享的UringWriterPool，不计入单个WAL
+     */
+    MemoryUsage memory_usage() const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        size_t writer = writer_ ? sizeof(UringLogWriter) : 0;
+        return {sizeof(*this) + log_file_path_.size(), sizeof(*this) + log_file_path_.capacity() + writer};
+    }
+
     /**
      * @brief   清空日志（检查点）
      */
@@ -78,13 +139,15 @@ public:
         std::ofstream file(log_file_path_, std::ios::trunc);
         file.close();
         
-        std::cout << "WAL cleared (checkpoint)" << std::endl;
+        if (verbose_) std::cout << "WAL cleared (checkpoint)" << std::endl;
     }
     
 private:
     std::string log_file_path_;      ///< 日志文件路径
     std::fstream log_file_;         ///< 日志文件流
     mutable std::mutex mutex_;      ///< 保护文件操作
+    std::unique_ptr<UringLogWriter> writer_;    ///< 批量写入器（O_APPEND，clear截断后仍追加在末尾）
+    bool verbose_;                  ///< 是否打印恢复过程和检查点信息
     
     /**
      * @brief   从日志恢复
@@ -0,0 +1,217 @@
+/**
+ * @file    perf_regress.cpp
+ * @brief   性能回归检测
+ * @details 运行固定的kernel和端到端benchmark，多次重复取中位数和MAD，
+ *          与保存的基线JSON比较，吞吐或召回率显著下降时返回非零
+ *
+ * 用法：perf_regress [baseline.json] [--update]
+ *   - 基线文件不存在或指定 --update 时，写入本次结果作为新基线
+ *   - 否则与基线比较，任一指标回退超过阈值即失败
+ */
+
+#include <iostream>
+#include <vector>
+#include <string>
+#include <chrono>
+#include <functional>
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <set>
+#include <map>
+#include <queue>
+#include <sstream>
+#include <iomanip>
+#include "../src/core/dataset.hpp"
+#include "../src/core/metrics.hpp"
+#include "../src/core/kmeans.hpp"
+#include "../src/core/ivf_index.hpp"
+#include "../src/core/data_generator.hpp"
+#include "../third_party/json.hpp"
+
+using json = nlohmann::json;
+using minimilvus::idx_t;
+
+namespace {
+
+const int kRepeats = 7;                    ///< 每个benchmark重复次数
+const double kThroughputTolerance = 0.10;  ///< 吞吐允许下降的比例
+const double kRecallTolerance = 0.01;      ///< 召回率允许下降的绝对值
+const double kMadSigma = 3.0;              ///< 显著性：差异需超过 3 * MAD
+
+/**
+ * @brief   单个指标的统计结果
+ */
+struct Stat {
+    double median = 0.0;
+    double mad = 0.0;           ///< 中位数绝对偏差
+};
+
+double median_of(std::vector<double> v) {
+    std::sort(v.begin(), v.end());
+    size_t n = v.size();
+    return n % 2 ? v[n / 2] : 0.5 * (v[n / 2 - 1] + v[n / 2]);
+}
+
+Stat make_stat(const std::vector<double>& samples) {
+    Stat s;
+    s.median = median_of(samples);
+    std::vector<double> dev;
+    for (double x : samples) dev.push_back(std::abs(x - s.median));
+    s.mad = median_of(dev);
+    return s;
+}
+
+/**
+ * @brief   重复运行fn并统计吞吐（items/s）
+ * @param   fn      待测函数，返回处理的item数量
+ */
+Stat measure_throughput(const std::function<double()>& fn) {
+    fn();  // 预热
+    std::vector<double> samples;
+    for (int r = 0; r < kRepeats; ++r) {
+        auto t0 = std::chrono::steady_clock::now();
+        double items = fn();
+        double sec = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+        samples.push_back(items / std::max(sec, 1e-9));
+    }
+    return make_stat(samples);
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    std::string baseline_path = "perf_baseline.json";
+    bool update = false;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--update") update = true;
+        else baseline_path = arg;
+    }
+
+    const int DIM = 128;
+    const int N_VECTORS = 100000;
+    const int N_QUERIES = 200;
+    const int N_LISTS = 300;
+    const int K = 10;
+
+    minimilvus::DataGenConfig config;
+    config.dim = DIM;
+    config.count = N_VECTORS;
+    config.n_centers = 100;
+    minimilvus::DataGenerator generator(config);
+    minimilvus::VectorDataset dataset = generator.generate_or_load("bench_data");
+    auto queries = generator.generate_queries(N_QUERIES);
+
+    std::map<std::string, Stat> results;
+
+    // ---- kernel: L2 / IP 距离 ----
+    std::cout << "[perf_regress] distance kernels..." << std::endl;
+    volatile float sink = 0;
+    results["l2_distance_vec_per_s"] = measure_throughput([&] {
+        float acc = 0;
+        for (idx_t i = 0; i < dataset.get_count(); ++i) {
+            acc += minimilvus::l2_distance(queries[0], dataset.get_vector(i));
+        }
+        sink = acc;
+        return (double)dataset.get_count();
+    });
+    results["ip_distance_vec_per_s"] = measure_throughput([&] {
+        float acc = 0;
+        for (idx_t i = 0; i < dataset.get_count(); ++i) {
+            acc += minimilvus::ip_distance(queries[0], dataset.get_vector(i));
+        }
+        sink = acc;
+        return (double)dataset.get_count();
+    });
+
+    // ---- 端到端：IVF 构建 ----
+    std::cout << "[perf_regress] ivf build..." << std::endl;
+    std::vector<double> build_samples;
+    for (int r = 0; r < 3; ++r) {
+        minimilvus::IVFIndex index(DIM, N_LISTS);
+        auto t0 = std::chrono::steady_clock::now();
+        index.build(dataset);
+        double sec = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+        build_samples.push_back(N_VECTORS / sec);
+    }
+    results["ivf_build_vec_per_s"] = make_stat(build_samples);
+
+    // ---- 端到端：IVF 搜索 QPS 和召回率 ----
+    std::cout << "[perf_regress] ivf search..." << std::endl;
+    minimilvus::IVFIndex index(DIM, N_LISTS);
+    index.build(dataset);
+
+    std::vector<std::set<idx_t>> ground_truth;
+    for (const auto& q : queries) {
+        std::priority_queue<minimilvus::SearchResult> pq;
+        for (idx_t i = 0; i < dataset.get_count(); ++i) {
+            float d = minimilvus::l2_distance(q, dataset.get_vector(i));
+            if (pq.size() < (size_t)K) pq.push({i, d});
+            else if (d < pq.top().distance) { pq.pop(); pq.push({i, d}); }
+        }
+        std::set<idx_t> truth;
+        while (!pq.empty()) { truth.insert(pq.top().id); pq.pop(); }
+        ground_truth.push_back(truth);
+    }
+
+    double recall = 0;
+    results["ivf_search_qps"] = measure_throughput([&] {
+        int hit = 0;
+        for (int i = 0; i < N_QUERIES; ++i) {
+            auto res = index.search(queries[i], dataset, K);
+            for (const auto& r : res) hit += ground_truth[i].count(r.id);
+        }
+        recall = (double)hit / (N_QUERIES * K);
+        return (double)N_QUERIES;
+    });
+    // 召回率是确定值，MAD为0
+    results["ivf_recall_at_10"] = make_stat({recall});
+
+    // ---- 输出本次结果 ----
+    json current = json::object();
+    for (const auto& [name, s] : results) {
+        current[name] = {{"median", s.median}, {"mad", s.mad}};
+        std::cout << "    " << std::setw(24) << std::left << name
+                  << " median " << s.median << "  mad " << s.mad << std::endl;
+    }
+
+    std::ifstream in(baseline_path);
+    if (update || !in.is_open()) {
+        std::ofstream out(baseline_path);
+        out << current.dump(2) << std::endl;
+        std::cout << "[perf_regress] baseline written to " << baseline_path << std::endl;
+        return 0;
+    }
+
+    // ---- 与基线比较 ----
+    json baseline = json::parse(in);
+    int failures = 0;
+    for (const auto& [name, s] : results) {
+        if (!baseline.contains(name)) continue;
+        double base_median = baseline[name]["median"].get<double>();
+        double base_mad = baseline[name]["mad"].get<double>();
+        double delta = s.median - base_median;
+        bool regressed;
+        if (name.find("recall") != std::string::npos) {
+            regressed = delta < -kRecallTolerance;
+        } else {
+            // 需同时超过比例阈值和噪声范围，避免机器抖动误报
+            double noise = kMadSigma * std::max(s.mad, base_mad);
+            regressed = delta < -kThroughputTolerance * base_median && -delta > noise;
+        }
+        std::ostringstream pct;
+        pct << std::showpos << std::fixed << std::setprecision(1)
+            << (base_median != 0 ? delta / base_median * 100 : 0.0) << "%";
+        std::cout << (regressed ? "  REGRESSION " : "  ok         ") << std::setw(24) << std::left << name
+                  << pct.str() << std::endl;
+        if (regressed) failures++;
+    }
+
+    if (failures > 0) {
+        std::cout << "[perf_regress] FAILED: " << failures << " metric(s) regressed" << std::endl;
+        return 1;
+    }
+    std::cout << "[perf_regress] PASSED" << std::endl;
+    return 0;
+}
@@ -4,42 +4,45 @@
 #include <random>
 #include <iomanip>
 #include <set>
-#include "../src/core/dataset/dataset.hpp"
-#include "../src/core/metrics/metrics.hpp"
-#include "../src/core/index/ivf_index.hpp"
+#include "../src/core/dataset.hpp"
+#include "../src/core/metrics.hpp"
+#include "../src/core/ivf_index.hpp"
+#include "../src/core/perf_counters.hpp"
+#include "../src/core/data_generator.hpp"
+#include "../src/core/cpu_affinity.hpp"
 
-// --- 将原来的 generate_random_vector 替换/补充为 generate_clustered_data ---
-
-struct DataGenerator {
-    std::mt19937 rng{42};
-    std::vector<std::vector<float>> centers;
-    int dim;
-    
-    DataGenerator(int k_centers, int d) : dim(d) {
-        std::uniform_real_distribution<float> dist(-10.0f, 10.0f);
-        for(int i=0; i<k_centers; ++i) {
-            std::vector<float> c(dim);
-            for(int j=0; j<dim; ++j) c[j] = dist(rng);
-            centers.push_back(c);
-        }
-    }
-    
-    std::vector<float> generate() {
-        // 随机选一个簇中心
-        std::uniform_int_distribution<int> center_dist(0, centers.size()-1);
-        const auto& center = centers[center_dist(rng)];
-        
-        // 在中心附近加高斯噪声
-        std::normal_distribution<float> noise_dist(0.0f, 1.0f); // 标准差1.0
-        std::vector<float> vec(dim);
-        for(int i=0; i<dim; ++i) {
-            vec[i] = center[i] + noise_dist(rng);
-        }
-        return vec;
+/**
+ * @brief   打印一段benchmark的硬件计数器报告
+ * @param   name        阶段名
+ * @param   sample      计数器读数
+ * @param   n_vectors   本阶段处理的向量数（距离计算次数）
+ * @param   bytes       本阶段读取的向量数据量
+ * @param   peak_bw     STREAM实测峰值带宽（GB/s）
+ */
+void print_perf_report(const char* name, const minimilvus::PerfSample& sample,
+                       double n_vectors, double bytes, double peak_bw) {
+    double bw = sample.seconds > 0 ? bytes / sample.seconds / 1e9 : 0.0;
+    std::ios saved_fmt(nullptr);
+    saved_fmt.copyfmt(std::cout);
+    std::cout << "    [perf] " << name << ": " << std::fixed << std::setprecision(2)
+              << bw << " GB/s (" << (peak_bw > 0 ? bw / peak_bw * 100 : 0.0) << "% of peak)";
+    if (sample.valid && n_vectors > 0) {
+        std::cout << ", IPC " << sample.ipc()
+                  << ", cycles/vec " << sample.cycles / n_vectors
+                  << ", LLC miss/vec " << sample.llc_misses / n_vectors
+                  << ", dTLB miss/vec " << sample.dtlb_misses / n_vectors;
     }
-};
+    std::cout << std::endl;
+    std::cout.copyfmt(saved_fmt);
+}
 
 int main() {
+    // 计数器需在OpenMP线程启动前打开，之后创建的工作线程才会被统计
+    minimilvus::PerfCounterGroup perf;
+    if (!perf.available()) {
+        std::cout << "perf_event_open unavailable, reporting bandwidth only" << std::endl;
+    }
+
     const int DIM = 128;
     const int N_VECTORS = 1000000; 
     const int N_QUERIES = 100;   
@@ -52,24 +55,32 @@ int main() {
     const int REFINE_FACTOR = 5;    // 精排因子
 
     std::cout << "=== Mini-Milvus Benchmark (Clustered Data) ===" << std::endl;
+
+    double peak_bw = minimilvus::measure_stream_bandwidth();
+    std::cout << "[0] STREAM triad peak bandwidth: " << peak_bw << " GB/s" << std::endl;
+    const double vec_bytes = DIM * sizeof(float);
     
-    // 使用高斯混合数据生成器 (10个中心)
-    DataGenerator generator(100, DIM); 
-    minimilvus::VectorDataset dataset(DIM);
-    for(int i=0; i<N_VECTORS; ++i) {
-        dataset.add(generator.generate());
-    }
-    
-    std::vector<std::vector<float>> queries;
-    for(int i=0; i<N_QUERIES; ++i) {
-        queries.push_back(generator.generate());
-    }
+    // 使用高斯混合数据生成器 (100个中心)，结果缓存在 bench_data/ 下
+    minimilvus::DataGenConfig gen_config;
+    gen_config.dim = DIM;
+    gen_config.count = N_VECTORS;
+    gen_config.n_centers = 100;
+    minimilvus::DataGenerator generator(gen_config);
+
+    auto start_gen = std::chrono::high_resolution_clock::now();
+    minimilvus::VectorDataset dataset = generator.generate_or_load("bench_data");
+    std::cout << "[1] Dataset ready in "
+              << std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start_gen).count()
+              << "s" << std::endl;
+
+    auto queries = generator.generate_queries(N_QUERIES);
 
     // --- Brute Force Search ---
     std::cout << "[2] Running Brute Force Search (Baseline)..." << std::endl;
     std::vector<std::set<int64_t>> ground_truth; // 存下来用于算 Recall
 
     auto start_bf = std::chrono::high_resolution_clock::now();
+    perf.start();
     for (const auto& q : queries) {
         // 简单的暴力搜索 TopK (用最小堆逻辑自己写一个简单的)
         std::priority_queue<minimilvus::SearchResult> pq;
@@ -93,9 +104,12 @@ int main() {
         }
         ground_truth.push_back(truth);
     }
+    auto perf_bf = perf.stop();
     auto end_bf = std::chrono::high_resolution_clock::now();
     std::chrono::duration<double> time_bf = end_bf - start_bf;
     std::cout << "    -> Brute Force Time: " << time_bf.count() << "s" << std::endl;
+    print_perf_report("l2 distance kernel", perf_bf, (double)N_QUERIES * N_VECTORS,
+                      (double)N_QUERIES * N_VECTORS * vec_bytes, peak_bw);
 
 
     // --- IVF Search ---
@@ -103,18 +117,25 @@ int main() {
     auto start_build = std::chrono::high_resolution_clock::now();
     
     minimilvus::IVFIndex index(DIM, N_LISTS);
+    perf.start();
     index.build(dataset);
+    auto perf_build = perf.stop();
     
     auto end_build = std::chrono::high_resolution_clock::now();
     std::cout << "    -> Build Time: " << std::chrono::duration<double>(end_build - start_build).count() << "s" << std::endl;
+    // KMeans 5轮迭代 + 1轮分配，每轮每个向量扫描一遍
+    print_perf_report("kmeans + assignment", perf_build, 6.0 * N_VECTORS,
+                      6.0 * N_VECTORS * vec_bytes, peak_bw);
 
     std::cout << "[4] Running Smart IVF Search..." << std::endl;
     float total_recall = 0;
+    minimilvus::QueryProfile profile;
     
     auto start_ivf = std::chrono::high_resolution_clock::now();
+    perf.start();
     for (int i = 0; i < N_QUERIES; ++i) {
         std::span<const float> q_span(queries[i].data(), DIM);
-        auto results = index.search(q_span, dataset, K, PROBE_RATIO, MAX_PROBE, REFINE_FACTOR);
+        auto results = index.search(q_span, dataset, K, PROBE_RATIO, MAX_PROBE, REFINE_FACTOR, &profile);
         
         // 计算 Recall (召回率)
         // 看搜出来的 ID 有多少在 Ground Truth 里
@@ -127,12 +148,66 @@ int main() {
         std::cout << "Single Time Recall: " << (float)hit / K << std::endl;
         total_recall += (float)hit / K;
     }
+    auto perf_ivf = perf.stop();
     auto end_ivf = std::chrono::high_resolution_clock::now();
     std::chrono::duration<double> time_ivf = end_ivf - start_ivf;
+    print_perf_report("ivf search", perf_ivf, (double)profile.vectors_scanned,
+                      (double)profile.vectors_scanned * vec_bytes, peak_bw);
     
     std::cout << "    -> IVF Search Time: " << time_ivf.count() << "s" << std::endl;
     std::cout << "    -> Speedup: " << time_bf.count() / time_ivf.count() << "x" << std::endl;
     std::cout << "    -> Avg Recall: " << (total_recall / N_QUERIES) * 100 << "%" << std::endl;
 
+    // 各阶段平均耗时，用于定位慢查询的瓶颈
+    std::cout << "[5] Per-query stage breakdown (avg):" << std::endl;
+    for (int s = 0; s < minimilvus::QueryProfile::kStageCount; ++s) {
+        auto stage = static_cast<minimilvus::ProfileStage>(s);
+        std::cout << "    -> " << std::setw(18) << std::left << minimilvus::profile_stage_name(stage)
+                  << profile.stage_us(stage) / N_QUERIES << " us" << std::endl;
+    }
+    std::cout << "    -> Buckets probed: " << (double)profile.buckets_probed / N_QUERIES
+              << ", vectors scanned: " << (double)profile.vectors_scanned / N_QUERIES << std::endl;
+
+    // 并行批量搜索：OpenMP线程不绑核 vs 每线程独占一个核
+    std::cout << "[6] Batch search, unpinned vs pinned OpenMP threads:" << std::endl;
+    const int BATCH_ROUNDS = 5;
+    auto batch_search = [&] {
+        auto t0 = std::chrono::high_resolution_clock::now();
+        for (int round = 0; round < BATCH_ROUNDS; ++round) {
+            #pragma omp parallel for schedule(dynamic)
+            for (int i = 0; i < N_QUERIES; ++i) {
+                std::span<const float> q_span(queries[i].data(), DIM);
+                index.search(q_span, dataset, K, PROBE_RATIO, MAX_PROBE, REFINE_FACTOR);
+            }
+        }
+        std::chrono::duration<double> t = std::chrono::high_resolution_clock::now() - t0;
+        return BATCH_ROUNDS * N_QUERIES / t.count();
+    };
+    std::vector<int> cpus = minimilvus::available_cpus();
+    auto unpin = [&] { minimilvus::pin_openmp_threads(minimilvus::AffinityPlan::shared(cpus)); };
+    auto pin = [&] { return minimilvus::pin_openmp_threads(minimilvus::AffinityPlan::per_core(cpus)); };
+    // 先预热一遍，再交替先后顺序测量并各取最好成绩，避免先测的一方总是落在冷缓存上
+    batch_search();
+    const int TRIALS = 3;
+    double unpinned_qps = 0.0, pinned_qps = 0.0;
+    bool pinned_ok = true;
+    for (int trial = 0; trial < TRIALS; ++trial) {
+        for (int order = 0; order < 2; ++order) {
+            if ((trial + order) % 2 == 0) {
+                unpin();
+                unpinned_qps = std::max(unpinned_qps, batch_search());
+            } else {
+                pinned_ok = pin() && pinned_ok;
+                pinned_qps = std::max(pinned_qps, batch_search());
+            }
+        }
+    }
+    unpin();
+    std::cout << "    -> " << omp_get_max_threads() << " threads on " << cpus.size() << " CPUs, "
+              << minimilvus::numa_nodes().size() << " NUMA node(s)" << std::endl;
+    std::cout << "    -> Unpinned: " << unpinned_qps << " QPS" << std::endl;
+    std::cout << "    -> Pinned:   " << pinned_qps << " QPS"
+              << (pinned_ok ? "" : " (pinning failed)") << std::endl;
+
     return 0;
 }
\ No newline at end of file
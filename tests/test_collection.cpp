@@ -0,0 +1,128 @@
+/**
+ * @file    test_collection.cpp
+ * @brief   集合与集合管理器测试
+ */
+
+#include <iostream>
+#include <cassert>
+#include <filesystem>
+#include <random>
+#include "../src/core/collection_manager.hpp"
+
+using namespace minimilvus;
+
+std::vector<float> random_vector(std::mt19937& rng, int dim) {
+    std::normal_distribution<float> dist(0.0f, 1.0f);
+    std::vector<float> v(dim);
+    for (auto& x : v) x = dist(rng);
+    return v;
+}
+
+int main() {
+    std::cout << "=== Collection Test ===" << std::endl;
+    const std::string dir = "test_collection_data";
+    std::filesystem::remove_all(dir);
+    std::mt19937 rng(7);
+
+    // 1. 集合插入、构建与搜索
+    CollectionManager manager;
+    CollectionConfig config{"tenant_a", 16, MetricType::L2, IndexType::IVF, 8, dir};
+    auto a = manager.create(config);
+    for (int i = 0; i < 500; ++i) a->insert(random_vector(rng, 16));
+    a->build_index();
+    auto query = random_vector(rng, 16);
+    a->insert(query);
+    auto results = a->search(query, 5);
+    assert(!results.empty() && results[0].id == 500);
+    std::cout << "✓ insert/build/search passed" << std::endl;
+
+    // 2. 按名称路由请求
+    manager.create({"tenant_b", 4, MetricType::IP, IndexType::Flat, 0, dir});
+    manager.get("tenant_b")->insert({1, 0, 0, 0});
+    manager.get("tenant_b")->insert({0, 1, 0, 0});
+    SearchRequest request;
+    request.collection = "tenant_b";
+    request.vector = {0, 2, 0, 0};
+    request.top_k = 1;
+    auto response = manager.search(request);
+    assert(response.results.size() == 1 && response.results[0].id == 1);
+    std::cout << "✓ request routing passed" << std::endl;
+
+    // 3. WAL + 快照恢复
+    manager.flush_all();
+    manager.get("tenant_b")->insert({0, 0, 1, 0});
+    {
+        Collection reopened({"tenant_b", 4, MetricType::IP, IndexType::Flat, 0, dir});
+        assert(reopened.size() == 3);
+    }
+    std::cout << "✓ snapshot + WAL recovery passed" << std::endl;
+
+    // 4. 内存预算下的LRU淘汰与懒加载
+    CollectionManager small(1);
+    small.register_existing(config);
+    small.register_existing({"tenant_b", 4, MetricType::IP, IndexType::Flat, 0, dir});
+    assert(small.loaded_count() == 0);
+    assert(small.get("tenant_a")->size() == 501);
+    assert(small.get("tenant_b")->size() == 3);
+    assert(small.loaded_count() == 1);
+    assert(small.get("tenant_a")->search(query, 1)[0].id == 500);
+    std::cout << "✓ lazy load and LRU eviction passed" << std::endl;
+
+    // 5. 借出中的集合不被淘汰；插入后自动重新计费
+    {
+        auto pinned = small.get("tenant_a");
+        assert(small.get("tenant_b")->size() == 3);
+        assert(small.loaded_count() == 2);
+        size_t before = small.loaded_bytes();
+        for (int i = 0; i < 200; ++i) pinned->insert(random_vector(rng, 16));
+        assert(small.loaded_bytes() > before);
+        bool threw = false;
+        try {
+            small.drop("tenant_a");
+        } catch (const std::runtime_error&) {
+            threw = true;
+        }
+        assert(threw);
+    }
+    assert(small.get("tenant_b")->size() == 3);
+    assert(small.loaded_count() == 1);
+    assert(small.get("tenant_a")->size() == 701);
+    std::cout << "✓ pinned collections and live accounting passed" << std::endl;
+
+    // 6. flush在清空WAL前崩溃：快照中已有的WAL记录不会被重复插入
+    {
+        CollectionConfig crash_config{"tenant_c", 8, MetricType::L2, IndexType::IVF, 4, dir};
+        std::string wal = Collection::wal_path(crash_config), manifest = Collection::manifest_path(crash_config);
+        {
+            Collection c(crash_config);
+            for (int i = 0; i < 100; ++i) c.insert(random_vector(rng, 8));
+            c.build_index();
+            c.flush();
+            for (int i = 0; i < 50; ++i) c.insert(random_vector(rng, 8));
+            std::filesystem::copy_file(wal, wal + ".bak");
+            std::filesystem::copy_file(manifest, manifest + ".bak");
+            c.flush();
+        }
+        // 快照与manifest都已写完，WAL未清空
+        std::filesystem::copy_file(wal + ".bak", wal, std::filesystem::copy_options::overwrite_existing);
+        auto last = random_vector(rng, 8);
+        {
+            Collection c(crash_config);
+            assert(c.size() == 150);
+            c.insert(last);
+            assert(c.size() == 151);
+        }
+        // 数据集快照已替换，manifest仍是上一代：重建索引并按记录ID跳过
+        std::filesystem::copy_file(manifest + ".bak", manifest, std::filesystem::copy_options::overwrite_existing);
+        {
+            Collection c(crash_config);
+            assert(c.size() == 151 && c.dirty());
+            assert(c.search(last, 1)[0].id == 150);
+        }
+    }
+    std::cout << "✓ crash between snapshot and WAL truncation passed" << std::endl;
+
+    std::filesystem::remove_all(dir);
+    std::cout << "ALL TESTS PASSED! 🚀" << std::endl;
+    return 0;
+}
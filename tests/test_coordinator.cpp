@@ -0,0 +1,197 @@
+/**
+ * @file    test_coordinator.cpp
+ * @brief   多进程分片集群与协调节点测试
+ */
+
+#include <iostream>
+#include <cassert>
+#include <thread>
+#include <atomic>
+#include <filesystem>
+#include "../src/core/coordinator.hpp"
+#include "../src/core/collection.hpp"
+#include "../src/core/data_generator.hpp"
+
+using namespace minimilvus;
+
+const int DIM = 32;
+const int N_VECTORS = 6000;
+const int N_SHARDS = 3;
+
+/**
+ * @brief   对[begin, end)区间暴力搜索，返回全局ID
+ */
+std::vector<SearchResult> brute_force(const VectorDataset& dataset, idx_t begin, idx_t end,
+                                      std::span<const float> query, int k) {
+    std::priority_queue<SearchResult> top;
+    for (idx_t i = begin; i < end; ++i) {
+        float d = l2_distance(query, dataset.get_vector(i));
+        if (top.size() < (size_t)k) top.push({i, d});
+        else if (d < top.top().distance) { top.pop(); top.push({i, d}); }
+    }
+    std::vector<SearchResult> results(top.size());
+    for (size_t i = results.size(); i-- > 0;) { results[i] = top.top(); top.pop(); }
+    return results;
+}
+
+int main() {
+    std::cout << "=== Coordinator Test ===" << std::endl;
+    DataGenConfig config;
+    config.dim = DIM;
+    config.count = N_VECTORS;
+    config.n_centers = 20;
+
+    // 每个分片进程持有一个Flat集合，数据由协调节点按ID哈希写入；分片1每隔一个查询慢20ms，用于触发对冲
+    const std::string data_dir = "test_coordinator_data";
+    std::filesystem::remove_all(data_dir);
+    LocalCluster cluster(N_SHARDS, [&](int shard) -> ShardServer::Handlers {
+        CollectionConfig shard_config;
+        shard_config.name = "shard" + std::to_string(shard);
+        shard_config.dim = DIM;
+        shard_config.index_type = IndexType::Flat;
+        shard_config.data_dir = data_dir;
+        auto collection = std::make_shared<Collection>(shard_config);
+        auto calls = std::make_shared<std::atomic<int>>(0);
+        auto search = [=](std::span<const float> query, int k) {
+            if (shard == 1 && (*calls)++ % 2 == 0) {
+                std::this_thread::sleep_for(std::chrono::milliseconds(20));
+            }
+            return collection->search(query, k);
+        };
+        auto insert = [=](std::span<const float> vec) {
+            return collection->insert(std::vector<float>(vec.begin(), vec.end()));
+        };
+        return {search, insert};
+    });
+
+    DataGenerator generator(config);
+    VectorDataset dataset = generator.generate();
+    auto queries = generator.generate_queries(10);
+
+    CoordinatorOptions options;
+    options.hedge_delay = std::chrono::microseconds(2000);
+    Coordinator coordinator(cluster.endpoints(), options);
+
+    for (idx_t i = 0; i < N_VECTORS; ++i) {
+        idx_t id = coordinator.insert(dataset.get_vector(i));
+        assert(id == i);
+    }
+    size_t total = 0;
+    for (int s = 0; s < N_SHARDS; ++s) {
+        size_t shard_size = coordinator.shard_size(s);
+        std::cout << "  shard " << s << ": " << shard_size << " vectors" << std::endl;
+        assert(shard_size > N_VECTORS / N_SHARDS / 2);
+        total += shard_size;
+    }
+    assert(total == N_VECTORS);
+    std::cout << "✓ inserts hash-partitioned across shards" << std::endl;
+
+    // 各分片返回本地ID，协调节点映射回全局ID后应与全量暴力搜索一致
+    for (const auto& q : queries) {
+        auto merged = coordinator.search(q, 10);
+        auto expected = brute_force(dataset, 0, N_VECTORS, q, 10);
+        assert(merged.size() == expected.size());
+        for (size_t i = 0; i < merged.size(); ++i) assert(merged[i].id == expected[i].id);
+    }
+    std::cout << "✓ scatter-gather matches brute force" << std::endl;
+
+    std::cout << "Hedges sent: " << coordinator.hedges_sent()
+              << ", won: " << coordinator.hedges_won() << std::endl;
+    assert(coordinator.hedges_won() > 0);
+    std::cout << "✓ hedged requests cut slow shard" << std::endl;
+
+    // merge_topk 单元测试
+    auto merged = merge_topk({{{1, 0.1f}, {2, 0.5f}}, {}, {{3, 0.2f}, {4, 0.3f}}}, 3);
+    assert(merged.size() == 3 && merged[0].id == 1 && merged[1].id == 3 && merged[2].id == 4);
+    std::cout << "✓ k-way merge passed" << std::endl;
+
+    cluster.shutdown();
+    std::filesystem::remove_all(data_dir);
+
+    // 副本故障转移：第一个副本不可连接、第二个副本返回错误时都转向可用副本
+    {
+        auto search_fn = [&](std::span<const float> query, int k) {
+            return brute_force(dataset, 0, N_VECTORS, query, k);
+        };
+        ShardServer good(search_fn);
+        int good_port = good.start();
+        ShardServer failing([](std::span<const float>, int) -> std::vector<SearchResult> {
+            throw std::runtime_error("replica broken");
+        });
+        int failing_port = failing.start();
+        int dead_port = 0;
+        {
+            ShardServer dead(search_fn);
+            dead_port = dead.start();
+        }
+
+        CoordinatorOptions no_hedge;
+        no_hedge.hedging = false;
+        Coordinator failover({{{"127.0.0.1", dead_port}, {"127.0.0.1", good_port}},
+                              {{"127.0.0.1", failing_port}, {"127.0.0.1", good_port}}}, no_hedge);
+        auto results = failover.search(queries[0], 10);
+        auto expected = brute_force(dataset, 0, N_VECTORS, queries[0], 10);
+        assert(results.size() == 10 && results[0].id == expected[0].id);
+        assert(failover.retries() >= 1);
+
+        bool threw = false;
+        try {
+            Coordinator({{{"127.0.0.1", dead_port}}}, no_hedge).search(queries[0], 10);
+        } catch (const std::runtime_error&) {
+            threw = true;
+        }
+        assert(threw);
+        std::cout << "✓ replica failover passed" << std::endl;
+
+        // 服务端重启后池中的空闲连接失效：换新连接重试一次
+        Coordinator pooled({{{"127.0.0.1", good_port}}}, no_hedge);
+        pooled.search(queries[0], 10);
+        good.stop();
+        ShardServer restarted(search_fn);
+        restarted.start(good_port);
+        assert(pooled.search(queries[1], 10).size() == 10);
+        assert(pooled.retries() == 1);
+        std::cout << "✓ stale pooled connection retried" << std::endl;
+
+        // 非法k被拒绝；已关闭连接的服务线程被回收
+        for (int bad_k : {0, -1, kMaxSearchK + 1}) {
+            threw = false;
+            try {
+                pooled.search(queries[0], bad_k);
+            } catch (const std::invalid_argument&) {
+                threw = true;
+            }
+            assert(threw);
+            threw = false;
+            try {
+                uint64_t id;
+                int k;
+                std::vector<float> q;
+                decode_search_request(encode_search_request(1, bad_k, queries[0]), id, k, q);
+            } catch (const std::runtime_error&) {
+                threw = true;
+            }
+            assert(threw);
+        }
+        for (int i = 0; i < 50; ++i) {
+            int fd = connect_tcp("127.0.0.1", good_port);
+            assert(fd >= 0);
+            bool sent = send_frame(fd, MessageType::SearchRequest, encode_search_request(i, 1, queries[0]));
+            assert(sent);
+            MessageType type;
+            std::string payload;
+            bool received = recv_frame(fd, type, payload);
+            assert(received && type == MessageType::SearchResponse);
+            ::close(fd);
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+        int fd = connect_tcp("127.0.0.1", good_port);
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+        assert(restarted.client_threads() <= 3);
+        ::close(fd);
+        std::cout << "✓ request validation and thread reaping passed" << std::endl;
+    }
+
+    std::cout << "ALL TESTS PASSED! 🚀" << std::endl;
+    return 0;
+}
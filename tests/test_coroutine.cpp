@@ -0,0 +1,217 @@
+/**
+ * @file    test_coroutine.cpp
+ * @brief   协程任务、事件循环与协程分片服务端测试
+ */
+
+#include <iostream>
+#include <cassert>
+#include <filesystem>
+#include <random>
+#include <thread>
+#include <atomic>
+#include "../src/core/async_shard_server.hpp"
+#include "../src/core/coordinator.hpp"
+#include "../src/core/uring_storage.hpp"
+
+using namespace minimilvus;
+
+Task<int> add_one(int x) { co_return x + 1; }
+
+Task<int> chain(int x) {
+    int a = co_await add_one(x);
+    int b = co_await add_one(a);
+    co_return b;
+}
+
+Task<void> fail() {
+    throw std::runtime_error("boom");
+    co_return;
+}
+
+Task<int> on_pool(ThreadPool& pool, std::thread::id caller) {
+    co_await resume_on(pool);
+    co_return std::this_thread::get_id() != caller ? 1 : 0;
+}
+
+Task<void> sleeper(EventLoop& loop, int ms, std::vector<int>& order) {
+    co_await loop.sleep_for(std::chrono::milliseconds(ms));
+    order.push_back(ms);
+}
+
+Task<void> read_rows(EventLoop& loop, const VectorFile& file, std::vector<float>& out, int& finished) {
+    const size_t dim = file.get_dim();
+    for (idx_t i = 0; i < 4; ++i) {
+        int n = co_await file.async_fetch(i * 10, {out.data() + i * dim, dim});
+        assert(n == static_cast<int>(dim * sizeof(float)));
+    }
+    if (++finished == 8) loop.stop();
+}
+
+int main() {
+    std::cout << "=== Coroutine Test ===" << std::endl;
+
+    // 1. Task链式调用与异常传播
+    assert(sync_wait(chain(1)) == 3);
+    bool thrown = false;
+    try {
+        sync_wait(fail());
+    } catch (const std::runtime_error&) {
+        thrown = true;
+    }
+    assert(thrown);
+    ThreadPool pool(2);
+    assert(sync_wait(on_pool(pool, std::this_thread::get_id())) == 1);
+    std::cout << "✓ task chaining / exceptions / resume_on passed" << std::endl;
+
+    // 2. 定时器按截止时间顺序恢复
+    {
+        EventLoop loop;
+        std::vector<int> order;
+        loop.post([&] {
+            spawn(sleeper(loop, 30, order));
+            spawn(sleeper(loop, 10, order));
+            spawn(sleeper(loop, 20, order));
+        });
+        loop.post([&] { spawn([](EventLoop& l) -> Task<void> {
+            co_await l.sleep_for(std::chrono::milliseconds(50));
+            l.stop();
+        }(loop)); });
+        loop.run();
+        assert((order == std::vector<int>{10, 20, 30}));
+    }
+    std::cout << "✓ event loop timers passed" << std::endl;
+
+    // 2.1 投递队列溢出时仍按投递顺序执行
+    {
+        EventLoop loop(8);
+        std::vector<int> order;
+        std::thread loop_thread([&] { loop.run(); });
+        const int n_posts = 20000;
+        for (int i = 0; i < n_posts; ++i) loop.post([&order, i] { order.push_back(i); });
+        std::atomic<bool> done{false};
+        loop.post([&] { done = true; });
+        while (!done) std::this_thread::yield();
+        loop.stop();
+        loop_thread.join();
+        assert(order.size() == static_cast<size_t>(n_posts));
+        for (int i = 0; i < n_posts; ++i) assert(order[i] == i);
+    }
+    std::cout << "✓ event loop post order passed" << std::endl;
+
+    // 3. 事件循环驱动io_uring，多个协程并发读取
+    if (IoUring::supported()) {
+        const std::string path = "test_coroutine_vectors.mmvd";
+        VectorDataset dataset(8);
+        for (idx_t i = 0; i < 100; ++i) dataset.add(std::vector<float>(8, static_cast<float>(i)));
+        dataset.save(path);
+        IoUring ring(32);
+        VectorFile file(path, &ring);
+        EventLoop loop;
+        loop.attach(ring);
+        std::vector<std::vector<float>> outs(8, std::vector<float>(4 * 8));
+        int finished = 0;
+        loop.post([&] {
+            for (auto& out : outs) spawn(read_rows(loop, file, out, finished));
+        });
+        loop.run();
+        for (const auto& out : outs) assert(out[3 * 8] == 30.0f);
+        std::filesystem::remove(path);
+        std::cout << "✓ io_uring on event loop passed" << std::endl;
+    }
+
+    // 4. 协程分片服务端：单循环线程承载大量并发连接
+    const int dim = 16;
+    VectorDataset dataset(dim);
+    std::mt19937 rng(5);
+    std::normal_distribution<float> dist;
+    for (auto& x : dataset.extend(2000)) x = dist(rng);
+    auto brute_force = [&](std::span<const float> q, int k) {
+        std::vector<SearchResult> all;
+        for (idx_t i = 0; i < dataset.get_count(); ++i) all.push_back({i, l2_distance(q, dataset.get_vector(i))});
+        std::partial_sort(all.begin(), all.begin() + k, all.end(),
+                          [](const SearchResult& a, const SearchResult& b) { return a.distance < b.distance; });
+        all.resize(k);
+        return all;
+    };
+
+    EventLoop loop;
+    std::thread loop_thread([&] { loop.run(); });
+    AsyncShardServer server(loop, brute_force, &pool);
+    int port = server.start();
+
+    const int n_clients = 200;
+    std::vector<int> fds;
+    std::vector<std::vector<float>> queries;
+    for (int c = 0; c < n_clients; ++c) {
+        int fd = connect_tcp("127.0.0.1", port);
+        assert(fd >= 0);
+        std::vector<float> q(dim);
+        for (auto& x : q) x = dist(rng);
+        bool sent = send_frame(fd, MessageType::SearchRequest, encode_search_request(c, 5, q));
+        assert(sent);
+        fds.push_back(fd);
+        queries.push_back(q);
+    }
+    for (int c = 0; c < n_clients; ++c) {
+        MessageType type;
+        std::string payload;
+        bool received = recv_frame(fds[c], type, payload);
+        assert(received && type == MessageType::SearchResponse);
+        uint64_t request_id = 0;
+        std::vector<SearchResult> results;
+        decode_search_response(payload, request_id, results);
+        auto expected = brute_force(queries[c], 5);
+        assert(request_id == static_cast<uint64_t>(c) && results.size() == 5 && results[0].id == expected[0].id);
+        ::close(fds[c]);
+    }
+    std::cout << "✓ " << n_clients << " concurrent connections passed" << std::endl;
+
+    // 与协调节点互通（关闭对冲，否则负载高时会多发一次请求，计数不确定）
+    {
+        CoordinatorOptions options;
+        options.hedging = false;
+        Coordinator coordinator({{{"127.0.0.1", port}}}, options);
+        auto results = coordinator.search(queries[0], 5);
+        assert(results.size() == 5 && results[0].id == brute_force(queries[0], 5)[0].id);
+    }
+    std::cout << "✓ coordinator interop passed" << std::endl;
+
+    server.stop();
+    loop.stop();
+    loop_thread.join();
+    assert(server.requests_served() == n_clients + 1);
+
+    // 多个事件循环：accept所在循环把新连接投递给其他循环
+    {
+        EventLoop loop_a, loop_b;
+        CoreLayout layout = CoreLayout::split(available_cpus());
+        loop_a.set_affinity(layout.io);
+        loop_b.set_affinity(layout.io);
+        std::thread ta([&] { loop_a.run(); }), tb([&] { loop_b.run(); });
+        AsyncShardServer multi({&loop_a, &loop_b}, brute_force);
+        int multi_port = multi.start();
+        std::vector<int> clients;
+        for (int c = 0; c < 20; ++c) {
+            clients.push_back(connect_tcp("127.0.0.1", multi_port));
+            bool sent = send_frame(clients.back(), MessageType::SearchRequest, encode_search_request(c, 3, queries[c]));
+            assert(sent);
+        }
+        for (int fd : clients) {
+            MessageType type;
+            std::string payload;
+            bool received = recv_frame(fd, type, payload);
+            assert(received && type == MessageType::SearchResponse);
+            ::close(fd);
+        }
+        multi.stop();
+        loop_a.stop();
+        loop_b.stop();
+        ta.join();
+        tb.join();
+        assert(multi.requests_served() == 20);
+    }
+    std::cout << "✓ multi-loop connection handoff passed" << std::endl;
+
+    std::cout << "All coroutine tests passed!" << std::endl;
+    return 0;
+}
@@ -0,0 +1,133 @@
+/**
+ * @file    test_disk_refine.cpp
+ * @brief   磁盘精排索引测试：内存中只有编码，精排读盘取原始向量
+ */
+
+#include <iostream>
+#include <iomanip>
+#include <cassert>
+#include <filesystem>
+#include <set>
+#include "../src/core/index_factory.hpp"
+#include "../src/core/data_generator.hpp"
+
+using namespace minimilvus;
+
+std::vector<std::set<idx_t>> ground_truth(const VectorDataset& dataset,
+                                          const std::vector<std::vector<float>>& queries, int k) {
+    std::vector<std::set<idx_t>> truth;
+    for (const auto& q : queries) {
+        std::vector<SearchResult> all;
+        for (idx_t i = 0; i < dataset.get_count(); ++i) all.push_back({i, l2_distance(q, dataset.get_vector(i))});
+        std::partial_sort(all.begin(), all.begin() + k, all.end());
+        std::set<idx_t> ids;
+        for (int j = 0; j < k; ++j) ids.insert(all[j].id);
+        truth.push_back(ids);
+    }
+    return truth;
+}
+
+double recall(const VectorIndex& index, const std::vector<std::vector<float>>& queries,
+              const std::vector<std::set<idx_t>>& truth, int k, int nprobe) {
+    int hits = 0;
+    for (size_t i = 0; i < queries.size(); ++i) {
+        for (const auto& r : index.search(queries[i], k, nprobe)) hits += truth[i].count(r.id);
+    }
+    return static_cast<double>(hits) / (queries.size() * k);
+}
+
+int main() {
+    std::cout << "=== Disk Refine Test ===" << std::endl;
+    const int DIM = 32, K = 10, NPROBE = 8;
+    const std::string dir = (std::filesystem::temp_directory_path() / "minimilvus_disk_refine").string();
+    std::filesystem::remove_all(dir);
+    std::filesystem::create_directories(dir);
+
+    DataGenConfig config;
+    config.dim = DIM;
+    config.count = 20000;
+    config.n_centers = 50;
+    DataGenerator generator(config);
+    VectorDataset dataset = generator.generate();
+    auto queries = generator.generate_queries(50);
+    auto truth = ground_truth(dataset, queries, K);
+    const std::string vectors_path = dir + "/vectors.mmvd";
+    dataset.save(vectors_path);
+    const double raw_bytes = static_cast<double>(dataset.get_count()) * DIM * sizeof(float);
+
+    // 精排后召回接近Flat，结果距离为精确距离，内存只有编码
+    std::cout << std::left << std::setw(24) << "description" << std::setw(10) << "codes"
+              << std::setw(10) << "refined" << "RAM / raw" << std::endl;
+    for (const char* desc : {"IVF64,SQ8", "IVF64,PQ8", "IVF64,PQ8,Residual"}) {
+        auto plain = index_factory(DIM, desc);
+        plain->build(dataset);
+        DiskRefineIndex refined(index_factory(DIM, desc), vectors_path, 8);
+        refined.build(dataset);
+        assert(refined.description() == std::string(desc) + ",RefineDisk");
+
+        double r_plain = recall(*plain, queries, truth, K, NPROBE);
+        double r_refined = recall(refined, queries, truth, K, NPROBE);
+        double ram = refined.memory_report().total().used_bytes / raw_bytes;
+        std::cout << std::setw(24) << desc << std::setw(10) << std::setprecision(3) << r_plain
+                  << std::setw(10) << r_refined << ram << std::endl;
+        bool pq = IndexSpec::parse(desc).codec == "PQ";
+        assert(r_refined >= r_plain);
+        assert(r_refined > (pq ? 0.6 : 0.95));
+        if (pq) assert(ram < 0.5);
+
+        auto results = refined.search(queries[0], K, NPROBE);
+        assert(static_cast<int>(results.size()) == K);
+        for (size_t j = 0; j < results.size(); ++j) {
+            assert(results[j].distance == l2_distance(queries[0], dataset.get_vector(results[j].id)));
+            if (j) assert(results[j - 1].distance <= results[j].distance);
+        }
+    }
+    std::cout << "✓ refine recall passed" << std::endl;
+
+    // io_uring读取与pread结果一致
+    if (IoUring::supported()) {
+        IoUring ring(64);
+        std::string inner_path = dir + "/inner.idx";
+        auto inner = index_factory(DIM, "IVF64,PQ8");
+        inner->build(dataset);
+        inner->save(inner_path);
+        DiskRefineIndex with_ring(load_index(inner_path), vectors_path, 4, &ring);
+        DiskRefineIndex with_pread(load_index(inner_path), vectors_path, 4);
+        for (int i = 0; i < 5; ++i) {
+            auto a = with_ring.search(queries[i], K, NPROBE);
+            auto b = with_pread.search(queries[i], K, NPROBE);
+            assert(a.size() == b.size());
+            for (size_t j = 0; j < a.size(); ++j) assert(a[j].id == b[j].id && a[j].distance == b[j].distance);
+        }
+        std::cout << "✓ io_uring fetch passed" << std::endl;
+    }
+
+    // 内积度量、保存加载、越界ID
+    {
+        DiskRefineIndex ip(index_factory(DIM, "IVF32,SQ8", MetricType::IP), vectors_path);
+        ip.build(dataset);
+        auto results = ip.search(queries[0], K, 32);
+        for (const auto& r : results) assert(r.distance == IPMetric::distance(queries[0], dataset.get_vector(r.id)));
+
+        std::string path = dir + "/refine.idx";
+        ip.save(path);
+        auto loaded = load_index(path);
+        assert(loaded->description() == "IVF32,SQ8,RefineDisk" && loaded->metric() == MetricType::IP);
+        auto again = loaded->search(queries[0], K, 32);
+        assert(again.size() == results.size());
+        for (size_t j = 0; j < again.size(); ++j) assert(again[j].id == results[j].id);
+
+        bool threw = false;
+        try {
+            ip.add(dataset.get_vector(0), dataset.get_count());
+        } catch (const std::out_of_range&) {
+            threw = true;
+        }
+        assert(threw);
+    }
+    std::cout << "✓ inner product and persistence passed" << std::endl;
+
+    std::filesystem::remove_all(dir);
+    std::cout << "All disk refine tests passed!" << std::endl;
+    return 0;
+}
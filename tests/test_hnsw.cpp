@@ -0,0 +1,163 @@
+/**
+ * @file    test_hnsw.cpp
+ * @brief   HNSW图索引测试：并行构建、节点布局、访问标记复用与持久化
+ */
+
+#include <iostream>
+#include <iomanip>
+#include <cassert>
+#include <chrono>
+#include <filesystem>
+#include <set>
+#include "../src/core/index_factory.hpp"
+#include "../src/core/data_generator.hpp"
+
+using namespace minimilvus;
+
+template<typename Metric = L2Metric>
+std::vector<std::set<idx_t>> ground_truth(const VectorDataset& dataset,
+                                          const std::vector<std::vector<float>>& queries, int k) {
+    std::vector<std::set<idx_t>> truth;
+    for (const auto& q : queries) {
+        std::vector<SearchResult> all;
+        for (idx_t i = 0; i < dataset.get_count(); ++i) all.push_back({i, Metric::distance(q, dataset.get_vector(i))});
+        std::partial_sort(all.begin(), all.begin() + k, all.end());
+        std::set<idx_t> ids;
+        for (int j = 0; j < k; ++j) ids.insert(all[j].id);
+        truth.push_back(ids);
+    }
+    return truth;
+}
+
+template<typename Index>
+double recall(const Index& index, const std::vector<std::vector<float>>& queries,
+              const std::vector<std::set<idx_t>>& truth, int k, int ef, idx_t id_offset = 0) {
+    int hits = 0;
+    for (size_t i = 0; i < queries.size(); ++i) {
+        auto results = index.search(queries[i], k, ef);
+        assert(static_cast<int>(results.size()) == k);
+        for (size_t j = 0; j < results.size(); ++j) {
+            if (j) assert(results[j - 1].distance <= results[j].distance);
+            hits += truth[i].count(results[j].id - id_offset);
+        }
+    }
+    return static_cast<double>(hits) / (queries.size() * k);
+}
+
+int main() {
+    std::cout << "=== HNSW Test ===" << std::endl;
+    const int DIM = 32, K = 10, M = 16;
+
+    DataGenConfig config;
+    config.dim = DIM;
+    config.count = 20000;
+    config.n_centers = 50;
+    DataGenerator generator(config);
+    VectorDataset dataset = generator.generate();
+    auto queries = generator.generate_queries(100);
+    auto truth = ground_truth(dataset, queries, K);
+
+    // 并行批量构建：ef越大召回越高，外部ID保持first_id偏移
+    const idx_t ID_OFFSET = 1000000;
+    HNSW<> index(DIM, M, 100);
+    auto t0 = std::chrono::steady_clock::now();
+    index.add(dataset, ID_OFFSET);
+    double build_s = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+    assert(index.size() == static_cast<size_t>(dataset.get_count()));
+    double r16 = recall(index, queries, truth, K, 16, ID_OFFSET);
+    double r64 = recall(index, queries, truth, K, 64, ID_OFFSET);
+    std::cout << std::setprecision(3) << "  build " << build_s << "s on " << omp_get_max_threads()
+              << " threads, max level " << index.max_level() << ", recall ef=16: " << r16
+              << ", ef=64: " << r64 << std::endl;
+    assert(r64 > 0.95 && r64 >= r16);
+
+    QueryProfile profile;
+    index.search(queries[0], K, 64, &profile);
+    std::cout << "  distances per query: " << profile.vectors_scanned << std::endl;
+    assert(profile.vectors_scanned > 0 && profile.vectors_scanned < dataset.get_count() / 4);
+    std::cout << "✓ parallel build passed" << std::endl;
+
+    // 节点布局：第0层按64字节对齐，向量连续存放，邻居数不超过2M且无自环
+    {
+        assert(index.node_stride() % HNSW<>::kNodeAlignment == 0);
+        assert(index.node_stride() >= DIM * sizeof(float) + (2 * M + 1) * sizeof(uint32_t));
+        for (size_t i = 0; i < 1000; ++i) {
+            assert(reinterpret_cast<uintptr_t>(index.node_vector(i)) % HNSW<>::kNodeAlignment == 0);
+            auto vec = dataset.get_vector(i);
+            assert(std::equal(vec.begin(), vec.end(), index.node_vector(i)));
+            auto nbs = index.neighbors(i);
+            assert(!nbs.empty() && nbs.size() <= static_cast<size_t>(2 * M));
+            for (idx_t nb : nbs) assert(nb != ID_OFFSET + static_cast<idx_t>(i));
+        }
+    }
+    std::cout << "✓ node layout passed" << std::endl;
+
+    // 逐个插入（扩容路径）与并行构建召回相当
+    {
+        HNSW<> serial(DIM, M, 100);
+        for (idx_t i = 0; i < dataset.get_count(); ++i) serial.add(dataset.get_vector(i), i);
+        double r = recall(serial, queries, truth, K, 64);
+        std::cout << "  incremental insert recall ef=64: " << r << std::endl;
+        assert(r > 0.95);
+    }
+    std::cout << "✓ incremental insert passed" << std::endl;
+
+    // 访问标记轮次回绕（>65535次搜索）后结果不变
+    {
+        DataGenConfig small_config = config;
+        small_config.count = 500;
+        VectorDataset small = DataGenerator(small_config).generate();
+        HNSW<> small_index(DIM, 8, 40);
+        small_index.add(small);
+        auto expected = small_index.search(queries[0], K, 16);
+        for (int i = 0; i < 70000; ++i) small_index.search(queries[i % queries.size()], K, 16);
+        auto again = small_index.search(queries[0], K, 16);
+        assert(again.size() == expected.size());
+        for (size_t j = 0; j < again.size(); ++j) assert(again[j].id == expected[j].id);
+    }
+    std::cout << "✓ visited epoch wrap passed" << std::endl;
+
+    // 工厂创建、保存加载、内积度量
+    {
+        auto hnsw = index_factory(DIM, "HNSW16");
+        hnsw->build(dataset);
+        assert(hnsw->description() == "HNSW16" && hnsw->is_trained());
+        assert(hnsw->memory_report().components.count("level0"));
+        std::string path = (std::filesystem::temp_directory_path() / "minimilvus_hnsw.idx").string();
+        hnsw->save(path);
+        auto loaded = load_index(path);
+        assert(loaded->description() == "HNSW16" && loaded->size() == hnsw->size());
+        for (size_t i = 0; i < 20; ++i) {
+            auto a = hnsw->search(queries[i], K, 32);
+            auto b = loaded->search(queries[i], K, 32);
+            assert(a.size() == b.size());
+            for (size_t j = 0; j < a.size(); ++j) assert(a[j].id == b[j].id && a[j].distance == b[j].distance);
+        }
+
+        auto ip = index_factory(DIM, "HNSW16", MetricType::IP);
+        ip->build(dataset);
+        ip->save(path);
+        auto ip_loaded = load_index(path);
+        assert(ip_loaded->metric() == MetricType::IP);
+        auto ip_truth = ground_truth<IPMetric>(dataset, queries, K);
+        double r = recall(*ip_loaded, queries, ip_truth, K, 128);
+        std::cout << "  inner product recall ef=128: " << r << std::endl;
+        assert(r > 0.8);
+        std::filesystem::remove(path);
+    }
+    std::cout << "✓ factory and persistence passed" << std::endl;
+
+    for (const char* bad : {"HNSW", "HNSW1", "HNSWx", "HNSW16,Flat"}) {
+        bool threw = false;
+        try {
+            index_factory(DIM, bad);
+        } catch (const std::invalid_argument&) {
+            threw = true;
+        }
+        assert(threw);
+    }
+    std::cout << "✓ description validation passed" << std::endl;
+
+    std::cout << "All HNSW tests passed!" << std::endl;
+    return 0;
+}
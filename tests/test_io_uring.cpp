@@ -0,0 +1,155 @@
+/**
+ * @file    test_io_uring.cpp
+ * @brief   io_uring存储层测试
+ */
+
+#include <iostream>
+#include <cassert>
+#include <filesystem>
+#include <random>
+#include "../src/core/uring_storage.hpp"
+#include "../src/core/collection.hpp"
+
+using namespace minimilvus;
+
+/**
+ * @brief   最简单的立即执行协程，结束后自行销毁
+ */
+struct FireAndForget {
+    struct promise_type {
+        FireAndForget get_return_object() { return {}; }
+        std::suspend_never initial_suspend() noexcept { return {}; }
+        std::suspend_never final_suspend() noexcept { return {}; }
+        void return_void() {}
+        void unhandled_exception() { std::terminate(); }
+    };
+};
+
+FireAndForget fetch_rows(const VectorFile& file, std::vector<idx_t> ids, std::vector<float>& out, int& finished) {
+    const size_t dim = file.get_dim();
+    for (size_t i = 0; i < ids.size(); ++i) {
+        int n = co_await file.async_fetch(ids[i], {out.data() + i * dim, dim});
+        assert(n == static_cast<int>(dim * sizeof(float)));
+    }
+    finished++;
+}
+
+int main() {
+    std::cout << "=== io_uring Storage Test ===" << std::endl;
+    if (!IoUring::supported()) {
+        std::cout << "io_uring not available, skipping" << std::endl;
+        return 0;
+    }
+    const std::string dir = "test_io_uring_data";
+    std::filesystem::remove_all(dir);
+    std::filesystem::create_directories(dir);
+
+    const int dim = 32;
+    VectorDataset dataset(dim);
+    std::mt19937 rng(3);
+    std::normal_distribution<float> dist;
+    for (auto& x : dataset.extend(5000)) x = dist(rng);
+    dataset.save(dir + "/vectors.mmvd");
+
+    IoUring ring(64);
+
+    // 1. 批量随机读取（含相邻合并），与pread回退路径结果一致
+    VectorFile file(dir + "/vectors.mmvd", &ring);
+    VectorFile fallback(dir + "/vectors.mmvd");
+    std::vector<idx_t> ids = {4999, 7, 8, 9, 1234, 0, 300};
+    std::vector<float> out(ids.size() * dim), out_fallback(ids.size() * dim);
+    file.fetch(ids, out);
+    fallback.fetch(ids, out_fallback);
+    for (size_t i = 0; i < ids.size(); ++i) {
+        auto expected = dataset.get_vector(ids[i]);
+        assert(std::equal(expected.begin(), expected.end(), out.begin() + i * dim));
+    }
+    assert(out == out_fallback);
+    std::cout << "✓ batched fetch passed" << std::endl;
+
+    // 2. 段加载（注册缓冲区 + 多个分块同时在途）
+    VectorDataset loaded = file.load(64 << 10);
+    assert(loaded.get_count() == dataset.get_count());
+    for (idx_t i = 0; i < dataset.get_count(); i += 97) {
+        auto a = dataset.get_vector(i), b = loaded.get_vector(i);
+        assert(std::equal(a.begin(), a.end(), b.begin()));
+    }
+    std::cout << "✓ segment load passed" << std::endl;
+
+    // 3. 多个协程各自co_await读取，由poll驱动
+    const int n_tasks = 16;
+    std::vector<std::vector<float>> task_out(n_tasks, std::vector<float>(4 * dim));
+    int finished = 0;
+    for (int t = 0; t < n_tasks; ++t) {
+        fetch_rows(file, {t * 4, t * 4 + 100, t * 4 + 200, t * 4 + 300}, task_out[t], finished);
+    }
+    assert(ring.pending() == n_tasks);
+    while (finished < n_tasks) ring.poll();
+    for (int t = 0; t < n_tasks; ++t) {
+        auto expected = dataset.get_vector(t * 4 + 300);
+        assert(std::equal(expected.begin(), expected.end(), task_out[t].begin() + 3 * dim));
+    }
+    std::cout << "✓ coroutine awaitables passed" << std::endl;
+
+    // 4. WAL组提交与逐条写入交替
+    {
+        WAL wal(dir + "/group_commit.wal");
+        std::vector<std::pair<std::string, std::string>> records;
+        for (int i = 0; i < 1000; ++i) records.emplace_back("ADD_VECTOR", std::to_string(i));
+        assert(wal.append_batch(records));
+        assert(wal.append("ADD_VECTOR", "single"));
+        assert(wal.append_batch(records));
+        size_t count = wal.for_each_record([](const std::string&, const std::string&) {});
+        assert(count == 2001);
+        wal.clear();
+        assert(wal.append_batch(records));
+        assert(wal.for_each_record([](const std::string&, const std::string&) {}) == 1000);
+    }
+    std::cout << "✓ WAL batch append passed" << std::endl;
+
+    // 4.1 多个WAL共享写入池：ring数量不随WAL数增长；未完成的请求在ring析构前被等待
+    {
+        std::vector<std::unique_ptr<WAL>> wals;
+        std::vector<std::pair<std::string, std::string>> records(10, {"ADD_VECTOR", "x"});
+        for (int i = 0; i < 16; ++i) {
+            wals.push_back(std::make_unique<WAL>(dir + "/shared_" + std::to_string(i) + ".wal"));
+            assert(wals.back()->append_batch(records));
+        }
+        assert(UringWriterPool::shared().rings() <= UringWriterPool::shared().slots());
+        for (const auto& wal : wals) assert(wal->for_each_record([](const std::string&, const std::string&) {}) == 10);
+
+        if (IoUring::supported()) {
+            auto buffer = std::make_unique<std::vector<char>>(1 << 16);
+            int fd = ::open((dir + "/vectors.mmvd").c_str(), O_RDONLY);
+            assert(fd >= 0);
+            IoCompletion completion;
+            {
+                IoUring ring(8);
+                ring.prepare(IoRequest::read(fd, buffer->data(), static_cast<uint32_t>(buffer->size()), 0), &completion);
+                ring.submit();
+            }
+            // 析构只等待完成、不回填结果
+            assert(!completion.done);
+            ::close(fd);
+        }
+    }
+    std::cout << "✓ shared writer pool passed" << std::endl;
+
+    // 5. 集合批量插入可从WAL恢复
+    {
+        CollectionConfig config{"batch", 4, MetricType::L2, IndexType::Flat, 0, dir};
+        {
+            Collection collection(config);
+            std::vector<std::vector<float>> vecs(100, std::vector<float>(4, 1.0f));
+            assert(collection.insert_batch(vecs) == 0);
+            assert(collection.size() == 100);
+        }
+        Collection reopened(config);
+        assert(reopened.size() == 100);
+    }
+    std::cout << "✓ collection batch insert passed" << std::endl;
+
+    std::filesystem::remove_all(dir);
+    std::cout << "All io_uring tests passed!" << std::endl;
+    return 0;
+}
@@ -0,0 +1,246 @@
+/**
+ * @file    test_ivf_pipeline.cpp
+ * @brief   策略模板IVF与索引工厂测试
+ */
+
+#include <iostream>
+#include <iomanip>
+#include <cassert>
+#include <chrono>
+#include <cmath>
+#include <filesystem>
+#include <map>
+#include <set>
+#include "../src/core/index_factory.hpp"
+#include "../src/core/data_generator.hpp"
+
+using namespace minimilvus;
+
+/**
+ * @brief   暴力搜索的真实Top-K
+ */
+std::vector<std::set<idx_t>> ground_truth(const VectorDataset& dataset,
+                                          const std::vector<std::vector<float>>& queries,
+                                          int k, MetricType metric) {
+    std::vector<std::set<idx_t>> truth;
+    for (const auto& q : queries) {
+        std::vector<SearchResult> all;
+        for (idx_t i = 0; i < dataset.get_count(); ++i) {
+            float d = metric == MetricType::L2 ? L2Metric::distance(q, dataset.get_vector(i))
+                                               : IPMetric::distance(q, dataset.get_vector(i));
+            all.push_back({i, d});
+        }
+        std::partial_sort(all.begin(), all.begin() + k, all.end());
+        std::set<idx_t> ids;
+        for (int j = 0; j < k; ++j) ids.insert(all[j].id);
+        truth.push_back(ids);
+    }
+    return truth;
+}
+
+double recall(const VectorIndex& index, const std::vector<std::vector<float>>& queries,
+              const std::vector<std::set<idx_t>>& truth, int k, int nprobe) {
+    int hits = 0;
+    for (size_t i = 0; i < queries.size(); ++i) {
+        for (const auto& r : index.search(queries[i], k, nprobe)) hits += truth[i].count(r.id);
+    }
+    return static_cast<double>(hits) / (queries.size() * k);
+}
+
+int main() {
+    std::cout << "=== IVF Pipeline Test ===" << std::endl;
+    const int DIM = 32, K = 10, NPROBE = 8;
+
+    // FP16往返误差在半精度舍入范围内，溢出为inf
+    {
+        for (float x : {0.0f, 1.0f, -2.5f, 65504.0f, 1e-5f, 3.14159f}) {
+            float y = half_to_float(float_to_half(x));
+            assert(std::fabs(x - y) <= std::fabs(x) * 1e-3f + 1e-7f);
+        }
+        assert(std::isinf(half_to_float(float_to_half(1e6f))));
+    }
+    std::cout << "✓ fp16 conversion passed" << std::endl;
+
+    DataGenConfig config;
+    config.dim = DIM;
+    config.count = 20000;
+    config.n_centers = 50;
+    DataGenerator generator(config);
+    VectorDataset dataset = generator.generate();
+    auto queries = generator.generate_queries(50);
+    auto truth_l2 = ground_truth(dataset, queries, K, MetricType::L2);
+
+    {
+        SQ8Codec sq(DIM);
+        sq.train(dataset);
+        std::vector<uint8_t> code(sq.code_size());
+        std::vector<float> decoded(DIM);
+        auto vec = dataset.get_vector(7);
+        sq.encode(vec, code.data());
+        sq.decode(code.data(), decoded.data());
+        float exact = l2_distance(queries[0], vec);
+        float approx = sq.scanner<L2Metric>(queries[0])(code.data());
+        assert(std::fabs(approx - l2_distance(queries[0], decoded)) <= 1e-3f * (1.0f + approx));
+        assert(std::fabs(approx - exact) <= 0.05f * exact + 1.0f);
+    }
+    std::cout << "✓ sq8 scanner matches decode passed" << std::endl;
+
+    // 编译期组合：直接实例化模板
+    {
+        IVF<L2Metric, FlatCodec, VectorListStorage> flat(DIM, 64);
+        flat.build(dataset);
+        assert(flat.size() == static_cast<size_t>(dataset.get_count()));
+        assert(flat.description() == "IVF64,Flat");
+        auto results = flat.search(dataset.get_vector(123), 1, 4);
+        assert(results.size() == 1 && results[0].id == 123 && results[0].distance == 0.0f);
+
+        IVF<L2Metric, SQ8Codec, PagedListStorage> paged(DIM, 64);
+        paged.build(dataset);
+        assert(paged.description() == "IVF64,SQ8,Paged");
+        assert(paged.search(dataset.get_vector(5), 1, 4)[0].id == 5);
+    }
+    std::cout << "✓ compile-time pipelines passed" << std::endl;
+
+    // 运行时工厂：各编码器的召回与内存
+    std::cout << std::left << std::setw(28) << "description" << std::setw(10) << "recall"
+              << std::setw(14) << "bytes/vec" << "us/query" << std::endl;
+    std::map<std::string, double> recalls;
+    for (const char* desc : {"IVF64,Flat", "IVF64,FP16", "IVF64,SQ8", "IVF64,SQ8,ResidualPerList", "IVF64,PQ8",
+                             "IVF64,PQ8,Residual", "IVF64,PQ16,Paged"}) {
+        auto index = index_factory(DIM, desc);
+        index->build(dataset);
+        assert(index->description() == desc);
+        auto t0 = std::chrono::steady_clock::now();
+        double r = recall(*index, queries, truth_l2, K, NPROBE);
+        double us = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - t0).count()
+                    / queries.size();
+        double bytes = static_cast<double>(index->memory_report().total().used_bytes) / index->size();
+        std::cout << std::setw(28) << desc << std::setw(10) << std::setprecision(3) << r
+                  << std::setw(14) << std::setprecision(4) << bytes << std::setprecision(3) << us << std::endl;
+        recalls[desc] = r;
+        std::string codec = IndexSpec::parse(desc).codec;
+        if (codec == "Flat" || codec == "FP16") assert(r > 0.9);
+        if (codec == "SQ8") assert(r > 0.8);
+        if (codec == "PQ") assert(r > 0.2);
+    }
+    assert(recalls["IVF64,PQ8,Residual"] > recalls["IVF64,PQ8"]);
+    assert(recalls["IVF64,SQ8,ResidualPerList"] >= recalls["IVF64,SQ8"] - 0.02);
+    std::cout << "✓ factory pipelines passed" << std::endl;
+
+    // 残差PQ预计算表：||q-c||² + (||r||² + 2<c,r>) - 2<q,r> 与直接对 q-c 建表一致
+    {
+        PQCodec pq(DIM, 8);
+        pq.train(dataset);
+        auto q = queries[1];
+        auto c = dataset.get_vector(42);
+        std::vector<float> qc(DIM);
+        for (int d = 0; d < DIM; ++d) qc[d] = q[d] - c[d];
+        auto table = pq.residual_term_table(c);
+        auto query_term = pq.inner_product_table(q);
+        for (size_t i = 0; i < table.size(); ++i) table[i] -= 2.0f * query_term[i];
+        PQCodec::Scanner<L2Metric> precomputed(pq.segments(), std::move(table), l2_distance(q, c));
+        auto direct = pq.scanner<L2Metric>(qc);
+        std::vector<uint8_t> code(pq.code_size());
+        for (int i = 0; i < 20; ++i) {
+            pq.encode(dataset.get_vector(i * 97), code.data());
+            assert(std::fabs(precomputed(code.data()) - direct(code.data())) <= 1e-3f * (1.0f + direct(code.data())));
+        }
+
+        IVF<L2Metric, PQCodec, VectorListStorage> residual(DIM, 64, PQCodec(DIM, 8), ResidualMode::Global);
+        residual.build(dataset);
+        assert(residual.memory_report().total().used_bytes > 64 * 8 * 256 * sizeof(float));
+        auto results = residual.search(queries[0], K, NPROBE);
+        for (size_t j = 1; j < results.size(); ++j) assert(results[j - 1].distance <= results[j].distance);
+        // 结果距离等于查询到 c + decode(r) 的距离
+        for (const auto& r : results) {
+            auto vec = dataset.get_vector(r.id);
+            int list = 0;
+            for (int l = 1; l < 64; ++l) {
+                if (l2_distance(vec, {residual.centroids().data() + l * DIM, DIM}) <
+                    l2_distance(vec, {residual.centroids().data() + list * DIM, DIM})) list = l;
+            }
+            std::vector<float> res(DIM), decoded(DIM);
+            for (int d = 0; d < DIM; ++d) res[d] = vec[d] - residual.centroids()[list * DIM + d];
+            residual.codec().encode(res, code.data());
+            residual.codec().decode(code.data(), decoded.data());
+            for (int d = 0; d < DIM; ++d) decoded[d] += residual.centroids()[list * DIM + d];
+            float expect = l2_distance(queries[0], decoded);
+            assert(std::fabs(r.distance - expect) <= 1e-3f * (1.0f + expect));
+        }
+    }
+    std::cout << "✓ residual precomputed tables passed" << std::endl;
+
+    // 内积度量
+    {
+        auto truth_ip = ground_truth(dataset, queries, K, MetricType::IP);
+        for (const char* desc : {"IVF32,SQ8", "IVF32,SQ8,Residual", "IVF32,PQ16,Residual"}) {
+            auto index = index_factory(DIM, desc, MetricType::IP);
+            index->build(dataset);
+            assert(index->metric() == MetricType::IP);
+            double r = recall(*index, queries, truth_ip, K, 32);
+            std::cout << "  IP " << desc << " recall " << r << std::endl;
+            assert(r > (IndexSpec::parse(desc).codec == "PQ" ? 0.3 : 0.8));
+        }
+    }
+    std::cout << "✓ inner product pipeline passed" << std::endl;
+
+    // 保存与加载：load_index根据文件头恢复组合
+    {
+        std::filesystem::path path = std::filesystem::temp_directory_path() / "minimilvus_ivf_pipeline.idx";
+        for (const char* desc : {"IVF32,PQ8,Residual", "IVF32,SQ8,ResidualPerList,Paged", "IVF32,PQ8,Paged"}) {
+            auto index = index_factory(DIM, desc);
+            index->build(dataset);
+            index->save(path.string());
+            auto loaded = load_index(path.string());
+            assert(loaded->description() == desc && loaded->size() == index->size());
+            for (int i = 0; i < 5; ++i) {
+                auto a = index->search(queries[i], K, NPROBE);
+                auto b = loaded->search(queries[i], K, NPROBE);
+                assert(a.size() == b.size());
+                for (size_t j = 0; j < a.size(); ++j) assert(a[j].id == b[j].id && a[j].distance == b[j].distance);
+            }
+        }
+        bool threw = false;
+        try {
+            IVF<IPMetric, PQCodec, PagedListStorage>::load(path.string());
+        } catch (const std::runtime_error&) {
+            threw = true;
+        }
+        assert(threw);
+
+        // 损坏的长度字段按文件大小拒绝，而不是触发超大分配
+        const std::string desc = "IVF32,PQ8,Paged";
+        std::streamoff centroid_len = 12 + 4 + std::string(L2Metric::kName).size() + 4 + desc.size();
+        {
+            std::fstream file(path, std::ios::binary | std::ios::in | std::ios::out);
+            int64_t huge = int64_t(1) << 40;
+            file.seekp(centroid_len);
+            file.write(reinterpret_cast<const char*>(&huge), sizeof(huge));
+        }
+        threw = false;
+        try {
+            load_index(path.string());
+        } catch (const std::runtime_error&) {
+            threw = true;
+        }
+        assert(threw);
+        std::filesystem::remove(path);
+    }
+    std::cout << "✓ save/load round trip passed" << std::endl;
+
+    // 非法描述串
+    for (const char* bad : {"", "HNSW", "IVF", "IVF0,Flat", "IVF16,SQ4", "IVF16,PQ", "IVF16,Flat,Tiered",
+                            "IVF16,Flat,Paged,Residual", "IVF16,PQ8,Residual,Residual"}) {
+        bool threw = false;
+        try {
+            index_factory(DIM, bad);
+        } catch (const std::invalid_argument&) {
+            threw = true;
+        }
+        assert(threw);
+    }
+    std::cout << "✓ description validation passed" << std::endl;
+
+    std::cout << "All IVF pipeline tests passed!" << std::endl;
+    return 0;
+}
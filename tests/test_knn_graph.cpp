@@ -0,0 +1,208 @@
+/**
+ * @file    test_knn_graph.cpp
+ * @brief   kNN图构建与IVF搜索后沿图扩展候选的测试
+ */
+
+#include <iostream>
+#include <iomanip>
+#include <cassert>
+#include <cmath>
+#include <filesystem>
+#include <set>
+#include "../src/core/ivf_index.hpp"
+#include "../src/core/data_generator.hpp"
+
+using namespace minimilvus;
+
+/**
+ * @brief   近似图相对精确图的边召回
+ */
+double graph_recall(const KnnGraph& approx, const KnnGraph& truth) {
+    size_t hits = 0;
+    for (idx_t v = 0; v < truth.size(); ++v) {
+        auto found = approx.neighbors(v);
+        std::set<idx_t> ids(found.begin(), found.end());
+        for (idx_t u : truth.neighbors(v)) hits += ids.count(u);
+    }
+    return static_cast<double>(hits) / truth.num_edges();
+}
+
+int main() {
+    std::cout << "=== kNN Graph Test ===" << std::endl;
+    const int DIM = 32, K = 10, GRAPH_K = 16;
+
+    DataGenConfig config;
+    config.dim = DIM;
+    config.count = 10000;
+    config.n_centers = 50;
+    DataGenerator generator(config);
+    VectorDataset dataset = generator.generate();
+
+    // 精确图：无自环，邻居按距离升序
+    KnnGraph truth = KnnGraph::exact(dataset, GRAPH_K);
+    assert(truth.size() == dataset.get_count() && truth.num_edges() == static_cast<size_t>(dataset.get_count()) * GRAPH_K);
+    for (idx_t v = 0; v < 100; ++v) {
+        auto nbs = truth.neighbors(v);
+        for (size_t j = 0; j < nbs.size(); ++j) {
+            assert(nbs[j] != v);
+            if (j) assert(l2_distance(dataset.get_vector(v), dataset.get_vector(nbs[j - 1])) <=
+                          l2_distance(dataset.get_vector(v), dataset.get_vector(nbs[j])));
+        }
+    }
+    std::cout << "✓ exact graph passed" << std::endl;
+
+    // 分块距离核与逐对计算一致
+    {
+        const size_t nx = 5, ny = 7;
+        std::vector<float> x, y, x_norms, y_norms;
+        for (size_t i = 0; i < nx; ++i) {
+            auto v = dataset.get_vector(i);
+            x.insert(x.end(), v.begin(), v.end());
+            x_norms.push_back(ip_distance(v, v));
+        }
+        for (size_t j = 0; j < ny; ++j) {
+            auto v = dataset.get_vector(100 + j);
+            y.insert(y.end(), v.begin(), v.end());
+            y_norms.push_back(ip_distance(v, v));
+        }
+        std::vector<float> ip(nx * ny), l2(nx * ny);
+        inner_product_block(x.data(), nx, y.data(), ny, DIM, ip.data());
+        l2_distance_block(x.data(), nx, y.data(), ny, DIM, x_norms.data(), y_norms.data(), l2.data());
+        for (size_t i = 0; i < nx; ++i) {
+            for (size_t j = 0; j < ny; ++j) {
+                float exact_ip = ip_distance(dataset.get_vector(i), dataset.get_vector(100 + j));
+                float exact_l2 = l2_distance(dataset.get_vector(i), dataset.get_vector(100 + j));
+                assert(std::fabs(ip[i * ny + j] - exact_ip) <= 1e-4f * (std::fabs(exact_ip) + x_norms[i]));
+                assert(std::fabs(l2[i * ny + j] - exact_l2) <= 1e-4f * (x_norms[i] + y_norms[j]));
+            }
+        }
+    }
+    std::cout << "✓ blocked distance kernels passed" << std::endl;
+
+    // NN-descent：几轮迭代后边召回接近精确图，距离计算远少于暴力的N²/2
+    NNDescentConfig nn_config;
+    nn_config.k = GRAPH_K;
+    NNDescentStats full_stats;
+    auto graph = std::make_shared<const KnnGraph>(nn_descent(dataset, nn_config, &full_stats));
+    double r = graph_recall(*graph, truth);
+    const double brute_pairs = 0.5 * dataset.get_count() * dataset.get_count();
+    std::cout << "  nn-descent edge recall: " << std::setprecision(3) << r << ", " << full_stats.iterations
+              << " iterations, distances / brute force: " << full_stats.distance_computations / brute_pairs << std::endl;
+    assert(graph->size() == dataset.get_count() && r > 0.9);
+    assert(full_stats.distance_computations < brute_pairs);
+    for (idx_t v = 0; v < graph->size(); ++v) {
+        auto nbs = graph->neighbors(v);
+        assert(static_cast<int>(nbs.size()) == GRAPH_K);
+        for (idx_t u : nbs) assert(u != v && u >= 0 && u < dataset.get_count());
+    }
+
+    // 采样：rho越小每轮计算越少，召回仍然可用
+    {
+        NNDescentConfig sampled = nn_config;
+        sampled.rho = 0.5;
+        NNDescentStats sampled_stats;
+        KnnGraph g = nn_descent(dataset, sampled, &sampled_stats);
+        double rs = graph_recall(g, truth);
+        std::cout << "  rho=0.5 edge recall: " << rs << ", distances / brute force: "
+                  << sampled_stats.distance_computations / brute_pairs << std::endl;
+        assert(rs > 0.85);
+        assert(sampled_stats.distance_computations / sampled_stats.iterations <
+               full_stats.distance_computations / full_stats.iterations);
+    }
+
+    // 内积度量
+    {
+        KnnGraph ip_truth = KnnGraph::exact<IPMetric>(dataset, GRAPH_K);
+        KnnGraph ip_graph = nn_descent<IPMetric>(dataset, nn_config);
+        double ri = graph_recall(ip_graph, ip_truth);
+        std::cout << "  inner product edge recall: " << ri << std::endl;
+        assert(ri > 0.8);
+    }
+
+    // 数据量不足k时每个节点只有N-1个邻居
+    {
+        VectorDataset tiny(DIM);
+        for (idx_t i = 0; i < 5; ++i) {
+            auto v = dataset.get_vector(i);
+            tiny.add(std::vector<float>(v.begin(), v.end()));
+        }
+        nn_config.k = 8;
+        KnnGraph small = nn_descent(tiny, nn_config);
+        for (idx_t v = 0; v < 5; ++v) assert(small.neighbors(v).size() == 4);
+
+        bool threw = false;
+        try {
+            nn_config.rho = 0.0;
+            nn_descent(tiny, nn_config);
+        } catch (const std::invalid_argument&) {
+            threw = true;
+        }
+        assert(threw);
+    }
+    std::cout << "✓ nn-descent passed" << std::endl;
+
+    // 保存加载与非法CSR
+    {
+        std::string path = (std::filesystem::temp_directory_path() / "minimilvus_knn.graph").string();
+        graph->save(path);
+        KnnGraph loaded = KnnGraph::load(path);
+        assert(loaded.offsets() == graph->offsets() && loaded.neighbor_array() == graph->neighbor_array());
+        std::filesystem::remove(path);
+
+        bool threw = false;
+        try {
+            KnnGraph bad({0, 3, 2}, {1, 2});
+        } catch (const std::invalid_argument&) {
+            threw = true;
+        }
+        assert(threw);
+    }
+    std::cout << "✓ graph persistence passed" << std::endl;
+
+    // IVF + kNN图：只探测1个桶时，沿图扩展找回边界上的近邻
+    auto queries = generator.generate_queries(100);
+    std::vector<std::set<idx_t>> expected;
+    for (const auto& q : queries) {
+        std::vector<SearchResult> all;
+        for (idx_t i = 0; i < dataset.get_count(); ++i) all.push_back({i, l2_distance(q, dataset.get_vector(i))});
+        std::partial_sort(all.begin(), all.begin() + K, all.end());
+        std::set<idx_t> ids;
+        for (int j = 0; j < K; ++j) ids.insert(all[j].id);
+        expected.push_back(ids);
+    }
+    IVFIndex index(DIM, 64);
+    index.build(dataset);
+    auto eval = [&](int max_nprobe, QueryProfile* profile) {
+        int hits = 0;
+        for (size_t i = 0; i < queries.size(); ++i) {
+            auto results = index.search(queries[i], dataset, K, 10.0f, max_nprobe, 5, profile);
+            std::set<idx_t> ids;
+            for (size_t j = 0; j < results.size(); ++j) {
+                assert(ids.insert(results[j].id).second);
+                if (j) assert(results[j - 1].distance <= results[j].distance);
+                hits += expected[i].count(results[j].id);
+            }
+        }
+        return static_cast<double>(hits) / (queries.size() * K);
+    };
+
+    QueryProfile plain_profile, graph_profile;
+    double plain_1 = eval(1, &plain_profile);
+    double plain_4 = eval(4, nullptr);
+    index.set_graph(graph);
+    double graph_1 = eval(1, &graph_profile);
+    std::cout << "  recall nprobe=1: " << plain_1 << ", nprobe=4: " << plain_4
+              << ", nprobe=1 + graph: " << graph_1 << std::endl;
+    std::cout << "  extra distances per query: " << graph_profile.graph_expanded / queries.size()
+              << ", vectors scanned per query: " << plain_profile.vectors_scanned / queries.size() << std::endl;
+    assert(plain_profile.graph_expanded == 0 && graph_profile.graph_expanded > 0);
+    assert(graph_1 > plain_1 + 0.05);
+    assert(graph_profile.graph_expanded < plain_profile.vectors_scanned);
+
+    index.set_graph(nullptr);
+    assert(index.graph() == nullptr && eval(1, nullptr) == plain_1);
+    std::cout << "✓ graph expansion passed" << std::endl;
+
+    std::cout << "All kNN graph tests passed!" << std::endl;
+    return 0;
+}
@@ -0,0 +1,90 @@
+/**
+ * @file    test_memory_stats.cpp
+ * @brief   内存统计、倒排桶空闲容量回收与报告序列化测试
+ */
+
+#include <iostream>
+#include <cassert>
+#include <string>
+#include "../src/core/ivf_index.hpp"
+#include "../src/core/data_generator.hpp"
+#include "../src/core/api/api.hpp"
+
+using namespace minimilvus;
+
+int main() {
+    std::cout << "=== Memory Stats Test ===" << std::endl;
+    const int DIM = 16, N_LISTS = 32;
+
+    // vector_memory区分size与capacity
+    std::vector<int> v;
+    v.reserve(100);
+    v.resize(10);
+    MemoryUsage usage = vector_memory(v);
+    assert(usage.used_bytes == 10 * sizeof(int) && usage.allocated_bytes == 100 * sizeof(int));
+    assert(usage.slack_bytes() == 90 * sizeof(int));
+
+    MemoryReport nested;
+    nested.add("a", {10, 20});
+    nested.add("a", {5, 5});
+    MemoryReport report;
+    report.add("b", {1, 2});
+    report.merge(nested, "x.");
+    assert(report.components.at("x.a").used_bytes == 15 && report.components.at("x.a").allocated_bytes == 25);
+    assert(report.total().used_bytes == 16 && report.total().allocated_bytes == 27);
+    std::cout << "✓ usage accounting and report merge passed" << std::endl;
+
+    DataGenConfig config;
+    config.dim = DIM;
+    config.count = 5000;
+    config.n_centers = 20;
+    DataGenerator generator(config);
+    VectorDataset dataset = generator.generate();
+    auto extra = generator.generate_queries(1000);
+
+    IVFIndex index(DIM, N_LISTS);
+    index.build(dataset);
+    MemoryReport built = index.memory_report();
+    const auto& centroids = built.components.at("centroids");
+    const auto& lists = built.components.at("inverted_lists");
+    assert(centroids.used_bytes == static_cast<size_t>(N_LISTS) * DIM * sizeof(float));
+    assert(lists.used_bytes == static_cast<size_t>(dataset.get_count()) * sizeof(idx_t));
+    assert(lists.slack_bytes() == 0);  // build按最终大小预留
+    assert(built.components.at("inverted_list_headers").used_bytes == N_LISTS * sizeof(std::vector<idx_t>));
+    MemoryUsage sum;
+    for (const auto& [name, u] : built.components) sum += u;
+    assert(built.total().used_bytes == sum.used_bytes && built.total().allocated_bytes == sum.allocated_bytes);
+    std::cout << "✓ index report totals match components" << std::endl;
+
+    // 增量插入使桶扩容留下空闲容量，shrink_to_fit归还
+    for (size_t i = 0; i < extra.size(); ++i) index.add(extra[i], dataset.get_count() + i);
+    MemoryReport grown = index.memory_report();
+    size_t slack = grown.components.at("inverted_lists").slack_bytes();
+    assert(slack > 0);
+    size_t reclaimed = index.shrink_to_fit();
+    MemoryReport shrunk = index.memory_report();
+    assert(reclaimed == slack);
+    assert(shrunk.components.at("inverted_lists").slack_bytes() == 0);
+    assert(shrunk.components.at("inverted_lists").used_bytes == grown.components.at("inverted_lists").used_bytes);
+    assert(shrunk.total().allocated_bytes + reclaimed == grown.total().allocated_bytes);
+    std::cout << "✓ shrink_to_fit reclaimed " << reclaimed << " bytes of list slack" << std::endl;
+
+    // JSON与Prometheus输出
+    json j = json::parse(serialize_memory_report(shrunk));
+    assert(j["total"]["used_bytes"].get<size_t>() == shrunk.total().used_bytes);
+    assert(j["total"]["allocated_bytes"].get<size_t>() == shrunk.total().allocated_bytes);
+    assert(j["components"]["inverted_lists"]["slack_bytes"].get<size_t>() == 0);
+    assert(j["components"]["centroids"]["used_bytes"].get<size_t>() == centroids.used_bytes);
+
+    std::string metrics = format_memory_metrics(shrunk);
+    assert(metrics.find("# TYPE minimilvus_memory_used_bytes gauge\n") == 0);
+    assert(metrics.find("# TYPE minimilvus_memory_allocated_bytes gauge\n") != std::string::npos);
+    assert(metrics.find("minimilvus_memory_used_bytes{component=\"centroids\"} " +
+                        std::to_string(centroids.used_bytes) + "\n") != std::string::npos);
+    assert(metrics.find("minimilvus_memory_allocated_bytes{component=\"inverted_lists\"} " +
+                        std::to_string(shrunk.components.at("inverted_lists").allocated_bytes) + "\n") != std::string::npos);
+    std::cout << "✓ JSON and Prometheus serialization passed" << std::endl;
+
+    std::cout << "ALL TESTS PASSED! 🚀" << std::endl;
+    return 0;
+}
@@ -0,0 +1,208 @@
+/**
+ * @file    test_opq.cpp
+ * @brief   线性代数内核与OPQ测试
+ */
+
+#include <iostream>
+#include <iomanip>
+#include <cassert>
+#include <cmath>
+#include <filesystem>
+#include <random>
+#include <set>
+#include "../src/core/index_factory.hpp"
+#include "../src/core/data_generator.hpp"
+
+using namespace minimilvus;
+
+float max_abs_diff(const Matrix& a, const Matrix& b) {
+    float d = 0;
+    for (size_t i = 0; i < a.data.size(); ++i) d = std::max(d, std::fabs(a.data[i] - b.data[i]));
+    return d;
+}
+
+Matrix random_matrix(int rows, int cols, std::mt19937& rng) {
+    std::normal_distribution<float> dist(0.0f, 1.0f);
+    Matrix m(rows, cols);
+    for (float& x : m.data) x = dist(rng);
+    return m;
+}
+
+/**
+ * @brief   编码器在数据集上的平均重构误差
+ */
+template<typename Codec>
+double distortion(const Codec& codec, const VectorDataset& dataset) {
+    std::vector<uint8_t> code(codec.code_size());
+    std::vector<float> decoded(dataset.get_dim());
+    double sum = 0;
+    for (idx_t i = 0; i < dataset.get_count(); ++i) {
+        codec.encode(dataset.get_vector(i), code.data());
+        codec.decode(code.data(), decoded.data());
+        sum += l2_distance(dataset.get_vector(i), decoded);
+    }
+    return sum / dataset.get_count();
+}
+
+int main() {
+    std::cout << "=== OPQ Test ===" << std::endl;
+    std::mt19937 rng(11);
+
+    // 分块matvec与逐元素结果一致（含非4、非8整除的尾部）
+    {
+        Matrix m = random_matrix(7, 13, rng);
+        std::vector<float> x(13), y(7);
+        for (float& v : x) v = std::normal_distribution<float>()(rng);
+        matvec(m, x.data(), y.data());
+        for (int i = 0; i < 7; ++i) {
+            float expect = 0;
+            for (int j = 0; j < 13; ++j) expect += m(i, j) * x[j];
+            assert(std::fabs(y[i] - expect) < 1e-4f);
+        }
+        Matrix a = random_matrix(5, 9, rng), b = random_matrix(9, 3, rng);
+        Matrix c = matmul(a, b);
+        for (int i = 0; i < 5; ++i) {
+            for (int j = 0; j < 3; ++j) {
+                float expect = 0;
+                for (int k = 0; k < 9; ++k) expect += a(i, k) * b(k, j);
+                assert(std::fabs(c(i, j) - expect) < 1e-4f);
+            }
+        }
+    }
+    std::cout << "✓ matvec/matmul passed" << std::endl;
+
+    // SVD：重构、正交性、奇异值降序；秩亏时U仍正交
+    {
+        Matrix m = random_matrix(8, 5, rng);
+        for (int i = 0; i < 8; ++i) m(i, 4) = m(i, 1);   // 秩为4
+        SVDResult r = svd(m);
+        Matrix us = r.U;
+        for (int i = 0; i < 8; ++i) {
+            for (int j = 0; j < 5; ++j) us(i, j) *= r.S[j];
+        }
+        assert(max_abs_diff(matmul(us, r.V.transpose()), m) < 1e-4f);
+        assert(max_abs_diff(matmul(r.U.transpose(), r.U), Matrix::identity(5)) < 1e-4f);
+        assert(max_abs_diff(matmul(r.V.transpose(), r.V), Matrix::identity(5)) < 1e-4f);
+        for (int j = 1; j < 5; ++j) assert(r.S[j] <= r.S[j - 1]);
+        assert(r.S[4] < 1e-4f);
+    }
+    std::cout << "✓ jacobi svd passed" << std::endl;
+
+    // 对称特征分解：重构、正交性、特征值降序（含奇数维和重复特征值）
+    for (int n : {1, 7, 24}) {
+        Matrix x = random_matrix(3 * n, n, rng);
+        Matrix m = crossprod(x.data.data(), n, x.data.data(), n, 3 * n);
+        if (n > 2) {
+            for (int j = 0; j < n; ++j) m(j, 0) = m(0, j) = 0.0f;
+            m(0, 0) = m(1, 1);
+        }
+        EigenResult r = symmetric_eigen(m);
+        Matrix vd = r.vectors;
+        for (int i = 0; i < n; ++i) {
+            for (int j = 0; j < n; ++j) vd(i, j) *= r.values[j];
+        }
+        float scale = std::max(1.0f, r.values[0]);
+        assert(max_abs_diff(matmul(vd, r.vectors.transpose()), m) < 1e-4f * scale);
+        assert(max_abs_diff(matmul(r.vectors.transpose(), r.vectors), Matrix::identity(n)) < 1e-4f);
+        for (int j = 1; j < n; ++j) assert(r.values[j] <= r.values[j - 1]);
+
+        // 与SVD给出的奇异值一致（半正定矩阵）
+        SVDResult sv = svd(m);
+        for (int j = 0; j < n; ++j) assert(std::fabs(sv.S[j] - r.values[j]) < 1e-3f * scale);
+    }
+    std::cout << "✓ symmetric jacobi eigen passed" << std::endl;
+
+    // Procrustes：由 X 和 Y = X Rᵀ 恢复R
+    {
+        const int d = 16, n = 500;
+        Matrix rotation = random_orthogonal(d, 5);
+        assert(max_abs_diff(matmul(rotation, rotation.transpose()), Matrix::identity(d)) < 1e-4f);
+        Matrix x = random_matrix(n, d, rng);
+        Matrix y(n, d);
+        matvec_batch(rotation, x.data.data(), y.data.data(), n);
+        Matrix recovered = orthogonal_procrustes(crossprod(y.data.data(), d, x.data.data(), d, n));
+        assert(max_abs_diff(recovered, rotation) < 1e-3f);
+    }
+    std::cout << "✓ orthogonal procrustes passed" << std::endl;
+
+    // OPQ：低秩相关数据（32维由8维隐变量线性生成，模拟embedding的维度相关性），
+    // PQ每段只看到隐变量的一部分投影，OPQ旋转后各段更独立
+    const int DIM = 32, LATENT = 8;
+    Matrix mixing = random_matrix(DIM, LATENT, rng);
+    VectorDataset dataset(DIM);
+    {
+        std::normal_distribution<float> dist(0.0f, 1.0f);
+        std::vector<float> z(LATENT), x(DIM);
+        for (int i = 0; i < 10000; ++i) {
+            for (int j = 0; j < LATENT; ++j) z[j] = dist(rng) * (LATENT - j);
+            matvec(mixing, z.data(), x.data());
+            for (float& v : x) v += 0.05f * dist(rng);
+            dataset.add(x);
+        }
+    }
+
+    {
+        PQCodec pq(DIM, 8);
+        pq.train(dataset);
+        OPQCodec opq(DIM, 8);
+        opq.train(dataset);
+        double pq_err = distortion(pq, dataset), opq_err = distortion(opq, dataset);
+        std::cout << "  distortion: PQ " << pq_err << ", OPQ " << opq_err << std::endl;
+        assert(opq_err < pq_err * 0.9);
+        const Matrix& r = opq.rotation();
+        assert(max_abs_diff(matmul(r, r.transpose()), Matrix::identity(DIM)) < 1e-3f);
+
+        // 旋转保持距离：OPQ扫描距离等于到解码向量的距离
+        std::vector<uint8_t> code(opq.code_size());
+        std::vector<float> decoded(DIM);
+        auto q = dataset.get_vector(1);
+        opq.encode(dataset.get_vector(2), code.data());
+        opq.decode(code.data(), decoded.data());
+        float scanned = opq.scanner<L2Metric>(q)(code.data());
+        assert(std::fabs(scanned - l2_distance(q, decoded)) < 1e-2f * (1.0f + scanned));
+    }
+    std::cout << "✓ opq lowers distortion passed" << std::endl;
+
+    // 索引中的OPQ：召回不低于PQ，保存加载后结果一致
+    {
+        const int K = 10;
+        std::vector<std::set<idx_t>> truth;
+        std::vector<idx_t> query_ids;
+        for (int i = 0; i < 30; ++i) query_ids.push_back(i * 300 + 7);
+        for (idx_t qid : query_ids) {
+            std::vector<SearchResult> all;
+            for (idx_t i = 0; i < dataset.get_count(); ++i) {
+                all.push_back({i, l2_distance(dataset.get_vector(qid), dataset.get_vector(i))});
+            }
+            std::partial_sort(all.begin(), all.begin() + K, all.end());
+            std::set<idx_t> ids;
+            for (int j = 0; j < K; ++j) ids.insert(all[j].id);
+            truth.push_back(ids);
+        }
+        auto eval = [&](const VectorIndex& index) {
+            int hits = 0;
+            for (size_t i = 0; i < query_ids.size(); ++i) {
+                for (const auto& r : index.search(dataset.get_vector(query_ids[i]), K, 8)) hits += truth[i].count(r.id);
+            }
+            return static_cast<double>(hits) / (query_ids.size() * K);
+        };
+        auto pq_index = index_factory(DIM, "IVF16,PQ8");
+        auto opq_index = index_factory(DIM, "IVF16,OPQ8");
+        pq_index->build(dataset);
+        opq_index->build(dataset);
+        double pq_recall = eval(*pq_index), opq_recall = eval(*opq_index);
+        std::cout << "  recall@10: PQ " << pq_recall << ", OPQ " << opq_recall << std::endl;
+        assert(opq_recall >= pq_recall);
+
+        std::string path = (std::filesystem::temp_directory_path() / "minimilvus_opq.idx").string();
+        opq_index->save(path);
+        auto loaded = load_index(path);
+        assert(loaded->description() == "IVF16,OPQ8");
+        assert(eval(*loaded) == opq_recall);
+        std::filesystem::remove(path);
+    }
+    std::cout << "✓ opq index passed" << std::endl;
+
+    std::cout << "All OPQ tests passed!" << std::endl;
+    return 0;
+}
@@ -0,0 +1,178 @@
+/**
+ * @file    test_reorder.cpp
+ * @brief   ID重排测试：BFS/RCM顺序、IVF按桶重排、HNSW节点重排，外部ID保持不变
+ */
+
+#include <iostream>
+#include <iomanip>
+#include <cassert>
+#include <filesystem>
+#include <random>
+#include "../src/core/hnsw.hpp"
+#include "../src/core/data_generator.hpp"
+
+using namespace minimilvus;
+
+/**
+ * @brief   随机打乱数据集行顺序，模拟按插入时间编号的数据
+ */
+VectorDataset shuffled(const VectorDataset& dataset, uint64_t seed) {
+    std::vector<idx_t> order(dataset.get_count());
+    std::iota(order.begin(), order.end(), 0);
+    std::shuffle(order.begin(), order.end(), std::mt19937_64(seed));
+    return permute_rows(dataset, IdPermutation(std::move(order)));
+}
+
+void assert_same_results(const std::vector<SearchResult>& a, const std::vector<SearchResult>& b) {
+    assert(a.size() == b.size());
+    for (size_t j = 0; j < a.size(); ++j) assert(a[j].id == b[j].id && a[j].distance == b[j].distance);
+}
+
+int main() {
+    std::cout << "=== Reorder Test ===" << std::endl;
+    const int DIM = 32, K = 10;
+
+    DataGenConfig config;
+    config.dim = DIM;
+    config.count = 20000;
+    config.n_centers = 50;
+    DataGenerator generator(config);
+    VectorDataset dataset = shuffled(generator.generate(), 9);
+    auto queries = generator.generate_queries(50);
+
+    // 排列：非法排列被拒绝，正反映射互逆
+    {
+        IdPermutation perm({2, 0, 1});
+        assert(perm.to_new(2) == 0 && perm.to_old(0) == 2);
+        for (idx_t i = 0; i < 3; ++i) assert(perm.to_old(perm.to_new(i)) == i);
+        for (auto bad : {std::vector<idx_t>{0, 0, 1}, std::vector<idx_t>{0, 3, 1}}) {
+            bool threw = false;
+            try {
+                IdPermutation p(bad);
+            } catch (const std::invalid_argument&) {
+                threw = true;
+            }
+            assert(threw);
+        }
+    }
+    std::cout << "✓ permutation passed" << std::endl;
+
+    // 图顺序：BFS/RCM显著缩短边的编号跨度，重编号后的图与数据集一致
+    NNDescentConfig nn_config;
+    nn_config.k = 16;
+    KnnGraph graph = nn_descent(dataset, nn_config);
+    {
+        double before = average_edge_gap(graph);
+        IdPermutation bfs = bfs_order(graph);
+        IdPermutation rcm = rcm_order(graph);
+        KnnGraph bfs_graph = permute_graph(graph, bfs);
+        KnnGraph rcm_graph = permute_graph(graph, rcm);
+        std::cout << std::setprecision(4) << "  average edge gap: original " << before << ", bfs "
+                  << average_edge_gap(bfs_graph) << ", rcm " << average_edge_gap(rcm_graph) << std::endl;
+        assert(average_edge_gap(bfs_graph) < before / 4);
+        assert(average_edge_gap(rcm_graph) < before / 4);
+
+        VectorDataset reordered = permute_rows(dataset, rcm);
+        for (idx_t i = 0; i < 100; ++i) {
+            idx_t old_id = rcm.to_old(i);
+            auto a = reordered.get_vector(i);
+            auto b = dataset.get_vector(old_id);
+            assert(std::equal(a.begin(), a.end(), b.begin()));
+            auto nbs = rcm_graph.neighbors(i);
+            auto old_nbs = graph.neighbors(old_id);
+            for (size_t j = 0; j < nbs.size(); ++j) assert(rcm.to_old(nbs[j]) == old_nbs[j]);
+        }
+    }
+    std::cout << "✓ graph orders passed" << std::endl;
+
+    // IVF按桶重排：结果（原ID与距离）不变，每个桶的行号连续；映射表随索引保存
+    {
+        IVFIndex index(DIM, 64);
+        index.set_spill_ratio(1.2f);
+        index.build(dataset);
+        index.set_graph(std::make_shared<const KnnGraph>(graph));
+        std::vector<std::vector<SearchResult>> before;
+        for (const auto& q : queries) before.push_back(index.search(q, dataset, K, 0.2f, 4));
+
+        VectorDataset reordered = index.reorder(dataset);
+        assert(index.labels().size() == static_cast<size_t>(dataset.get_count()));
+        for (size_t i = 0; i < queries.size(); ++i) {
+            assert_same_results(before[i], index.search(queries[i], reordered, K, 0.2f, 4));
+        }
+
+        // 再次重排（映射表复合）后结果仍不变；图随索引一起重编号
+        VectorDataset twice = index.reorder(reordered);
+        for (size_t i = 0; i < queries.size(); ++i) {
+            assert_same_results(before[i], index.search(queries[i], twice, K, 0.2f, 4));
+        }
+
+        std::string path = (std::filesystem::temp_directory_path() / "minimilvus_reorder.idx").string();
+        index.save(path);
+        IVFIndex loaded = IVFIndex::load(path);
+        assert(loaded.labels() == index.labels());
+        loaded.set_graph(std::make_shared<const KnnGraph>(*index.graph()));
+        for (size_t i = 0; i < queries.size(); ++i) {
+            assert_same_results(before[i], loaded.search(queries[i], twice, K, 0.2f, 4));
+        }
+
+        // 损坏的映射表长度按文件大小拒绝，而不是触发超大分配
+        {
+            // 文件末尾依次为：映射表长度、映射表、溢出比例(float)、是否溢出(u8)
+            auto tail = sizeof(int64_t) + index.labels().size() * sizeof(idx_t) + sizeof(float) + 1;
+            std::fstream file(path, std::ios::binary | std::ios::in | std::ios::out);
+            file.seekp(static_cast<std::streamoff>(std::filesystem::file_size(path) - tail));
+            int64_t huge = int64_t(1) << 40;
+            file.write(reinterpret_cast<const char*>(&huge), sizeof(huge));
+        }
+        bool threw = false;
+        try {
+            IVFIndex::load(path);
+        } catch (const std::runtime_error&) {
+            threw = true;
+        }
+        assert(threw);
+        std::filesystem::remove(path);
+    }
+    {
+        // 桶内行号连续：未开启溢出时，第一次扫描一个桶只触达一段连续的行
+        IVFIndex index(DIM, 64);
+        index.build(dataset);
+        VectorDataset reordered = index.reorder(dataset);
+        QueryProfile profile;
+        index.search(queries[0], reordered, K, 0.0f, 1, 5, &profile);
+        auto results = index.search(queries[0], reordered, K, 0.0f, 1);
+        idx_t lo = dataset.get_count(), hi = -1;
+        for (const auto& r : results) {
+            idx_t row = std::find(index.labels().begin(), index.labels().end(), r.id) - index.labels().begin();
+            lo = std::min(lo, row);
+            hi = std::max(hi, row);
+        }
+        assert(hi - lo < profile.vectors_scanned);
+    }
+    std::cout << "✓ ivf reorder passed" << std::endl;
+
+    // HNSW按第0层图的RCM顺序重排：搜索结果完全不变，边跨度缩短（启发式保留的长边使降幅小于kNN图）
+    {
+        HNSW<> index(DIM, 16, 100);
+        index.add(dataset);
+        std::vector<std::vector<SearchResult>> before;
+        for (const auto& q : queries) before.push_back(index.search(q, K, 64));
+        KnnGraph level0 = index.level0_graph();
+        IdPermutation perm = rcm_order(level0);
+        double gap_before = average_edge_gap(level0);
+        index.reorder(perm);
+        double gap_after = average_edge_gap(index.level0_graph());
+        std::cout << "  hnsw level0 edge gap: " << gap_before << " -> " << gap_after << std::endl;
+        assert(gap_after < gap_before * 0.75);
+        for (size_t i = 0; i < queries.size(); ++i) assert_same_results(before[i], index.search(queries[i], K, 64));
+
+        auto vec = dataset.get_vector(perm.to_old(0));
+        assert(std::equal(vec.begin(), vec.end(), index.node_vector(0)));
+        index.add(dataset.get_vector(0), dataset.get_count());
+        assert(index.size() == static_cast<size_t>(dataset.get_count()) + 1);
+    }
+    std::cout << "✓ hnsw reorder passed" << std::endl;
+
+    std::cout << "All reorder tests passed!" << std::endl;
+    return 0;
+}
@@ -1,29 +1,106 @@
 /**
  * @file    test_thread_pool.cpp
- * @brief   线程池测试
+ * @brief   线程池测试与任务队列基准
  */
 
 #include <iostream>
+#include <iomanip>
 #include <vector>
+#include <queue>
+#include <mutex>
+#include <condition_variable>
 #include <chrono>
 #include <future>
-#include "../src/core/utils/thread_pool.hpp"
+#include <cassert>
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include "../src/core/thread_pool.hpp"
+#include "../src/core/mpmc_queue.hpp"
 
 void print_hello(int id) {
     std::cout << "Thread " << id << " says hello!" << std::endl;
     std::this_thread::sleep_for(std::chrono::milliseconds(100));
 }
 
+/**
+ * @brief   原线程池使用的队列：std::queue + mutex + condition_variable，每次push都notify_one
+ */
+template<typename T>
+class MutexQueue {
+public:
+    void push(T value) {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            queue_.push(std::move(value));
+        }
+        cv_.notify_one();
+    }
+
+    bool pop(T& out) {
+        std::unique_lock<std::mutex> lock(mutex_);
+        cv_.wait(lock, [this] { return closed_ || !queue_.empty(); });
+        if (queue_.empty()) return false;
+        out = std::move(queue_.front());
+        queue_.pop();
+        return true;
+    }
+
+    void close() {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            closed_ = true;
+        }
+        cv_.notify_all();
+    }
+
+private:
+    std::queue<T> queue_;
+    std::mutex mutex_;
+    std::condition_variable cv_;
+    bool closed_ = false;
+};
+
+/**
+ * @brief   多生产者多消费者传递整数，返回每秒传递数并校验总和
+ */
+template<typename Queue>
+double transfer_rate(Queue& queue, int producers, int consumers, int64_t per_producer) {
+    std::atomic<int64_t> sum{0};
+    auto start = std::chrono::steady_clock::now();
+    std::vector<std::thread> threads;
+    for (int c = 0; c < consumers; ++c) {
+        threads.emplace_back([&] {
+            int64_t value, local = 0;
+            while (queue.pop(value)) local += value;
+            sum += local;
+        });
+    }
+    std::vector<std::thread> producer_threads;
+    for (int p = 0; p < producers; ++p) {
+        producer_threads.emplace_back([&] {
+            for (int64_t i = 1; i <= per_producer; ++i) queue.push(i);
+        });
+    }
+    for (auto& t : producer_threads) t.join();
+    queue.close();
+    for (auto& t : threads) t.join();
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    assert(sum == producers * per_producer * (per_producer + 1) / 2);
+    return producers * per_producer / seconds;
+}
+
 int main() {
     std::cout << "=== ThreadPool Test ===" << std::endl;
-    
+
     // 创建线程池（4个线程）
     minimilvus::ThreadPool pool(4);
     std::cout << "Created pool with " << pool.num_threads() << " threads" << std::endl;
-    
+
     // 提交8个任务（线程只有4个，所以会并行执行）
     std::vector<std::future<void>> futures;
-    
+
     for (int i = 0; i < 8; ++i) {
         // 使用 lambda 捕获 i
         auto fut = pool.submit([i]() {
@@ -31,16 +108,201 @@ int main() {
         });
         futures.push_back(std::move(fut));
     }
-    
+
     std::cout << "Submitted 8 tasks" << std::endl;
-    
+
     // 等待所有任务完成
     // get() 会阻塞直到任务完成
     for (auto& fut : futures) {
         fut.get();
     }
-    
+
     std::cout << "All tasks completed!" << std::endl;
-    
+
+    // 有界队列：容量小于任务数时提交方等待空位，结果仍然完整
+    {
+        minimilvus::ThreadPool small(2, 8);
+        std::atomic<int> done{0};
+        for (int i = 0; i < 1000; ++i) small.post([&] { done++; });
+        while (done < 1000) std::this_thread::yield();
+    }
+    std::cout << "✓ bounded queue backpressure passed" << std::endl;
+
+    // 绑核：CPU列表解析、角色划分，以及工作线程按方案绑定
+    {
+        assert((minimilvus::parse_cpu_list("0-2, 5,3") == std::vector<int>{0, 1, 2, 3, 5}));
+        bool threw = false;
+        try { minimilvus::parse_cpu_list("3-1"); } catch (const std::invalid_argument&) { threw = true; }
+        assert(threw);
+
+        auto layout = minimilvus::CoreLayout::parse("io=0;search=1-6;background=7");
+        assert(layout.io == std::vector<int>{0});
+        assert(layout.search.size() == 6 && layout.background == std::vector<int>{7});
+        auto split = minimilvus::CoreLayout::split({0, 1, 2, 3, 4, 5, 6, 7}, 1, 2);
+        assert(split.io == std::vector<int>{0});
+        assert((split.search == std::vector<int>{1, 2, 3, 4, 5}));
+        assert((split.background == std::vector<int>{6, 7}));
+
+        std::vector<int> cpus = minimilvus::available_cpus();
+        auto plan = minimilvus::AffinityPlan::per_core(cpus);
+        minimilvus::ThreadPool pinned(static_cast<int>(cpus.size()) + 1, 64, plan);
+        std::vector<std::future<std::vector<int>>> masks;
+        for (int i = 0; i < pinned.num_threads() * 4; ++i) {
+            masks.push_back(pinned.submit([] { return minimilvus::current_thread_affinity(); }));
+        }
+        for (auto& mask : masks) {
+            auto cpus_of_worker = mask.get();
+            assert(cpus_of_worker.size() == 1);
+            assert(std::binary_search(cpus.begin(), cpus.end(), cpus_of_worker[0]));
+        }
+        // 缩容后再扩容：新线程复用空出的槽位，所有核仍各有一个线程
+        if (cpus.size() >= 2) {
+            const int n = static_cast<int>(cpus.size());
+            minimilvus::ThreadPool regrown(n, 64, plan);
+            regrown.resize(n - 1);
+            // 退出令牌排在其后的任务之前：该任务完成时多余线程已领到令牌
+            regrown.submit([] {}).get();
+            std::this_thread::sleep_for(std::chrono::milliseconds(20));
+            regrown.resize(n);
+            std::atomic<int> arrived{0};
+            std::vector<std::future<int>> owners;
+            for (int i = 0; i < n; ++i) {
+                owners.push_back(regrown.submit([&arrived, n] {
+                    arrived++;
+                    while (arrived < n) std::this_thread::yield();
+                    return minimilvus::current_thread_affinity()[0];
+                }));
+            }
+            std::vector<int> owned;
+            for (auto& f : owners) owned.push_back(f.get());
+            std::sort(owned.begin(), owned.end());
+            assert(owned == cpus);
+        }
+        std::cout << "  " << minimilvus::numa_nodes().size() << " NUMA node(s), "
+                  << cpus.size() << " CPU(s) available" << std::endl;
+    }
+    std::cout << "✓ worker pinning passed" << std::endl;
+
+    // cgroup配额：v2的cpu.max与v1的cfs_quota_us
+    {
+        namespace fs = std::filesystem;
+        fs::path root = fs::temp_directory_path() / "minimilvus_cgroup_test";
+        fs::remove_all(root);
+        fs::create_directories(root / "cpu");
+        std::ofstream(root / "cpu" / "cpu.cfs_quota_us") << "-1\n";
+        std::ofstream(root / "cpu" / "cpu.cfs_period_us") << "100000\n";
+        assert(minimilvus::cgroup_cpu_limit(root) == 0.0);
+        std::ofstream(root / "cpu" / "cpu.cfs_quota_us") << "150000\n";
+        assert(minimilvus::cgroup_cpu_limit(root) == 1.5);
+        std::ofstream(root / "cpu.max") << "max 100000\n";
+        assert(minimilvus::cgroup_cpu_limit(root) == 0.0);
+        std::ofstream(root / "cpu.max") << "250000 100000\n";
+        assert(minimilvus::cgroup_cpu_limit(root) == 2.5);
+
+        // 进程位于子cgroup时读取自己所在目录的配额，并取各级中最严格的一个
+        fs::create_directories(root / "kubepods" / "pod1");
+        std::ofstream(root / "kubepods" / "cpu.max") << "400000 100000\n";
+        std::ofstream(root / "kubepods" / "pod1" / "cpu.max") << "max 100000\n";
+        std::ofstream(root / "self_cgroup") << "0::/kubepods/pod1\n";
+        assert(minimilvus::cgroup_cpu_limit(root, root / "self_cgroup") == 2.5);
+        fs::remove(root / "cpu.max");
+        assert(minimilvus::cgroup_cpu_limit(root, root / "self_cgroup") == 4.0);
+        std::ofstream(root / "kubepods" / "pod1" / "cpu.max") << "50000 100000\n";
+        assert(minimilvus::cgroup_cpu_limit(root, root / "self_cgroup") == 0.5);
+        // cgroup v1：按cpu控制器所在的行定位
+        fs::remove_all(root / "kubepods");
+        fs::create_directories(root / "cpu" / "job");
+        std::ofstream(root / "cpu" / "job" / "cpu.cfs_quota_us") << "300000\n";
+        std::ofstream(root / "cpu" / "job" / "cpu.cfs_period_us") << "100000\n";
+        std::ofstream(root / "self_cgroup") << "4:memory:/other\n3:cpu,cpuacct:/job\n";
+        assert(minimilvus::cgroup_cpu_limit(root, root / "self_cgroup") == 1.5);
+        std::ofstream(root / "cpu" / "cpu.cfs_quota_us") << "-1\n";
+        assert(minimilvus::cgroup_cpu_limit(root, root / "self_cgroup") == 3.0);
+        fs::remove_all(root);
+
+        int effective = minimilvus::effective_cpu_count();
+        assert(effective >= 1 && effective <= static_cast<int>(minimilvus::available_cpus().size()));
+        minimilvus::ThreadPool default_pool;
+        assert(default_pool.num_threads() == effective);
+        std::cout << "  effective CPUs: " << effective << std::endl;
+    }
+    std::cout << "✓ cgroup quota detection passed" << std::endl;
+
+    // 运行时扩缩容：任务不丢失，指标反映队列深度与利用率
+    {
+        minimilvus::ThreadPool elastic(2);
+        std::atomic<int> done{0};
+        std::atomic<bool> release{false};
+        for (int i = 0; i < 2; ++i) elastic.post([&] { while (!release) std::this_thread::yield(); done++; });
+        for (int i = 0; i < 100; ++i) elastic.post([&] { done++; });
+        while (elastic.stats().busy_threads < 2) std::this_thread::yield();
+        auto blocked = elastic.stats();
+        assert(blocked.queue_depth == 100 && blocked.busy_threads == 2);
+
+        elastic.resize(6);
+        assert(elastic.num_threads() == 6);
+        while (done < 100) std::this_thread::yield();
+        release = true;
+        while (done < 102) std::this_thread::yield();
+
+        elastic.resize(1);
+        assert(elastic.num_threads() == 1);
+        for (int i = 0; i < 100; ++i) elastic.post([&] { done++; });
+        while (done < 202) std::this_thread::yield();
+        elastic.resize(3);
+        auto futures_after = elastic.submit([] { return 7; });
+        assert(futures_after.get() == 7);
+
+        elastic.stats();
+        for (int i = 0; i < 3; ++i) {
+            elastic.post([] { std::this_thread::sleep_for(std::chrono::milliseconds(50)); });
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+        auto s = elastic.stats();
+        assert(s.tasks_completed == 206);
+        assert(s.utilization > 0.2 && s.utilization <= 1.0);
+        std::cout << "  utilization over last sample: " << std::setprecision(2) << s.utilization << std::endl;
+    }
+    std::cout << "✓ live resize and metrics passed" << std::endl;
+
+    // post的任务抛出异常：计入失败数，工作线程继续运行
+    {
+        minimilvus::ThreadPool pool(1);
+        pool.post([] { throw std::runtime_error("task failed"); });
+        auto after = pool.submit([] { return 1; });
+        assert(after.get() == 1);
+        assert(pool.stats().tasks_failed == 1);
+    }
+    std::cout << "✓ throwing post task passed" << std::endl;
+
+    // 基准：互斥锁队列 vs 无锁MPMC队列
+    std::cout << "\n=== Queue Benchmark (items/s) ===" << std::endl;
+    const int64_t per_producer = 200000;
+    std::cout << std::left << std::setw(10) << "P x C" << std::setw(16) << "mutex+cv"
+              << std::setw(16) << "MPMC" << "speedup" << std::endl;
+    for (auto [producers, consumers] : {std::pair{1, 1}, std::pair{2, 2}, std::pair{4, 4}}) {
+        MutexQueue<int64_t> mutex_queue;
+        minimilvus::BlockingMPMCQueue<int64_t> mpmc_queue(1 << 14);
+        double mutex_rate = transfer_rate(mutex_queue, producers, consumers, per_producer);
+        double mpmc_rate = transfer_rate(mpmc_queue, producers, consumers, per_producer);
+        std::cout << std::setw(10) << (std::to_string(producers) + "x" + std::to_string(consumers))
+                  << std::setw(16) << std::fixed << std::setprecision(0) << mutex_rate
+                  << std::setw(16) << mpmc_rate
+                  << std::setprecision(2) << mpmc_rate / mutex_rate << "x" << std::endl;
+    }
+
+    // 基准：线程池小任务吞吐
+    {
+        const int n_tasks = 200000;
+        minimilvus::ThreadPool bench_pool(4);
+        std::atomic<int> done{0};
+        auto start = std::chrono::steady_clock::now();
+        for (int i = 0; i < n_tasks; ++i) bench_pool.post([&] { done.fetch_add(1, std::memory_order_relaxed); });
+        while (done < n_tasks) std::this_thread::yield();
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        std::cout << "ThreadPool post throughput: " << std::setprecision(0) << n_tasks / seconds
+                  << " tasks/s" << std::endl;
+    }
+
     return 0;
-}
\ No newline at end of file
+}
@@ -0,0 +1,150 @@
+/**
+ * @file    test_tiered_ivf.cpp
+ * @brief   冷热分层IVF与桶访问统计测试
+ */
+
+#include <iostream>
+#include <cassert>
+#include <filesystem>
+#include <random>
+#include <thread>
+#include "../src/core/tiered_ivf.hpp"
+#include "../src/core/data_generator.hpp"
+
+using namespace minimilvus;
+
+/**
+ * @brief   在若干种子向量附近生成倾斜分布的查询
+ */
+std::vector<std::vector<float>> skewed_queries(const VectorDataset& dataset, const std::vector<idx_t>& seeds,
+                                               int count, std::mt19937& rng) {
+    std::normal_distribution<float> noise(0.0f, 0.05f);
+    std::vector<std::vector<float>> queries;
+    for (int i = 0; i < count; ++i) {
+        auto base = dataset.get_vector(seeds[i % seeds.size()]);
+        std::vector<float> q(base.begin(), base.end());
+        for (float& x : q) x += noise(rng);
+        queries.push_back(std::move(q));
+    }
+    return queries;
+}
+
+int main() {
+    std::cout << "=== Tiered IVF Test ===" << std::endl;
+    const int DIM = 32, N_LISTS = 64, K = 10, NPROBE = 2;
+    const std::string dir = (std::filesystem::temp_directory_path() / "minimilvus_tiered").string();
+    std::filesystem::remove_all(dir);
+    std::filesystem::create_directories(dir);
+
+    DataGenConfig config;
+    config.dim = DIM;
+    config.count = 20000;
+    config.n_centers = 50;
+    DataGenerator generator(config);
+    VectorDataset dataset = generator.generate();
+    const std::string vectors_path = dir + "/vectors.mmvd";
+    dataset.save(vectors_path);
+    std::mt19937 rng(5);
+
+    // IVFIndex记录每个桶的探测次数
+    {
+        IVFIndex index(DIM, N_LISTS);
+        index.build(dataset);
+        QueryProfile profile;
+        for (int i = 0; i < 20; ++i) index.search(dataset.get_vector(i * 13), dataset, K, 0.2f, 5, 5, &profile);
+        uint64_t total = 0;
+        for (uint64_t c : index.access_stats().counts()) total += c;
+        assert(total == static_cast<uint64_t>(profile.buckets_probed));
+    }
+    std::cout << "✓ ivf access counts passed" << std::endl;
+
+    // 衰减：旧访问按系数衰减，新访问全额计入
+    {
+        ListAccessTracker tracker(3);
+        for (int i = 0; i < 8; ++i) tracker.record(0);
+        tracker.decay(0.5);
+        for (int i = 0; i < 2; ++i) tracker.record(1);
+        const auto& scores = tracker.decay(0.5);
+        assert(scores[0] == 4.0 && scores[1] == 2.0 && scores[2] == 0.0);
+        assert(tracker.count(0) == 8 && tracker.count(1) == 2);
+    }
+    std::cout << "✓ access tracker decay passed" << std::endl;
+
+    const size_t raw_bytes = dataset.get_count() * DIM * sizeof(float);
+    TieredConfig tiered_config;
+    tiered_config.hot_budget_bytes = raw_bytes / 8;
+    TieredIVF<> index(DIM, N_LISTS, vectors_path, tiered_config);
+    index.build(dataset);
+    assert(index.stats().hot_lists == 0 && index.size() == static_cast<size_t>(dataset.get_count()));
+
+    // 倾斜查询后重平衡：被查询的桶晋升为热桶，热层不超预算，热桶结果为精确距离
+    std::vector<idx_t> seeds_a = {11, 4021, 9033};
+    auto queries_a = skewed_queries(dataset, seeds_a, 90, rng);
+    for (const auto& q : queries_a) index.search(q, K, NPROBE);
+    assert(index.rebalance() > 0);
+    TierStats stats = index.stats();
+    std::cout << "  hot lists " << stats.hot_lists << ", hot bytes " << stats.hot_bytes
+              << " / " << stats.budget_bytes << std::endl;
+    assert(stats.hot_lists > 0 && stats.hot_bytes <= stats.budget_bytes);
+    for (idx_t seed : seeds_a) assert(index.is_hot(index.assign(dataset.get_vector(seed))));
+    for (const auto& q : queries_a) {
+        for (const auto& r : index.search(q, K, NPROBE)) {
+            if (index.is_hot(index.assign(dataset.get_vector(r.id)))) {
+                assert(r.distance == l2_distance(q, dataset.get_vector(r.id)));
+            }
+        }
+    }
+    std::cout << "✓ promotion under budget passed" << std::endl;
+
+    // 查询分布迁移：预算只够当前热集时，几轮重平衡后新热点晋升，旧热点降级
+    index.set_hot_budget(stats.hot_bytes);
+    std::vector<idx_t> seeds_b = {2500, 15077};
+    auto queries_b = skewed_queries(dataset, seeds_b, 90, rng);
+    for (int round = 0; round < 4; ++round) {
+        for (const auto& q : queries_b) index.search(q, K, NPROBE);
+        index.rebalance();
+    }
+    stats = index.stats();
+    std::cout << "  hot lists " << stats.hot_lists << ", hot bytes " << stats.hot_bytes
+              << " / " << stats.budget_bytes << std::endl;
+    for (idx_t seed : seeds_b) assert(index.is_hot(index.assign(dataset.get_vector(seed))));
+    assert(stats.demotions > 0 && stats.hot_bytes <= stats.budget_bytes);
+    std::cout << "  promotions " << stats.promotions << ", demotions " << stats.demotions << std::endl;
+    std::cout << "✓ shifting hot set passed" << std::endl;
+
+    // 预算为0时全部降级；内存报告只在热层保留全精度向量
+    {
+        index.set_hot_budget(0);
+        index.search(queries_b[0], K, NPROBE);
+        index.rebalance();
+        assert(index.stats().hot_lists == 0);
+        assert(index.memory_report().total().used_bytes < raw_bytes / 2);
+    }
+    std::cout << "✓ demotion passed" << std::endl;
+
+    // 按查询次数自动重平衡，与并发查询共存
+    {
+        TieredConfig auto_config;
+        auto_config.hot_budget_bytes = raw_bytes / 8;
+        auto_config.rebalance_interval = 25;
+        TieredIVF<> auto_index(DIM, N_LISTS, vectors_path, auto_config);
+        auto_index.build(dataset);
+        std::vector<std::thread> threads;
+        for (int t = 0; t < 4; ++t) {
+            threads.emplace_back([&, t] {
+                for (int i = 0; i < 25; ++i) auto_index.search(queries_a[(t * 25 + i) % queries_a.size()], K, NPROBE);
+            });
+        }
+        for (auto& t : threads) t.join();
+        // 查询只唤醒维护线程；执行期间到来的请求被合并
+        auto_index.wait_for_maintenance();
+        TierStats s = auto_index.stats();
+        assert(s.rebalances >= 1 && s.rebalances <= 4);
+        assert(s.hot_lists > 0 && s.hot_bytes <= s.budget_bytes);
+    }
+    std::cout << "✓ automatic rebalance passed" << std::endl;
+
+    std::filesystem::remove_all(dir);
+    std::cout << "All tiered IVF tests passed!" << std::endl;
+    return 0;
+}
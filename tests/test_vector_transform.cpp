@@ -0,0 +1,169 @@
+/**
+ * @file    test_vector_transform.cpp
+ * @brief   预处理变换（随机旋转、PCA、白化）与带变换的索引测试
+ */
+
+#include <iostream>
+#include <iomanip>
+#include <cassert>
+#include <cmath>
+#include <filesystem>
+#include <random>
+#include <set>
+#include "../src/core/index_factory.hpp"
+
+using namespace minimilvus;
+
+/**
+ * @brief   低秩数据：dim维由latent维隐变量线性生成，加少量各向同性噪声
+ */
+VectorDataset low_rank_dataset(int dim, int latent, idx_t count, std::mt19937& rng) {
+    std::normal_distribution<float> dist(0.0f, 1.0f);
+    Matrix mixing(dim, latent);
+    for (float& x : mixing.data) x = dist(rng);
+    VectorDataset dataset(dim);
+    std::vector<float> z(latent), x(dim);
+    for (idx_t i = 0; i < count; ++i) {
+        for (int j = 0; j < latent; ++j) z[j] = dist(rng) * (1.0f + 0.2f * (latent - j));
+        matvec(mixing, z.data(), x.data());
+        for (float& v : x) v += 3.0f + 0.02f * dist(rng);
+        dataset.add(x);
+    }
+    return dataset;
+}
+
+int main() {
+    std::cout << "=== Vector Transform Test ===" << std::endl;
+    std::mt19937 rng(3);
+    const int DIM = 64, LATENT = 16, K = 10;
+    VectorDataset dataset = low_rank_dataset(DIM, LATENT, 20000, rng);
+
+    // 随机旋转保持距离
+    {
+        VectorTransform rr = VectorTransform::random_rotation(DIM, 7);
+        rr.train(dataset);
+        auto a = rr.apply(dataset.get_vector(0));
+        auto b = rr.apply(dataset.get_vector(1));
+        float before = l2_distance(dataset.get_vector(0), dataset.get_vector(1));
+        assert(std::fabs(l2_distance(a, b) - before) < 1e-3f * before);
+        assert(rr.name() == "RR" && rr.out_dim() == DIM);
+    }
+    std::cout << "✓ random rotation preserves distances passed" << std::endl;
+
+    // PCA：特征值降序，保留方差集中在前LATENT维，投影后各维去相关
+    {
+        VectorTransform pca = VectorTransform::pca(DIM, LATENT);
+        pca.train(dataset);
+        assert(pca.name() == "PCA16");
+        const auto& eig = pca.eigenvalues();
+        for (size_t i = 1; i < eig.size(); ++i) assert(eig[i] <= eig[i - 1] + 1e-3f);
+        std::cout << "  explained variance ratio: " << pca.explained_variance_ratio() << std::endl;
+        assert(pca.explained_variance_ratio() > 0.999);
+
+        VectorDataset reduced = pca.apply(dataset);
+        assert(reduced.get_dim() == LATENT && reduced.get_count() == dataset.get_count());
+        Matrix cov = crossprod(reduced.get_vector(0).data(), LATENT, reduced.get_vector(0).data(), LATENT,
+                               reduced.get_count());
+        for (int i = 0; i < LATENT; ++i) {
+            for (int j = 0; j < LATENT; ++j) {
+                float c = cov(i, j) / reduced.get_count();
+                if (i == j) assert(std::fabs(c - eig[i]) < 0.02f * eig[i]);
+                else assert(std::fabs(c) < 0.02f * eig[0]);
+            }
+        }
+
+        // 低秩数据上降维几乎不改变距离
+        float before = l2_distance(dataset.get_vector(3), dataset.get_vector(4));
+        float after = l2_distance(reduced.get_vector(3), reduced.get_vector(4));
+        assert(std::fabs(after - before) < 0.01f * before);
+    }
+    std::cout << "✓ pca passed" << std::endl;
+
+    // 白化：各维方差为1
+    {
+        VectorTransform pcaw = VectorTransform::pca(DIM, 8, true);
+        pcaw.train(dataset);
+        assert(pcaw.name() == "PCAW8");
+        VectorDataset white = pcaw.apply(dataset);
+        for (int j = 0; j < 8; ++j) {
+            double var = 0;
+            for (idx_t i = 0; i < white.get_count(); ++i) var += white.get_vector(i)[j] * white.get_vector(i)[j];
+            assert(std::fabs(var / white.get_count() - 1.0) < 0.02);
+        }
+    }
+    std::cout << "✓ whitening passed" << std::endl;
+
+    // 带变换的索引：PCA降维后召回接近原始维度，编码更小；保存加载后结果一致
+    {
+        std::vector<idx_t> query_ids;
+        for (int i = 0; i < 40; ++i) query_ids.push_back(i * 500 + 11);
+        std::vector<std::set<idx_t>> truth;
+        for (idx_t qid : query_ids) {
+            std::vector<SearchResult> all;
+            for (idx_t i = 0; i < dataset.get_count(); ++i) {
+                all.push_back({i, l2_distance(dataset.get_vector(qid), dataset.get_vector(i))});
+            }
+            std::partial_sort(all.begin(), all.begin() + K, all.end());
+            std::set<idx_t> ids;
+            for (int j = 0; j < K; ++j) ids.insert(all[j].id);
+            truth.push_back(ids);
+        }
+        auto eval = [&](const VectorIndex& index) {
+            int hits = 0;
+            for (size_t i = 0; i < query_ids.size(); ++i) {
+                for (const auto& r : index.search(dataset.get_vector(query_ids[i]), K, 8)) hits += truth[i].count(r.id);
+            }
+            return static_cast<double>(hits) / (query_ids.size() * K);
+        };
+
+        std::cout << std::left << std::setw(24) << "description" << std::setw(10) << "recall" << "bytes/vec" << std::endl;
+        double full_recall = 0, full_bytes = 0;
+        for (const char* desc : {"IVF32,Flat", "PCA16,IVF32,Flat", "PCAR16,IVF32,SQ8", "RR,IVF32,PQ16"}) {
+            auto index = index_factory(DIM, desc);
+            index->build(dataset);
+            assert(index->description() == desc && index->get_dim() == DIM);
+            double r = eval(*index);
+            double bytes = static_cast<double>(index->memory_report().total().used_bytes) / index->size();
+            std::cout << std::setw(24) << desc << std::setw(10) << std::setprecision(3) << r
+                      << std::setprecision(4) << bytes << std::endl;
+            if (std::string(desc) == "IVF32,Flat") {
+                full_recall = r;
+                full_bytes = bytes;
+            } else if (std::string(desc) == "PCA16,IVF32,Flat") {
+                assert(r > full_recall - 0.05);
+                assert(bytes < full_bytes * 0.5);
+            }
+        }
+
+        std::string path = (std::filesystem::temp_directory_path() / "minimilvus_transform.idx").string();
+        auto index = index_factory(DIM, "PCAW16,IVF32,SQ8,Paged");
+        index->build(dataset);
+        index->save(path);
+        auto loaded = load_index(path);
+        assert(loaded->description() == "PCAW16,IVF32,SQ8,Paged" && loaded->size() == index->size());
+        for (idx_t qid : query_ids) {
+            auto a = index->search(dataset.get_vector(qid), K, 8);
+            auto b = loaded->search(dataset.get_vector(qid), K, 8);
+            assert(a.size() == b.size());
+            for (size_t j = 0; j < a.size(); ++j) assert(a[j].id == b[j].id && a[j].distance == b[j].distance);
+        }
+        std::filesystem::remove(path);
+    }
+    std::cout << "✓ transformed index passed" << std::endl;
+
+    // 非法描述串
+    for (const char* bad : {"PCA0,IVF16,Flat", "PCA128,IVF16,Flat", "PCAQ16,IVF16,Flat", "ZCA16,IVF16,Flat",
+                            "PCA16", "RR,RR,IVF16,Flat"}) {
+        bool threw = false;
+        try {
+            index_factory(DIM, bad);
+        } catch (const std::invalid_argument&) {
+            threw = true;
+        }
+        assert(threw);
+    }
+    std::cout << "✓ description validation passed" << std::endl;
+
+    std::cout << "All vector transform tests passed!" << std::endl;
+    return 0;
+}